@@ -24,6 +24,11 @@
 
 #include <base/configurable.h>
 
+#include <algorithm>
+#include <stdexcept>
+#include <format>
+#include <string>
+
 bool clox::base::runtime_configurable_configuration::dump_ast()
 {
 	return dump_ast_;
@@ -34,8 +39,273 @@ bool clox::base::runtime_configurable_configuration::dump_assembly()
 	return dump_assembly_;
 }
 
+bool clox::base::runtime_configurable_configuration::bytecode_cache()
+{
+	return bytecode_cache_;
+}
+
+bool clox::base::runtime_configurable_configuration::optimize()
+{
+	return optimize_;
+}
+
+void clox::base::runtime_configurable_configuration::set_optimize(bool optimize)
+{
+	optimize_ = optimize;
+}
+
+size_t clox::base::runtime_configurable_configuration::memory_limit()
+{
+	return memory_limit_;
+}
+
+void clox::base::runtime_configurable_configuration::set_memory_limit(size_t limit)
+{
+	memory_limit_ = limit;
+}
+
+bool clox::base::runtime_configurable_configuration::jit()
+{
+	return jit_;
+}
+
+size_t clox::base::runtime_configurable_configuration::jit_threshold()
+{
+	return jit_threshold_;
+}
+
+void clox::base::runtime_configurable_configuration::set_jit(bool jit)
+{
+	jit_ = jit;
+}
+
+void clox::base::runtime_configurable_configuration::set_jit_threshold(size_t threshold)
+{
+	jit_threshold_ = threshold;
+}
+
+size_t clox::base::runtime_configurable_configuration::osr_threshold()
+{
+	return osr_threshold_;
+}
+
+bool clox::base::runtime_configurable_configuration::jit_background()
+{
+	return jit_background_;
+}
+
+bool clox::base::runtime_configurable_configuration::show_tiering()
+{
+	return show_tiering_;
+}
+
+void clox::base::runtime_configurable_configuration::set_show_tiering(bool show)
+{
+	show_tiering_ = show;
+}
+
+void clox::base::runtime_configurable_configuration::set_osr_threshold(size_t threshold)
+{
+	osr_threshold_ = threshold;
+}
+
+void clox::base::runtime_configurable_configuration::set_jit_background(bool background)
+{
+	jit_background_ = background;
+}
+
+bool clox::base::runtime_configurable_configuration::aot()
+{
+	return aot_;
+}
+
+void clox::base::runtime_configurable_configuration::set_aot(bool aot)
+{
+	aot_ = aot;
+}
+
+bool clox::base::runtime_configurable_configuration::time_statistic()
+{
+	return time_statistic_;
+}
+
+bool clox::base::runtime_configurable_configuration::time_statistic_json()
+{
+	return time_statistic_json_;
+}
+
+bool clox::base::runtime_configurable_configuration::profile()
+{
+	return profile_;
+}
+
+std::string clox::base::runtime_configurable_configuration::profile_output()
+{
+	return profile_output_;
+}
+
+void clox::base::runtime_configurable_configuration::set_profile_output(bool profile, const std::string& path)
+{
+	profile_ = profile || !path.empty();
+	profile_output_ = path;
+}
+
+std::string clox::base::runtime_configurable_configuration::sample_output()
+{
+	return sample_output_;
+}
+
+size_t clox::base::runtime_configurable_configuration::sample_frequency()
+{
+	return sample_frequency_;
+}
+
+std::string clox::base::runtime_configurable_configuration::trace_output()
+{
+	return trace_output_;
+}
+
+size_t clox::base::runtime_configurable_configuration::trace_threshold()
+{
+	return trace_threshold_;
+}
+
+bool clox::base::runtime_configurable_configuration::heap_census()
+{
+	return heap_census_;
+}
+
+std::string clox::base::runtime_configurable_configuration::heap_dump_output()
+{
+	return heap_dump_output_;
+}
+
+bool clox::base::runtime_configurable_configuration::allocation_profile()
+{
+	return allocation_profile_;
+}
+
+size_t clox::base::runtime_configurable_configuration::allocation_sample_interval()
+{
+	return allocation_sample_interval_;
+}
+
+void clox::base::runtime_configurable_configuration::set_allocation_profile(bool profile, size_t interval)
+{
+	allocation_profile_ = profile;
+	allocation_sample_interval_ = std::max<size_t>(interval, 1);
+}
+
+bool clox::base::runtime_configurable_configuration::perf_counters()
+{
+	return perf_counters_;
+}
+
+bool clox::base::runtime_configurable_configuration::perf_counters_by_function()
+{
+	return perf_counters_by_function_;
+}
+
+void clox::base::runtime_configurable_configuration::set_perf_counters(bool perf_counters, bool by_function)
+{
+	perf_counters_by_function_ = by_function;
+	perf_counters_ = perf_counters || by_function;
+}
+
+bool clox::base::runtime_configurable_configuration::count_instructions()
+{
+	return count_instructions_;
+}
+
 void clox::base::runtime_configurable_configuration::load_arguments(const argparse::ArgumentParser& arg_parser)
 {
 	dump_ast_ = arg_parser.get<bool>("--show-ast");
 	dump_assembly_ = arg_parser.get<bool>("--show-assembly");
+	bytecode_cache_ = arg_parser.get<bool>("--bytecode-cache");
+	optimize_ = !arg_parser.get<bool>("--no-optimize");
+	memory_limit_ = parse_memory_size("--memory-limit", arg_parser.get<std::string>("--memory-limit"));
+	jit_ = arg_parser.get<bool>("--jit");
+	jit_threshold_ = parse_count("--jit-threshold", arg_parser.get<std::string>("--jit-threshold"));
+	osr_threshold_ = parse_count("--osr-threshold", arg_parser.get<std::string>("--osr-threshold"));
+	jit_background_ = arg_parser.get<bool>("--jit-background");
+	show_tiering_ = arg_parser.get<bool>("--show-tiering");
+	aot_ = arg_parser.get<bool>("--aot");
+	time_statistic_json_ = arg_parser.get<bool>("--time-statistic-json");
+	time_statistic_ = arg_parser.get<bool>("--time-statistic") || time_statistic_json_;
+	profile_output_ = arg_parser.get<std::string>("--profile-output");
+	profile_ = arg_parser.get<bool>("--profile") || !profile_output_.empty();
+	sample_output_ = arg_parser.get<std::string>("--sample");
+	sample_frequency_ = parse_count("--sample-frequency", arg_parser.get<std::string>("--sample-frequency"));
+	trace_output_ = arg_parser.get<std::string>("--trace");
+	trace_threshold_ = parse_count("--trace-threshold", arg_parser.get<std::string>("--trace-threshold"));
+	heap_census_ = arg_parser.get<bool>("--heap-census");
+	heap_dump_output_ = arg_parser.get<std::string>("--heap-dump");
+	allocation_profile_ = arg_parser.get<bool>("--alloc-profile");
+	perf_counters_by_function_ = arg_parser.get<bool>("--perf-counters-by-function");
+	perf_counters_ = arg_parser.get<bool>("--perf-counters") || perf_counters_by_function_;
+	allocation_sample_interval_ = std::max<size_t>(
+			parse_memory_size("--alloc-sample-interval", arg_parser.get<std::string>("--alloc-sample-interval")), 1);
+
+	// counts are only deterministic if every instruction goes through the interpreter loop
+	count_instructions_ = arg_parser.get<bool>("--count-instructions");
+	if (count_instructions_)
+	{
+		jit_ = false;
+		aot_ = false;
+		time_statistic_ = true;
+	}
+}
+
+size_t clox::base::runtime_configurable_configuration::parse_memory_size(const std::string& option, const std::string& str)
+{
+	size_t pos{ 0 };
+	unsigned long long size{ 0 };
+
+	try
+	{
+		size = std::stoull(str, &pos);
+	}
+	catch (const std::logic_error&)
+	{
+		throw invalid_option(option, std::format("Invalid memory size {}.", str));
+	}
+
+	const auto suffix = str.substr(pos);
+	if (suffix.empty() || suffix == "B" || suffix == "b")
+	{
+		return size;
+	}
+	else if (suffix == "K" || suffix == "k")
+	{
+		return size << 10;
+	}
+	else if (suffix == "M" || suffix == "m")
+	{
+		return size << 20;
+	}
+	else if (suffix == "G" || suffix == "g")
+	{
+		return size << 30;
+	}
+
+	throw invalid_option(option, std::format("Invalid memory size {}.", str));
+}
+
+size_t clox::base::runtime_configurable_configuration::parse_count(const std::string& option, const std::string& str)
+{
+	// stoull takes a minus sign and wraps the value around
+	if (str.empty() || !std::all_of(str.begin(), str.end(), [](char c)
+	{ return c >= '0' && c <= '9'; }))
+	{
+		throw invalid_option(option, std::format("Invalid count {}.", str));
+	}
+
+	try
+	{
+		return std::stoull(str);
+	}
+	catch (const std::out_of_range&)
+	{
+		throw invalid_option(option, std::format("Count {} is too large.", str));
+	}
 }
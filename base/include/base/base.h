@@ -21,6 +21,8 @@
 #pragma once
 
 #include <concepts>
+#include <cstddef>
+#include <string>
 
 namespace clox::base
 {
@@ -55,6 +57,77 @@ public:
 	virtual bool dump_ast() = 0;
 
 	virtual bool dump_assembly() = 0;
+
+	virtual bool bytecode_cache() = 0;
+
+	/// \return whether the AST is optimized before code generation
+	virtual bool optimize() = 0;
+
+	/// \return the limit of heap memory in bytes for each virtual machine, 0 for unlimited
+	virtual size_t memory_limit() = 0;
+
+	/// \return whether hot functions are compiled to machine code
+	virtual bool jit() = 0;
+
+	/// \return how many calls make a function hot enough to be compiled to machine code
+	virtual size_t jit_threshold() = 0;
+
+	/// \return how many backward jumps make a running loop hot enough to be replaced by machine code on the stack
+	virtual size_t osr_threshold() = 0;
+
+	/// \return whether hot functions are compiled on another thread, while the interpreter keeps running them
+	virtual bool jit_background() = 0;
+
+	/// \return whether functions changing tiers, and a summary of them, are reported
+	virtual bool show_tiering() = 0;
+
+	/// \return whether the time of each phase is reported at exit
+	virtual bool time_statistic() = 0;
+
+	/// \return whether the time statistic is reported as JSON instead of a table
+	virtual bool time_statistic_json() = 0;
+
+	/// \return whether instructions and calls are profiled and reported at exit, which needs a build with PROFILER
+	virtual bool profile() = 0;
+
+	/// \return where collapsed stacks of the profile are written, empty for nowhere
+	virtual std::string profile_output() = 0;
+
+	/// \return where call stacks sampled by SIGPROF are written as folded stacks, empty for no sampling
+	virtual std::string sample_output() = 0;
+
+	/// \return samples taken every second of CPU time
+	virtual size_t sample_frequency() = 0;
+
+	/// \return where Chrome trace events are written, empty for no tracing
+	virtual std::string trace_output() = 0;
+
+	/// \return microseconds a function call takes at least to be traced
+	virtual size_t trace_threshold() = 0;
+
+	/// \return whether objects left in the heap are counted by type and class after running
+	virtual bool heap_census() = 0;
+
+	/// \return where a snapshot of the heap is written after running, empty for nowhere
+	virtual std::string heap_dump_output() = 0;
+
+	/// \return whether allocations are sampled by site, reported when the virtual machine exits
+	virtual bool allocation_profile() = 0;
+
+	/// \return bytes allocated between two samples of the allocation profiler
+	virtual size_t allocation_sample_interval() = 0;
+
+	/// \return whether hardware performance counters are reported by phase
+	virtual bool perf_counters() = 0;
+
+	/// \return whether hardware performance counters are reported by Lox function as well
+	virtual bool perf_counters_by_function() = 0;
+
+	/// \return whether the virtual machine counts the instructions it runs, with machine code turned off
+	virtual bool count_instructions() = 0;
+
+	/// \return whether numeric functions are compiled ahead of time to C by the system C compiler
+	virtual bool aot() = 0;
 };
 
 template<typename T>
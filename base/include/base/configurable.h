@@ -28,8 +28,30 @@
 
 #include <argparse/argparse.hpp>
 
+#include <stdexcept>
+#include <string>
+
 namespace clox::base
 {
+/// \brief the value given to an option can not be parsed
+class invalid_option final
+		: public std::invalid_argument
+{
+public:
+	invalid_option(std::string option, const std::string& message)
+		: std::invalid_argument(message), option_(std::move(option))
+	{
+	}
+
+	[[nodiscard]] const std::string& option() const
+	{
+		return option_;
+	}
+
+private:
+	std::string option_{};
+};
+
 class runtime_configurable_configuration
 		: public configurable_configuration<runtime_configurable_configuration>
 {
@@ -42,8 +64,109 @@ public:
 
 	bool dump_assembly() override;
 
+	bool bytecode_cache() override;
+
+	bool optimize() override;
+
+	void set_optimize(bool optimize);
+
+	size_t memory_limit() override;
+
+	void set_memory_limit(size_t limit);
+
+	bool jit() override;
+
+	size_t jit_threshold() override;
+
+	void set_jit(bool jit);
+
+	void set_jit_threshold(size_t threshold);
+
+	size_t osr_threshold() override;
+
+	bool jit_background() override;
+
+	bool show_tiering() override;
+
+	void set_show_tiering(bool show);
+
+	void set_osr_threshold(size_t threshold);
+
+	void set_jit_background(bool background);
+
+	bool aot() override;
+
+	bool time_statistic() override;
+
+	bool time_statistic_json() override;
+
+	bool profile() override;
+
+	std::string profile_output() override;
+
+	/// \brief profile and write collapsed stacks to the path, or only report the profile if it is empty
+	void set_profile_output(bool profile, const std::string& path);
+
+	std::string sample_output() override;
+
+	size_t sample_frequency() override;
+
+	std::string trace_output() override;
+
+	size_t trace_threshold() override;
+
+	bool heap_census() override;
+
+	std::string heap_dump_output() override;
+
+	bool allocation_profile() override;
+
+	size_t allocation_sample_interval() override;
+
+	void set_allocation_profile(bool profile, size_t interval);
+
+	bool perf_counters() override;
+
+	bool perf_counters_by_function() override;
+
+	void set_perf_counters(bool perf_counters, bool by_function);
+
+	bool count_instructions() override;
+
+	void set_aot(bool aot);
+
 private:
+	/// \brief parse sizes like 4096, 512K, 64M or 1G given to the option
+	static size_t parse_memory_size(const std::string& option, const std::string& str);
+
+	/// \brief parse a non-negative count given to the option
+	static size_t parse_count(const std::string& option, const std::string& str);
+
 	bool dump_ast_{};
 	bool dump_assembly_{};
+	bool bytecode_cache_{};
+	bool optimize_{ true };
+	size_t memory_limit_{};
+	bool jit_{ false };
+	size_t jit_threshold_{ 100 };
+	size_t osr_threshold_{ 1000 };
+	bool jit_background_{ false };
+	bool show_tiering_{};
+	bool aot_{};
+	bool time_statistic_{};
+	bool time_statistic_json_{};
+	bool profile_{};
+	std::string profile_output_{};
+	std::string sample_output_{};
+	size_t sample_frequency_{ 997 };
+	std::string trace_output_{};
+	size_t trace_threshold_{ 100 };
+	bool heap_census_{};
+	std::string heap_dump_output_{};
+	bool allocation_profile_{};
+	size_t allocation_sample_interval_{ 4096 };
+	bool perf_counters_{};
+	bool perf_counters_by_function_{};
+	bool count_instructions_{};
 };
 }
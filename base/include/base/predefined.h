@@ -48,6 +48,22 @@ public:
 #endif
 
 	static inline constexpr bool ENABLE_DEBUG_LOGGING_GC = DEBUG_LOGGING_GC;
+
+#ifndef PROFILER
+#warning "PROFILER is defined to 0 by default"
+#define PROFILER 0
+#endif
+
+	/// \brief count every instruction and call frame of the virtual machine for --profile
+	static inline constexpr bool ENABLE_PROFILER = PROFILER;
+
+#ifndef INSTRUCTION_COUNTING
+#warning "INSTRUCTION_COUNTING is defined to 0 by default"
+#define INSTRUCTION_COUNTING 0
+#endif
+
+	/// \brief count instructions run by the interpreter loop for --count-instructions
+	static inline constexpr bool ENABLE_INSTRUCTION_COUNTING = INSTRUCTION_COUNTING;
 };
 
 }
\ No newline at end of file
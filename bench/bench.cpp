@@ -0,0 +1,346 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/21/2022.
+//
+
+// clox_bench runs every program of the corpus through the classic interpreter and the virtual machine,
+// and reports median and p95 wall time with allocations of each as JSON.
+
+#include <helper/console.h>
+
+#include <driver/run.h>
+#include <driver/adapter/classic.h>
+#include <driver/adapter/vm.h>
+
+#include <logger/logger.h>
+
+#include <argparse/argparse.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+// every allocation of the process is counted, so that the interpreters are compared on equal terms
+atomic<size_t> allocation_count{ 0 };
+atomic<size_t> allocated_bytes{ 0 };
+
+/// \brief a console discarding what programs print, and keeping errors to tell why a program fails
+class bench_console final
+		: public clox::helper::console
+{
+public:
+	std::string read() override
+	{
+		return "";
+	}
+
+	std::optional<std::string> read_line() override
+	{
+		return nullopt;
+	}
+
+	void write([[maybe_unused]] const std::string& str) override
+	{
+	}
+
+	void write([[maybe_unused]] std::string_view sv) override
+	{
+	}
+
+	void write_line([[maybe_unused]] const std::string& str) override
+	{
+	}
+
+	void write_line([[maybe_unused]] std::string_view sv) override
+	{
+	}
+
+	std::istream& in() override
+	{
+		return in_;
+	}
+
+	std::ostream& out() override
+	{
+		return discarded_;
+	}
+
+	std::ostream& log() override
+	{
+		return discarded_;
+	}
+
+	std::ostream& error() override
+	{
+		return error_;
+	}
+
+	[[nodiscard]] std::string error_text() const
+	{
+		return error_.str();
+	}
+
+private:
+	std::istringstream in_{};
+	std::ostream discarded_{ nullptr }; // a stream without buffer fails every write, which is cheap
+	std::ostringstream error_{};
+};
+
+struct run_result
+{
+	double milliseconds;
+	size_t allocations;
+	size_t bytes;
+};
+
+struct bench_result
+{
+	string program;
+	string interpreter;
+	vector<run_result> runs;
+};
+
+template<typename Adapter>
+run_result run_once(const string& code, const string& name)
+{
+	clox::logging::logger::instance().clear_error();
+
+	bench_console cons{};
+	auto adapter = make_shared<Adapter>(cons);
+
+	auto allocations = allocation_count.load();
+	auto bytes = allocated_bytes.load();
+	auto start = chrono::steady_clock::now();
+
+	int ret = clox::driver::run_code(cons, adapter, code);
+
+	auto end = chrono::steady_clock::now();
+
+	if (ret != 0)
+	{
+		throw runtime_error{ std::format("{} exits with {}: {}", name, ret, cons.error_text()) };
+	}
+
+	return run_result{
+			chrono::duration<double, milli>{ end - start }.count(),
+			allocation_count.load() - allocations,
+			allocated_bytes.load() - bytes };
+}
+
+template<typename Adapter>
+bench_result run_bench(const string& code, const string& program, const string& interpreter, size_t warmup,
+		size_t repeat)
+{
+	for (size_t i = 0; i < warmup; i++)
+	{
+		run_once<Adapter>(code, program);
+	}
+
+	bench_result ret{ program, interpreter, {}};
+	for (size_t i = 0; i < repeat; i++)
+	{
+		ret.runs.push_back(run_once<Adapter>(code, program));
+	}
+
+	return ret;
+}
+
+/// \brief nearest-rank percentile of sorted values
+template<typename T>
+T percentile(const vector<T>& sorted, double p)
+{
+	auto rank = static_cast<size_t>(ceil(p / 100.0 * static_cast<double>(sorted.size())));
+	return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+template<typename T, typename F>
+vector<T> sorted_by(const vector<run_result>& runs, F field)
+{
+	vector<T> ret{};
+	ranges::transform(runs, back_inserter(ret), field);
+	ranges::sort(ret);
+	return ret;
+}
+
+void write_json(ostream& os, const vector<bench_result>& results, size_t warmup, size_t repeat)
+{
+	os << std::format(R"({{"warmup":{},"repeat":{},"benchmarks":[)", warmup, repeat);
+
+	for (bool first = true; const auto& r: results)
+	{
+		auto times = sorted_by<double>(r.runs, &run_result::milliseconds);
+		auto allocations = sorted_by<size_t>(r.runs, &run_result::allocations);
+		auto bytes = sorted_by<size_t>(r.runs, &run_result::bytes);
+
+		os << std::format("{}\n{{\"program\":\"{}\",\"interpreter\":\"{}\",\"median_ms\":{:.3f},\"p95_ms\":{:.3f},"
+						  "\"min_ms\":{:.3f},\"max_ms\":{:.3f},\"allocations\":{},\"allocated_bytes\":{}}}",
+				first ? "" : ",", r.program, r.interpreter,
+				percentile(times, 50), percentile(times, 95), times.front(), times.back(),
+				percentile(allocations, 50), percentile(bytes, 50));
+
+		first = false;
+	}
+
+	os << "\n]}" << endl;
+}
+
+}
+
+void* operator new(size_t size)
+{
+	allocation_count.fetch_add(1, memory_order_relaxed);
+	allocated_bytes.fetch_add(size, memory_order_relaxed);
+
+	if (auto p = malloc(size ? size : 1);p)
+	{
+		return p;
+	}
+
+	throw bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, [[maybe_unused]] size_t size) noexcept
+{
+	free(p);
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser arg_parser{ "clox_bench" };
+
+	arg_parser.add_argument("-d", "--directory")
+		.help("Directory of the Lox programs to run.")
+		.default_value(string{ BENCH_SRC_DIR });
+
+	arg_parser.add_argument("-f", "--filter")
+		.help("Only run programs whose names contain it.")
+		.default_value(string{ "" });
+
+	arg_parser.add_argument("-i", "--interpreter")
+		.help("Run with classic, vm or both.")
+		.default_value(string{ "both" });
+
+	arg_parser.add_argument("-w", "--warmup")
+		.help("Runs before measuring, which are not reported.")
+		.default_value(string{ "2" });
+
+	arg_parser.add_argument("-r", "--repeat")
+		.help("Runs measured for each program and interpreter.")
+		.default_value(string{ "10" });
+
+	arg_parser.add_argument("-o", "--output")
+		.help("Write the JSON report to the file instead of stdout.")
+		.default_value(string{ "" });
+
+	try
+	{
+		arg_parser.parse_args(argc, argv);
+	}
+	catch (const std::runtime_error& err)
+	{
+		cout << err.what() << endl;
+		cout << arg_parser;
+		return 1;
+	}
+
+	auto filter = arg_parser.get<string>("--filter");
+	auto interpreter = arg_parser.get<string>("--interpreter");
+	auto warmup = stoull(arg_parser.get<string>("--warmup"));
+	auto repeat = std::max<size_t>(stoull(arg_parser.get<string>("--repeat")), 1);
+
+	vector<filesystem::path> programs{};
+	for (const auto& entry: filesystem::directory_iterator{ arg_parser.get<string>("--directory") })
+	{
+		if (entry.path().extension() == ".lox" && entry.path().stem().string().find(filter) != string::npos)
+		{
+			programs.push_back(entry.path());
+		}
+	}
+
+	ranges::sort(programs);
+
+	vector<bench_result> results{};
+	try
+	{
+		for (const auto& path: programs)
+		{
+			ifstream file{ path };
+			stringstream ss{};
+			ss << file.rdbuf();
+
+			auto code = ss.str();
+			auto name = path.stem().string();
+
+			if (interpreter == "classic" || interpreter == "both")
+			{
+				cerr << std::format("Running {} with the classic interpreter", name) << endl;
+				results.push_back(run_bench<clox::driver::classic_interpreter_adapter>(code, name, "classic", warmup,
+						repeat));
+			}
+
+			if (interpreter == "vm" || interpreter == "both")
+			{
+				cerr << std::format("Running {} with the virtual machine", name) << endl;
+				results.push_back(run_bench<clox::driver::vm_interpreter_adapter>(code, name, "vm", warmup, repeat));
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	if (auto output = arg_parser.get<string>("--output");!output.empty())
+	{
+		ofstream file{ output };
+		write_json(file, results, warmup, repeat);
+	}
+	else
+	{
+		write_json(cout, results, warmup, repeat);
+	}
+
+	return 0;
+}
@@ -0,0 +1,239 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/21/2022.
+//
+
+// clox_frontend_bench measures throughput of the scanner, the parser and the resolver over synthetic sources of
+// growing size, and fits how time grows with it, so that quadratic behaviour stands out as O(N^2).
+
+#include <scanner/scanner.h>
+
+#include <parser/parser.h>
+
+#include <resolver/resolver.h>
+
+#include <logger/logger.h>
+
+#include <benchmark/benchmark.h>
+
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+using namespace clox::scanning;
+using namespace clox::parsing;
+using namespace clox::resolving;
+
+namespace
+{
+
+using source_generator = string (*)(size_t n);
+
+/// \brief a function with blocks nested n deep, and an expression with parentheses nested n deep
+string deep_nesting(size_t n)
+{
+	string ret{ "fun nested():integer {\n" };
+	for (size_t i = 0; i < n; i++)
+	{
+		ret += std::format("{{ var v{}=1;\n", i);
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		ret += "}\n";
+	}
+
+	ret += "return ";
+	ret += string(n, '(') + "1" + string(n, ')') + ";\n}\nprint nested();\n";
+	return ret;
+}
+
+string many_functions(size_t n)
+{
+	string ret{};
+	for (size_t i = 0; i < n; i++)
+	{
+		ret += std::format(
+				"fun f{0}(a:integer, b:integer):integer {{\n"
+				"  var c=a + b * {0};\n"
+				"  if (c > 10) {{\n"
+				"    return c - 1;\n"
+				"  }}\n"
+				"  while (c < 10) {{\n"
+				"    c=c + 1;\n"
+				"  }}\n"
+				"  return c;\n"
+				"}}\n"
+				"print f{0}({0}, 2);\n", i);
+	}
+
+	return ret;
+}
+
+string many_classes(size_t n)
+{
+	string ret{};
+	for (size_t i = 0; i < n; i++)
+	{
+		ret += std::format(
+				"class C{0} {{\n"
+				"  var value:integer;\n"
+				"  constructor(v:integer) {{\n"
+				"    this.value=v;\n"
+				"  }}\n"
+				"  fun get():integer {{\n"
+				"    return this.value;\n"
+				"  }}\n"
+				"  fun add(other:integer):integer {{\n"
+				"    return this.value + other;\n"
+				"  }}\n"
+				"}}\n"
+				"var c{0}=C{0}({0});\n"
+				"print c{0}.add(c{0}.get());\n", i);
+	}
+
+	return ret;
+}
+
+/// \brief sixteen string literals of n / 16 characters each
+string long_strings(size_t n)
+{
+	string ret{};
+	for (size_t i = 0; i < 16; i++)
+	{
+		ret += std::format("var s{}=\"{}\";\n", i, string(n / 16, static_cast<char>('a' + i)));
+	}
+
+	return ret;
+}
+
+vector<token> scan(const string& source)
+{
+	scanner sc{ source };
+	return sc.scan();
+}
+
+vector<shared_ptr<statement>> parse(const string& source)
+{
+	parser ps{ scan(source) };
+	auto ret = ps.parse();
+
+	if (clox::logging::logger::instance().has_errors())
+	{
+		throw logic_error{ "The synthetic source has errors." };
+	}
+
+	return ret;
+}
+
+void set_rates(benchmark::State& state, const string& source, size_t tokens)
+{
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+	state.counters["tokens"] = benchmark::Counter(static_cast<double>(state.iterations() * tokens),
+			benchmark::Counter::kIsRate);
+	state.SetComplexityN(state.range(0));
+}
+
+void bm_scan(benchmark::State& state, source_generator generate)
+{
+	auto source = generate(state.range(0));
+
+	size_t tokens{ 0 };
+	for (auto _: state)
+	{
+		auto result = scan(source);
+		tokens = result.size();
+		benchmark::DoNotOptimize(result.data());
+	}
+
+	set_rates(state, source, tokens);
+}
+
+void bm_parse(benchmark::State& state, source_generator generate)
+{
+	clox::logging::logger::instance().clear_error();
+
+	auto source = generate(state.range(0));
+	auto tokens = scan(source);
+
+	for (auto _: state)
+	{
+		state.PauseTiming();
+		auto input = tokens;
+		state.ResumeTiming();
+
+		parser ps{ std::move(input) };
+		auto stmts = ps.parse();
+		benchmark::DoNotOptimize(stmts.data());
+
+		state.PauseTiming();
+		stmts.clear(); // freeing the tree is not parsing
+		state.ResumeTiming();
+	}
+
+	set_rates(state, source, tokens.size());
+}
+
+void bm_resolve(benchmark::State& state, source_generator generate)
+{
+	clox::logging::logger::instance().clear_error();
+
+	auto source = generate(state.range(0));
+	auto tokens = scan(source).size();
+
+	for (auto _: state)
+	{
+		// the resolver annotates the tree it resolves, so every iteration gets a new one
+		state.PauseTiming();
+		auto stmts = parse(source);
+		state.ResumeTiming();
+
+		resolver rsv{};
+		rsv.resolve(stmts);
+		benchmark::ClobberMemory();
+
+		state.PauseTiming();
+		stmts.clear();
+		state.ResumeTiming();
+	}
+
+	set_rates(state, source, tokens);
+}
+
+}
+
+#define FRONTEND_BENCHMARKS(stage) \
+    BENCHMARK_CAPTURE(stage, deep_nesting, deep_nesting)->RangeMultiplier(4)->Range(16, 1024)->Complexity(); \
+    BENCHMARK_CAPTURE(stage, many_functions, many_functions)->RangeMultiplier(4)->Range(64, 16384)->Complexity(); \
+    BENCHMARK_CAPTURE(stage, many_classes, many_classes)->RangeMultiplier(4)->Range(64, 16384)->Complexity(); \
+    BENCHMARK_CAPTURE(stage, long_strings, long_strings)->RangeMultiplier(8)->Range(1 << 10, 1 << 22)->Complexity();
+
+FRONTEND_BENCHMARKS(bm_scan)
+FRONTEND_BENCHMARKS(bm_parse)
+FRONTEND_BENCHMARKS(bm_resolve)
+
+BENCHMARK_MAIN();
@@ -0,0 +1,79 @@
+# Runs a benchmark program with --count-instructions and compares its instruction and object counts with the baseline.
+# Counts rather than time are compared so that the result is the same on a busy machine.
+#
+# Usage: cmake -DCLOX=<clox> -DPROGRAM=<program.lox> -DBASELINE=<baseline.json> [-DTOLERANCE=<percent>]
+#              [-DUPDATE_BASELINE=ON] -P perf_gate.cmake
+
+cmake_minimum_required(VERSION 3.19)
+
+foreach (required CLOX PROGRAM BASELINE)
+    if (NOT DEFINED ${required})
+        message(FATAL_ERROR "${required} is not given.")
+    endif ()
+endforeach ()
+
+if (NOT DEFINED TOLERANCE)
+    set(TOLERANCE 2)
+endif ()
+
+set(COUNTERS instructions objects object_bytes)
+
+execute_process(
+        COMMAND ${CLOX} --count-instructions --time-statistic-json -f ${PROGRAM}
+        RESULT_VARIABLE result
+        OUTPUT_QUIET
+        ERROR_VARIABLE errors)
+
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${PROGRAM} exits with ${result}:\n${errors}")
+endif ()
+
+string(REGEX MATCH "{\"phases\":[^\n]*" statistic "${errors}")
+if (NOT statistic)
+    message(FATAL_ERROR "No time statistic is found in the output of ${PROGRAM}:\n${errors}")
+endif ()
+
+foreach (counter ${COUNTERS})
+    string(JSON measured_${counter} GET "${statistic}" counters ${counter})
+endforeach ()
+
+if (UPDATE_BASELINE)
+    set(content "{")
+    set(separator "")
+    foreach (counter ${COUNTERS})
+        string(APPEND content "${separator}\n  \"${counter}\": ${measured_${counter}}")
+        set(separator ",")
+    endforeach ()
+    string(APPEND content "\n}\n")
+
+    file(WRITE ${BASELINE} "${content}")
+    message(STATUS "Baseline of ${PROGRAM} is written to ${BASELINE}.")
+    return()
+endif ()
+
+if (NOT EXISTS ${BASELINE})
+    message(FATAL_ERROR "No baseline for ${PROGRAM}. Build the update_perf_baselines target to record one.")
+endif ()
+
+file(READ ${BASELINE} baseline)
+
+set(regressions "")
+foreach (counter ${COUNTERS})
+    string(JSON expected GET "${baseline}" ${counter})
+    math(EXPR limit "${expected} + ${expected} * ${TOLERANCE} / 100")
+
+    message(STATUS "${counter}: ${measured_${counter}} (baseline ${expected}, limit ${limit})")
+
+    if (measured_${counter} GREATER limit)
+        string(APPEND regressions "\n  ${counter} is ${measured_${counter}}, more than ${limit}")
+    elseif (measured_${counter} LESS expected)
+        math(EXPR floor "${expected} - ${expected} * ${TOLERANCE} / 100")
+        if (measured_${counter} LESS floor)
+            message(STATUS "${counter} improves beyond the tolerance, consider updating the baseline.")
+        endif ()
+    endif ()
+endforeach ()
+
+if (regressions)
+    message(FATAL_ERROR "${PROGRAM} regresses by more than ${TOLERANCE}%:${regressions}")
+endif ()
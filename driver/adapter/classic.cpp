@@ -26,6 +26,7 @@
 #include "driver/driver.h"
 
 #include "helper/std_console.h"
+#include "helper/time_statistic.h"
 
 #include "scanner/scanner.h"
 
@@ -61,12 +62,18 @@ int clox::driver::classic_interpreter_adapter::full_code(const std::vector<std::
 
 	classic::interpreter the_interpreter{ *cons_ };
 
-	rsv.resolve(stmts);
+	{
+		auto _t = time_statistic::instance().measure(statistic_phase::RESOLVING);
+		rsv.resolve(stmts);
+	}
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
 
-	the_interpreter.interpret(stmts, false);
+	{
+		auto _t = time_statistic::instance().measure(statistic_phase::EXECUTION);
+		the_interpreter.interpret(stmts, false);
+	}
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
@@ -76,12 +83,18 @@ int clox::driver::classic_interpreter_adapter::full_code(const std::vector<std::
 
 int clox::driver::classic_interpreter_adapter::repl(const std::vector<std::shared_ptr<parsing::statement>>& stmts)
 {
-	repl_resolver_.resolve(stmts);
+	{
+		auto _t = time_statistic::instance().measure(statistic_phase::RESOLVING);
+		repl_resolver_.resolve(stmts);
+	}
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
 
-	repl_intp_.interpret(stmts, false);
+	{
+		auto _t = time_statistic::instance().measure(statistic_phase::EXECUTION);
+		repl_intp_.interpret(stmts, false);
+	}
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
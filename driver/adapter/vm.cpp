@@ -30,6 +30,7 @@
 #include "driver/interpreter_adapter.h"
 
 #include "helper/std_console.h"
+#include "helper/time_statistic.h"
 
 #include "scanner/scanner.h"
 
@@ -39,10 +40,15 @@
 #include "logger/logger.h"
 
 #include "interpreter/vm/chunk.h"
+#include "interpreter/vm/bytecode_cache.h"
+#include "interpreter/vm/heap_snapshot.h"
+#include "interpreter/vm/heap_inspector.h"
 
 #include "resolver/resolver.h"
 
 #include "interpreter/codegen/codegen.h"
+#include "interpreter/ir/c_backend.h"
+#include "interpreter/vm/native_module.h"
 
 #include <utility>
 #include <iostream>
@@ -64,21 +70,128 @@ using namespace clox::resolving;
 using namespace clox::interpreting;
 using namespace clox::interpreting::vm;
 using namespace clox::interpreting::compiling;
+using namespace clox::interpreting::optimizing;
 
 
 int clox::driver::vm_interpreter_adapter::full_code(const std::vector<std::shared_ptr<parsing::statement>>& stmts)
+{
+	if (!prelude_sources_.empty())
+	{
+		return session_code(stmts);
+	}
+
+	return compile_and_run(stmts, nullptr);
+}
+
+int clox::driver::vm_interpreter_adapter::full_code(const std::vector<std::shared_ptr<parsing::statement>>& stmts,
+		const bytecode_cache_target& cache)
+{
+	if (!prelude_sources_.empty())
+	{
+		// the code depends on the function ids and globals of preludes, so it can't be cached on its own
+		return session_code(stmts);
+	}
+
+	return compile_and_run(stmts, &cache);
+}
+
+std::optional<int> clox::driver::vm_interpreter_adapter::cached_code(const bytecode_cache_target& cache)
+{
+	if (!prelude_sources_.empty())
+	{
+		return nullopt;
+	}
+
+	if (configurable_configuration_instance().aot() && native_module::available())
+	{
+		return nullopt; // machine code isn't cached, so it is compiled again along with the bytecode
+	}
+
+	// switch to the console of this adapter for logging, as scan_parse_and_run does for code that isn't cached
+	auto& prev_cons = logger::instance().get_console();
+	auto _c = finally([&prev_cons]
+	{
+		logger::instance().set_console(prev_cons);
+	});
+
+	logger::instance().set_console(*cons_);
+
+	auto top_level = bytecode_cache::load(heap_, cache.path, cache.source_hash);
+	if (!top_level)
+	{
+		return nullopt;
+	}
+
+	virtual_machine vm{ *cons_, heap_ };
+
+	// allocated before GC is enabled, for nothing refers to the loaded code until the vm runs it
+	auto closure = heap_->allocate<closure_object>(top_level);
+
+	garbage_collector gc{ *cons_, heap_, vm };
+
+	heap_->enable_gc(gc);
+
+	auto _ = finally([this]
+	{
+		heap_->remove_gc();
+	});
+
+	if (configurable_configuration_instance().dump_assembly())
+	{
+		top_level->body()->disassemble(*cons_);
+	}
+
+	auto _h = finally([this]
+	{
+		inspect_heap();
+	});
+
+	if (auto _t = time_statistic::instance().measure(statistic_phase::EXECUTION);
+		vm.run(closure) != virtual_machine_status::OK)
+	{
+		return 67;
+	}
+
+	if (logger::instance().has_errors())return 65;
+	else if (logger::instance().has_runtime_errors())return 67;
+
+	return 0;
+}
+
+int clox::driver::vm_interpreter_adapter::compile_and_run(const std::vector<std::shared_ptr<parsing::statement>>& stmts,
+		const bytecode_cache_target* cache)
 {
 	resolver rsv{};
 
 	classic::interpreter the_interpreter{ *cons_ };
 
-	rsv.resolve(stmts);
+	auto& stat = time_statistic::instance();
+
+	{
+		auto _t = stat.measure(statistic_phase::RESOLVING);
+		rsv.resolve(stmts);
+	}
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
 
+	if (configurable_configuration_instance().optimize())
+	{
+		auto _t = stat.measure(statistic_phase::OPTIMIZING);
+		optimizer{ rsv }.optimize(stmts);
+	}
+
 	codegen gen{ heap_, rsv };
 
+	ir::c_module c_module{};
+	if (configurable_configuration_instance().aot() && native_module::available())
+	{
+		gen.emit_c(c_module);
+	}
+
+	// outlives the virtual machine, which calls into it
+	optional<native_module> native{};
+
 	virtual_machine vm{ *cons_, heap_ };
 
 	garbage_collector gc{ *cons_, heap_, vm, gen };
@@ -90,17 +203,63 @@ int clox::driver::vm_interpreter_adapter::full_code(const std::vector<std::share
 		heap_->remove_gc();
 	});
 
-	gen.generate(stmts);
+	{
+		auto _t = stat.measure(statistic_phase::CODEGEN);
+		gen.generate(stmts);
+	}
+
+	stat.count(statistic_counter::BYTECODE_BYTES, gen.bytecode_size());
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
 
+	if (cache)
+	{
+		bytecode_cache::save(cache->path, cache->source_hash, gen.top_level()->function()); // best effort
+	}
+
 	if (configurable_configuration_instance().dump_assembly())
 	{
 		gen.top_level()->function()->body()->disassemble(*cons_);
 	}
 
-	vm.run(gen.top_level());
+	if (!c_module.empty())
+	{
+		auto _t = stat.measure(statistic_phase::CODEGEN);
+
+		// functions stay interpreted if the C compiler is missing or fails
+		if (native = native_module::build(c_module.source());native)
+		{
+			for (const auto& candidate: gen.native_candidates())
+			{
+				native_code code{ native->entry(candidate.symbol) };
+				if (!code.entry)continue;
+
+				for (auto kind: candidate.params)
+				{
+					code.params.push_back(kind == ir::value_kind::INTEGER ? NATIVE_INTEGER : NATIVE_FLOATING);
+				}
+
+				if (configurable_configuration_instance().show_tiering())
+				{
+					cons_->log() << std::format("[tiering] {} compiled to machine code ahead of time\n",
+						candidate.func->name());
+				}
+
+				vm.attach_native_code(candidate.func, std::move(code));
+			}
+		}
+	}
+
+	auto _h = finally([this]
+	{
+		inspect_heap();
+	});
+
+	if (auto _t = stat.measure(statistic_phase::EXECUTION);vm.run(gen.top_level()) != virtual_machine_status::OK)
+	{
+		return 67;
+	}
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
@@ -110,14 +269,105 @@ int clox::driver::vm_interpreter_adapter::full_code(const std::vector<std::share
 
 int clox::driver::vm_interpreter_adapter::repl(const std::vector<std::shared_ptr<parsing::statement>>& stmts)
 {
-	repl_resolver_.resolve(stmts);
+	return session_code(stmts);
+}
+
+int clox::driver::vm_interpreter_adapter::prelude(const std::string& source,
+		const std::vector<std::shared_ptr<parsing::statement>>& stmts)
+{
+	auto ret = session_code(stmts);
+
+	if (ret == 0)
+	{
+		prelude_sources_.push_back(source);
+	}
+
+	return ret;
+}
+
+bool clox::driver::vm_interpreter_adapter::save_snapshot(const std::string& path)
+{
+	return heap_snapshot::save(path, session_vm(), prelude_sources_);
+}
+
+bool clox::driver::vm_interpreter_adapter::load_snapshot(const std::string& path)
+{
+	// natives are in the snapshot as well
+	session_vm_ = std::make_unique<virtual_machine>(*cons_, heap_, false);
+
+	auto sources = heap_snapshot::load(path, *session_vm_);
+	if (!sources.has_value())
+	{
+		session_vm_ = nullptr;
+		return false;
+	}
+
+	// the typed front end still needs declarations in preludes, but they are never executed again
+	for (const auto& src: sources.value())
+	{
+		scanner sc{ src };
+		parser ps{ sc.scan() };
+
+		auto stmts = ps.parse();
+		if (logger::instance().has_errors())return false;
+
+		session_resolver_.resolve(stmts);
+		if (logger::instance().has_errors())return false;
+
+		session_resolver_.skip_code_generation();
+	}
+
+	prelude_sources_ = std::move(sources.value());
+	return true;
+}
+
+void clox::driver::vm_interpreter_adapter::inspect_heap()
+{
+	if (configurable_configuration_instance().heap_census())
+	{
+		heap_inspector::print_census(heap_->census(), cons_->error());
+	}
+
+	if (auto path = configurable_configuration_instance().heap_dump_output();
+		!path.empty() && !heap_inspector{ *heap_ }.write_snapshot(path))
+	{
+		logger::instance().error("--heap-dump", std::format("Cannot write heap snapshot to {}.", path));
+	}
+}
+
+clox::interpreting::vm::virtual_machine& clox::driver::vm_interpreter_adapter::session_vm()
+{
+	if (!session_vm_)
+	{
+		session_vm_ = std::make_unique<virtual_machine>(*cons_, heap_);
+	}
+
+	return *session_vm_;
+}
+
+int clox::driver::vm_interpreter_adapter::session_code(const std::vector<std::shared_ptr<parsing::statement>>& stmts)
+{
+	auto& stat = time_statistic::instance();
+
+	{
+		auto _t = stat.measure(statistic_phase::RESOLVING);
+		session_resolver_.resolve(stmts);
+	}
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
 
-	codegen gen{ heap_, repl_resolver_ };
+	if (configurable_configuration_instance().optimize())
+	{
+		auto _t = stat.measure(statistic_phase::OPTIMIZING);
+
+		// constants defined earlier in the session are propagated as well
+		session_optimizer_.optimize(stmts);
+	}
+
+	codegen gen{ heap_, session_resolver_ };
 
-	garbage_collector gc{ *cons_, heap_, repl_vm_, gen };
+	garbage_collector gc{ *cons_, heap_, session_vm(), gen };
 
 	heap_->enable_gc(gc);
 
@@ -126,7 +376,12 @@ int clox::driver::vm_interpreter_adapter::repl(const std::vector<std::shared_ptr
 		heap_->remove_gc();
 	});
 
-	gen.generate(stmts);
+	{
+		auto _t = stat.measure(statistic_phase::CODEGEN);
+		gen.generate(stmts);
+	}
+
+	stat.count(statistic_counter::BYTECODE_BYTES, gen.bytecode_size());
 
 	if (configurable_configuration_instance().dump_assembly())
 	{
@@ -136,7 +391,11 @@ int clox::driver::vm_interpreter_adapter::repl(const std::vector<std::shared_ptr
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
 
-	repl_vm_.run(gen.top_level());  // FIXME
+	if (auto _t = stat.measure(statistic_phase::EXECUTION);
+		session_vm().run(gen.top_level()) != virtual_machine_status::OK)  // FIXME
+	{
+		return 67;
+	}
 
 	if (logger::instance().has_errors())return 65;
 	else if (logger::instance().has_runtime_errors())return 67;
@@ -6,6 +6,10 @@
 #include "driver/adapter/vm.h"
 
 #include <helper/std_console.h>
+#include <helper/time_statistic.h>
+#include <helper/stack_sampler.h>
+#include <helper/trace_recorder.h>
+#include <helper/perf_counters.h>
 
 #include <scanner/scanner.h>
 
@@ -23,6 +27,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <format>
 
 #include <gsl/gsl>
 
@@ -40,25 +45,168 @@ int clox::driver::run(const argparse::ArgumentParser& arg_parser)
 {
 	auto file = arg_parser.get<string>("--file");
 
-	configurable_configuration_instance().load_arguments(arg_parser);
+	try
+	{
+		configurable_configuration_instance().load_arguments(arg_parser);
+	}
+	catch (const invalid_option& e)
+	{
+		logger::instance().error(e.option(), e.what());
+		return 1;
+	}
+
+	time_statistic::instance().enable(configurable_configuration_instance().time_statistic());
+
+	auto _ = gsl::finally([]
+	{
+		if (!configurable_configuration_instance().time_statistic())
+		{
+			return;
+		}
+
+		auto& cons = clox::helper::std_console::instance();
+		if (configurable_configuration_instance().time_statistic_json())
+		{
+			time_statistic::instance().print_json(cons.error());
+		}
+		else
+		{
+			time_statistic::instance().print_table(cons.error());
+		}
+	});
+
+	if (configurable_configuration_instance().profile() && !runtime_predefined_configuration::ENABLE_PROFILER)
+	{
+		logger::instance().error("--profile", "The profiler is not built in. Configure with -DENABLE_PROFILER=ON.");
+		return 1;
+	}
+
+	if (configurable_configuration_instance().count_instructions() &&
+		!runtime_predefined_configuration::ENABLE_INSTRUCTION_COUNTING)
+	{
+		logger::instance().error("--count-instructions",
+				"Instruction counting is not built in. Configure with -DENABLE_INSTRUCTION_COUNTING=ON.");
+		return 1;
+	}
+
+	if (auto path = configurable_configuration_instance().sample_output();!path.empty())
+	{
+		if (!stack_sampler::instance().start(configurable_configuration_instance().sample_frequency()))
+		{
+			logger::instance().error("--sample", "Cannot sample call stacks on this platform.");
+			return 1;
+		}
+	}
+
+	auto _s = gsl::finally([]
+	{
+		if (!stack_sampler::instance().running())
+		{
+			return;
+		}
+
+		stack_sampler::instance().stop();
+
+		ofstream file{ configurable_configuration_instance().sample_output() };
+		stack_sampler::instance().write_folded(file);
+	});
+
+	if (auto path = configurable_configuration_instance().trace_output();!path.empty())
+	{
+		auto threshold = chrono::microseconds{ configurable_configuration_instance().trace_threshold() };
+		if (!trace_recorder::instance().start(path, threshold))
+		{
+			logger::instance().error("--trace", std::format("Cannot write trace to {}.", path));
+			return 1;
+		}
+	}
+
+	auto _r = gsl::finally([]
+	{
+		trace_recorder::instance().stop();
+	});
+
+	if (configurable_configuration_instance().perf_counters() && !perf_counters::instance().open())
+	{
+		// not an error, for the script runs the same without them
+		clox::helper::std_console::instance().log()
+				<< std::format("Running without hardware performance counters. {}", perf_counters::instance().error())
+				<< endl;
+	}
+
+	auto _p = gsl::finally([]
+	{
+		if (perf_counters::instance().enabled())
+		{
+			perf_counters::instance().print_table(clox::helper::std_console::instance().error());
+			perf_counters::instance().close();
+		}
+	});
 
 	shared_ptr<interpreter_adapter> adapter{ nullptr };
 	if (arg_parser.get<bool>("--classic"))
 	{
+		if (configurable_configuration_instance().profile())
+		{
+			logger::instance().error("--profile", "In classic mode, there are no instructions to profile.");
+			return 1;
+		}
+
 		if (configurable_configuration_instance().dump_assembly())
 		{
 			logger::instance().error("--show-ast", "In classic mode, there is no assembly code to display.");
 			return 1;
 		}
 
+		if (!arg_parser.get<string>("--prelude").empty() ||
+			!arg_parser.get<string>("--snapshot").empty() ||
+			!arg_parser.get<string>("--save-snapshot").empty())
+		{
+			logger::instance().error("--classic", "Preludes and snapshots are only supported by the virtual machine.");
+			return 1;
+		}
+
 		adapter = static_pointer_cast<interpreter_adapter>(
 				make_shared<classic_interpreter_adapter>(clox::helper::std_console::instance()));
 
 	}
 	else
 	{
-		adapter = static_pointer_cast<interpreter_adapter>(
-				make_shared<vm_interpreter_adapter>(clox::helper::std_console::instance()));
+		auto vm_adapter = make_shared<vm_interpreter_adapter>(clox::helper::std_console::instance());
+
+		if (auto snapshot = arg_parser.get<string>("--snapshot"); !snapshot.empty())
+		{
+			if (!vm_adapter->load_snapshot(snapshot))
+			{
+				logger::instance().error("--snapshot", std::format("Cannot load snapshot {}.", snapshot));
+				return 1;
+			}
+		}
+
+		if (auto prelude = arg_parser.get<string>("--prelude"); !prelude.empty())
+		{
+			if (auto ret = clox::driver::run_prelude(clox::helper::std_console::instance(), vm_adapter, prelude);
+					ret != 0)
+			{
+				return ret;
+			}
+		}
+
+		if (auto snapshot = arg_parser.get<string>("--save-snapshot"); !snapshot.empty())
+		{
+			if (!vm_adapter->save_snapshot(snapshot))
+			{
+				logger::instance().error("--save-snapshot", std::format("Cannot save snapshot {}.", snapshot));
+				return 1;
+			}
+
+			if (file.empty())
+			{
+				return 0; // only to make the snapshot
+			}
+		}
+
+		adapter = static_pointer_cast<interpreter_adapter>(vm_adapter);
 	}
 
 
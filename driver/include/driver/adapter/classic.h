@@ -45,6 +45,8 @@ public:
 	}
 
 
+	using interpreter_adapter::full_code;
+
 	int full_code(const std::vector<std::shared_ptr<parsing::statement>>& code) override;
 
 	int repl(const std::vector<std::shared_ptr<parsing::statement>>& code) override;
@@ -27,8 +27,13 @@
 #include "parser/gen/parser_base.inc"
 #include "parser/gen/parser_classes.inc"
 
+#include "base/configuration.h"
+
+#include "driver/interpreter_adapter.h"
+
 #include "resolver/resolver.h"
 #include "interpreter/vm/vm.h"
+#include "interpreter/optimizer/optimizer.h"
 
 #include <string>
 #include <vector>
@@ -45,22 +50,52 @@ class vm_interpreter_adapter final
  public:
 
 	explicit vm_interpreter_adapter(helper::console& cons)
-		: heap_(std::make_shared<interpreting::vm::object_heap>(cons)),
+		: heap_(std::make_shared<interpreting::vm::object_heap>(cons,
+				base::configurable_configuration_instance().memory_limit())),
 		  cons_(&cons),
-		  repl_resolver_(),
-		  repl_vm_(cons, heap_)
+		  session_resolver_()
 	{
 	}
 
 	int full_code(const std::vector<std::shared_ptr<parsing::statement>>& stmts) override;
 
+	int full_code(const std::vector<std::shared_ptr<parsing::statement>>& stmts,
+			const bytecode_cache_target& cache) override;
+
+	std::optional<int> cached_code(const bytecode_cache_target& cache) override;
+
 	int repl(const std::vector<std::shared_ptr<parsing::statement>>& stmts) override;
 
+	/// \brief run a prelude, whose definitions stay visible to all code run after it
+	int prelude(const std::string& source, const std::vector<std::shared_ptr<parsing::statement>>& stmts);
+
+	/// \brief save the state after running preludes to path
+	/// \return false if failed
+	bool save_snapshot(const std::string& path);
+
+	/// \brief restore the state of preludes from the snapshot at path, instead of running them
+	/// \return false if failed
+	bool load_snapshot(const std::string& path);
+
  private:
+	int compile_and_run(const std::vector<std::shared_ptr<parsing::statement>>& stmts,
+			const bytecode_cache_target* cache);
+
+	/// \brief compile and run in the session shared by the REPL and preludes
+	int session_code(const std::vector<std::shared_ptr<parsing::statement>>& stmts);
+
+	interpreting::vm::virtual_machine& session_vm();
+
+	/// \brief take the heap census and snapshot asked for by the command line, after running
+	void inspect_heap();
+
 	std::shared_ptr<interpreting::vm::object_heap> heap_{};
 
-	resolving::resolver repl_resolver_{};
-	interpreting::vm::virtual_machine repl_vm_;
+	resolving::resolver session_resolver_{};
+	interpreting::optimizing::optimizer session_optimizer_{ session_resolver_ };
+	std::unique_ptr<interpreting::vm::virtual_machine> session_vm_{};
+
+	std::vector<std::string> prelude_sources_{};
 
 	mutable helper::console* cons_{};
 };
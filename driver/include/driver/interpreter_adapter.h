@@ -33,11 +33,19 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
 
 #include <concepts>
 
 namespace clox::driver
 {
+/// \brief where the precompiled code of a source file is cached
+struct bytecode_cache_target
+{
+	std::string path;
+	uint64_t source_hash;
+};
+
 class interpreter_adapter
 {
 public:
@@ -46,6 +54,20 @@ public:
 
 	virtual int repl(const std::vector<std::shared_ptr<parsing::statement>>& stmts) = 0;
 
+	/// \brief like full_code, but also save the compiled code to cache if the adapter supports it
+	virtual int full_code(const std::vector<std::shared_ptr<parsing::statement>>& stmts,
+			[[maybe_unused]] const bytecode_cache_target& cache)
+	{
+		return full_code(stmts);
+	}
+
+	/// \brief run the precompiled code in cache, skipping the front end
+	/// \return the exit code, or nullopt if the adapter doesn't support it or the cache is absent or outdated
+	virtual std::optional<int> cached_code([[maybe_unused]] const bytecode_cache_target& cache)
+	{
+		return std::nullopt;
+	}
+
 };
 
 }
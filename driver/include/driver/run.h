@@ -26,6 +26,7 @@
 
 #include <driver/run.h>
 #include <driver/interpreter_adapter.h>
+#include <driver/adapter/vm.h>
 
 #include <helper/console.h>
 
@@ -43,9 +44,19 @@ namespace clox::driver
 		bool dump_ast = false,
 		bool dump_assembly = false);
 
+/// \brief like run_code, and the compiled code is saved to cache if the adapter supports it
+[[nodiscard]] int run_code(helper::console& output_cons,
+		const std::shared_ptr<interpreter_adapter>& adapter,
+		const std::string& code,
+		const bytecode_cache_target& cache);
+
 [[nodiscard]] int
 run_file(helper::console& cons, const std::shared_ptr<interpreter_adapter>& adapter, const std::string& name);
 
+/// \brief run the file as a prelude, whose definitions are visible to code run later
+[[nodiscard]] int
+run_prelude(helper::console& cons, const std::shared_ptr<vm_interpreter_adapter>& adapter, const std::string& name);
+
 [[nodiscard]] int run_repl(helper::console& cons, const std::shared_ptr<interpreter_adapter>& adapter);
 
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "driver/adapter/classic.h"
 
 #include <helper/std_console.h>
+#include <helper/time_statistic.h>
 
 #include <scanner/scanner.h>
 
@@ -13,6 +14,9 @@
 
 #include <interpreter/classic/interpreter.h>
 #include <interpreter/vm/chunk.h>
+#include <interpreter/vm/bytecode_cache.h>
+
+#include <base/configuration.h>
 
 #include <resolver/resolver.h>
 
@@ -20,6 +24,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <concepts>
 
 #include <gsl/gsl>
 
@@ -32,11 +37,25 @@ using namespace clox::logging;
 using namespace clox::resolving;
 using namespace clox::interpreting;
 
-int clox::driver::run_code(helper::console &output_cons,
-						   const std::shared_ptr<interpreter_adapter> &adapter,
-						   const string &code,
-						   bool dump_ast,
-						   bool dump_assembly)
+namespace
+{
+string read_source(const string &name)
+{
+	ifstream src{name};
+
+	stringstream ss{};
+	ss << src.rdbuf();
+
+	if (!src)
+	{
+		throw std::runtime_error("Cannot read source file.");
+	}
+
+	return ss.str();
+}
+
+template<std::invocable<const std::vector<std::shared_ptr<statement>> &> TRun>
+int scan_parse_and_run(clox::helper::console &output_cons, const string &code, TRun run)
 {
 	// switch to the desirable console for logging
 	auto &prev_cons = logger::instance().get_console();
@@ -47,32 +66,91 @@ int clox::driver::run_code(helper::console &output_cons,
 
 	logger::instance().set_console(output_cons);
 
-	scanner sc{code};
-	parser ps{sc.scan()};
+	auto& stat = time_statistic::instance();
+
+	vector<token> tokens{};
+	{
+		auto _t = stat.measure(statistic_phase::SCANNING);
+
+		scanner sc{code};
+		tokens = sc.scan();
+	}
+
+	stat.count(statistic_counter::TOKENS, tokens.size());
+
+	auto nodes_before = parser_class_base::created_count();
+
+	vector<shared_ptr<statement>> stmts{};
+	{
+		auto _t = stat.measure(statistic_phase::PARSING);
+
+		parser ps{std::move(tokens)};
+		stmts = ps.parse();
+	}
+
+	stat.count(statistic_counter::AST_NODES, parser_class_base::created_count() - nodes_before);
 
-	auto stmts = ps.parse();
 	if (logger::instance().has_errors())
 	{
 		return 65;
 	}
 
-	return adapter->full_code(stmts);
+	return run(stmts);
+}
+}
+
+int clox::driver::run_code(helper::console &output_cons,
+						   const std::shared_ptr<interpreter_adapter> &adapter,
+						   const string &code,
+						   bool dump_ast,
+						   bool dump_assembly)
+{
+	return scan_parse_and_run(output_cons, code, [&adapter](const auto &stmts)
+	{
+		return adapter->full_code(stmts);
+	});
+}
+
+int clox::driver::run_code(helper::console &output_cons,
+						   const std::shared_ptr<interpreter_adapter> &adapter,
+						   const string &code,
+						   const bytecode_cache_target &cache)
+{
+	return scan_parse_and_run(output_cons, code, [&adapter, &cache](const auto &stmts)
+	{
+		return adapter->full_code(stmts, cache);
+	});
 }
 
 int clox::driver::run_file(helper::console &cons, const std::shared_ptr<interpreter_adapter> &adapter,
 						   const std::string &name)
 {
-	ifstream src{name};
+	auto code = read_source(name);
 
-	stringstream ss{};
-	ss << src.rdbuf();
-
-	if (!src)
+	if (clox::base::configurable_configuration_instance().bytecode_cache())
 	{
-		throw std::runtime_error("Cannot read source file.");
+		bytecode_cache_target cache{vm::bytecode_cache::cache_path_of(name), vm::bytecode_cache::hash_of(code)};
+
+		if (auto ret = adapter->cached_code(cache); ret.has_value())
+		{
+			return ret.value();
+		}
+
+		return run_code(cons, adapter, code, cache);
 	}
 
-	return run_code(cons, adapter, ss.str());
+	return run_code(cons, adapter, code);
+}
+
+int clox::driver::run_prelude(helper::console &cons, const std::shared_ptr<vm_interpreter_adapter> &adapter,
+							  const std::string &name)
+{
+	auto code = read_source(name);
+
+	return scan_parse_and_run(cons, code, [&adapter, &code](const auto &stmts)
+	{
+		return adapter->prelude(code, stmts);
+	});
 }
 
 int clox::driver::run_repl(helper::console &cons, const std::shared_ptr<interpreter_adapter> &adapter)
@@ -101,8 +179,26 @@ int clox::driver::run_repl(helper::console &cons, const std::shared_ptr<interpre
 		logger::instance().clear_error();
 
 		scanner sc{line.value_or("")};
-		parser ps{sc.scan()};
-		auto stmt = ps.parse();
+
+		vector<token> tokens{};
+		{
+			auto _t = time_statistic::instance().measure(statistic_phase::SCANNING);
+			tokens = sc.scan();
+		}
+
+		time_statistic::instance().count(statistic_counter::TOKENS, tokens.size());
+
+		auto nodes_before = parser_class_base::created_count();
+
+		vector<shared_ptr<statement>> stmt{};
+		{
+			auto _t = time_statistic::instance().measure(statistic_phase::PARSING);
+
+			parser ps{std::move(tokens)};
+			stmt = ps.parse();
+		}
+
+		time_statistic::instance().count(statistic_counter::AST_NODES, parser_class_base::created_count() - nodes_before);
 
 		if (logger::instance().has_errors())
 		{
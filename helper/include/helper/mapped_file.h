@@ -0,0 +1,82 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/2/2022.
+//
+
+#pragma once
+
+#include <string>
+#include <span>
+#include <cstddef>
+
+namespace clox::helper
+{
+
+/// \brief read-only memory mapping of a whole file
+class mapped_file final
+{
+public:
+	mapped_file() = default;
+
+	/// \brief map the file at path. Check valid() for the result, because absent files are expected in most usages.
+	explicit mapped_file(const std::string& path);
+
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	mapped_file(mapped_file&& other) noexcept;
+
+	mapped_file& operator=(mapped_file&& other) noexcept;
+
+	[[nodiscard]] bool valid() const
+	{
+		return data_ != nullptr;
+	}
+
+	[[nodiscard]] std::span<const std::byte> data() const
+	{
+		return { data_, size_ };
+	}
+
+	[[nodiscard]] size_t size() const
+	{
+		return size_;
+	}
+
+private:
+	void unmap();
+
+	const std::byte* data_{ nullptr };
+
+	size_t size_{ 0 };
+
+#ifdef _WIN32
+	void* mapping_handle_{ nullptr };
+#endif
+};
+
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/20/2022.
+//
+
+#pragma once
+
+#include <base/base.h>
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace clox::helper
+{
+
+enum class statistic_phase : size_t;
+
+enum class perf_event : size_t
+{
+	CYCLES,
+	INSTRUCTIONS,
+	BRANCHES,
+	BRANCH_MISSES,
+	L1D_MISSES, // read misses of the level 1 data cache
+	LLC_MISSES, // read misses of the last level cache
+
+	EVENT_COUNT,
+};
+
+/// \brief values of every counter, scaled up if the counters were multiplexed
+struct perf_sample
+{
+	std::array<uint64_t, static_cast<size_t>(perf_event::EVENT_COUNT)> values{};
+
+	[[nodiscard]] uint64_t operator[](perf_event e) const
+	{
+		return values[static_cast<size_t>(e)];
+	}
+
+	perf_sample& operator+=(const perf_sample& other);
+
+	friend perf_sample operator-(const perf_sample& lhs, const perf_sample& rhs);
+};
+
+/// \brief hardware performance counters of the current thread by perf_event_open, counting user space only
+/// \details counters the processor or the kernel doesn't allow are left out, and if none are allowed, nothing is counted
+class perf_counters final
+		: public base::singleton<perf_counters>
+{
+public:
+	perf_counters() = default;
+
+	~perf_counters();
+
+	/// \return false if no counter can be opened, with the reason in error()
+	bool open();
+
+	void close();
+
+	[[nodiscard]] bool enabled() const
+	{
+		return leader_ >= 0;
+	}
+
+	[[nodiscard]] const std::string& error() const
+	{
+		return error_;
+	}
+
+	[[nodiscard]] bool available(perf_event e) const
+	{
+		return fds_[static_cast<size_t>(e)] >= 0;
+	}
+
+	/// \return current values of the counters, all zero if disabled
+	[[nodiscard]] perf_sample read() const;
+
+	void add(statistic_phase phase, const perf_sample& delta);
+
+	void print_table(std::ostream& os) const;
+
+	/// \brief print counters by name, with IPC and miss rates
+	void print_rows(std::ostream& os, std::string_view title,
+			const std::vector<std::pair<std::string, perf_sample>>& rows) const;
+
+private:
+	int leader_{ -1 };
+
+	std::array<int, static_cast<size_t>(perf_event::EVENT_COUNT)> fds_{ -1, -1, -1, -1, -1, -1 };
+
+	/// \brief position of each counter in what the group reads, for the ones left out are absent
+	std::array<size_t, static_cast<size_t>(perf_event::EVENT_COUNT)> positions_{};
+
+	size_t opened_{ 0 };
+
+	std::string error_{};
+
+	/// \brief by statistic_phase
+	std::vector<perf_sample> phases_{};
+};
+
+}
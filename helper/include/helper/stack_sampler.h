@@ -0,0 +1,165 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/18/2022.
+//
+
+#pragma once
+
+#include <base/base.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace clox::helper
+{
+
+/// \brief a sampling profiler of Lox call stacks, driven by SIGPROF.
+/// The signal handler asks the running interpreter to copy its frames as raw words, and appends them to a ring buffer,
+/// all without allocating or locking. They are resolved to names and lines later, in ordinary code, while what they
+/// point to is still alive, and accumulated as folded stacks for flame graphs.
+///
+/// Only signals to the thread which started the sampler are taken, the others are counted as dropped.
+class stack_sampler final
+		: public base::singleton<stack_sampler>
+{
+public:
+	struct raw_frame
+	{
+		uint64_t function;
+		uint64_t location;
+	};
+
+	/// \brief copy up to capacity frames of the source, outermost first. Called in the signal handler.
+	using capture_type = size_t (*)(void* source, raw_frame* frames, size_t capacity) noexcept;
+
+	/// \brief name a frame captured from the source
+	using resolve_type = std::string (*)(void* source, const raw_frame& frame);
+
+	/// \brief deeper stacks keep their innermost frames
+	static inline constexpr size_t MAX_DEPTH = 128;
+
+	static inline constexpr size_t RING_WORDS = 1 << 20;
+
+	stack_sampler() = default;
+
+	~stack_sampler();
+
+	/// \return whether sampling is supported on this platform
+	[[nodiscard]] static bool available();
+
+	/// \brief sample the calling thread frequency times every second of CPU time
+	/// \return false if the timer can not be set up
+	bool start(size_t frequency);
+
+	void stop();
+
+	[[nodiscard]] bool running() const
+	{
+		return running_;
+	}
+
+	/// \brief sample the source from now on, until it is detached
+	void attach(void* source, capture_type capture, resolve_type resolve);
+
+	/// \brief resolve what is sampled from the source, and sample whatever was sampled before it again
+	void detach(void* source);
+
+	/// \brief signals arriving until leave_critical are dropped, for the frames of the source are being changed
+	void enter_critical() noexcept
+	{
+		critical_.store(true, std::memory_order_relaxed);
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+	}
+
+	void leave_critical() noexcept
+	{
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+		critical_.store(false, std::memory_order_relaxed);
+	}
+
+	/// \return whether the ring buffer is more than half full
+	[[nodiscard]] bool needs_drain() const noexcept
+	{
+		return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed) > RING_WORDS / 2;
+	}
+
+	/// \brief resolve the samples in the ring buffer with the current source
+	void drain();
+
+	/// \brief write each stack sampled, as names separated by ';', followed by how many times
+	void write_folded(std::ostream& os);
+
+	[[nodiscard]] size_t samples() const
+	{
+		return samples_;
+	}
+
+	[[nodiscard]] size_t dropped() const
+	{
+		return dropped_.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct source_entry
+	{
+		void* source{ nullptr };
+		capture_type capture{ nullptr };
+		resolve_type resolve{ nullptr };
+	};
+
+	static void handle_signal(int signal);
+
+	void sample() noexcept;
+
+	/// \brief the source the handler captures, always the last attached
+	std::atomic<void*> source_{ nullptr };
+	std::atomic<capture_type> capture_{ nullptr };
+	std::atomic<bool> critical_{ false };
+
+	std::vector<source_entry> sources_{};
+
+	std::unique_ptr<uint64_t[]> ring_{};
+
+	/// \brief words written by the handler and read by drain, which only grow, and wrap around the ring
+	std::atomic<size_t> head_{ 0 };
+	std::atomic<size_t> tail_{ 0 };
+
+	std::atomic<size_t> dropped_{ 0 };
+
+	size_t samples_{ 0 };
+
+	long thread_id_{ 0 };
+
+	bool running_{ false };
+
+	std::map<std::string, size_t> folded_{};
+};
+
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/17/2022.
+//
+
+#pragma once
+
+#include <base/base.h>
+
+#include <helper/perf_counters.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+
+namespace clox::helper
+{
+
+enum class statistic_phase : size_t
+{
+	SCANNING,
+	PARSING,
+	RESOLVING,
+	OPTIMIZING,
+	CODEGEN,
+	EXECUTION,
+	GC, // part of the phase it happens in, mostly execution
+
+	PHASE_COUNT,
+};
+
+/// \return the name of the phase, as the time statistic, hardware counters and traces show it
+[[nodiscard]] std::string_view phase_name(statistic_phase phase);
+
+enum class statistic_counter : size_t
+{
+	TOKENS,
+	AST_NODES,
+	BYTECODE_BYTES,
+	INSTRUCTIONS, // only counted with --count-instructions
+	OBJECTS,
+	OBJECT_BYTES,
+
+	COUNTER_COUNT,
+};
+
+/// \brief where the time of running scripts goes, measured by a monotonic clock
+class time_statistic final
+		: public base::singleton<time_statistic>
+{
+public:
+	using clock_type = std::chrono::steady_clock;
+
+	/// \brief add the time from its construction to its destruction to the phase, and trace it as a span if tracing.
+	/// Hardware counters are added to the phase as well if they are enabled.
+	class scoped_timer final
+	{
+	public:
+		scoped_timer(time_statistic& stat, statistic_phase phase);
+
+		~scoped_timer();
+
+		scoped_timer(const scoped_timer&) = delete;
+
+		scoped_timer& operator=(const scoped_timer&) = delete;
+
+	private:
+		time_statistic* stat_{ nullptr };
+		bool tracing_{ false };
+		perf_counters* perf_{ nullptr };
+		perf_sample perf_start_{};
+		statistic_phase phase_{};
+		clock_type::time_point start_{};
+	};
+
+	time_statistic() = default;
+
+	void enable(bool enabled)
+	{
+		enabled_ = enabled;
+	}
+
+	[[nodiscard]] bool enabled() const
+	{
+		return enabled_;
+	}
+
+	/// \return a timer measuring the phase until it is destroyed, which does nothing if the statistic is disabled
+	[[nodiscard]] scoped_timer measure(statistic_phase phase)
+	{
+		return scoped_timer{ *this, phase };
+	}
+
+	void add(statistic_phase phase, clock_type::duration time);
+
+	void count(statistic_counter counter, size_t n);
+
+	void clear();
+
+	void print_table(std::ostream& os) const;
+
+	void print_json(std::ostream& os) const;
+
+private:
+	struct phase_record
+	{
+		clock_type::duration time{ 0 };
+		size_t times{ 0 };
+	};
+
+	bool enabled_{ false };
+
+	std::array<phase_record, static_cast<size_t>(statistic_phase::PHASE_COUNT)> phases_{};
+
+	std::array<size_t, static_cast<size_t>(statistic_counter::COUNTER_COUNT)> counters_{};
+};
+
+}
@@ -0,0 +1,166 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/19/2022.
+//
+
+#pragma once
+
+#include <base/base.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace clox::helper
+{
+
+/// \brief records spans as Chrome trace events, which chrome://tracing and Perfetto open
+/// \details every thread buffers its own events, and a background thread writes full buffers out
+class trace_recorder final
+		: public base::singleton<trace_recorder>
+{
+public:
+	using clock_type = std::chrono::steady_clock;
+
+	/// \brief a span from its construction to its destruction, which does nothing if the recorder is stopped
+	class scoped_span final
+	{
+	public:
+		scoped_span(trace_recorder& recorder, std::string_view name, std::string_view category);
+
+		~scoped_span();
+
+		scoped_span(const scoped_span&) = delete;
+
+		scoped_span& operator=(const scoped_span&) = delete;
+
+	private:
+		trace_recorder* recorder_{ nullptr };
+		std::string_view name_{};
+		std::string_view category_{};
+		clock_type::time_point start_{};
+	};
+
+	trace_recorder() = default;
+
+	~trace_recorder();
+
+	/// \brief begin writing to the file
+	/// \param threshold Lox and native function calls shorter than it are left out
+	/// \return false if the file can't be written
+	bool start(const std::string& path, clock_type::duration threshold);
+
+	/// \brief write out what all threads buffered and finish the file
+	void stop();
+
+	[[nodiscard]] bool enabled() const
+	{
+		return enabled_;
+	}
+
+	[[nodiscard]] clock_type::duration threshold() const
+	{
+		return threshold_;
+	}
+
+	[[nodiscard]] scoped_span span(std::string_view name, std::string_view category)
+	{
+		return scoped_span{ *this, name, category };
+	}
+
+	/// \brief record a span that has ended
+	/// \param category must outlive the recorder, like a string literal
+	void complete(std::string name, std::string_view category, clock_type::time_point start, clock_type::time_point end);
+
+	/// \brief record a function call if it is not shorter than the threshold
+	void complete_call(std::string name, std::string_view category, clock_type::time_point start,
+			clock_type::time_point end)
+	{
+		if (end - start >= threshold_)
+		{
+			complete(std::move(name), category, start, end);
+		}
+	}
+
+private:
+	static inline constexpr size_t FLUSH_EVENTS = 4096;
+
+	struct trace_event
+	{
+		std::string name;
+		std::string_view category;
+		clock_type::time_point start;
+		clock_type::duration duration;
+	};
+
+	struct thread_buffer
+	{
+		std::mutex lock{};
+		std::vector<trace_event> events{};
+		size_t tid{ 0 };
+	};
+
+	struct flush_batch
+	{
+		size_t tid;
+		std::vector<trace_event> events;
+	};
+
+	thread_buffer& local_buffer();
+
+	void hand_over(thread_buffer& buf);
+
+	void write_loop();
+
+	void write(const flush_batch& batch);
+
+	std::atomic<bool> enabled_{ false };
+
+	clock_type::duration threshold_{};
+
+	clock_type::time_point origin_{};
+
+	std::ofstream file_{};
+	bool first_event_{ true };
+
+	std::mutex buffers_lock_{};
+	std::vector<std::shared_ptr<thread_buffer>> buffers_{};
+
+	std::mutex queue_lock_{};
+	std::condition_variable queue_cond_{};
+	std::vector<flush_batch> queue_{};
+	bool stopping_{ false };
+
+	std::thread writer_{};
+};
+
+}
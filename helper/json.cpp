@@ -0,0 +1,62 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <helper/json.h>
+
+#include <format>
+
+using namespace std;
+
+std::string clox::helper::escape_json(std::string_view str)
+{
+	string ret{};
+	ret.reserve(str.size());
+
+	for (auto c: str)
+	{
+		switch (c)
+		{
+		case '"':
+			ret += "\\\"";
+			break;
+		case '\\':
+			ret += "\\\\";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				ret += std::format("\\u{:04x}", static_cast<unsigned>(c));
+			}
+			else
+			{
+				ret += c;
+			}
+			break;
+		}
+	}
+
+	return ret;
+}
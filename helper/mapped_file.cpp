@@ -0,0 +1,163 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/2/2022.
+//
+
+#include <helper/mapped_file.h>
+
+#include <utility>
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#else
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+clox::helper::mapped_file::mapped_file(const std::string& path)
+{
+	auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file); // the mapping keeps the file open
+
+	if (!mapping)
+	{
+		return;
+	}
+
+	auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		CloseHandle(mapping);
+		return;
+	}
+
+	mapping_handle_ = mapping;
+	data_ = static_cast<const std::byte*>(view);
+	size_ = static_cast<size_t>(size.QuadPart);
+}
+
+void clox::helper::mapped_file::unmap()
+{
+	if (data_)
+	{
+		UnmapViewOfFile(data_);
+		CloseHandle(mapping_handle_);
+	}
+
+	data_ = nullptr;
+	size_ = 0;
+	mapping_handle_ = nullptr;
+}
+
+#else
+
+clox::helper::mapped_file::mapped_file(const std::string& path)
+{
+	auto fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	struct stat st{};
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return;
+	}
+
+	auto addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps the file open
+
+	if (addr == MAP_FAILED)
+	{
+		return;
+	}
+
+	data_ = static_cast<const std::byte*>(addr);
+	size_ = static_cast<size_t>(st.st_size);
+}
+
+void clox::helper::mapped_file::unmap()
+{
+	if (data_)
+	{
+		munmap(const_cast<std::byte*>(data_), size_);
+	}
+
+	data_ = nullptr;
+	size_ = 0;
+}
+
+#endif
+
+clox::helper::mapped_file::~mapped_file()
+{
+	unmap();
+}
+
+clox::helper::mapped_file::mapped_file(clox::helper::mapped_file&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+clox::helper::mapped_file& clox::helper::mapped_file::operator=(clox::helper::mapped_file&& other) noexcept
+{
+	if (this != &other)
+	{
+		unmap();
+
+		data_ = std::exchange(other.data_, nullptr);
+		size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+		mapping_handle_ = std::exchange(other.mapping_handle_, nullptr);
+#endif
+	}
+	return *this;
+}
@@ -0,0 +1,262 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/20/2022.
+//
+
+#include <helper/perf_counters.h>
+#include <helper/time_statistic.h>
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+
+#if defined(__linux__)
+
+#define CLOX_PERF_EVENTS
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+using namespace std;
+
+using namespace clox::helper;
+
+namespace
+{
+
+#ifdef CLOX_PERF_EVENTS
+
+constexpr uint64_t cache_read_miss(uint64_t cache)
+{
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr pair<uint32_t, uint64_t> EVENT_CONFIGS[]{
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE, cache_read_miss(PERF_COUNT_HW_CACHE_L1D) },
+		{ PERF_TYPE_HW_CACHE, cache_read_miss(PERF_COUNT_HW_CACHE_LL) },
+};
+
+static_assert(size(EVENT_CONFIGS) == static_cast<size_t>(perf_event::EVENT_COUNT));
+
+int open_event(uint32_t type, uint64_t config, int group)
+{
+	perf_event_attr attr{};
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group < 0 ? 1 : 0; // the group starts with its leader
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+#endif
+
+double ratio_of(uint64_t num, uint64_t den)
+{
+	return den ? static_cast<double>(num) / static_cast<double>(den) : 0.0;
+}
+
+}
+
+perf_sample& perf_sample::operator+=(const perf_sample& other)
+{
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		values[i] += other.values[i];
+	}
+
+	return *this;
+}
+
+perf_sample clox::helper::operator-(const perf_sample& lhs, const perf_sample& rhs)
+{
+	perf_sample ret{};
+	for (size_t i = 0; i < ret.values.size(); i++)
+	{
+		ret.values[i] = lhs.values[i] - rhs.values[i];
+	}
+
+	return ret;
+}
+
+perf_counters::~perf_counters()
+{
+	close();
+}
+
+bool perf_counters::open()
+{
+#ifdef CLOX_PERF_EVENTS
+	if (enabled())
+	{
+		return true;
+	}
+
+	for (size_t i = 0; i < fds_.size(); i++)
+	{
+		auto [type, config] = EVENT_CONFIGS[i];
+
+		auto fd = open_event(type, config, leader_);
+		if (fd < 0)
+		{
+			if (leader_ < 0)
+			{
+				error_ = std::format("perf_event_open failed: {}. Check /proc/sys/kernel/perf_event_paranoid.",
+						strerror(errno));
+				return false;
+			}
+
+			continue; // this one is not supported, but others may be
+		}
+
+		if (leader_ < 0)
+		{
+			leader_ = fd;
+		}
+
+		fds_[i] = fd;
+		positions_[i] = opened_++;
+	}
+
+	ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	return true;
+#else
+	error_ = "Hardware performance counters are only supported on Linux.";
+	return false;
+#endif
+}
+
+void perf_counters::close()
+{
+#ifdef CLOX_PERF_EVENTS
+	for (auto& fd: fds_)
+	{
+		if (fd >= 0)
+		{
+			::close(fd);
+			fd = -1;
+		}
+	}
+
+	leader_ = -1;
+	opened_ = 0;
+#endif
+}
+
+perf_sample perf_counters::read() const
+{
+	perf_sample ret{};
+
+#ifdef CLOX_PERF_EVENTS
+	if (!enabled())
+	{
+		return ret;
+	}
+
+	// nr, time enabled, time running, then a value for each counter
+	array<uint64_t, 3 + static_cast<size_t>(perf_event::EVENT_COUNT)> buf{};
+	if (::read(leader_, buf.data(), sizeof(buf)) < static_cast<ssize_t>((3 + opened_) * sizeof(uint64_t)))
+	{
+		return ret;
+	}
+
+	auto enabled = buf[1], running = buf[2];
+	if (running == 0)
+	{
+		return ret; // never scheduled
+	}
+
+	for (size_t i = 0; i < fds_.size(); i++)
+	{
+		if (fds_[i] < 0)continue;
+
+		auto value = buf[3 + positions_[i]];
+		ret.values[i] = enabled == running ? value : static_cast<uint64_t>(static_cast<double>(value) * ratio_of(enabled, running));
+	}
+#endif
+
+	return ret;
+}
+
+void perf_counters::add(statistic_phase phase, const perf_sample& delta)
+{
+	phases_.resize(static_cast<size_t>(statistic_phase::PHASE_COUNT));
+	phases_[static_cast<size_t>(phase)] += delta;
+}
+
+void perf_counters::print_table(std::ostream& os) const
+{
+	vector<pair<string, perf_sample>> rows{};
+	for (size_t i = 0; i < phases_.size(); i++)
+	{
+		if (phases_[i][perf_event::CYCLES] || phases_[i][perf_event::INSTRUCTIONS])
+		{
+			rows.emplace_back(string{ phase_name(static_cast<statistic_phase>(i)) }, phases_[i]);
+		}
+	}
+
+	print_rows(os, "Phase", rows);
+}
+
+void perf_counters::print_rows(std::ostream& os, std::string_view title,
+		const std::vector<std::pair<std::string, perf_sample>>& rows) const
+{
+	const auto column = [this](perf_event e, string_view text)
+	{
+		return available(e) ? string{ text } : string{ "n/a" };
+	};
+
+	os << std::format("{:<24}{:>16}{:>16}{:>8}{:>14}{:>14}{:>14}", title, "Cycles", "Instructions", "IPC",
+			"Branch miss", "L1D MPKI", "LLC MPKI") << endl;
+
+	for (const auto& [name, s]: rows)
+	{
+		auto instructions = s[perf_event::INSTRUCTIONS];
+
+		os << std::format("{:<24}{:>16}{:>16}{:>8}{:>14}{:>14}{:>14}",
+				name,
+				column(perf_event::CYCLES, std::format("{}", s[perf_event::CYCLES])),
+				column(perf_event::INSTRUCTIONS, std::format("{}", instructions)),
+				std::format("{:.2f}", ratio_of(instructions, s[perf_event::CYCLES])),
+				column(perf_event::BRANCH_MISSES,
+						std::format("{:.2f}%", 100.0 * ratio_of(s[perf_event::BRANCH_MISSES], s[perf_event::BRANCHES]))),
+				column(perf_event::L1D_MISSES,
+						std::format("{:.2f}", 1000.0 * ratio_of(s[perf_event::L1D_MISSES], instructions))),
+				column(perf_event::LLC_MISSES,
+						std::format("{:.2f}", 1000.0 * ratio_of(s[perf_event::LLC_MISSES], instructions)))) << endl;
+	}
+}
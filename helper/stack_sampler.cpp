@@ -0,0 +1,257 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/18/2022.
+//
+
+#include <helper/stack_sampler.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#if defined(__linux__)
+
+#define CLOX_STACK_SAMPLER
+
+#include <csignal>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#endif
+
+using namespace std;
+
+using namespace clox::helper;
+
+namespace
+{
+
+/// \brief the handler has no other way to find the sampler, and instance() may not be called in it
+std::atomic<stack_sampler*> active_sampler{ nullptr };
+
+#ifdef CLOX_STACK_SAMPLER
+struct sigaction previous_action{};
+#endif
+
+}
+
+stack_sampler::~stack_sampler()
+{
+	stop();
+}
+
+bool stack_sampler::available()
+{
+#ifdef CLOX_STACK_SAMPLER
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool stack_sampler::start(size_t frequency)
+{
+#ifdef CLOX_STACK_SAMPLER
+	if (running_ || frequency == 0)
+	{
+		return false;
+	}
+
+	ring_ = make_unique<uint64_t[]>(RING_WORDS);
+	thread_id_ = syscall(SYS_gettid);
+	active_sampler.store(this);
+
+	struct sigaction action{};
+	action.sa_handler = handle_signal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+
+	if (sigaction(SIGPROF, &action, &previous_action) != 0)
+	{
+		active_sampler.store(nullptr);
+		return false;
+	}
+
+	auto interval = static_cast<suseconds_t>(max<size_t>(1'000'000 / frequency, 1));
+
+	itimerval timer{};
+	timer.it_interval.tv_sec = interval / 1'000'000;
+	timer.it_interval.tv_usec = interval % 1'000'000;
+	timer.it_value = timer.it_interval;
+
+	if (setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+	{
+		sigaction(SIGPROF, &previous_action, nullptr);
+		active_sampler.store(nullptr);
+		return false;
+	}
+
+	running_ = true;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void stack_sampler::stop()
+{
+#ifdef CLOX_STACK_SAMPLER
+	if (!running_)
+	{
+		return;
+	}
+
+	itimerval timer{};
+	setitimer(ITIMER_PROF, &timer, nullptr);
+	sigaction(SIGPROF, &previous_action, nullptr);
+
+	drain();
+
+	active_sampler.store(nullptr);
+	running_ = false;
+#endif
+}
+
+void stack_sampler::attach(void* source, capture_type capture, resolve_type resolve)
+{
+	drain(); // what is in the ring belongs to the previous source
+
+	enter_critical();
+	sources_.push_back(source_entry{ source, capture, resolve });
+	source_.store(source, memory_order_relaxed);
+	capture_.store(capture, memory_order_relaxed);
+	leave_critical();
+}
+
+void stack_sampler::detach(void* source)
+{
+	drain();
+
+	enter_critical();
+	erase_if(sources_, [source](const source_entry& entry)
+	{
+		return entry.source == source;
+	});
+
+	source_.store(sources_.empty() ? nullptr : sources_.back().source, memory_order_relaxed);
+	capture_.store(sources_.empty() ? nullptr : sources_.back().capture, memory_order_relaxed);
+	leave_critical();
+}
+
+void stack_sampler::handle_signal([[maybe_unused]] int signal)
+{
+	auto saved_errno = errno;
+
+	if (auto sampler = active_sampler.load(memory_order_relaxed);sampler)
+	{
+		sampler->sample();
+	}
+
+	errno = saved_errno;
+}
+
+void stack_sampler::sample() noexcept
+{
+#ifdef CLOX_STACK_SAMPLER
+	auto capture = capture_.load(memory_order_relaxed);
+	if (syscall(SYS_gettid) != thread_id_ || critical_.load(memory_order_relaxed) || !capture || !ring_)
+	{
+		dropped_.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+
+	raw_frame frames[MAX_DEPTH];
+	auto depth = capture(source_.load(memory_order_relaxed), frames, MAX_DEPTH);
+
+	auto head = head_.load(memory_order_relaxed), tail = tail_.load(memory_order_relaxed);
+	if (RING_WORDS - (head - tail) < 1 + 2 * depth)
+	{
+		dropped_.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+
+	ring_[head++ % RING_WORDS] = depth;
+	for (size_t i = 0; i < depth; i++)
+	{
+		ring_[head++ % RING_WORDS] = frames[i].function;
+		ring_[head++ % RING_WORDS] = frames[i].location;
+	}
+
+	atomic_signal_fence(memory_order_release);
+	head_.store(head, memory_order_relaxed);
+#endif
+}
+
+void stack_sampler::drain()
+{
+	if (!ring_)
+	{
+		return;
+	}
+
+	auto head = head_.load(memory_order_relaxed);
+	atomic_signal_fence(memory_order_acquire);
+
+	auto tail = tail_.load(memory_order_relaxed);
+
+	// the handler only appends, so samples up to head are complete
+	while (tail != head)
+	{
+		auto depth = ring_[tail++ % RING_WORDS];
+
+		string stack{};
+		for (size_t i = 0; i < depth; i++)
+		{
+			raw_frame frame{ ring_[tail % RING_WORDS], ring_[(tail + 1) % RING_WORDS] };
+			tail += 2;
+
+			if (!sources_.empty())
+			{
+				if (!stack.empty())
+				{
+					stack += ';';
+				}
+				stack += sources_.back().resolve(sources_.back().source, frame);
+			}
+		}
+
+		if (!stack.empty())
+		{
+			folded_[stack]++;
+			samples_++;
+		}
+	}
+
+	tail_.store(tail, memory_order_relaxed);
+}
+
+void stack_sampler::write_folded(std::ostream& os)
+{
+	drain();
+
+	for (const auto& [stack, count]: folded_)
+	{
+		os << stack << ' ' << count << '\n';
+	}
+}
@@ -0,0 +1,167 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/17/2022.
+//
+
+#include <helper/time_statistic.h>
+#include <helper/trace_recorder.h>
+
+#include <format>
+#include <string_view>
+
+using namespace std;
+
+using namespace clox::helper;
+
+namespace
+{
+
+constexpr string_view PHASE_NAMES[]{
+		"scanning",
+		"parsing",
+		"resolving",
+		"optimizing",
+		"codegen",
+		"execution",
+		"gc",
+};
+
+constexpr string_view COUNTER_NAMES[]{
+		"tokens",
+		"ast_nodes",
+		"bytecode_bytes",
+		"instructions",
+		"objects",
+		"object_bytes",
+};
+
+static_assert(size(PHASE_NAMES) == static_cast<size_t>(statistic_phase::PHASE_COUNT));
+static_assert(size(COUNTER_NAMES) == static_cast<size_t>(statistic_counter::COUNTER_COUNT));
+
+double milliseconds_of(time_statistic::clock_type::duration time)
+{
+	return chrono::duration<double, milli>{ time }.count();
+}
+
+}
+
+std::string_view clox::helper::phase_name(statistic_phase phase)
+{
+	return PHASE_NAMES[static_cast<size_t>(phase)];
+}
+
+time_statistic::scoped_timer::scoped_timer(time_statistic& stat, statistic_phase phase)
+		: stat_(stat.enabled() ? &stat : nullptr), tracing_(trace_recorder::instance().enabled()), phase_(phase)
+{
+	if (stat_ || tracing_)
+	{
+		start_ = clock_type::now();
+	}
+
+	if (auto& perf = perf_counters::instance();perf.enabled())
+	{
+		perf_ = &perf;
+		perf_start_ = perf.read();
+	}
+}
+
+time_statistic::scoped_timer::~scoped_timer()
+{
+	if (perf_)
+	{
+		perf_->add(phase_, perf_->read() - perf_start_);
+	}
+
+	if (!stat_ && !tracing_)
+	{
+		return;
+	}
+
+	auto end = clock_type::now();
+
+	if (stat_)
+	{
+		stat_->add(phase_, end - start_);
+	}
+
+	if (tracing_)
+	{
+		trace_recorder::instance().complete(string{ phase_name(phase_) }, "phase", start_, end);
+	}
+}
+
+void time_statistic::add(statistic_phase phase, clock_type::duration time)
+{
+	auto& record = phases_[static_cast<size_t>(phase)];
+	record.time += time;
+	record.times++;
+}
+
+void time_statistic::count(statistic_counter counter, size_t n)
+{
+	if (enabled_)
+	{
+		counters_[static_cast<size_t>(counter)] += n;
+	}
+}
+
+void time_statistic::clear()
+{
+	phases_ = {};
+	counters_ = {};
+}
+
+void time_statistic::print_table(std::ostream& os) const
+{
+	os << std::format("{:<16}{:>14}{:>10}\n", "phase", "time (ms)", "times");
+	for (size_t i = 0; i < phases_.size(); i++)
+	{
+		os << std::format("{:<16}{:>14.3f}{:>10}\n", PHASE_NAMES[i], milliseconds_of(phases_[i].time),
+				phases_[i].times);
+	}
+
+	os << std::format("{:<16}{:>14}\n", "counter", "value");
+	for (size_t i = 0; i < counters_.size(); i++)
+	{
+		os << std::format("{:<16}{:>14}\n", COUNTER_NAMES[i], counters_[i]);
+	}
+}
+
+void time_statistic::print_json(std::ostream& os) const
+{
+	os << "{\"phases\":{";
+	for (size_t i = 0; i < phases_.size(); i++)
+	{
+		os << std::format("{}\"{}\":{{\"milliseconds\":{:.3f},\"times\":{}}}", i ? "," : "", PHASE_NAMES[i],
+				milliseconds_of(phases_[i].time), phases_[i].times);
+	}
+
+	os << "},\"counters\":{";
+	for (size_t i = 0; i < counters_.size(); i++)
+	{
+		os << std::format("{}\"{}\":{}", i ? "," : "", COUNTER_NAMES[i], counters_[i]);
+	}
+
+	os << "}}\n";
+}
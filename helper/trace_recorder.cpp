@@ -0,0 +1,227 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/19/2022.
+//
+
+#include <helper/trace_recorder.h>
+#include <helper/json.h>
+
+#include <format>
+
+using namespace std;
+
+using namespace clox::helper;
+
+namespace
+{
+
+double microseconds_of(trace_recorder::clock_type::duration time)
+{
+	return chrono::duration<double, micro>{ time }.count();
+}
+
+}
+
+trace_recorder::scoped_span::scoped_span(trace_recorder& recorder, std::string_view name, std::string_view category)
+		: recorder_(recorder.enabled() ? &recorder : nullptr), name_(name), category_(category)
+{
+	if (recorder_)
+	{
+		start_ = clock_type::now();
+	}
+}
+
+trace_recorder::scoped_span::~scoped_span()
+{
+	if (recorder_)
+	{
+		recorder_->complete(string{ name_ }, category_, start_, clock_type::now());
+	}
+}
+
+trace_recorder::~trace_recorder()
+{
+	stop();
+}
+
+bool trace_recorder::start(const string& path, clock_type::duration threshold)
+{
+	file_.open(path, ios::out | ios::trunc);
+	if (!file_)
+	{
+		return false;
+	}
+
+	file_ << R"({"displayTimeUnit":"ms","traceEvents":[)";
+
+	first_event_ = true;
+	threshold_ = threshold;
+	origin_ = clock_type::now();
+	stopping_ = false;
+
+	writer_ = std::thread{ [this]
+	{
+		write_loop();
+	} };
+
+	enabled_ = true;
+	return true;
+}
+
+void trace_recorder::stop()
+{
+	if (!enabled_)
+	{
+		return;
+	}
+
+	enabled_ = false;
+
+	{
+		lock_guard g{ buffers_lock_ };
+		for (auto& buf: buffers_)
+		{
+			lock_guard bg{ buf->lock };
+			hand_over(*buf);
+		}
+	}
+
+	{
+		lock_guard g{ queue_lock_ };
+		stopping_ = true;
+	}
+	queue_cond_.notify_one();
+
+	writer_.join();
+
+	file_ << "]}" << endl;
+	file_.close();
+}
+
+void trace_recorder::complete(std::string name, std::string_view category, clock_type::time_point start,
+		clock_type::time_point end)
+{
+	if (!enabled_)
+	{
+		return;
+	}
+
+	auto& buf = local_buffer();
+
+	lock_guard g{ buf.lock };
+	buf.events.push_back(trace_event{ std::move(name), category, start, end - start });
+
+	if (buf.events.size() >= FLUSH_EVENTS)
+	{
+		hand_over(buf);
+	}
+}
+
+trace_recorder::thread_buffer& trace_recorder::local_buffer()
+{
+	// buffers stay owned by the recorder, so events of threads that have exited are still written
+	thread_local thread_buffer* local{ nullptr };
+
+	if (!local)
+	{
+		auto buf = make_shared<thread_buffer>();
+		buf->events.reserve(FLUSH_EVENTS);
+
+		lock_guard g{ buffers_lock_ };
+		buf->tid = buffers_.size() + 1;
+		buffers_.push_back(buf);
+
+		local = buf.get();
+	}
+
+	return *local;
+}
+
+void trace_recorder::hand_over(thread_buffer& buf)
+{
+	// the caller holds the lock of buf
+	if (buf.events.empty())
+	{
+		return;
+	}
+
+	flush_batch batch{ buf.tid, std::move(buf.events) };
+	buf.events = {};
+	buf.events.reserve(FLUSH_EVENTS);
+
+	{
+		lock_guard g{ queue_lock_ };
+		queue_.push_back(std::move(batch));
+	}
+	queue_cond_.notify_one();
+}
+
+void trace_recorder::write_loop()
+{
+	for (;;)
+	{
+		vector<flush_batch> batches{};
+		bool stopping{ false };
+
+		{
+			unique_lock g{ queue_lock_ };
+			queue_cond_.wait(g, [this]
+			{
+				return stopping_ || !queue_.empty();
+			});
+
+			batches.swap(queue_);
+			stopping = stopping_;
+		}
+
+		for (const auto& batch: batches)
+		{
+			write(batch);
+		}
+
+		if (stopping)
+		{
+			return;
+		}
+	}
+}
+
+void trace_recorder::write(const flush_batch& batch)
+{
+	for (const auto& e: batch.events)
+	{
+		if (!first_event_)
+		{
+			file_ << ",";
+		}
+		first_event_ = false;
+
+		file_ << std::format(R"({{"name":"{}","cat":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{}}})",
+				escape_json(e.name),
+				e.category,
+				microseconds_of(e.start - origin_),
+				microseconds_of(e.duration),
+				batch.tid) << "\n";
+	}
+}
@@ -38,6 +38,7 @@
 #include <logger/logger.h>
 
 #include <iostream>
+#include <algorithm>
 #include <format>
 #include <utility>
 
@@ -59,6 +60,116 @@ interpreter::interpreter(helper::console& cons)
 {
 	environment_ = globals_;
 	install_native_functions();
+
+	if (helper::stack_sampler::instance().running())
+	{
+		sample_frames_.push_back({ 0, 0 });
+		helper::stack_sampler::instance().attach(this, capture_frames, resolve_frame);
+		sampling_ = true;
+	}
+}
+
+interpreter::~interpreter()
+{
+	if (sampling_)
+	{
+		helper::stack_sampler::instance().detach(this);
+	}
+}
+
+namespace
+{
+/// \brief the line a statement is on, or 0 if it has no token telling it
+size_t statement_line(const shared_ptr<statement>& s)
+{
+	switch (s->get_type())
+	{
+	case PC_TYPE_print_statement:
+		return static_pointer_cast<print_statement>(s)->get_keyword().line();
+	case PC_TYPE_variable_statement:
+		return static_pointer_cast<variable_statement>(s)->get_name().line();
+	case PC_TYPE_while_statement:
+		return static_pointer_cast<while_statement>(s)->get_cond_l_paren().line();
+	case PC_TYPE_if_statement:
+		return static_pointer_cast<if_statement>(s)->get_cond_l_paren().line();
+	case PC_TYPE_return_statement:
+		return static_pointer_cast<return_statement>(s)->get_return_keyword().line();
+	case PC_TYPE_expression_statement:
+	{
+		auto expr = static_pointer_cast<expression_statement>(s)->get_expr();
+		switch (expr->get_type())
+		{
+		case PC_TYPE_call_expression:
+			return static_pointer_cast<call_expression>(expr)->get_paren().line();
+		case PC_TYPE_assignment_expression:
+			return static_pointer_cast<assignment_expression>(expr)->get_name().line();
+		case PC_TYPE_set_expression:
+			return static_pointer_cast<set_expression>(expr)->get_name().line();
+		case PC_TYPE_postfix_expression:
+			return static_pointer_cast<postfix_expression>(expr)->get_op().line();
+		case PC_TYPE_unary_expression:
+			return static_pointer_cast<unary_expression>(expr)->get_op().line();
+		default:
+			return 0;
+		}
+	}
+	default:
+		return 0;
+	}
+}
+}
+
+void interpreter::push_sample_frame(const std::string& name)
+{
+	if (!sampling_)
+	{
+		return;
+	}
+
+	auto [iter, inserted] = sample_name_ids_.try_emplace(name, sample_names_.size());
+	if (inserted)
+	{
+		sample_names_.push_back(name);
+	}
+
+	helper::stack_sampler::instance().enter_critical();
+	sample_frames_.push_back({ iter->second, 0 });
+	helper::stack_sampler::instance().leave_critical();
+}
+
+void interpreter::pop_sample_frame()
+{
+	if (!sampling_)
+	{
+		return;
+	}
+
+	helper::stack_sampler::instance().enter_critical();
+	sample_frames_.pop_back();
+	helper::stack_sampler::instance().leave_critical();
+}
+
+size_t interpreter::capture_frames(void* source, helper::stack_sampler::raw_frame* frames, size_t capacity) noexcept
+{
+	auto intp = static_cast<interpreter*>(source);
+
+	auto count = std::min(intp->sample_frames_.size(), capacity);
+	std::copy(intp->sample_frames_.end() - static_cast<ptrdiff_t>(count), intp->sample_frames_.end(), frames);
+
+	return count;
+}
+
+std::string interpreter::resolve_frame(void* source, const helper::stack_sampler::raw_frame& frame)
+{
+	auto intp = static_cast<interpreter*>(source);
+
+	auto& name = intp->sample_names_.at(frame.function);
+	if (frame.location == 0)
+	{
+		return name;
+	}
+
+	return std::format("{}:{}", name, frame.location);
 }
 
 
@@ -382,6 +493,14 @@ void interpreter::visit_print_statement(const shared_ptr<parsing::print_statemen
 
 void interpreter::execute(const shared_ptr<parsing::statement>& s)
 {
+	if (sampling_)
+	{
+		if (auto line = statement_line(s);line)
+		{
+			sample_frames_.back().location = line;
+		}
+	}
+
 	accept(*s, *dynamic_cast<statement_visitor<void>*>(this));
 }
 
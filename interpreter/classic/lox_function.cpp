@@ -25,8 +25,12 @@
 #include <interpreter/classic/return.h>
 #include <interpreter/classic/environment.h>
 
+#include <helper/trace_recorder.h>
+
 #include <memory>
 
+#include <gsl/gsl>
+
 using namespace std;
 
 using namespace clox::interpreting;
@@ -44,6 +48,23 @@ lox_function::call(interpreter* the_interpreter, const std::shared_ptr<parsing::
 		env->put(params[i].first.lexeme(), args[i]);
 	}
 
+	the_interpreter->push_sample_frame(decl_->get_name().lexeme());
+	auto _ = gsl::finally([the_interpreter]
+	{
+		the_interpreter->pop_sample_frame();
+	});
+
+	auto& tracer = helper::trace_recorder::instance();
+	auto start = tracer.enabled() ? helper::trace_recorder::clock_type::now()
+								  : helper::trace_recorder::clock_type::time_point{};
+	auto _t = gsl::finally([this, &tracer, start]
+	{
+		if (tracer.enabled())
+		{
+			tracer.complete_call(decl_->get_name().lexeme(), "lox", start, helper::trace_recorder::clock_type::now());
+		}
+	});
+
 	try
 	{
 		the_interpreter->execute_block(decl_->get_body(), env);
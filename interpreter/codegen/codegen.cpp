@@ -82,10 +82,10 @@ void codegen::scope_begin()
 	{
 		auto func = static_pointer_cast<function_scope>(scope);
 		function_top()->upvalue_count_ = func->upvalues().size();
-		emit_code(func->upvalues().size());
+		emit_operand(func->upvalues().size());
 		for (const auto& upval : func->upvalues())
 		{
-			emit_codes(upval->holds_symbol() /*it is a local variable */, upval->access_index());
+			emit_operands(upval->holds_symbol() /*it is a local variable */, upval->access_index());
 		}
 	}
 }
@@ -118,7 +118,7 @@ void codegen::scope_end()
 	{
 		emit_codes(
 			V(op_code::POP_N),
-			static_cast<chunk::code_type>(scope->names().size())
+			static_cast<chunk::operand_type>(scope->names().size())
 		);
 	}
 
@@ -130,6 +130,11 @@ std::shared_ptr<resolving::scope> codegen::current_scope()
 	return *scope_iterator_;
 }
 
+void codegen::skip_scopes(size_t count)
+{
+	current_scope()->skip_children(count);
+}
+
 void clox::interpreting::compiling::codegen::visit_assignment_expression(
 	const std::shared_ptr<assignment_expression>& ae)
 {
@@ -248,9 +253,9 @@ void clox::interpreting::compiling::codegen::visit_unary_expression(const std::s
 	case scanning::token_type::PLUS_PLUS:
 	case scanning::token_type::MINUS_MINUS:
 	{
-		if (!is_patchable(current_chunk()->peek(1)))
+		if (!is_patchable(current_chunk()->last_instruction()))
 		{
-			throw invalid_opcode(current_chunk()->peek(1));
+			throw invalid_opcode(current_chunk()->last_instruction());
 		}
 
 		op_code op = op_code::INC;
@@ -263,13 +268,14 @@ void clox::interpreting::compiling::codegen::visit_unary_expression(const std::s
 			op = vm::op_code::DEC;
 		}
 
-		if (!is_patchable(current_chunk()->peek(1)))
+		if (!is_patchable(current_chunk()->last_instruction()))
 		{
-			throw invalid_opcode(current_chunk()->peek(1));
+			throw invalid_opcode(current_chunk()->last_instruction());
 		}
 
-		auto unpatched = current_chunk()->peek(1);
-		current_chunk()->patch_end(VC(secondary_op_code_of(unpatched) | vm::secondary_op_code::SEC_OP_PREFIX, op), 1);
+		auto unpatched = current_chunk()->last_instruction();
+		current_chunk()->patch_last_instruction(
+			VC(secondary_op_code_of(unpatched) | vm::secondary_op_code::SEC_OP_PREFIX, op));
 
 		break;
 	}
@@ -281,6 +287,12 @@ void clox::interpreting::compiling::codegen::visit_unary_expression(const std::s
 
 void clox::interpreting::compiling::codegen::visit_this_expression(const std::shared_ptr<this_expression>& te)
 {
+	if (!inline_frames_.empty())
+	{
+		generate_inlined_argument(inline_frames_.back().candidate->params.size());
+		return;
+	}
+
 	emit_codes(te->get_keyword(), VC(SEC_OP_LOCAL, op_code::GET), 0);
 }
 
@@ -327,9 +339,9 @@ clox::interpreting::compiling::codegen::visit_postfix_expression(const std::shar
 	case scanning::token_type::PLUS_PLUS:
 	case scanning::token_type::MINUS_MINUS:
 	{
-		if (!is_patchable(current_chunk()->peek(1)))
+		if (!is_patchable(current_chunk()->last_instruction()))
 		{
-			throw invalid_opcode(current_chunk()->peek(1));
+			throw invalid_opcode(current_chunk()->last_instruction());
 		}
 
 		op_code op = op_code::INC;
@@ -342,13 +354,14 @@ clox::interpreting::compiling::codegen::visit_postfix_expression(const std::shar
 			op = vm::op_code::DEC;
 		}
 
-		if (!is_patchable(current_chunk()->peek(1)))
+		if (!is_patchable(current_chunk()->last_instruction()))
 		{
-			throw invalid_opcode(current_chunk()->peek(1));
+			throw invalid_opcode(current_chunk()->last_instruction());
 		}
 
-		auto unpatched = current_chunk()->peek(1);
-		current_chunk()->patch_end(VC(secondary_op_code_of(unpatched) | vm::secondary_op_code::SEC_OP_POSTFIX, op), 1);
+		auto unpatched = current_chunk()->last_instruction();
+		current_chunk()->patch_last_instruction(
+			VC(secondary_op_code_of(unpatched) | vm::secondary_op_code::SEC_OP_POSTFIX, op));
 		break;
 	}
 	default:
@@ -359,34 +372,7 @@ clox::interpreting::compiling::codegen::visit_postfix_expression(const std::shar
 void
 clox::interpreting::compiling::codegen::visit_literal_expression(const std::shared_ptr<literal_expression>& le)
 {
-	auto val = le->get_value();
-
-	std::visit([this, &le](auto&& arg)
-	{
-	  using T = std::decay_t<decltype(arg)>;
-
-	  if constexpr(std::is_same_v<T, boolean_literal_type>)
-	  {
-		  emit_code(le->get_token(),
-			  V(static_cast<boolean_literal_type>(arg) ? op_code::CONSTANT_TRUE : op_code::CONSTANT_FALSE));
-	  }
-	  else if constexpr(std::is_same_v<T, nil_value_tag_type>)
-	  {
-		  emit_code(le->get_token(), V(vm::op_code::CONSTANT_NIL));
-	  }
-	  else if constexpr(std::is_same_v<T, string_literal_type>)
-	  {
-		  emit_constant(le->get_token(), string_object::create_on_heap(heap_, arg));
-	  }
-	  else if constexpr(!std::is_same_v<T, empty_literal_tag>) // empty literal isn't meant to be a constant
-	  {
-		  emit_constant(le->get_token(), arg);
-	  }
-	  else
-	  {
-		  return; // do nothing for empty literal
-	  }
-	}, val);
+	emit_literal(le->get_token(), le->get_value());
 }
 
 void clox::interpreting::compiling::codegen::visit_grouping_expression(
@@ -399,6 +385,12 @@ void clox::interpreting::compiling::codegen::visit_var_expression(const std::sha
 {
 	auto name = ve->get_name();
 
+	if (auto param = inlined_parameter(ve);param)
+	{
+		generate_inlined_argument(param.value());
+		return;
+	}
+
 	auto binding = variable_lookup(ve);
 
 	if (binding)
@@ -545,6 +537,11 @@ void clox::interpreting::compiling::codegen::visit_call_expression(const std::sh
 	}
 	else if (annotation && !annotation->is_ctor()) [[likely]]
 	{
+		if (try_inline_call(ce, annotation))
+		{
+			return;
+		}
+
 		if (annotation->is_method())
 		{
 			auto get_expr = static_pointer_cast<get_expression>(ce->get_callee());
@@ -552,7 +549,15 @@ void clox::interpreting::compiling::codegen::visit_call_expression(const std::sh
 		}
 		else
 		{
-			emit_codes(ce->get_paren(), VC(SEC_OP_FUNC, op_code::PUSH), annotation->id());
+			// the clone for the argument types, if it is generated already
+			auto id = annotation->id();
+			if (auto specialization = resolver_->specialization_of(ce);
+				specialization && generated_specializations_.contains(specialization.value()))
+			{
+				id = specialization.value();
+			}
+
+			emit_codes(ce->get_paren(), VC(SEC_OP_FUNC, op_code::PUSH), id);
 			emit_code(ce->get_paren(), V(op_code::CLOSURE));
 		}
 
@@ -561,7 +566,12 @@ void clox::interpreting::compiling::codegen::visit_call_expression(const std::sh
 			generate(arg); // push arguments in the stack
 		}
 
-		if (annotation->is_method()) [[unlikely]]
+		if (annotation->is_method() && is_devirtualizable(annotation)) [[unlikely]]
+		{
+			emit_codes(ce->get_paren(), VC(SEC_OP_FUNC, op_code::INVOKE), annotation->id(),
+				ce->get_args().size()); // call the method directly, no subclass overrides it
+		}
+		else if (annotation->is_method()) [[unlikely]]
 		{
 			emit_codes(ce->get_paren(), V(op_code::INVOKE), annotation->id(),
 				ce->get_args().size()); // invoke the method
@@ -691,6 +701,24 @@ void clox::interpreting::compiling::codegen::visit_block_statement(const std::sh
 
 void clox::interpreting::compiling::codegen::visit_while_statement(const std::shared_ptr<while_statement>& ws)
 {
+	if (auto branch = ws->get_annotation<branch_annotation>();branch)
+	{
+		// the condition is known, so it is never tested
+		if (branch->taken())
+		{
+			auto loop_start = current_chunk()->count();
+
+			generate(ws->get_body());
+
+			emit_loop(loop_start);
+		}
+		else
+		{
+			skip_scopes(branch->dead_scopes());
+		}
+		return;
+	}
+
 	auto last_op =
 		current_chunk()->count(); // it will be the index of first instruction for cond. Prepared for LOOP instruction
 
@@ -717,6 +745,25 @@ clox::interpreting::compiling::codegen::visit_foreach_statement(const std::share
 
 void clox::interpreting::compiling::codegen::visit_if_statement(const std::shared_ptr<if_statement>& ifs)
 {
+	if (auto branch = ifs->get_annotation<branch_annotation>();branch)
+	{
+		// the condition is known, so only the live branch is generated
+		if (branch->taken())
+		{
+			generate(ifs->get_true_stmt());
+			skip_scopes(branch->dead_scopes());
+		}
+		else
+		{
+			skip_scopes(branch->dead_scopes());
+			if (ifs->get_false_stmt())
+			{
+				generate(ifs->get_false_stmt());
+			}
+		}
+		return;
+	}
+
 	generate(ifs->get_cond());
 
 	auto then_jmp = emit_jump(ifs->get_cond_l_paren(), V(op_code::JUMP_IF_FALSE));
@@ -778,7 +825,15 @@ clox::interpreting::compiling::codegen::visit_function_statement(const std::shar
 		declare_local_variable(param.first.lexeme());
 	}
 
-	generate(fs->get_body());
+	if (generate_through_ir(fs))
+	{
+		// scopes of the body are never entered
+		current_scope()->skip_children();
+	}
+	else
+	{
+		generate(fs->get_body());
+	}
 
 	scope_end();
 
@@ -793,6 +848,13 @@ clox::interpreting::compiling::codegen::visit_function_statement(const std::shar
 		set_constant(constant, func);
 	}
 
+	for (const auto& [id, clone]: pending_specializations_)
+	{
+		emit_codes(fs->get_name(), VC(SEC_OP_FUNC, vm::op_code::DEFINE), id, make_constant(clone));
+		generated_specializations_.insert(id);
+	}
+
+	pending_specializations_.clear();
 }
 
 void clox::interpreting::compiling::codegen::visit_return_statement(const std::shared_ptr<return_statement>& rs)
@@ -855,20 +917,54 @@ void codegen::emit_code(const token& lead_token, vm::full_opcode_type byte)
 	current_chunk()->write(byte, lead_token);
 }
 
+void codegen::emit_operand(vm::chunk::operand_type operand)
+{
+	current_chunk()->write_operand(operand);
+}
+
 void codegen::emit_return()
 {
 	emit_code(V(op_code::CONSTANT_NIL));
 	emit_code(V(op_code::RETURN));
 }
 
-vm::chunk::code_type codegen::emit_constant(const scanning::token& tk, const value& val)
+void codegen::emit_literal(const scanning::token& tk, const scanning::literal_value_type& val)
+{
+	std::visit([this, &tk](auto&& arg)
+	{
+	  using T = std::decay_t<decltype(arg)>;
+
+	  if constexpr(std::is_same_v<T, boolean_literal_type>)
+	  {
+		  emit_code(tk, V(static_cast<boolean_literal_type>(arg) ? op_code::CONSTANT_TRUE : op_code::CONSTANT_FALSE));
+	  }
+	  else if constexpr(std::is_same_v<T, nil_value_tag_type>)
+	  {
+		  emit_code(tk, V(vm::op_code::CONSTANT_NIL));
+	  }
+	  else if constexpr(std::is_same_v<T, string_literal_type>)
+	  {
+		  emit_constant(tk, string_object::create_on_heap(heap_, arg));
+	  }
+	  else if constexpr(!std::is_same_v<T, empty_literal_tag>) // empty literal isn't meant to be a constant
+	  {
+		  emit_constant(tk, arg);
+	  }
+	  else
+	  {
+		  return; // do nothing for empty literal
+	  }
+	}, val);
+}
+
+vm::chunk::operand_type codegen::emit_constant(const scanning::token& tk, const value& val)
 {
 	auto constant = make_constant(val);
 	emit_codes(tk, V(op_code::CONSTANT), constant);
 	return constant;
 }
 
-uint16_t codegen::make_constant(const value& val)
+vm::chunk::operand_type codegen::make_constant(const value& val)
 {
 	auto idx = current_chunk()->add_constant(val);
 	return idx;
@@ -879,7 +975,7 @@ void codegen::set_constant(vm::full_opcode_type pos, const value& val)
 	current_chunk()->constant_at(pos) = val;
 }
 
-void codegen::define_global_variable(const std::string& name, vm::chunk::code_type global,
+void codegen::define_global_variable(const std::string& name, vm::chunk::operand_type global,
 	std::optional<scanning::token> tk)
 {
 //	local_scopes_.front()->declare(name, local_scope::GLOBAL_SLOT);
@@ -899,14 +995,14 @@ void codegen::declare_local_variable(const string& name, size_t depth)
 //	local_totals_++;
 }
 
-uint16_t codegen::identifier_constant(const token& identifier)
+vm::chunk::operand_type codegen::identifier_constant(const token& identifier)
 {
 	return identifier_constant(identifier.lexeme());
 }
 
-uint16_t codegen::identifier_constant(const string& lexeme)
+vm::chunk::operand_type codegen::identifier_constant(const string& lexeme)
 {
-	return make_constant(lexeme);
+	return current_chunk()->add_name(constant_pool_, lexeme);
 }
 
 shared_ptr<named_symbol> codegen::variable_lookup(const string& name)
@@ -922,32 +1018,42 @@ std::shared_ptr<resolving::variable_annotation> codegen::variable_lookup(const s
 vm::chunk::difference_type codegen::emit_jump(const token& lead_token, vm::full_opcode_type jmp)
 {
 	emit_code(jmp);
-	emit_code(PATCHABLE_PLACEHOLDER);
-
-	return current_chunk()->count() - 1;
+	return current_chunk()->write_placeholder();
 }
 
 void codegen::patch_jump(vm::chunk::difference_type pos)
 {
-	auto dist = current_chunk()->count() - 1 - pos;
-	if (dist > numeric_limits<full_opcode_type>::max())
+	auto dist = current_chunk()->count() - (pos + chunk::MAX_OPERAND_SIZE);
+	if (dist > numeric_limits<chunk::operand_type>::max())
 	{
 		throw jump_too_long{ static_cast<size_t>(dist) };
 	}
 
-	current_chunk()->patch_begin(dist, pos);
+	current_chunk()->patch_operand(pos, dist);
 }
 
 void codegen::emit_loop(vm::chunk::difference_type pos)
 {
-	auto dist = current_chunk()->count() - pos + 2;
-	if (dist > numeric_limits<full_opcode_type>::max())
+	emit_code(V(op_code::LOOP));
+
+	// the distance counts its own operand, whose size depends on the distance
+	auto base = current_chunk()->count() - pos;
+	auto dist = base + 1;
+	for (size_t size = 1; size <= chunk::MAX_OPERAND_SIZE; size++)
+	{
+		dist = base + size;
+		if (chunk::operand_size(dist) == size)
+		{
+			break;
+		}
+	}
+
+	if (dist > numeric_limits<chunk::operand_type>::max())
 	{
 		throw jump_too_long{ static_cast<size_t>(dist) };
 	}
 
-	emit_code(V(op_code::LOOP));
-	emit_code(dist);
+	emit_operand(dist);
 }
 
 void codegen::function_push(vm::function_object_raw_pointer func)
@@ -969,8 +1075,11 @@ vm::function_object_raw_pointer codegen::function_pop(bool is_in_ctor)
 	}
 
 	auto top = function_top();
+	top->body()->seal();
 	functions_.pop_back();
 
+	sealed_bytecode_size_ += top->body()->count();
+
 	return top;
 }
 
@@ -979,6 +1088,11 @@ vm::function_object_raw_pointer codegen::function_top()
 	return functions_.back();
 }
 
+size_t codegen::bytecode_size()
+{
+	return sealed_bytecode_size_ + (functions_.empty() ? 0 : function_top()->body()->count());
+}
+
 vm::closure_object_raw_pointer codegen::top_level()
 {
 	return heap_->allocate<closure_object>(function_top());
@@ -0,0 +1,475 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/12/2022.
+//
+
+#include <base/configuration.h>
+
+#include <interpreter/codegen/codegen.h>
+#include <interpreter/codegen/inliner.h>
+
+#include <interpreter/vm/opcode.h>
+
+#include <resolver/ast_annotation.h>
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <numeric>
+#include <ranges>
+
+using namespace std;
+using namespace gsl;
+
+using namespace clox;
+using namespace clox::base;
+using namespace clox::scanning;
+using namespace clox::parsing;
+using namespace clox::resolving;
+using namespace clox::interpreting;
+using namespace clox::interpreting::compiling;
+using namespace clox::interpreting::vm;
+
+std::optional<inline_candidate>
+inline_analyzer::analyze(const std::shared_ptr<parsing::function_statement>& fs)
+{
+	if (fs->get_func_type() == function_statement_type::FST_CTOR)
+	{
+		return nullopt;
+	}
+
+	inline_candidate candidate{};
+	for (const auto& param: fs->get_params())
+	{
+		candidate.params.push_back(param.first.lexeme());
+	}
+	candidate.uses.resize(candidate.params.size() + 1, 0);
+
+	const auto& body = fs->get_body();
+	if (body.size() > 1)
+	{
+		return nullopt;
+	}
+	else if (body.size() == 1)
+	{
+		if (auto rs = dynamic_pointer_cast<return_statement>(body.front());rs)
+		{
+			candidate.value = rs->get_val();
+		}
+		else if (auto es = dynamic_pointer_cast<expression_statement>(body.front());es)
+		{
+			candidate.value = es->get_expr();
+			candidate.discarded = true;
+		}
+		else
+		{
+			return nullopt;
+		}
+	}
+
+	inline_analyzer analyzer{ candidate };
+	if (candidate.value)
+	{
+		analyzer.analyze(candidate.value);
+	}
+
+	if (!analyzer.eligible_)
+	{
+		return nullopt;
+	}
+
+	// the call evaluates the receiver, if any, and then arguments from left to right
+	vector<size_t> expected(candidate.params.size());
+	iota(expected.begin(), expected.end(), 0);
+
+	bool is_method = fs->get_func_type() != function_statement_type::FST_FUNCTION;
+	if (is_method)
+	{
+		expected.insert(expected.begin(), candidate.params.size());
+	}
+
+	candidate.ordered = candidate.ordered && analyzer.reads_ == expected;
+
+	return candidate;
+}
+
+inline_analyzer::inline_analyzer(inline_candidate& candidate)
+		: candidate_(candidate)
+{
+	candidate_.ordered = true;
+}
+
+void inline_analyzer::analyze(const shared_ptr<parsing::expression>& expr)
+{
+	if (!eligible_)
+	{
+		return;
+	}
+
+	if (++nodes_ > INLINE_SIZE_LIMIT)
+	{
+		eligible_ = false;
+		return;
+	}
+
+	accept(*expr, *static_cast<expression_visitor<void>*>(this));
+}
+
+void inline_analyzer::use(size_t index)
+{
+	candidate_.uses[index]++;
+	reads_.push_back(index);
+
+	if (conditional_depth_ > 0 || effect_seen_)
+	{
+		candidate_.ordered = false;
+	}
+}
+
+void inline_analyzer::effect()
+{
+	effect_seen_ = true;
+}
+
+void inline_analyzer::visit_assignment_expression(const std::shared_ptr<parsing::assignment_expression>& ptr)
+{
+	eligible_ = false;
+}
+
+void inline_analyzer::visit_binary_expression(const std::shared_ptr<parsing::binary_expression>& be)
+{
+	analyze(be->get_left());
+	analyze(be->get_right());
+
+	if (be->get_annotation<operator_annotation>())
+	{
+		effect(); // it calls the operator method
+	}
+}
+
+void inline_analyzer::visit_unary_expression(const std::shared_ptr<parsing::unary_expression>& ue)
+{
+	if (auto op = ue->get_op().type();op != token_type::MINUS && op != token_type::BANG)
+	{
+		eligible_ = false;
+		return;
+	}
+
+	analyze(ue->get_right());
+}
+
+void inline_analyzer::visit_this_expression(const std::shared_ptr<parsing::this_expression>& ptr)
+{
+	use(candidate_.params.size());
+}
+
+void inline_analyzer::visit_base_expression(const std::shared_ptr<parsing::base_expression>& ptr)
+{
+	eligible_ = false;
+}
+
+void inline_analyzer::visit_postfix_expression(const std::shared_ptr<parsing::postfix_expression>& ptr)
+{
+	eligible_ = false;
+}
+
+void inline_analyzer::visit_literal_expression(const std::shared_ptr<parsing::literal_expression>& le)
+{
+	if (holds_alternative<empty_literal_tag>(le->get_value()))
+	{
+		eligible_ = false;
+	}
+}
+
+void inline_analyzer::visit_grouping_expression(const std::shared_ptr<parsing::grouping_expression>& ge)
+{
+	analyze(ge->get_expr());
+}
+
+void inline_analyzer::visit_lambda_expression(const std::shared_ptr<parsing::lambda_expression>& ptr)
+{
+	eligible_ = false;
+}
+
+void inline_analyzer::visit_var_expression(const std::shared_ptr<parsing::var_expression>& ve)
+{
+	auto annotation = ve->get_annotation<variable_annotation>();
+	if (!annotation || !annotation->symbol() || annotation->upvalue())
+	{
+		eligible_ = false;
+		return;
+	}
+
+	if (annotation->symbol()->is_global())
+	{
+		effect(); // undefined globals are reported
+		return;
+	}
+
+	// the body declares nothing, so the only locals are parameters
+	auto iter = ranges::find(candidate_.params, ve->get_name().lexeme());
+	if (iter == candidate_.params.end())
+	{
+		eligible_ = false;
+		return;
+	}
+
+	use(static_cast<size_t>(iter - candidate_.params.begin()));
+}
+
+void inline_analyzer::visit_ternary_expression(const std::shared_ptr<parsing::ternary_expression>& te)
+{
+	analyze(te->get_cond());
+
+	conditional_depth_++;
+	analyze(te->get_true_expr());
+	analyze(te->get_false_expr());
+	conditional_depth_--;
+}
+
+void inline_analyzer::visit_logical_expression(const std::shared_ptr<parsing::logical_expression>& le)
+{
+	analyze(le->get_left());
+
+	conditional_depth_++;
+	analyze(le->get_right());
+	conditional_depth_--;
+}
+
+void inline_analyzer::visit_call_expression(const std::shared_ptr<parsing::call_expression>& ce)
+{
+	if (ce->get_callee()->get_type() == parsing::PC_TYPE_base_expression)
+	{
+		eligible_ = false;
+		return;
+	}
+
+	// follow what codegen evaluates for each kind of calls
+	if (auto annotation = ce->get_annotation<call_annotation>();!annotation)
+	{
+		analyze(ce->get_callee());
+	}
+	else if (annotation->is_ctor() && !annotation->statement())
+	{
+		effect(); // default constructors take no arguments
+		return;
+	}
+	else if (annotation->is_method())
+	{
+		analyze(static_pointer_cast<get_expression>(ce->get_callee())->get_object());
+	}
+
+	for (const auto& arg: ce->get_args())
+	{
+		analyze(arg);
+	}
+
+	effect();
+}
+
+void inline_analyzer::visit_list_initializer_expression(
+		const std::shared_ptr<parsing::list_initializer_expression>& ptr)
+{
+	eligible_ = false;
+}
+
+void inline_analyzer::visit_map_initializer_expression(
+		const std::shared_ptr<parsing::map_initializer_expression>& ptr)
+{
+	eligible_ = false;
+}
+
+void inline_analyzer::visit_get_expression(const std::shared_ptr<parsing::get_expression>& ge)
+{
+	if (auto annotation = ge->get_annotation<class_annotation>();!annotation || annotation->is_method())
+	{
+		eligible_ = false;
+		return;
+	}
+
+	analyze(ge->get_object());
+	effect(); // properties of nil are reported
+}
+
+void inline_analyzer::visit_set_expression(const std::shared_ptr<parsing::set_expression>& se)
+{
+	analyze(se->get_object());
+	analyze(se->get_val());
+	effect();
+}
+
+bool codegen::is_devirtualizable(const std::shared_ptr<resolving::call_annotation>& annotation) const
+{
+	return configurable_configuration_instance().optimize() && annotation->statement() &&
+		   !resolver_->hierarchy().is_overridden(annotation->statement());
+}
+
+bool codegen::try_inline_call(const std::shared_ptr<parsing::call_expression>& ce,
+	const std::shared_ptr<resolving::call_annotation>& annotation)
+{
+	if (!configurable_configuration_instance().optimize())
+	{
+		return false;
+	}
+
+	auto fs = dynamic_pointer_cast<function_statement>(annotation->statement());
+	if (!fs)
+	{
+		return false; // native functions
+	}
+
+	if (annotation->is_method() && !is_devirtualizable(annotation))
+	{
+		return false; // the receiver may select an override
+	}
+
+	// never unfold recursion
+	if (ranges::any_of(inline_frames_, [&fs](const inline_frame& frame)
+	{
+		return frame.callee == fs.get();
+	}))
+	{
+		return false;
+	}
+
+	if (!inline_candidates_.contains(fs.get()))
+	{
+		inline_candidates_.insert_or_assign(fs.get(), inline_analyzer::analyze(fs));
+	}
+
+	const auto& candidate = inline_candidates_.at(fs.get());
+	if (!candidate || candidate->params.size() != ce->get_args().size())
+	{
+		return false;
+	}
+
+	inline_frame frame{ .callee = fs.get(), .candidate = &candidate.value(), .args = ce->get_args() };
+	if (annotation->is_method())
+	{
+		frame.args.push_back(static_pointer_cast<get_expression>(ce->get_callee())->get_object());
+	}
+
+	for (const auto& arg: frame.args)
+	{
+		frame.trivial.push_back(is_trivial_argument(arg));
+	}
+
+	// arguments with effects are substituted only where the call would have evaluated them
+	if (!candidate->ordered && ranges::find(frame.trivial, false) != frame.trivial.end())
+	{
+		return false;
+	}
+
+	inline_frames_.push_back(std::move(frame));
+	auto _ = finally([this]
+	{
+		inline_frames_.pop_back();
+	});
+
+	if (candidate->value)
+	{
+		generate(candidate->value);
+	}
+	else
+	{
+		emit_code(ce->get_paren(), V(op_code::CONSTANT_NIL));
+	}
+
+	if (candidate->value && candidate->discarded)
+	{
+		emit_code(ce->get_paren(), V(op_code::POP));
+		emit_code(ce->get_paren(), V(op_code::CONSTANT_NIL));
+	}
+
+	return true;
+}
+
+bool codegen::is_trivial_argument(const std::shared_ptr<parsing::expression>& expr)
+{
+	switch (expr->get_type())
+	{
+	case PC_TYPE_literal_expression:
+		return !holds_alternative<empty_literal_tag>(
+			static_pointer_cast<literal_expression>(expr)->get_value());
+
+	case PC_TYPE_grouping_expression:
+		return is_trivial_argument(static_pointer_cast<grouping_expression>(expr)->get_expr());
+
+	case PC_TYPE_this_expression:
+		return inline_frames_.empty() || inline_frames_.back().trivial.at(inline_frames_.back().candidate->params.size());
+
+	case PC_TYPE_var_expression:
+	{
+		auto ve = static_pointer_cast<var_expression>(expr);
+		if (auto param = inlined_parameter(ve);param)
+		{
+			return inline_frames_.back().trivial[param.value()];
+		}
+
+		// locals can only be changed by the caller, unlike globals and captured ones
+		auto binding = variable_lookup(ve);
+		return binding && !binding->upvalue() && binding->symbol() && binding->symbol()->is_local() &&
+			   !binding->symbol()->is_captured();
+	}
+
+	default:
+		return false;
+	}
+}
+
+std::optional<size_t> codegen::inlined_parameter(const std::shared_ptr<parsing::var_expression>& ve)
+{
+	if (inline_frames_.empty())
+	{
+		return nullopt;
+	}
+
+	if (auto binding = variable_lookup(ve);!binding || binding->upvalue() || !binding->symbol() ||
+										   !binding->symbol()->is_local())
+	{
+		return nullopt;
+	}
+
+	const auto& params = inline_frames_.back().candidate->params;
+	if (auto iter = ranges::find(params, ve->get_name().lexeme());iter != params.end())
+	{
+		return static_cast<size_t>(iter - params.begin());
+	}
+
+	return nullopt;
+}
+
+void codegen::generate_inlined_argument(size_t index)
+{
+	// arguments belong to the caller, which might be inlined itself
+	auto frame = std::move(inline_frames_.back());
+	inline_frames_.pop_back();
+
+	auto _ = finally([this, &frame]
+	{
+		inline_frames_.push_back(std::move(frame));
+	});
+
+	generate(frame.args.at(index));
+}
@@ -0,0 +1,369 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#include <base/configuration.h>
+
+#include <interpreter/codegen/codegen.h>
+
+#include <interpreter/ir/builder.h>
+#include <interpreter/ir/passes.h>
+#include <interpreter/ir/slot_allocator.h>
+
+#include <interpreter/vm/opcode.h>
+
+#include <ranges>
+#include <unordered_map>
+
+using namespace std;
+
+using namespace clox;
+using namespace clox::base;
+using namespace clox::scanning;
+using namespace clox::parsing;
+using namespace clox::resolving;
+using namespace clox::interpreting;
+using namespace clox::interpreting::compiling;
+using namespace clox::interpreting::vm;
+
+bool codegen::generate_through_ir(const std::shared_ptr<parsing::function_statement>& fs)
+{
+	if (!configurable_configuration_instance().optimize() ||
+		fs->get_func_type() != function_statement_type::FST_FUNCTION ||
+		fs->get_annotation<function_annotation>() ||
+		current_scope()->scope_type() != scope_types::FUNCTION_SCOPE)
+	{
+		return false;
+	}
+
+	// closures read upvalues, which the IR does not model
+	if (!static_pointer_cast<function_scope>(current_scope())->upvalues().empty())
+	{
+		return false;
+	}
+
+	vector<shared_ptr<named_symbol>> params{};
+	for (const auto& param: fs->get_params())
+	{
+		params.push_back(current_scope()->name_typed<named_symbol>(param.first.lexeme()));
+	}
+
+	auto built = ir::builder::build(fs, params);
+	if (!built)
+	{
+		return false;
+	}
+
+	auto kind_of = [](type_id id)
+	{
+		switch (id)
+		{
+		case PRIMITIVE_TYPE_ID_INTEGER:
+			return ir::value_kind::INTEGER;
+		case PRIMITIVE_TYPE_ID_FLOATING:
+			return ir::value_kind::FLOATING;
+		default:
+			return ir::value_kind::UNKNOWN;
+		}
+	};
+
+	vector<ir::value_kind> kinds{};
+	for (const auto& param: params)
+	{
+		kinds.push_back(kind_of(param->type()->id()));
+	}
+
+	lower_ir(fs, built.value(), kinds);
+	emit_ir_c(fs, built.value(), kinds, function_top());
+
+	// clones for the argument types of calls, whose union typed parameters become the types they are called with
+	for (const auto& specialization: resolver_->specializations(fs))
+	{
+		auto clone = ir::builder::build(fs, params);
+
+		auto clone_kinds = kinds;
+		for (size_t i = 0; i < clone_kinds.size(); i++)
+		{
+			if (specialization.param_types[i] != PRIMITIVE_TYPE_ID_ANY)
+			{
+				clone_kinds[i] = kind_of(specialization.param_types[i]);
+			}
+		}
+
+		function_push(heap_->allocate<function_object>(fs->get_name().lexeme(), fs->get_params().size()));
+		lower_ir(fs, clone.value(), clone_kinds);
+		emit_ir_c(fs, clone.value(), clone_kinds, function_top());
+		pending_specializations_.emplace_back(specialization.id, function_pop());
+	}
+
+	return true;
+}
+
+void codegen::emit_ir_c(const std::shared_ptr<parsing::function_statement>& fs, const ir::function& func,
+	const vector<ir::value_kind>& params, function_object_raw_pointer target)
+{
+	if (!c_module_)
+	{
+		return;
+	}
+
+	if (auto symbol = c_module_->add(func, params, fs->get_name().lexeme());symbol)
+	{
+		native_candidates_.push_back(native_candidate{ target, symbol.value(), params });
+	}
+}
+
+void codegen::lower_ir(const std::shared_ptr<parsing::function_statement>& fs, ir::function& func,
+	const vector<ir::value_kind>& params)
+{
+	ir::run_passes(func);
+
+	auto slots = ir::allocate_slots(func);
+
+	// reserve the slots for temporaries right above the parameters
+	for (size_t i = 0; i < slots.temporaries; i++)
+	{
+		emit_code(fs->get_name(), V(op_code::CONSTANT_NIL));
+	}
+
+	auto order = func.reverse_post_order();
+
+	auto kinds = ir::value_kinds(func, order, params);
+
+	unordered_map<ir::block_id, chunk::difference_type> block_positions{};
+	unordered_map<ir::block_id, vector<chunk::difference_type>> pending_jumps{};
+
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		auto b = order[i];
+		auto next = i + 1 < order.size() ? order[i + 1] : ir::INVALID_BLOCK;
+
+		auto jump_to = [&](ir::block_id to, const token& tk, bool can_fall_through)
+		{
+			if (block_positions.contains(to))
+			{
+				emit_loop(block_positions.at(to));
+			}
+			else if (!can_fall_through || to != next)
+			{
+				pending_jumps[to].push_back(emit_jump(tk, V(op_code::JUMP)));
+			}
+		};
+
+		block_positions[b] = current_chunk()->count();
+		if (auto iter = pending_jumps.find(b);iter != pending_jumps.end())
+		{
+			for (auto pos: iter->second)
+			{
+				patch_jump(pos);
+			}
+			pending_jumps.erase(iter);
+		}
+
+		for (auto v: func.block(b).instructions)
+		{
+			const auto& inst = func.at(v);
+
+			switch (inst.op)
+			{
+			case ir::ir_op::PARAMETER:
+			case ir::ir_op::PHI:
+				break;
+
+			case ir::ir_op::PRINT:
+				emit_ir_value(func, slots, kinds, inst.operands.front());
+				emit_code(inst.location, V(op_code::PRINT));
+				break;
+
+			case ir::ir_op::RETURN:
+				emit_ir_value(func, slots, kinds, inst.operands.front());
+				emit_code(inst.location, V(op_code::RETURN));
+				break;
+
+			case ir::ir_op::JUMP:
+				emit_ir_phi_copies(func, slots, kinds, b, inst.targets.front());
+				jump_to(inst.targets.front(), inst.location, true);
+				break;
+
+			case ir::ir_op::BRANCH:
+			{
+				emit_ir_value(func, slots, kinds, inst.operands.front());
+				auto false_jump = emit_jump(inst.location, V(op_code::JUMP_IF_FALSE));
+
+				emit_code(inst.location, V(op_code::POP));
+				emit_ir_phi_copies(func, slots, kinds, b, inst.targets[0]);
+				jump_to(inst.targets[0], inst.location, false);
+
+				patch_jump(false_jump);
+
+				emit_code(inst.location, V(op_code::POP));
+				emit_ir_phi_copies(func, slots, kinds, b, inst.targets[1]);
+				jump_to(inst.targets[1], inst.location, true);
+				break;
+			}
+
+			default:
+				if (slots.inlined[v])
+				{
+					break;
+				}
+
+				emit_ir_computation(func, slots, kinds, v);
+
+				if (auto slot = slots.slots[v];slot != ir::slot_assignment::NO_SLOT)
+				{
+					emit_codes(inst.location, VC(SEC_OP_LOCAL, op_code::SET), slot);
+				}
+
+				// unused values are computed all the same for the runtime errors they might raise
+				emit_code(inst.location, V(op_code::POP));
+				break;
+			}
+		}
+	}
+}
+
+void codegen::emit_ir_value(const ir::function& func, const ir::slot_assignment& slots,
+	const vector<ir::value_kind>& kinds, ir::value_id v)
+{
+	if (slots.inlined[v])
+	{
+		emit_ir_computation(func, slots, kinds, v);
+	}
+	else
+	{
+		emit_codes(func.at(v).location, VC(SEC_OP_LOCAL, op_code::GET), slots.slots[v]);
+	}
+}
+
+void codegen::emit_ir_computation(const ir::function& func, const ir::slot_assignment& slots,
+	const vector<ir::value_kind>& kinds, ir::value_id v)
+{
+	const auto& inst = func.at(v);
+
+	if (inst.op == ir::ir_op::CONSTANT)
+	{
+		emit_literal(inst.location, inst.constant);
+		return;
+	}
+	else if (inst.op == ir::ir_op::LOAD_GLOBAL)
+	{
+		emit_codes(inst.location, VC(SEC_OP_GLOBAL, op_code::GET), identifier_constant(inst.name));
+		return;
+	}
+
+	for (auto op: inst.operands)
+	{
+		emit_ir_value(func, slots, kinds, op);
+	}
+
+	// operands of the same kind take the fast path of the VM, as long as they turn out to be that at runtime
+	secondary_opcode_base_type specialized{ 0 };
+	if (inst.operands.size() == 2 && kinds[inst.operands[0]] == kinds[inst.operands[1]])
+	{
+		if (kinds[inst.operands[0]] == ir::value_kind::INTEGER)specialized = SEC_OP_INTEGER;
+		else if (kinds[inst.operands[0]] == ir::value_kind::FLOATING)specialized = SEC_OP_FLOATING;
+	}
+
+	switch (inst.op)
+	{
+	case ir::ir_op::ADD:
+		emit_code(inst.location, VC(specialized, op_code::ADD));
+		break;
+	case ir::ir_op::SUBTRACT:
+		emit_code(inst.location, VC(specialized, op_code::SUBTRACT));
+		break;
+	case ir::ir_op::MULTIPLY:
+		emit_code(inst.location, VC(specialized, op_code::MULTIPLY));
+		break;
+	case ir::ir_op::DIVIDE:
+		emit_code(inst.location, V(op_code::DIVIDE));
+		break;
+	case ir::ir_op::POW:
+		emit_code(inst.location, V(op_code::POW));
+		break;
+	case ir::ir_op::EQUAL:
+		emit_code(inst.location, VC(specialized, op_code::EQUAL));
+		break;
+	case ir::ir_op::NOT_EQUAL:
+		emit_code(inst.location, VC(specialized, op_code::EQUAL));
+		emit_code(inst.location, V(op_code::NOT));
+		break;
+	case ir::ir_op::LESS:
+		emit_code(inst.location, VC(specialized, op_code::LESS));
+		break;
+	case ir::ir_op::LESS_EQUAL:
+		emit_code(inst.location, VC(specialized, op_code::LESS_EQUAL));
+		break;
+	case ir::ir_op::GREATER:
+		emit_code(inst.location, VC(specialized, op_code::GREATER));
+		break;
+	case ir::ir_op::GREATER_EQUAL:
+		emit_code(inst.location, VC(specialized, op_code::GREATER_EQUAL));
+		break;
+	case ir::ir_op::NEGATE:
+		emit_code(inst.location, V(op_code::NEGATE));
+		break;
+	case ir::ir_op::NOT:
+		emit_code(inst.location, V(op_code::NOT));
+		break;
+	default:
+		throw internal_codegen_error{ "Instruction without value" };
+	}
+}
+
+void codegen::emit_ir_phi_copies(const ir::function& func, const ir::slot_assignment& slots,
+	const vector<ir::value_kind>& kinds, ir::block_id from, ir::block_id to)
+{
+	const auto& preds = func.block(to).predecessors;
+	auto index = static_cast<size_t>(ranges::find(preds, from) - preds.begin());
+
+	vector<ir::value_id> phis{};
+	for (auto v: func.block(to).instructions)
+	{
+		if (func.at(v).op != ir::ir_op::PHI)
+		{
+			break;
+		}
+
+		auto source = func.at(v).operands[index];
+		if (slots.inlined[source] || slots.slots[source] != slots.slots[v])
+		{
+			phis.push_back(v);
+		}
+	}
+
+	// the copies happen at once, so every source is read before any phi is written
+	for (auto v: phis)
+	{
+		emit_ir_value(func, slots, kinds, func.at(v).operands[index]);
+	}
+
+	for (auto v: phis | views::reverse)
+	{
+		emit_codes(func.at(v).location, VC(SEC_OP_LOCAL, op_code::SET), slots.slots[v]);
+		emit_code(func.at(v).location, V(op_code::POP));
+	}
+}
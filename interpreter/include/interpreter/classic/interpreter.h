@@ -27,6 +27,7 @@
 #include <base/base.h>
 
 #include <helper/console.h>
+#include <helper/stack_sampler.h>
 
 #include <parser/gen/parser_classes.inc>
 
@@ -44,6 +45,8 @@
 
 #include <variant>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include "environment.h"
 
 namespace clox::interpreting::classic
@@ -63,6 +66,8 @@ public:
 public:
 	[[nodiscard]] explicit interpreter(helper::console& cons);
 
+	~interpreter();
+
 public:
 
 	void visit_expression_statement(const std::shared_ptr<parsing::expression_statement>& ptr) override;
@@ -156,6 +161,14 @@ private:
 
 	static bool is_truthy(evaluating_result res);
 
+	void push_sample_frame(const std::string& name);
+
+	void pop_sample_frame();
+
+	static size_t capture_frames(void* source, helper::stack_sampler::raw_frame* frames, size_t capacity) noexcept;
+
+	static std::string resolve_frame(void* source, const helper::stack_sampler::raw_frame& frame);
+
 
 	mutable bool repl_{ false };
 
@@ -164,5 +177,14 @@ private:
 	std::shared_ptr<classic::environment> globals_{ nullptr };
 	std::shared_ptr<classic::environment> environment_{ nullptr };
 
+	/// \brief whether the stack sampler takes call stacks of this
+	bool sampling_{ false };
+
+	/// \brief a shadow call stack for the sampler, of {name id, line}
+	std::vector<helper::stack_sampler::raw_frame> sample_frames_{};
+
+	std::vector<std::string> sample_names_{ "<script>" };
+	std::unordered_map<std::string, uint64_t> sample_name_ids_{};
+
 };
 }
@@ -28,18 +28,29 @@
 #include <parser/gen/parser_base.inc>
 
 #include <interpreter/vm/chunk.h>
+#include <interpreter/vm/constant_pool.h>
 #include <interpreter/vm/heap.h>
 #include <interpreter/vm/opcode.h>
 #include "object/closure_object.h"
 
 #include <interpreter/codegen/exceptions.h>
+#include <interpreter/codegen/inliner.h>
+
+#include <interpreter/ir/c_backend.h>
+#include <interpreter/ir/ir.h>
+#include <interpreter/ir/passes.h>
+#include <interpreter/ir/slot_allocator.h>
 
 #include <resolver/binding.h>
 #include <resolver/resolver.h>
 #include <resolver/ast_annotation.h>
 
 #include <concepts>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include "object/native_function_object.h"
 
 
@@ -51,8 +62,6 @@ class codegen final
 {
 public:
 	friend class vm::garbage_collector;
-
-	static inline constexpr auto PATCHABLE_PLACEHOLDER = std::numeric_limits<vm::full_opcode_type>::max();
 public:
 	explicit codegen(std::shared_ptr<vm::object_heap> heap, const resolving::resolver& rsv);
 
@@ -113,10 +122,34 @@ public:
 	void visit_class_statement(const std::shared_ptr<parsing::class_statement>& ptr) override;
 
 public:
+	/// \brief a function also translated to C, which is to be called instead once it is compiled
+	struct native_candidate
+	{
+		vm::function_object_raw_pointer func{ nullptr };
+
+		std::string symbol{};
+
+		std::vector<ir::value_kind> params{};
+	};
+
 	void generate(const std::vector<std::shared_ptr<parsing::statement>>& stmts);
 
 	vm::closure_object_raw_pointer top_level();
 
+	/// \brief translate functions generated through the IR to C as well, adding them to the module
+	void emit_c(ir::c_module& module)
+	{
+		c_module_ = &module;
+	}
+
+	[[nodiscard]] const std::vector<native_candidate>& native_candidates() const
+	{
+		return native_candidates_;
+	}
+
+	/// \return bytes of bytecode generated for every function, including the top level
+	[[nodiscard]] size_t bytecode_size();
+
 private:
 
 	std::shared_ptr<vm::chunk> current_chunk();
@@ -127,7 +160,7 @@ private:
 
 	void generate(const std::shared_ptr<parsing::expression>& s);
 
-	void define_global_variable(const std::string& name, vm::chunk::code_type global,
+	void define_global_variable(const std::string& name, vm::chunk::operand_type global,
 			std::optional<scanning::token> tk = std::nullopt);
 
 	void declare_local_variable(const std::string& name, size_t depth = 0);
@@ -142,6 +175,9 @@ private:
 
 	void scope_end();
 
+	/// \brief skip scopes of code that is never generated, keeping the scope iterator in step with the resolver
+	void skip_scopes(size_t count);
+
 	std::shared_ptr<resolving::named_symbol> variable_lookup(const std::string& name);
 
 	std::shared_ptr<resolving::variable_annotation> variable_lookup(const std::shared_ptr<parsing::expression>& expr);
@@ -150,21 +186,76 @@ private:
 
 	void emit_code(vm::full_opcode_type byte);
 
-	template<std::convertible_to<vm::full_opcode_type> ...Args>
-	void emit_codes(const scanning::token& lead_token, const Args& ...arg)
+	void emit_operand(vm::chunk::operand_type operand);
+
+	template<std::convertible_to<vm::chunk::operand_type> ...Args>
+	void emit_codes(const scanning::token& lead_token, vm::full_opcode_type op, const Args& ...operands)
 	{
-		(emit_code(lead_token, (vm::full_opcode_type)arg), ...);
+		emit_code(lead_token, op);
+		(emit_operand((vm::chunk::operand_type)operands), ...);
 	}
 
-	template<std::convertible_to<vm::full_opcode_type> ...Args>
-	void emit_codes(const Args& ...arg)
+	template<std::convertible_to<vm::chunk::operand_type> ...Args>
+	void emit_codes(vm::full_opcode_type op, const Args& ...operands)
 	{
-		(emit_code((vm::full_opcode_type)arg), ...);
+		emit_code(op);
+		(emit_operand((vm::chunk::operand_type)operands), ...);
+	}
+
+	template<std::convertible_to<vm::chunk::operand_type> ...Args>
+	void emit_operands(const Args& ...operands)
+	{
+		(emit_operand((vm::chunk::operand_type)operands), ...);
 	}
 
 	void emit_return();
 
-	vm::chunk::code_type emit_constant(const scanning::token& tk, const vm::value& val);
+	void emit_literal(const scanning::token& tk, const scanning::literal_value_type& val);
+
+	/// \brief whether the method bound to the call is overridden by no subclass,
+	/// so that it can be called without looking it up in the class of the receiver
+	[[nodiscard]] bool is_devirtualizable(const std::shared_ptr<resolving::call_annotation>& annotation) const;
+
+	/// \brief generate the body of a small callee in place of the call
+	/// \return false if the callee should be called as usual, in which case nothing is emitted
+	bool try_inline_call(const std::shared_ptr<parsing::call_expression>& ce,
+			const std::shared_ptr<resolving::call_annotation>& annotation);
+
+	/// \brief whether evaluating the expression any number of times, or not at all, is the same as evaluating it once
+	bool is_trivial_argument(const std::shared_ptr<parsing::expression>& expr);
+
+	/// \return the parameter of the function being inlined that the expression reads, if any
+	std::optional<size_t> inlined_parameter(const std::shared_ptr<parsing::var_expression>& ve);
+
+	/// \brief generate what is passed for a parameter of the function being inlined, in the context of its caller
+	void generate_inlined_argument(size_t index);
+
+	/// \brief generate the body of the function through the SSA IR, which is optimized before lowering
+	/// \return false if the function can not be expressed in the IR, in which case nothing is emitted
+	bool generate_through_ir(const std::shared_ptr<parsing::function_statement>& fs);
+
+	/// \brief optimize the function and emit it to the current chunk,
+	/// with arithmetic specialized for what the parameters are expected to be
+	void lower_ir(const std::shared_ptr<parsing::function_statement>& fs, ir::function& func,
+			const std::vector<ir::value_kind>& params);
+
+	/// \brief translate the function, already optimized by lowering, to C if a module is set
+	void emit_ir_c(const std::shared_ptr<parsing::function_statement>& fs, const ir::function& func,
+			const std::vector<ir::value_kind>& params, vm::function_object_raw_pointer target);
+
+	/// \brief push the value, computing it right here if it is inlined
+	void emit_ir_value(const ir::function& func, const ir::slot_assignment& slots,
+			const std::vector<ir::value_kind>& kinds, ir::value_id v);
+
+	/// \brief push the result of the instruction, computed from its operands
+	void emit_ir_computation(const ir::function& func, const ir::slot_assignment& slots,
+			const std::vector<ir::value_kind>& kinds, ir::value_id v);
+
+	/// \brief write the values the phis of to take from the edge of from
+	void emit_ir_phi_copies(const ir::function& func, const ir::slot_assignment& slots,
+			const std::vector<ir::value_kind>& kinds, ir::block_id from, ir::block_id to);
+
+	vm::chunk::operand_type emit_constant(const scanning::token& tk, const vm::value& val);
 
 	vm::chunk::difference_type emit_jump(const scanning::token& lead_token, vm::full_opcode_type jmp);
 
@@ -172,24 +263,54 @@ private:
 
 	void emit_loop(vm::chunk::difference_type pos);
 
-	uint16_t identifier_constant(const scanning::token& identifier);
+	vm::chunk::operand_type identifier_constant(const scanning::token& identifier);
 
-	uint16_t identifier_constant(const std::string& lexeme);
+	vm::chunk::operand_type identifier_constant(const std::string& lexeme);
 
 
 	void set_constant(vm::full_opcode_type pos, const vm::value& val);
 
-	uint16_t make_constant(const vm::value& val);
+	vm::chunk::operand_type make_constant(const vm::value& val);
 
 	std::vector<vm::function_object_raw_pointer> functions_{};
 
 	std::shared_ptr<vm::object_heap> heap_{};
 
+	std::shared_ptr<vm::constant_pool> constant_pool_{ std::make_shared<vm::constant_pool>() };
+
 	resolving::scope_collection scopes_;
 
 	resolving::scope_collection::iterator scope_iterator_;
 
 	const resolving::resolver* resolver_;
+
+	struct inline_frame
+	{
+		const parsing::function_statement* callee{ nullptr };
+
+		const inline_candidate* candidate{ nullptr };
+
+		/// \brief arguments for parameters, followed by the receiver for methods
+		std::vector<std::shared_ptr<parsing::expression>> args{};
+
+		std::vector<bool> trivial{};
+	};
+
+	std::unordered_map<const parsing::function_statement*, std::optional<inline_candidate>> inline_candidates_{};
+
+	std::vector<inline_frame> inline_frames_{};
+
+	/// \brief clones of the function being generated, which are defined right after it
+	std::vector<std::pair<resolving::function_id_type, vm::function_object_raw_pointer>> pending_specializations_{};
+
+	std::unordered_set<resolving::function_id_type> generated_specializations_{};
+
+	ir::c_module* c_module_{ nullptr };
+
+	std::vector<native_candidate> native_candidates_{};
+
+	/// \brief bytes of bytecode of the functions done
+	size_t sealed_bytecode_size_{ 0 };
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/12/2022.
+//
+
+#pragma once
+
+#include <parser/gen/parser_classes.inc>
+#include <parser/gen/parser_base.inc>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace clox::interpreting::compiling
+{
+
+/// \brief the body of a function small enough to be generated in place of calls to it
+struct inline_candidate
+{
+	/// \brief what the call evaluates to, nullptr for nil
+	std::shared_ptr<parsing::expression> value{};
+
+	/// \brief the value is computed only for its effect, and the call evaluates to nil, like setters
+	bool discarded{ false };
+
+	std::vector<std::string> params{};
+
+	/// \brief how many times each parameter is read, followed by how many times this is read
+	std::vector<size_t> uses{};
+
+	/// \brief this and every parameter are read exactly once, in the order the call evaluates them,
+	/// and before anything which might have an effect, so arguments with effects can be substituted
+	bool ordered{ false };
+};
+
+/// \brief decides whether a function is small and simple enough to be inlined.
+/// Bodies made of a single return or expression statement, reading only parameters, this and globals, qualify.
+class inline_analyzer final
+		: public parsing::expression_visitor<void>
+{
+public:
+	static inline constexpr size_t INLINE_SIZE_LIMIT = 16;
+
+	/// \return nullopt if the function should be called as usual
+	[[nodiscard]] static std::optional<inline_candidate> analyze(const std::shared_ptr<parsing::function_statement>& fs);
+
+	void visit_assignment_expression(const std::shared_ptr<parsing::assignment_expression>& ptr) override;
+
+	void visit_binary_expression(const std::shared_ptr<parsing::binary_expression>& ptr) override;
+
+	void visit_unary_expression(const std::shared_ptr<parsing::unary_expression>& ptr) override;
+
+	void visit_this_expression(const std::shared_ptr<parsing::this_expression>& ptr) override;
+
+	void visit_base_expression(const std::shared_ptr<parsing::base_expression>& ptr) override;
+
+	void visit_postfix_expression(const std::shared_ptr<parsing::postfix_expression>& ptr) override;
+
+	void visit_literal_expression(const std::shared_ptr<parsing::literal_expression>& ptr) override;
+
+	void visit_grouping_expression(const std::shared_ptr<parsing::grouping_expression>& ptr) override;
+
+	void visit_lambda_expression(const std::shared_ptr<parsing::lambda_expression>& ptr) override;
+
+	void visit_var_expression(const std::shared_ptr<parsing::var_expression>& ptr) override;
+
+	void visit_ternary_expression(const std::shared_ptr<parsing::ternary_expression>& ptr) override;
+
+	void visit_logical_expression(const std::shared_ptr<parsing::logical_expression>& ptr) override;
+
+	void visit_call_expression(const std::shared_ptr<parsing::call_expression>& ptr) override;
+
+	void visit_list_initializer_expression(const std::shared_ptr<parsing::list_initializer_expression>& ptr) override;
+
+	void visit_map_initializer_expression(const std::shared_ptr<parsing::map_initializer_expression>& ptr) override;
+
+	void visit_get_expression(const std::shared_ptr<parsing::get_expression>& ptr) override;
+
+	void visit_set_expression(const std::shared_ptr<parsing::set_expression>& ptr) override;
+
+private:
+	explicit inline_analyzer(inline_candidate& candidate);
+
+	void analyze(const std::shared_ptr<parsing::expression>& expr);
+
+	void use(size_t index);
+
+	void effect();
+
+	inline_candidate& candidate_;
+
+	bool eligible_{ true };
+
+	size_t nodes_{ 0 };
+
+	size_t conditional_depth_{ 0 };
+
+	bool effect_seen_{ false };
+
+	std::vector<size_t> reads_{};
+};
+
+}
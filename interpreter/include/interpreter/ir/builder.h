@@ -0,0 +1,171 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#pragma once
+
+#include <parser/gen/parser_classes.inc>
+#include <parser/gen/parser_base.inc>
+
+#include <resolver/ast_annotation.h>
+
+#include <interpreter/ir/ir.h>
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace clox::interpreting::ir
+{
+
+/// \brief builds SSA form from a resolved function, with the algorithm from
+/// Braun et al., Simple and Efficient Construction of Static Single Assignment Form.
+/// Functions using what the IR can not express, like calls, closures or classes, are refused.
+class builder final
+		: public parsing::expression_visitor<value_id>,
+		  public parsing::statement_visitor<void>
+{
+public:
+	/// \param params symbols of the parameters, in order
+	/// \return nullopt if the function can not be expressed in the IR
+	[[nodiscard]] static std::optional<function> build(const std::shared_ptr<parsing::function_statement>& fs,
+			const std::vector<std::shared_ptr<resolving::named_symbol>>& params);
+
+	value_id visit_assignment_expression(const std::shared_ptr<parsing::assignment_expression>& ptr) override;
+
+	value_id visit_binary_expression(const std::shared_ptr<parsing::binary_expression>& ptr) override;
+
+	value_id visit_unary_expression(const std::shared_ptr<parsing::unary_expression>& ptr) override;
+
+	value_id visit_this_expression(const std::shared_ptr<parsing::this_expression>& ptr) override;
+
+	value_id visit_base_expression(const std::shared_ptr<parsing::base_expression>& ptr) override;
+
+	value_id visit_postfix_expression(const std::shared_ptr<parsing::postfix_expression>& ptr) override;
+
+	value_id visit_literal_expression(const std::shared_ptr<parsing::literal_expression>& ptr) override;
+
+	value_id visit_grouping_expression(const std::shared_ptr<parsing::grouping_expression>& ptr) override;
+
+	value_id visit_lambda_expression(const std::shared_ptr<parsing::lambda_expression>& ptr) override;
+
+	value_id visit_var_expression(const std::shared_ptr<parsing::var_expression>& ptr) override;
+
+	value_id visit_ternary_expression(const std::shared_ptr<parsing::ternary_expression>& ptr) override;
+
+	value_id visit_logical_expression(const std::shared_ptr<parsing::logical_expression>& ptr) override;
+
+	value_id visit_call_expression(const std::shared_ptr<parsing::call_expression>& ptr) override;
+
+	value_id
+	visit_list_initializer_expression(const std::shared_ptr<parsing::list_initializer_expression>& ptr) override;
+
+	value_id visit_map_initializer_expression(const std::shared_ptr<parsing::map_initializer_expression>& ptr) override;
+
+	value_id visit_get_expression(const std::shared_ptr<parsing::get_expression>& ptr) override;
+
+	value_id visit_set_expression(const std::shared_ptr<parsing::set_expression>& ptr) override;
+
+	void visit_expression_statement(const std::shared_ptr<parsing::expression_statement>& ptr) override;
+
+	void visit_print_statement(const std::shared_ptr<parsing::print_statement>& ptr) override;
+
+	void visit_variable_statement(const std::shared_ptr<parsing::variable_statement>& ptr) override;
+
+	void visit_block_statement(const std::shared_ptr<parsing::block_statement>& ptr) override;
+
+	void visit_while_statement(const std::shared_ptr<parsing::while_statement>& ptr) override;
+
+	void visit_foreach_statement(const std::shared_ptr<parsing::foreach_statement>& ptr) override;
+
+	void visit_if_statement(const std::shared_ptr<parsing::if_statement>& ptr) override;
+
+	void visit_function_statement(const std::shared_ptr<parsing::function_statement>& ptr) override;
+
+	void visit_return_statement(const std::shared_ptr<parsing::return_statement>& ptr) override;
+
+	void visit_class_statement(const std::shared_ptr<parsing::class_statement>& ptr) override;
+
+private:
+	using variable_type = const resolving::named_symbol*;
+
+	explicit builder(size_t param_count);
+
+	void build(const std::shared_ptr<parsing::statement>& stmt);
+
+	void build(const std::vector<std::shared_ptr<parsing::statement>>& stmts);
+
+	value_id build(const std::shared_ptr<parsing::expression>& expr);
+
+	value_id emit(ir_op op, std::vector<value_id> operands, const scanning::token& location);
+
+	value_id emit_constant(const scanning::literal_value_type& val, const scanning::token& location);
+
+	/// \brief the symbol of a local which lives in the function being built
+	variable_type local_variable(const std::shared_ptr<parsing::expression>& expr);
+
+	/// \brief increase or decrease a local, returning {old value, new value}
+	std::pair<value_id, value_id> step_variable(const std::shared_ptr<parsing::expression>& target,
+			const scanning::token& op);
+
+	void jump(block_id to);
+
+	void branch(value_id cond, block_id if_true, block_id if_false, const scanning::token& location);
+
+	/// \brief continue in a fresh block, which is unreachable, after a return
+	void start_unreachable();
+
+	value_id phi(block_id b, std::vector<value_id> operands, const scanning::token& location);
+
+	void write_variable(variable_type var, block_id b, value_id val);
+
+	value_id read_variable(variable_type var, block_id b);
+
+	value_id read_variable_recursive(variable_type var, block_id b);
+
+	value_id add_phi_operands(variable_type var, value_id phi);
+
+	value_id try_remove_trivial_phi(value_id phi);
+
+	void seal_block(block_id b);
+
+	value_id undefined();
+
+	function func_;
+
+	block_id current_{ 0 };
+
+	std::unordered_map<variable_type, std::unordered_map<block_id, value_id>> current_def_{};
+
+	std::unordered_set<block_id> sealed_{};
+
+	std::unordered_map<block_id, std::vector<std::pair<variable_type, value_id>>> incomplete_phis_{};
+
+	value_id undefined_{ INVALID_VALUE };
+};
+
+}
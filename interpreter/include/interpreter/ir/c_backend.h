@@ -0,0 +1,63 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/16/2022.
+//
+
+#pragma once
+
+#include <interpreter/ir/ir.h>
+#include <interpreter/ir/passes.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace clox::interpreting::ir
+{
+
+/// \brief translates functions in SSA form to C, where every value is an unboxed long long, long double or boolean.
+/// Only functions whose every value has a known representation, given the parameters are what they are declared,
+/// are translated. Arithmetic follows the specialized instructions of the virtual machine, so results match it
+/// as long as the arguments are exactly of the declared types, which callers have to check.
+class c_module final
+{
+public:
+	c_module() = default;
+
+	/// \return the symbol of the entry taking and returning clox_value, nullopt if the function can not be translated
+	std::optional<std::string> add(const function& func, const std::vector<value_kind>& params, const std::string& name);
+
+	[[nodiscard]] bool empty() const
+	{
+		return functions_.empty();
+	}
+
+	/// \return a translation unit defining every function added
+	[[nodiscard]] std::string source() const;
+
+private:
+	std::vector<std::string> functions_{};
+};
+
+}
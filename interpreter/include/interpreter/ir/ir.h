@@ -0,0 +1,211 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#pragma once
+
+#include <scanner/scanner.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace clox::interpreting::ir
+{
+
+/// \brief every instruction defines the value of the same id, even if it produces nothing
+using value_id = uint32_t;
+using block_id = uint32_t;
+
+static inline constexpr value_id INVALID_VALUE = std::numeric_limits<value_id>::max();
+static inline constexpr block_id INVALID_BLOCK = std::numeric_limits<block_id>::max();
+
+enum class ir_op
+{
+	CONSTANT,
+	PARAMETER,
+	LOAD_GLOBAL,
+
+	ADD,
+	SUBTRACT,
+	MULTIPLY,
+	DIVIDE,
+	POW,
+	EQUAL,
+	NOT_EQUAL,
+	LESS,
+	LESS_EQUAL,
+	GREATER,
+	GREATER_EQUAL,
+	NEGATE,
+	NOT,
+
+	PHI,
+
+	PRINT,
+
+	// terminators
+	JUMP,
+	BRANCH,
+	RETURN,
+};
+
+/// \brief whether the instruction computes a value from its operands only, without any effect
+[[nodiscard]] static inline constexpr bool is_pure(ir_op op)
+{
+	return op == ir_op::CONSTANT || (op >= ir_op::ADD && op <= ir_op::NOT);
+}
+
+[[nodiscard]] static inline constexpr bool is_terminator(ir_op op)
+{
+	return op == ir_op::JUMP || op == ir_op::BRANCH || op == ir_op::RETURN;
+}
+
+struct instruction
+{
+	ir_op op{};
+
+	block_id block{ INVALID_BLOCK };
+
+	/// \brief for PHI, operands are in the order of predecessors of the block
+	std::vector<value_id> operands{};
+
+	/// \brief successors for JUMP and BRANCH. BRANCH goes to the first one if the condition is true.
+	std::vector<block_id> targets{};
+
+	/// \brief the value of CONSTANT
+	scanning::literal_value_type constant{};
+
+	/// \brief the name of LOAD_GLOBAL
+	std::string name{};
+
+	/// \brief the index of PARAMETER
+	size_t index{ 0 };
+
+	scanning::token location{ scanning::virtual_token };
+
+	bool removed{ false };
+};
+
+struct basic_block
+{
+	block_id id{ INVALID_BLOCK };
+
+	std::vector<value_id> instructions{};
+
+	std::vector<block_id> predecessors{};
+
+	[[nodiscard]] std::vector<block_id> successors(const class function& func) const;
+};
+
+/// \brief a function in SSA form, the first block is the entry
+class function final
+{
+public:
+	function() = default;
+
+	explicit function(size_t param_count)
+			: param_count_(param_count)
+	{
+	}
+
+	[[nodiscard]] size_t param_count() const
+	{
+		return param_count_;
+	}
+
+	[[nodiscard]] block_id entry() const
+	{
+		return 0;
+	}
+
+	block_id new_block();
+
+	/// \brief append an instruction to the end of the block
+	value_id append(block_id b, instruction inst);
+
+	/// \brief insert an instruction to the beginning of the block, before any other one
+	value_id prepend(block_id b, instruction inst);
+
+	/// \brief move the instruction to the end of the block, but before the terminator
+	void move_before_terminator(value_id v, block_id to);
+
+	/// \brief take the instruction off its block
+	void remove(value_id v);
+
+	/// \brief make every user of from use to instead
+	void replace_all_uses(value_id from, value_id to);
+
+	[[nodiscard]] instruction& at(value_id v)
+	{
+		return instructions_.at(v);
+	}
+
+	[[nodiscard]] const instruction& at(value_id v) const
+	{
+		return instructions_.at(v);
+	}
+
+	[[nodiscard]] basic_block& block(block_id b)
+	{
+		return blocks_.at(b);
+	}
+
+	[[nodiscard]] const basic_block& block(block_id b) const
+	{
+		return blocks_.at(b);
+	}
+
+	[[nodiscard]] std::vector<basic_block>& blocks()
+	{
+		return blocks_;
+	}
+
+	[[nodiscard]] const std::vector<basic_block>& blocks() const
+	{
+		return blocks_;
+	}
+
+	/// \return the terminator of the block, or INVALID_VALUE if it is still open
+	[[nodiscard]] value_id terminator(block_id b) const;
+
+	/// \return blocks reachable from the entry in reverse post order
+	[[nodiscard]] std::vector<block_id> reverse_post_order() const;
+
+	/// \brief count of instructions ever created, which bounds value ids
+	[[nodiscard]] size_t value_count() const
+	{
+		return instructions_.size();
+	}
+
+private:
+	std::vector<instruction> instructions_{};
+	std::vector<basic_block> blocks_{};
+
+	size_t param_count_{ 0 };
+};
+
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#pragma once
+
+#include <interpreter/ir/ir.h>
+
+#include <vector>
+
+namespace clox::interpreting::ir
+{
+
+/// \return whether every value is surely a number or a boolean, which arithmetic never refuses
+[[nodiscard]] std::vector<bool> numeric_values(const function& func, const std::vector<block_id>& rpo);
+
+/// \brief the representation a number is expected to have at runtime
+enum class value_kind
+{
+	UNKNOWN,
+	INTEGER,
+	FLOATING,
+};
+
+/// \return the representation of every value, following the promotion rules of arithmetic,
+/// if the parameters have the given ones. Nothing guarantees it, for narrower values can be passed.
+[[nodiscard]] std::vector<value_kind> value_kinds(const function& func, const std::vector<block_id>& rpo,
+	const std::vector<value_kind>& params);
+
+/// \return whether executing the instruction might raise a runtime error
+[[nodiscard]] bool may_trap(const function& func, const std::vector<bool>& numeric, value_id v);
+
+/// \brief drop blocks the entry can not reach, along with the predecessors and phi operands they contribute
+void remove_unreachable_blocks(function& func);
+
+/// \return the immediate dominator of every block, INVALID_BLOCK for unreachable ones. The entry dominates itself.
+[[nodiscard]] std::vector<block_id> immediate_dominators(const function& func);
+
+[[nodiscard]] bool dominates(const std::vector<block_id>& idom, block_id a, block_id b);
+
+/// \brief reuse pure computations of the same operands which are available along every path
+void eliminate_common_subexpressions(function& func);
+
+/// \brief remove instructions whose values are never used and which have no effect
+void eliminate_dead_code(function& func);
+
+/// \brief move pure computations whose operands do not change in a loop to its preheader
+void hoist_loop_invariants(function& func);
+
+/// \brief run every pass in a sensible order
+void run_passes(function& func);
+
+}
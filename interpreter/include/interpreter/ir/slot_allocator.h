@@ -0,0 +1,56 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#pragma once
+
+#include <interpreter/ir/ir.h>
+
+#include <limits>
+#include <vector>
+
+namespace clox::interpreting::ir
+{
+
+/// \brief where every value lives when the function is lowered to bytecode
+struct slot_assignment
+{
+	static inline constexpr size_t NO_SLOT = std::numeric_limits<size_t>::max();
+
+	/// \brief values computed right where they are used, like constants and single-use expressions
+	std::vector<bool> inlined{};
+
+	/// \brief the local slot of every value which is stored, NO_SLOT for the others
+	std::vector<size_t> slots{};
+
+	/// \brief count of slots above the parameters, which are reserved when the function is entered
+	size_t temporaries{ 0 };
+};
+
+/// \brief assign stack slots to values by linear scan over live intervals in reverse post order.
+/// Parameters stay in their own slots, and values whose live intervals do not overlap share one.
+[[nodiscard]] slot_assignment allocate_slots(const function& func);
+
+}
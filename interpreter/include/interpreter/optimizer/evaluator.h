@@ -0,0 +1,175 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/14/2022.
+//
+
+#pragma once
+
+#include <parser/gen/parser_classes.inc>
+#include <parser/gen/parser_base.inc>
+
+#include <resolver/ast_annotation.h>
+
+#include <scanner/scanner.h>
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace clox::interpreting::optimizing
+{
+
+/// \brief runs calls to pure functions with constant arguments while optimizing, so their results become constants.
+/// Only locals, literals, arithmetic, branches, loops and calls to other functions are evaluated;
+/// anything else, or running out of steps, gives up and leaves the call to run time.
+class evaluator final
+		: public parsing::expression_visitor<scanning::literal_value_type>,
+		  public parsing::statement_visitor<void>
+{
+public:
+	static inline constexpr size_t STEP_LIMIT = 100000;
+	static inline constexpr size_t DEPTH_LIMIT = 256;
+
+	/// \return nullopt if the call can not be evaluated at compile time
+	[[nodiscard]] static std::optional<scanning::literal_value_type>
+	evaluate(const std::shared_ptr<parsing::function_statement>& fs,
+			const std::vector<scanning::literal_value_type>& args);
+
+	scanning::literal_value_type
+	visit_assignment_expression(const std::shared_ptr<parsing::assignment_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_binary_expression(const std::shared_ptr<parsing::binary_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_unary_expression(const std::shared_ptr<parsing::unary_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_this_expression(const std::shared_ptr<parsing::this_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_base_expression(const std::shared_ptr<parsing::base_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_postfix_expression(const std::shared_ptr<parsing::postfix_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_literal_expression(const std::shared_ptr<parsing::literal_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_grouping_expression(const std::shared_ptr<parsing::grouping_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_lambda_expression(const std::shared_ptr<parsing::lambda_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_var_expression(const std::shared_ptr<parsing::var_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_ternary_expression(const std::shared_ptr<parsing::ternary_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_logical_expression(const std::shared_ptr<parsing::logical_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_call_expression(const std::shared_ptr<parsing::call_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_list_initializer_expression(const std::shared_ptr<parsing::list_initializer_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_map_initializer_expression(const std::shared_ptr<parsing::map_initializer_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_get_expression(const std::shared_ptr<parsing::get_expression>& ptr) override;
+
+	scanning::literal_value_type
+	visit_set_expression(const std::shared_ptr<parsing::set_expression>& ptr) override;
+
+	void visit_expression_statement(const std::shared_ptr<parsing::expression_statement>& ptr) override;
+
+	void visit_print_statement(const std::shared_ptr<parsing::print_statement>& ptr) override;
+
+	void visit_variable_statement(const std::shared_ptr<parsing::variable_statement>& ptr) override;
+
+	void visit_block_statement(const std::shared_ptr<parsing::block_statement>& ptr) override;
+
+	void visit_while_statement(const std::shared_ptr<parsing::while_statement>& ptr) override;
+
+	void visit_foreach_statement(const std::shared_ptr<parsing::foreach_statement>& ptr) override;
+
+	void visit_if_statement(const std::shared_ptr<parsing::if_statement>& ptr) override;
+
+	void visit_function_statement(const std::shared_ptr<parsing::function_statement>& ptr) override;
+
+	void visit_return_statement(const std::shared_ptr<parsing::return_statement>& ptr) override;
+
+	void visit_class_statement(const std::shared_ptr<parsing::class_statement>& ptr) override;
+
+private:
+	/// \brief thrown when the evaluation meets what only the virtual machine can run
+	struct not_evaluable
+	{
+	};
+
+	struct frame
+	{
+		std::shared_ptr<parsing::function_statement> callee{};
+		std::vector<scanning::literal_value_type> args{};
+
+		std::unordered_map<const resolving::named_symbol*, scanning::literal_value_type> locals{};
+
+		std::optional<scanning::literal_value_type> returned{};
+	};
+
+	evaluator() = default;
+
+	scanning::literal_value_type call(const std::shared_ptr<parsing::function_statement>& fs,
+			std::vector<scanning::literal_value_type> args);
+
+	scanning::literal_value_type evaluate(const std::shared_ptr<parsing::expression>& expr);
+
+	void execute(const std::shared_ptr<parsing::statement>& stmt);
+
+	/// \return the local of the function being evaluated which the expression names
+	[[nodiscard]] const resolving::named_symbol* local_of(const std::shared_ptr<parsing::expression>& expr) const;
+
+	/// \return the value of the local, where parameters are bound by their names the first time they are met
+	scanning::literal_value_type& variable(const std::shared_ptr<parsing::expression>& expr,
+			const scanning::token& name);
+
+	/// \return the value before and after increasing or decreasing, the same as INC and DEC
+	std::pair<scanning::literal_value_type, scanning::literal_value_type>
+	step_variable(const std::shared_ptr<parsing::expression>& target, const scanning::token& op);
+
+	void step();
+
+	std::vector<frame> frames_{};
+
+	size_t steps_{ 0 };
+};
+
+}
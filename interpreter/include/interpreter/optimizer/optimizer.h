@@ -0,0 +1,167 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/8/2022.
+//
+
+#pragma once
+
+#include <parser/gen/parser_classes.inc>
+#include <parser/gen/parser_base.inc>
+
+#include <resolver/ast_annotation.h>
+#include <resolver/resolver.h>
+
+#include <scanner/scanner.h>
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace clox::interpreting::optimizing
+{
+
+/// \brief rewrites the resolved AST before code generation.
+/// It folds constant expressions, replaces reads of constants whose initializers fold into literals,
+/// evaluates calls to pure functions with constant arguments,
+/// and marks branches whose conditions are known so that code generation drops the dead ones.
+/// Nodes are rewritten in place, so the same statements are handed to codegen afterwards.
+class optimizer final
+		: public parsing::expression_visitor<std::shared_ptr<parsing::expression>>,
+		  public parsing::statement_visitor<void>
+{
+public:
+	optimizer() = default;
+
+	/// \brief also evaluates calls to functions the resolver has found pure, whose arguments are all constants
+	explicit optimizer(const resolving::resolver& resolver);
+
+	void optimize(const std::vector<std::shared_ptr<parsing::statement>>& stmts);
+
+	/// \return the value of the expression if it is a literal
+	[[nodiscard]] static std::optional<scanning::literal_value_type>
+	literal_of(const std::shared_ptr<parsing::expression>& expr);
+
+	/// \brief truthiness the same as the virtual machine, where only false and nil are false
+	[[nodiscard]] static bool is_truthy(const scanning::literal_value_type& val);
+
+	[[nodiscard]] static std::optional<scanning::literal_value_type>
+	fold_binary(scanning::token_type op, const scanning::literal_value_type& l, const scanning::literal_value_type& r);
+
+	[[nodiscard]] static std::optional<scanning::literal_value_type>
+	fold_unary(scanning::token_type op, const scanning::literal_value_type& r);
+
+	std::shared_ptr<parsing::expression>
+	visit_assignment_expression(const std::shared_ptr<parsing::assignment_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_binary_expression(const std::shared_ptr<parsing::binary_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_unary_expression(const std::shared_ptr<parsing::unary_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_this_expression(const std::shared_ptr<parsing::this_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_base_expression(const std::shared_ptr<parsing::base_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_postfix_expression(const std::shared_ptr<parsing::postfix_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_literal_expression(const std::shared_ptr<parsing::literal_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_grouping_expression(const std::shared_ptr<parsing::grouping_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_lambda_expression(const std::shared_ptr<parsing::lambda_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_var_expression(const std::shared_ptr<parsing::var_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_ternary_expression(const std::shared_ptr<parsing::ternary_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_logical_expression(const std::shared_ptr<parsing::logical_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_call_expression(const std::shared_ptr<parsing::call_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_list_initializer_expression(const std::shared_ptr<parsing::list_initializer_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_map_initializer_expression(const std::shared_ptr<parsing::map_initializer_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_get_expression(const std::shared_ptr<parsing::get_expression>& ptr) override;
+
+	std::shared_ptr<parsing::expression>
+	visit_set_expression(const std::shared_ptr<parsing::set_expression>& ptr) override;
+
+	void visit_expression_statement(const std::shared_ptr<parsing::expression_statement>& ptr) override;
+
+	void visit_print_statement(const std::shared_ptr<parsing::print_statement>& ptr) override;
+
+	void visit_variable_statement(const std::shared_ptr<parsing::variable_statement>& ptr) override;
+
+	void visit_block_statement(const std::shared_ptr<parsing::block_statement>& ptr) override;
+
+	void visit_while_statement(const std::shared_ptr<parsing::while_statement>& ptr) override;
+
+	void visit_foreach_statement(const std::shared_ptr<parsing::foreach_statement>& ptr) override;
+
+	void visit_if_statement(const std::shared_ptr<parsing::if_statement>& ptr) override;
+
+	void visit_function_statement(const std::shared_ptr<parsing::function_statement>& ptr) override;
+
+	void visit_return_statement(const std::shared_ptr<parsing::return_statement>& ptr) override;
+
+	void visit_class_statement(const std::shared_ptr<parsing::class_statement>& ptr) override;
+
+private:
+	void optimize(const std::shared_ptr<parsing::statement>& stmt);
+
+	[[nodiscard]] std::shared_ptr<parsing::expression> optimize(const std::shared_ptr<parsing::expression>& expr);
+
+	/// \return count of scopes the statement creates in its enclosing scope, which the resolver has recorded
+	[[nodiscard]] static size_t scope_count(const std::shared_ptr<parsing::statement>& stmt);
+
+	/// \return count of lambdas in the expression outside other lambdas, each of which has a scope
+	/// in the enclosing one. Expressions with any can't be dropped without skipping their scopes as well.
+	[[nodiscard]] static size_t lambda_count(const std::shared_ptr<parsing::expression>& expr);
+
+	/// \return whether the statement declares names in its enclosing scope, so it can never be dropped
+	/// without breaking the slots of locals the resolver has assigned
+	[[nodiscard]] static bool declares_names(const std::shared_ptr<parsing::statement>& stmt);
+
+	const resolving::resolver* resolver_{ nullptr };
+
+	std::unordered_map<std::shared_ptr<resolving::named_symbol>, scanning::literal_value_type> constants_{};
+};
+
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/20/2022.
+//
+
+#pragma once
+
+#include "object/object.h"
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+namespace clox::interpreting::vm
+{
+
+/// \brief allocation_profiler tells which Lox functions and lines allocate objects, and how many of them survive GC.
+/// The heap hands it an allocation every interval bytes, and it charges the allocation to the line the top call frame
+/// of the virtual machine is on. A sample of size bytes stands for interval / size allocations of interval bytes.
+class allocation_profiler final
+{
+public:
+	static inline constexpr size_t REPORT_SITES = 20;
+
+	allocation_profiler(class virtual_machine& vm, size_t interval);
+
+	[[nodiscard]] size_t interval() const
+	{
+		return interval_;
+	}
+
+	/// \brief the object of size bytes is sampled
+	void sampled(object_raw_pointer obj, size_t size);
+
+	/// \brief the sampled object is deallocated
+	void freed(object_raw_pointer obj);
+
+	/// \brief a collection has ended, so sampled objects still alive have survived one
+	void collected();
+
+	/// \brief print sites with most bytes allocated
+	void report(std::ostream& os) const;
+
+private:
+	using site_key_type = std::tuple<std::string, int64_t>;
+
+	struct site_record
+	{
+		size_t samples{ 0 };
+		double count{ 0 };
+		size_t bytes{ 0 };
+		size_t survivors{ 0 };
+	};
+
+	struct sample_record
+	{
+		site_record* site{ nullptr };
+		bool survived{ false };
+	};
+
+	[[nodiscard]] site_key_type current_site() const;
+
+	class virtual_machine* vm_{ nullptr };
+
+	size_t interval_{ 0 };
+
+	size_t collections_{ 0 };
+
+	std::map<site_key_type, site_record> sites_{};
+
+	/// \brief sampled objects not deallocated yet
+	std::unordered_map<object_raw_pointer, sample_record> live_{};
+};
+
+}
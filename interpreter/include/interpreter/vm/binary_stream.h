@@ -0,0 +1,145 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/4/2022.
+//
+
+#pragma once
+
+#include <interpreter/vm/exceptions.h>
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <cstring>
+#include <type_traits>
+
+namespace clox::interpreting::vm
+{
+
+/// \brief append-only buffer for binary images like the bytecode cache and heap snapshots.
+/// Values are stored in native byte order, for images are only meant to be read on the machine producing them.
+class binary_writer final
+{
+public:
+	template<typename T>
+	requires std::is_trivially_copyable_v<T>
+	void write(const T& val)
+	{
+		buf_.append(reinterpret_cast<const char*>(&val), sizeof(T));
+	}
+
+	void write(std::string_view str)
+	{
+		write<uint64_t>(str.size());
+		buf_.append(str);
+	}
+
+	template<typename T>
+	void write_array(const T& container)
+	{
+		write<uint64_t>(container.size());
+		buf_.append(reinterpret_cast<const char*>(container.data()), container.size() * sizeof(container[0]));
+	}
+
+	[[nodiscard]] const std::string& buffer() const
+	{
+		return buf_;
+	}
+
+	/// \brief write the buffer to a temporary file and rename it to path,
+	/// so that concurrent readers never see a partial image
+	/// \return false if failed
+	bool save(const std::string& path) const;
+
+private:
+	std::string buf_{};
+};
+
+/// \brief bounds-checked reader for images written by binary_writer
+/// \throws invalid_binary_image if the image is truncated
+class binary_reader final
+{
+public:
+	explicit binary_reader(std::span<const std::byte> data)
+			: data_(data)
+	{
+	}
+
+	template<typename T>
+	requires std::is_trivially_copyable_v<T>
+	T read()
+	{
+		T ret{};
+		std::memcpy(&ret, take(sizeof(T)), sizeof(T)); // the image may not be aligned for T
+		return ret;
+	}
+
+	std::string read_string()
+	{
+		auto size = read<uint64_t>();
+		auto data = take(size);
+		return std::string{ reinterpret_cast<const char*>(data), size };
+	}
+
+	template<typename T>
+	void read_array(T& container)
+	{
+		auto size = read<uint64_t>();
+		if (size > remaining() / sizeof(container[0]))
+		{
+			throw invalid_binary_image{ "array is larger than the image" };
+		}
+
+		container.resize(size);
+		std::memcpy(container.data(), take(size * sizeof(container[0])), size * sizeof(container[0]));
+	}
+
+	[[nodiscard]] size_t remaining() const
+	{
+		return data_.size() - pos_;
+	}
+
+	[[nodiscard]] bool done() const
+	{
+		return pos_ == data_.size();
+	}
+
+private:
+	const std::byte* take(size_t size)
+	{
+		if (size > remaining())
+		{
+			throw invalid_binary_image{ "unexpected end of image" };
+		}
+
+		auto ret = data_.data() + pos_;
+		pos_ += size;
+		return ret;
+	}
+
+	std::span<const std::byte> data_;
+	size_t pos_{ 0 };
+};
+
+}
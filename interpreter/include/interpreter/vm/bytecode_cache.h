@@ -0,0 +1,81 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/2/2022.
+//
+
+#pragma once
+
+#include <interpreter/vm/heap.h>
+#include <interpreter/vm/chunk.h>
+
+#include "object/function_object.h"
+
+#include <string>
+#include <string_view>
+#include <memory>
+
+namespace clox::interpreting::vm
+{
+
+/// \brief bytecode_cache saves the function tree generated by codegen into a .loxc file next to the source,
+/// so that later runs of an unchanged script can skip scanning, parsing, resolving and code generation.
+class bytecode_cache final
+{
+public:
+	using hash_type = uint64_t;
+
+	static inline constexpr uint32_t MAGIC = 0x43584F4C; // "LOXC" in little endian
+
+	/// \brief bump it whenever the bytecode or the file layout changes
+	static inline constexpr uint32_t VERSION = 5;
+
+	/// \brief options changing the generated code, which a cache is only valid for
+	enum codegen_flag : uint32_t
+	{
+		CODEGEN_OPTIMIZED = 1 << 0,
+		CODEGEN_AOT = 1 << 1,
+	};
+
+	static inline constexpr std::string_view FILE_EXTENSION = ".loxc";
+
+	bytecode_cache() = delete;
+
+	[[nodiscard]] static std::string cache_path_of(const std::string& source_path);
+
+	[[nodiscard]] static hash_type hash_of(std::string_view source);
+
+	/// \return codegen flags of the current configuration
+	[[nodiscard]] static uint32_t codegen_flags();
+
+	/// \brief write the function tree rooted at top_level to path
+	/// \return false if the cache can't be written, which is not an error for callers
+	static bool save(const std::string& path, hash_type source_hash, function_object_raw_pointer top_level);
+
+	/// \brief map the cache file at path and rebuild the function tree on heap. GC must not be enabled on heap.
+	/// \return the top level function, or nullptr if the cache is absent, outdated or corrupted
+	[[nodiscard]] static function_object_raw_pointer
+	load(const std::shared_ptr<object_heap>& heap, const std::string& path, hash_type source_hash);
+};
+
+}
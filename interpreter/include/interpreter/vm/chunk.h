@@ -30,11 +30,15 @@
 
 #include <interpreter/vm/opcode.h>
 #include <interpreter/vm/value.h>
+#include <interpreter/vm/constant_pool.h>
 
 #include <scanner/scanner.h>
 
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include <optional>
+#include <unordered_map>
 
 namespace clox::interpreting::vm
 {
@@ -43,19 +47,58 @@ class chunk final
 public:
 	friend class function_object;
 
+	friend class heap_image_reader;
+
+	friend class heap_image_writer;
+
 	static inline constexpr int64_t INVALID_LINE = -1;
+	static inline constexpr int64_t INVALID_COLUMN = 0;
+
+	/// The code from offset up to the next run comes from the same source location
+	struct line_run
+	{
+		uint32_t offset;
+		int32_t line;
+		uint32_t column;
+	};
+
+	using line_table_type = std::pmr::vector<line_run>;
+
+	/// Instructions are byte-encoded: one header byte holding the main opcode,
+	/// whose top bit tells that a LEB128 secondary opcode follows,
+	/// then every operand as an unsigned LEB128.
+	using code_type = uint8_t;
+	using operand_type = uint32_t;
 
-	using code_type = full_opcode_type;
-	static_assert(sizeof(code_type) >= sizeof(uint32_t));
+	static inline constexpr code_type SECONDARY_FOLLOWS = 0x80;
+	static inline constexpr code_type LEB128_MORE = 0x80;
+	static inline constexpr code_type LEB128_PAYLOAD = 0x7F;
 
-	using code_list_type = std::vector<code_type>;
+	/// A 32-bit operand never takes more than 5 bytes. Placeholders for operands patched later always take all of them.
+	static inline constexpr size_t MAX_OPERAND_SIZE = 5;
+
+	static_assert(helper::enum_cast(op_code::OPCODE_ENUM_MAX) < SECONDARY_FOLLOWS);
+
+	using code_list_type = std::pmr::vector<code_type>;
+
+	using allocator_type = std::pmr::polymorphic_allocator<>;
 
 	using iterator_type = code_list_type::iterator;
 	using difference_type = int64_t;
+
+	/// An instruction with its operands, in the order the virtual machine reads them
+	struct decoded_instruction
+	{
+		full_opcode_type instruction;
+		std::vector<operand_type> operands;
+		uint64_t next_offset;
+	};
 public:
 	chunk() = default;
 
-	explicit chunk(std::string name);
+	explicit chunk(const allocator_type& alloc);
+
+	explicit chunk(std::string name, const allocator_type& alloc = {});
 
 	~chunk() = default;
 
@@ -82,42 +125,137 @@ public:
 
 	void disassemble(helper::console& out);
 
-	void write(code_type op, std::optional<scanning::token> t);
+	void write(full_opcode_type op, std::optional<scanning::token> t);
 
-	void write(code_type op, int64_t line = INVALID_LINE);
+	void write(full_opcode_type op, int64_t line = INVALID_LINE, int64_t column = INVALID_COLUMN);
 
-	/// Patch the code offset from the first opcode
-	/// \param new_op
+	void write_operand(operand_type operand);
+
+	/// Write a full-width operand which will be filled by patch_operand
+	/// \return offset of the placeholder
+	difference_type write_placeholder();
+
+	/// Fill the placeholder written by write_placeholder
 	/// \param offset
-	void patch_begin(code_type new_op, int64_t offset);
+	/// \param operand
+	void patch_operand(difference_type offset, operand_type operand);
+
+	/// \return the opcode of the last written instruction
+	full_opcode_type last_instruction();
 
-	/// Patch the code offset from the last opcode
+	/// Replace the opcode of the last written instruction, keeping its operands
 	/// \param new_op
-	/// \param offset
-	void patch_end(code_type new_op, int64_t offset);
+	void patch_last_instruction(full_opcode_type new_op);
+
+	/// Add a constant, reusing the slot of an equal one. Objects other than strings are never merged,
+	/// for they may be placeholders patched later.
+	operand_type add_constant(const value& val);
+
+	/// Add a variable name, which is stored once in the module-wide pool and viewed by the chunk
+	operand_type add_name(const std::shared_ptr<constant_pool>& pool, std::string_view name);
 
-	code_type peek(int64_t offset);
+	/// Drop the index used to merge constants, for no more constants are expected
+	void seal();
 
-	code_type add_constant(const value& val);
+	value& constant_at(operand_type pos);
 
-	value& constant_at(code_type pos);
+	/// \brief decode the instruction starting at offset without running it
+	[[nodiscard]] decoded_instruction decode_instruction(uint64_t offset);
 
 	int64_t line_of(code_list_type::iterator ip);
 
-	std::string filename();
+	int64_t column_of(code_list_type::iterator ip);
+
+		std::string filename();
+
+	static constexpr size_t operand_size(operand_type operand)
+	{
+		size_t size = 1;
+		while (operand >>= 7)
+		{
+			size++;
+		}
+		return size;
+	}
+
+	template<typename TIterator>
+	static operand_type read_operand(TIterator& ip)
+	{
+		operand_type ret = *ip++;
+		if (!(ret & LEB128_MORE)) [[likely]]
+		{
+			return ret;
+		}
+
+		ret &= LEB128_PAYLOAD;
+		for (size_t shift = 7; shift < MAX_OPERAND_SIZE * 7; shift += 7)
+		{
+			code_type byte = *ip++;
+			ret |= static_cast<operand_type>(byte & LEB128_PAYLOAD) << shift;
+			if (!(byte & LEB128_MORE))
+			{
+				break;
+			}
+		}
+		return ret;
+	}
+
+	template<typename TIterator>
+	static full_opcode_type read_instruction(TIterator& ip)
+	{
+		code_type head = *ip++;
+		auto main = static_cast<op_code>(head & ~SECONDARY_FOLLOWS);
+		if (head & SECONDARY_FOLLOWS)
+		{
+			return compose_opcode(static_cast<secondary_opcode_base_type>(read_operand(ip)), main);
+		}
+		return compose_opcode(0, main);
+	}
 
 private:
+	struct constant_hash
+	{
+		size_t operator()(const value& val) const noexcept;
+	};
+
+	struct constant_equal
+	{
+		bool operator()(const value& lhs, const value& rhs) const noexcept;
+	};
+
+	using constant_index_type = std::pmr::unordered_map<value, operand_type, constant_hash, constant_equal>;
+
+	static bool mergeable(const value& val);
+
+	void write_byte(code_type byte);
+
+	/// Start a new run in the line table if the location differs from the current one
+	void mark_location(int64_t line, int64_t column);
+
+	/// \return the run covering the given offset, or nullptr if there is none
+	const line_run* run_of(uint64_t offset) const;
+
+	/// \return the encoded size of the instruction header
+	static size_t encode_instruction(full_opcode_type op, code_type* out);
+
+	static size_t encode_operand(operand_type operand, code_type* out);
 
 	uint64_t disassemble_instruction(helper::console& out, uint64_t offset);
 
 	std::string name_{};
 
-	std::vector<value> constants_{};
+	std::pmr::vector<value> constants_{};
+
+	constant_index_type constant_index_{};
+
+	size_t indexed_constants_{ 0 };
+
+	std::shared_ptr<constant_pool> pool_{};
 
 	code_list_type codes_{};
 
-	std::vector<int64_t> lines_{};
+	line_table_type line_table_{};
 
-	int64_t last_line_{ INVALID_LINE };
+	difference_type last_instruction_{ -1 };
 };
 }
\ No newline at end of file
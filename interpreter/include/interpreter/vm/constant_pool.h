@@ -0,0 +1,64 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/6/2022.
+//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_set>
+
+namespace clox::interpreting::vm
+{
+
+/// \brief constant_pool holds the names referenced by every chunk of a module, each of them once.
+/// Names are never changed or removed once added, so chunks keep views of them rather than copies.
+class constant_pool final
+{
+public:
+	constant_pool() = default;
+
+	constant_pool(const constant_pool&) = delete;
+
+	constant_pool& operator=(const constant_pool&) = delete;
+
+	/// \brief add the name if it's absent
+	/// \return a view of the pooled name, valid as long as the pool lives
+	std::string_view intern(std::string_view name);
+
+	[[nodiscard]] size_t size() const
+	{
+		return names_.size();
+	}
+
+private:
+	// deque never moves its elements on push_back, so views to them are stable
+	std::deque<std::string> names_{};
+
+	std::unordered_set<std::string_view> index_{};
+};
+
+}
@@ -45,6 +45,49 @@ public:
 	}
 };
 
+class heap_memory_limit_exceeded final
+		: public std::runtime_error
+{
+public:
+	heap_memory_limit_exceeded(size_t requested, size_t used, size_t limit)
+			: requested_(requested), used_(used), limit_(limit),
+			  std::runtime_error(
+					  std::format("Heap memory limit exceeded: {} bytes requested, {} of {} bytes in use.",
+							  requested, used, limit))
+	{
+	}
+
+	[[nodiscard]] size_t requested() const
+	{
+		return requested_;
+	}
+
+	[[nodiscard]] size_t used() const
+	{
+		return used_;
+	}
+
+	[[nodiscard]] size_t limit() const
+	{
+		return limit_;
+	}
+
+private:
+	size_t requested_{};
+	size_t used_{};
+	size_t limit_{};
+};
+
+class integer_overflow final
+		: public std::overflow_error
+{
+public:
+	integer_overflow(integer_value_type l, integer_value_type r)
+			: std::overflow_error(std::format("Integer overflow: the result of {} and {} is out of range.", l, r))
+	{
+	}
+};
+
 class invalid_opcode final
 		: public std::invalid_argument
 {
@@ -82,6 +125,16 @@ public:
 	}
 };
 
+class invalid_binary_image final
+		: public std::runtime_error
+{
+public:
+	explicit invalid_binary_image(const std::string& reason)
+			: std::runtime_error(std::format("Invalid binary image: {}", reason))
+	{
+	}
+};
+
 class runtime_error
 		: public std::runtime_error
 {
@@ -31,6 +31,8 @@
 #include <interpreter/vm/value.h>
 #include <interpreter/vm/heap.h>
 
+#include <functional>
+
 namespace clox::interpreting::vm
 {
 class garbage_collector
@@ -47,12 +49,23 @@ public:
 	explicit garbage_collector(helper::console& cons, std::shared_ptr<object_heap> heap, class virtual_machine& vm,
 			class compiling::codegen& gen);
 
+	/// \brief for code that doesn't come from a codegen, like the bytecode cache
+	explicit garbage_collector(helper::console& cons, std::shared_ptr<object_heap> heap, class virtual_machine& vm);
+
 	void collect();
 
 	void mark_object(object_raw_pointer obj);
 
 	void mark_value(value& val);
 
+	using reference_visitor_type = std::function<void(object_raw_pointer)>;
+
+	/// \brief call visit with every object that obj references, as its blacken finds them, without marking any
+	void for_each_reference(object_raw_pointer obj, const reference_visitor_type& visit);
+
+	/// \brief call visit with every root, without marking any
+	void for_each_root(const reference_visitor_type& visit);
+
 private:
 	void mark_roots();
 
@@ -70,6 +83,9 @@ private:
 
 	base::iterable_stack<object_raw_pointer> gray_stack_{};
 
+	/// \brief if set, mark_object hands objects to it instead of marking them
+	const reference_visitor_type* reference_visitor_{ nullptr };
+
 	mutable class virtual_machine* vm_{ nullptr };
 
 	mutable class compiling::codegen* gen_{ nullptr };
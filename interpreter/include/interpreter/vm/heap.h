@@ -37,13 +37,38 @@
 #include <string>
 
 #include <memory>
+#include <memory_resource>
 #include <map>
+#include <list>
 
 
 namespace clox::interpreting::vm
 {
 
+/// \brief objects of the heap counted by their type, and instances by their class as well
+struct heap_census
+{
+	struct entry
+	{
+		size_t count{ 0 };
+		size_t bytes{ 0 };
+	};
+
+	std::map<object_type, entry> types{};
+	std::map<std::string, entry> classes{};
+
+	/// \brief bytes of the objects themselves
+	size_t object_bytes{ 0 };
+
+	/// \brief bytes of the heap, including internal buffers of objects
+	size_t total_bytes{ 0 };
+};
+
+/// \brief object_heap owns every object of the virtual machine.
+/// It is also the memory resource for the internal buffers of objects (vectors, strings, maps, chunks),
+/// so that size_ reflects the real memory usage rather than sizeof(T) only.
 class object_heap
+		: public std::pmr::memory_resource
 {
 public:
 	using object_list_type = std::list<object_raw_pointer>;
@@ -52,20 +77,26 @@ public:
 
 	using size_type = size_t;
 
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
 	friend class garbage_collector;
 
+	friend class heap_inspector;
+
 	// TODO: use runtime configuration
 	static inline constexpr size_type NEXT_GC_INITIAL = 1024;
 
+	static inline constexpr size_type UNLIMITED = 0;
+
 public:
 	object_heap() = delete;
 
-	explicit object_heap(helper::console& cons)
-			: cons_(&cons)
+	explicit object_heap(helper::console& cons, size_type memory_limit = UNLIMITED)
+			: cons_(&cons), memory_limit_(memory_limit)
 	{
 	}
 
-	~object_heap();
+	~object_heap() override;
 
 	template<std::derived_from<object> T, class ...Args>
 	T* allocate(Args&& ...args)
@@ -73,9 +104,39 @@ public:
 		using TRaw = std::decay_t<T>;
 		raw_pointer mem = allocate_raw(sizeof(TRaw));
 
-		auto ret = new(mem) T(std::forward<Args>(args)...); // placement new
+		T* ret{ nullptr };
+		try
+		{
+			if constexpr (std::uses_allocator_v<TRaw, allocator_type>)
+			{
+				ret = new(mem) T(std::forward<Args>(args)..., allocator()); // placement new
+			}
+			else
+			{
+				ret = new(mem) T(std::forward<Args>(args)...); // placement new
+			}
+		}
+		catch (...)
+		{
+			deallocate_raw(mem, sizeof(TRaw));
+			throw;
+		}
+
+		ret->allocated_size_ = sizeof(TRaw);
 		objects_.push_back(ret);
 
+		allocated_objects_++;
+		allocated_object_bytes_ += sizeof(TRaw);
+
+		if (allocation_profiler_)
+		{
+			bytes_until_sample_ -= static_cast<std::ptrdiff_t>(sizeof(TRaw));
+			if (bytes_until_sample_ <= 0)
+			{
+				sample_allocation(ret);
+			}
+		}
+
 		if constexpr (base::runtime_predefined_configuration::ENABLE_DEBUG_LOGGING_GC)
 		{
 			cons_->log()
@@ -90,34 +151,117 @@ public:
 	requires std::derived_from<T, object> || std::same_as<T, object_raw_pointer>
 	void deallocate(T* val)
 	{
-		using TRaw = std::decay_t<T>;
+		const auto size = val->allocated_size_;
 
 		if constexpr (base::runtime_predefined_configuration::ENABLE_DEBUG_LOGGING_GC)
 		{
 			cons_->log()
-					<< std::format("At {:x} deallocate {} bytes of type {}", (uintptr_t)val, sizeof(*val), val->type())
+					<< std::format("At {:x} deallocate {} bytes of type {}", (uintptr_t)val, size, val->type())
 					<< std::endl;
 		}
-		deallocate_raw(val, sizeof(TRaw));
+
+		if (val->allocation_sampled_ && allocation_profiler_)
+		{
+			forget_allocation(val);
+		}
+
+		val->~T(); // release the internal buffers back to this heap
+		deallocate_raw(val, size);
 	}
 
 	object_heap& enable_gc(class garbage_collector& gc);
 
 	object_heap& remove_gc();
 
+	/// \brief allocator for internal buffers of objects, which is accounted by this heap
+	[[nodiscard]] allocator_type allocator()
+	{
+		return allocator_type{ this };
+	}
+
+	[[nodiscard]] size_type size() const
+	{
+		return size_;
+	}
+
+	[[nodiscard]] bool gc_enabled() const
+	{
+		return gc_ != nullptr;
+	}
+
+	[[nodiscard]] size_type memory_limit() const
+	{
+		return memory_limit_;
+	}
+
+	object_heap& set_memory_limit(size_type limit);
+
+	/// \brief count objects by type and instances by class. Sizes are of objects themselves,
+	/// for their internal buffers are allocated from the heap without knowing who they belong to.
+	[[nodiscard]] heap_census census() const;
+
+	/// \brief hand an allocation to the profiler every interval bytes it asks for, or stop if it is nullptr
+	object_heap& set_allocation_profiler(class allocation_profiler* profiler);
+
+	[[nodiscard]] class allocation_profiler* current_allocation_profiler() const
+	{
+		return allocation_profiler_;
+	}
+
+	/// \return objects allocated since the heap is created, including collected ones
+	[[nodiscard]] size_t allocated_objects() const
+	{
+		return allocated_objects_;
+	}
+
+	/// \return bytes of objects allocated since the heap is created, without their internal buffers
+	[[nodiscard]] size_t allocated_object_bytes() const
+	{
+		return allocated_object_bytes_;
+	}
+
 private:
 	raw_pointer allocate_raw(size_t size);
 
 	void deallocate_raw(raw_pointer raw, size_t size);
 
+	/// \brief check if there is room for another size bytes, collecting garbage if allowed.
+	/// \throws heap_memory_limit_exceeded
+	void reserve(size_type size, bool can_collect);
+
+	void update_next_gc();
+
+	void sample_allocation(object_raw_pointer obj);
+
+	void forget_allocation(object_raw_pointer obj);
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+
+	[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
 	object_list_type objects_{};
 
 	size_type size_{ 0 };
 
 	size_type next_gc_{ NEXT_GC_INITIAL };
 
+	size_type memory_limit_{ UNLIMITED };
+
+	/// \brief a buffer went over the limit, which is checked after a collection at the next object allocation
+	bool limit_check_pending_{ false };
+
 	mutable class garbage_collector* gc_{};
 
+	class allocation_profiler* allocation_profiler_{ nullptr };
+
+	std::ptrdiff_t bytes_until_sample_{ 0 };
+
+	size_t allocated_objects_{ 0 };
+
+	size_t allocated_object_bytes_{ 0 };
+
 	mutable helper::console* cons_{};
 
 };
@@ -0,0 +1,141 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/4/2022.
+//
+
+#pragma once
+
+#include <interpreter/vm/heap.h>
+#include <interpreter/vm/chunk.h>
+#include <interpreter/vm/constant_pool.h>
+#include <interpreter/vm/value.h>
+#include <interpreter/vm/binary_stream.h>
+
+#include "object/object.h"
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <limits>
+
+namespace clox::interpreting::vm
+{
+
+/// \brief heap_image_writer serializes a graph of heap objects, in which objects refer to each other by indexes.
+/// It is the common part of the bytecode cache and heap snapshots.
+class heap_image_writer final
+{
+public:
+	using index_type = uint32_t;
+
+	static inline constexpr index_type NULL_INDEX = std::numeric_limits<index_type>::max();
+
+	/// \brief add obj and every object reachable from it
+	void add(object_raw_pointer obj);
+
+	void add(const value& val);
+
+	/// \brief write all added objects. Indexes are assigned here, so nothing can be added after it.
+	void write_objects(binary_writer& out);
+
+	void write_value(binary_writer& out, const value& val) const;
+
+	[[nodiscard]] index_type index_of(object_raw_pointer obj) const;
+
+private:
+	void write_object(binary_writer& out, object_raw_pointer obj) const;
+
+	void write_chunk(binary_writer& out, chunk& body) const;
+
+	std::vector<object_raw_pointer> objects_{};
+
+	std::unordered_map<object_raw_pointer, index_type> indexes_{};
+
+	bool sealed_{ false };
+};
+
+/// \brief heap_image_reader rebuilds objects written by heap_image_writer on a heap
+class heap_image_reader final
+{
+public:
+	using index_type = heap_image_writer::index_type;
+
+	explicit heap_image_reader(std::shared_ptr<object_heap> heap);
+
+	/// \brief allocate every object in the image. GC must not be enabled on the heap until they are rooted.
+	/// \throws invalid_binary_image
+	void read_objects(binary_reader& in);
+
+	/// \brief read a value written after the objects
+	value read_value(binary_reader& in) const;
+
+	[[nodiscard]] object_raw_pointer object_at(index_type idx) const;
+
+	/// \throws invalid_binary_image if the object isn't of type T
+	template<object_pointer T>
+	[[nodiscard]] T object_at(index_type idx) const
+	{
+		auto obj = object_at(idx);
+		if (!obj)
+		{
+			return nullptr;
+		}
+
+		auto ret = dynamic_cast<T>(obj);
+		if (!ret)
+		{
+			throw invalid_binary_image{ "object of unexpected type" };
+		}
+		return ret;
+	}
+
+private:
+	/// \brief a value that may refer to an object not allocated yet
+	struct value_ref
+	{
+		value val{};
+		std::optional<index_type> object{};
+	};
+
+	value_ref read_value_ref(binary_reader& in) const;
+
+	[[nodiscard]] value resolve(const value_ref& ref) const;
+
+	void read_object(binary_reader& in);
+
+	void read_chunk(binary_reader& in, chunk& body);
+
+	std::shared_ptr<object_heap> heap_{};
+
+	// names of every chunk in the image are pooled together, as codegen does for a module
+	std::shared_ptr<constant_pool> constant_pool_{ std::make_shared<constant_pool>() };
+
+	std::vector<object_raw_pointer> objects_{};
+
+	/// \brief reference patches applied after every object is allocated
+	std::vector<std::function<void()>> fixups_{};
+};
+
+}
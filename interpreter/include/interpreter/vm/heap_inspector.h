@@ -0,0 +1,85 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/19/2022.
+//
+
+#pragma once
+
+#include <interpreter/vm/heap.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace clox::interpreting::vm
+{
+
+/// \brief heap_inspector tells what objects are in a heap and what keeps them alive.
+/// It follows references the way the garbage collector does, so GC must be enabled on the heap.
+class heap_inspector final
+{
+public:
+	explicit heap_inspector(object_heap& heap);
+
+	static void print_census(const heap_census& census, std::ostream& os);
+
+	/// \brief write every object with its id, type, size and retained size, the references between them and the roots,
+	/// as JSON. The retained size of an object is what would be freed without it, found by the dominator tree.
+	void write_snapshot(std::ostream& os);
+
+	/// \return false if the file can't be written
+	bool write_snapshot(const std::string& path);
+
+private:
+	static inline constexpr size_t ROOT = 0; // a virtual node referencing every root
+
+	struct node
+	{
+		object_raw_pointer obj{ nullptr };
+		std::vector<size_t> references{};
+		std::vector<size_t> referrers{};
+		size_t size{ 0 };
+		size_t retained{ 0 };
+		size_t dominator{ 0 };
+		size_t postorder{ 0 };
+		bool reachable{ false };
+	};
+
+	void build_graph();
+
+	/// \brief Cooper, Harvey and Kennedy's iterative dominator algorithm over the reverse postorder
+	void compute_dominators();
+
+	size_t intersect(size_t a, size_t b) const;
+
+	static std::string name_of(object_raw_pointer obj);
+
+	object_heap* heap_{ nullptr };
+
+	std::vector<node> nodes_{};
+
+	std::vector<size_t> reverse_postorder_{};
+};
+
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/4/2022.
+//
+
+#pragma once
+
+#include <interpreter/vm/vm.h>
+
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace clox::interpreting::vm
+{
+
+/// \brief heap_snapshot saves globals, functions and every object reachable from them after preludes run,
+/// so that a new virtual machine starts with their state instead of running them again.
+class heap_snapshot final
+{
+public:
+	static inline constexpr uint32_t MAGIC = 0x49584F4C; // "LOXI" in little endian
+
+	/// \brief bump it whenever the bytecode or the file layout changes
+	static inline constexpr uint32_t VERSION = 3;
+
+	heap_snapshot() = delete;
+
+	/// \brief save the state of vm to path. Sources of preludes are saved as well,
+	/// for the typed front end needs their declarations to compile code using them.
+	/// \return false if the snapshot can't be written
+	static bool save(const std::string& path, virtual_machine& vm, const std::vector<std::string>& prelude_sources);
+
+	/// \brief restore the state saved to path into vm, which should be newly constructed.
+	/// GC must not be enabled on its heap.
+	/// \return sources of preludes, or nullopt if the snapshot is absent or invalid
+	static std::optional<std::vector<std::string>> load(const std::string& path, virtual_machine& vm);
+};
+
+}
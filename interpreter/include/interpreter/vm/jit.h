@@ -0,0 +1,267 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/15/2022.
+//
+
+#pragma once
+
+#include <interpreter/vm/chunk.h>
+#include <interpreter/vm/opcode.h>
+
+#include <helper/console.h>
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace clox::interpreting::vm
+{
+
+class virtual_machine;
+
+class function_object;
+
+enum class virtual_machine_status;
+
+/// \brief when functions move from the interpreter to machine code
+struct tiering_policy
+{
+	/// \brief calls after which a function is compiled
+	size_t call_threshold{ 100 };
+
+	/// \brief backward jumps after which a function is compiled, and its running loop entered in machine code
+	size_t backedge_threshold{ 1000 };
+
+	/// \brief compile on another thread, interpreting the function until its code is ready
+	bool background{ false };
+
+	/// \brief log functions changing tiers, and report the counters of all of them when the JIT is gone
+	bool observe{ false };
+};
+
+/// \brief pages holding machine code, which are writable while the code is emitted and executable afterwards
+class executable_memory final
+{
+public:
+	executable_memory() = default;
+
+	/// \brief copy the code to new pages and make them executable
+	explicit executable_memory(const std::vector<uint8_t>& code);
+
+	~executable_memory();
+
+	executable_memory(const executable_memory&) = delete;
+
+	executable_memory& operator=(const executable_memory&) = delete;
+
+	executable_memory(executable_memory&& other) noexcept;
+
+	executable_memory& operator=(executable_memory&& other) noexcept;
+
+	[[nodiscard]] const uint8_t* data() const
+	{
+		return data_;
+	}
+
+	[[nodiscard]] bool empty() const
+	{
+		return data_ == nullptr;
+	}
+
+private:
+	uint8_t* data_{ nullptr };
+	size_t size_{ 0 };
+};
+
+/// \brief a baseline JIT translating the bytecode of hot functions to x86-64 machine code.
+/// Every instruction becomes a call to a stub, where loading constants, locals and the arithmetic the compiler
+/// has specialized take short paths, and anything else runs the same code as the interpreter.
+/// Jumps and loops become native branches, so the dispatch loop is only left when the call frame changes.
+///
+/// Machine code never keeps values in registers or on the native stack between instructions: every value stays on
+/// the stack of the virtual machine, and the frame's ip is written back before each instruction. So the stack map of every call site is empty, and the collector finds all roots as usual.
+///
+/// Functions start in the interpreter, which counts their calls and the backward jumps of their loops. Backward jumps
+/// are counted in the call frame and reported once every threshold of them. Either count reaching its threshold
+/// compiles the function; there is no tier above this baseline one. As the state of machine code is exactly the state of the interpreter,
+/// a frame can switch tiers at the start of any instruction; a loop jumping back enters machine code right at its
+/// head, replacing the interpreted frame on the stack.
+class baseline_jit final
+{
+public:
+	/// \brief what machine code hands to the stubs it calls
+	struct context
+	{
+		virtual_machine* vm{ nullptr };
+
+		/// \brief the depth of call frames the code runs at, which it leaves once it changes
+		size_t depth{ 0 };
+
+		/// \brief the bytecode of the frame at that depth, which the stubs write the ip of the frame back into
+		chunk* body{ nullptr };
+
+		std::optional<virtual_machine_status> status{};
+		bool exit{ false };
+
+		/// \brief exceptions never unwind through machine code, but are rethrown once it is left
+		std::exception_ptr error{};
+	};
+
+	/// \brief returned by stubs to tell machine code to continue or to return to the interpreter
+	enum stub_result : uint32_t
+	{
+		STUB_CONTINUE = 0,
+		STUB_LEAVE = 1,
+	};
+
+	using stub_type = uint32_t (*)(context*, uint64_t operand, uint32_t offset);
+
+	using entry_type = void (*)(context*, const uint8_t* target);
+
+	/// \return whether machine code can be generated and run on this platform
+	[[nodiscard]] static bool available();
+
+	baseline_jit(virtual_machine& vm, tiering_policy policy, helper::console& cons);
+
+	~baseline_jit();
+
+	baseline_jit(const baseline_jit&) = delete;
+
+	baseline_jit& operator=(const baseline_jit&) = delete;
+
+	/// \brief count a call to the function, compiling it once it becomes hot
+	void count_call(const function_object* func);
+
+	/// \brief backward jumps a frame takes before reporting them by count_backedges
+	[[nodiscard]] size_t backedge_threshold() const
+	{
+		return policy_.backedge_threshold;
+	}
+
+	/// \brief count backward jumps of loops in the function, compiling it once it becomes hot
+	/// \return whether its machine code is ready, so the running frame should switch to it at the loop
+	bool count_backedges(const function_object* func, size_t count);
+
+	/// \brief run the top call frame in machine code from where its ip is
+	/// \return nullopt if the function is not compiled, so the frame has to be interpreted
+	std::optional<std::tuple<std::optional<virtual_machine_status>, bool>> run();
+
+private:
+	struct compiled_function
+	{
+		executable_memory code{};
+
+		/// \brief offsets into the machine code for offsets of instructions in the bytecode, -1 for the others
+		std::vector<int64_t> entries{};
+	};
+
+	struct profile
+	{
+		/// \brief keep the chunk alive, so its address is never reused by another function while it is profiled
+		std::shared_ptr<chunk> body{};
+
+		std::string name{};
+
+		size_t calls{ 0 };
+
+		size_t backedges{ 0 };
+
+		/// \brief times a loop of the function switched to machine code while running
+		size_t replacements{ 0 };
+
+		std::chrono::microseconds compile_time{ 0 };
+
+		/// \brief the code being compiled in the background
+		std::future<std::tuple<std::optional<compiled_function>, std::chrono::microseconds>> pending{};
+
+		std::optional<compiled_function> compiled{};
+	};
+
+	[[nodiscard]] static std::optional<compiled_function> compile(chunk& body);
+
+	[[nodiscard]] static std::tuple<std::optional<compiled_function>, std::chrono::microseconds> timed_compile(
+			chunk& body);
+
+	profile& profile_of(const function_object* func);
+
+	/// \brief compile the function, now or in the background as the policy says
+	void tier_up(profile& prof, const char* reason);
+
+	/// \brief take the code compiled in the background, if it is ready
+	void poll(profile& prof);
+
+	/// \return whether machine code of the function can be run
+	[[nodiscard]] static bool is_runnable(const profile& prof);
+
+	void install(profile& prof, std::optional<compiled_function> compiled, std::chrono::microseconds time);
+
+	void report();
+
+	// stubs called by machine code
+	/// \brief run the instruction at offset of the chunk the same as the interpreter
+	static uint32_t run_instruction(context* ctx, uint64_t body, uint32_t offset) noexcept;
+
+	static uint32_t push_constant(context* ctx, uint64_t constant, uint32_t offset) noexcept;
+
+	static uint32_t push_nil(context* ctx, uint64_t operand, uint32_t offset) noexcept;
+
+	static uint32_t push_true(context* ctx, uint64_t operand, uint32_t offset) noexcept;
+
+	static uint32_t push_false(context* ctx, uint64_t operand, uint32_t offset) noexcept;
+
+	static uint32_t pop(context* ctx, uint64_t operand, uint32_t offset) noexcept;
+
+	static uint32_t get_local(context* ctx, uint64_t slot, uint32_t offset) noexcept;
+
+	static uint32_t set_local(context* ctx, uint64_t slot, uint32_t offset) noexcept;
+
+	/// \brief write the ip back and leave, for the end of the bytecode
+	static uint32_t leave_at(context* ctx, uint64_t body, uint32_t offset) noexcept;
+
+	/// \return 1 if the value on the top of the stack is false, for JUMP_IF_FALSE to branch
+	static uint32_t is_false(context* ctx, uint64_t operand, uint32_t offset) noexcept;
+
+	/// \brief write the ip of the running frame back, so the sampler and the allocation profiler see the right line
+	static void sync_ip(context* ctx, uint32_t offset) noexcept;
+
+	template<op_code Op>
+	static uint32_t specialized_binary(context* ctx, uint64_t secondary, uint32_t offset) noexcept;
+
+	virtual_machine* vm_{ nullptr };
+
+	tiering_policy policy_{};
+
+	helper::console* cons_{ nullptr };
+
+	std::unordered_map<const chunk*, profile> profiles_{};
+};
+
+}
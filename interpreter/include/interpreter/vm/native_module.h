@@ -0,0 +1,101 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/16/2022.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace clox::interpreting::vm
+{
+
+/// \brief how numbers cross into code compiled ahead of time, laid out the same as clox_value in the C it is compiled from
+enum native_value_kind : int32_t
+{
+	NATIVE_INTEGER = 0,
+	NATIVE_FLOATING = 1,
+	NATIVE_BOOLEAN = 2,
+	NATIVE_OVERFLOW = 3, // an integer overflows, so the call is interpreted instead
+};
+
+struct native_value
+{
+	int32_t kind;
+	long long integer; // also holds booleans
+	long double floating;
+};
+
+using native_entry_type = native_value (*)(const native_value* args);
+
+/// \brief a function compiled ahead of time, which runs only if the arguments are exactly what it was compiled for
+struct native_code
+{
+	native_entry_type entry{ nullptr };
+	std::vector<native_value_kind> params{};
+};
+
+/// \brief a shared object built from C by the system C compiler, named by CC or cc
+class native_module final
+{
+public:
+	native_module() = default;
+
+	~native_module();
+
+	native_module(const native_module&) = delete;
+
+	native_module& operator=(const native_module&) = delete;
+
+	native_module(native_module&& other) noexcept;
+
+	native_module& operator=(native_module&& other) noexcept;
+
+	/// \return whether C can be compiled and loaded on this platform
+	[[nodiscard]] static bool available();
+
+	/// \brief compile the source to a shared object in a private temporary directory and load it
+	/// \return nullopt if the compiler fails or the object can not be loaded
+	[[nodiscard]] static std::optional<native_module> build(const std::string& source);
+
+	/// \return nullptr if the symbol is not defined
+	[[nodiscard]] native_entry_type entry(const std::string& symbol) const;
+
+private:
+	/// \return the compiler and the arguments named by CC, split on whitespace
+	static std::vector<std::string> compiler();
+
+	/// \brief create the file, failing if anything is at path already
+	static bool write_source(const std::string& path, const std::string& source);
+
+	/// \brief run the compiler without a shell, and wait for it
+	static bool run_compiler(const std::vector<std::string>& args);
+
+	void* handle_{ nullptr };
+};
+
+}
@@ -129,6 +129,8 @@ enum secondary_op_code : secondary_opcode_base_type
 	SEC_OP_CLASS = 1 << 6,
 	SEC_OP_CAPTURE = 1 << 7,
 	SEC_OP_CTOR = 1 << 8,
+	SEC_OP_INTEGER = 1 << 9, // arithmetic and comparison whose operands are expected to be integers
+	SEC_OP_FLOATING = 1 << 10, // arithmetic and comparison whose operands are expected to be floating
 
 	SEC_OPCODE_ENUM_MAX,
 };
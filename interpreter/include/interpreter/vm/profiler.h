@@ -0,0 +1,148 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/17/2022.
+//
+
+#pragma once
+
+#include <interpreter/vm/chunk.h>
+#include <interpreter/vm/opcode.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace clox::interpreting::vm
+{
+
+class function_object;
+
+/// \brief a deterministic profiler of the virtual machine, which sees every instruction it dispatches and every call
+/// frame it pushes or pops. Instructions are counted by opcode and by function, with and without callees, and so is
+/// wall time. Calls are counted by call site.
+///
+/// Only built with PROFILER defined to 1. Otherwise the hooks in the virtual machine compile to nothing.
+class execution_profiler final
+{
+public:
+	using clock_type = std::chrono::steady_clock;
+
+	execution_profiler() = default;
+
+	/// \brief a frame of the function is pushed, by the call at caller_ip of the caller if there is one
+	void enter(const function_object* func, const function_object* caller, std::optional<chunk::iterator_type> caller_ip);
+
+	/// \brief the top frame is popped
+	void leave();
+
+	void instruction(full_opcode_type code)
+	{
+		instructions_++;
+		opcodes_[code]++;
+		stack_nodes_[frames_.empty() ? 0 : frames_.back().node].self_instructions++;
+
+		if (!frames_.empty())
+		{
+			frames_.back().func->self_instructions++;
+		}
+	}
+
+	/// \brief opcodes, functions and call sites, each sorted by counts
+	void report(std::ostream& os);
+
+	/// \brief one line for each stack of functions, followed by the instructions run right in its innermost one,
+	/// as flamegraph.pl, speedscope and pprof converters read
+	void write_collapsed_stacks(std::ostream& os);
+
+private:
+	struct function_profile
+	{
+		/// \brief keep the chunk alive, so its address is never reused by another function while it is profiled
+		std::shared_ptr<chunk> body{};
+
+		std::string name{};
+
+		uint64_t calls{ 0 };
+
+		uint64_t self_instructions{ 0 };
+		uint64_t total_instructions{ 0 };
+
+		clock_type::duration self_time{ 0 };
+		clock_type::duration total_time{ 0 };
+
+		/// \brief frames of it on the stack, so recursive calls are counted into totals only once
+		size_t active{ 0 };
+	};
+
+	struct active_frame
+	{
+		function_profile* func{ nullptr };
+
+		size_t node{ 0 };
+
+		clock_type::time_point start{};
+		uint64_t start_instructions{ 0 };
+
+		clock_type::duration callee_time{ 0 };
+	};
+
+	/// \brief a node of the tree of every stack of functions seen
+	struct stack_node
+	{
+		size_t parent{ 0 };
+
+		function_profile* func{ nullptr };
+
+		std::unordered_map<function_profile*, size_t> children{};
+
+		uint64_t self_instructions{ 0 };
+	};
+
+	function_profile& profile_of(const function_object* func);
+
+	/// \brief leave all the frames still on the stack, as if they returned now
+	void finish();
+
+	uint64_t instructions_{ 0 };
+
+	std::unordered_map<full_opcode_type, uint64_t> opcodes_{};
+
+	std::unordered_map<const chunk*, function_profile> functions_{};
+
+	/// \brief by the caller, the offset of the call in it, and the callee
+	std::map<std::tuple<function_profile*, int64_t, function_profile*>, uint64_t> call_sites_{};
+
+	std::vector<active_frame> frames_{};
+
+	std::vector<stack_node> stack_nodes_{ stack_node{} };
+};
+
+}
@@ -32,6 +32,7 @@
 
 #include <variant>
 #include <string>
+#include <string_view>
 
 #include <memory>
 #include <map>
@@ -45,7 +46,7 @@ using floating_value_type = scanning::floating_literal_type;
 using boolean_value_type = scanning::boolean_literal_type;
 using nil_value_type = scanning::nil_value_tag_type;
 using object_value_type = object_raw_pointer;
-using variable_name_type = std::string;
+using variable_name_type = std::string_view; // views a name in the constant_pool of the chunk
 
 using value = std::variant<integer_value_type,
 		floating_value_type,
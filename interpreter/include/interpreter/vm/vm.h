@@ -24,6 +24,7 @@
 #pragma once
 
 #include <base/iterable_stack.h>
+#include <base/predefined.h>
 
 #include <interpreter/vm/opcode.h>
 #include <interpreter/vm/chunk.h>
@@ -33,16 +34,28 @@
 #include <interpreter/vm/heap.h>
 #include <interpreter/vm/heap_allocator.h>
 #include <interpreter/vm/garbage_collector.h>
+#include <interpreter/vm/jit.h>
+#include <interpreter/vm/native_module.h>
+#include <interpreter/vm/profiler.h>
+#include <interpreter/vm/allocation_profiler.h>
 
 #include "../../../../native/include/native/native_function.h"
 
+#include <helper/stack_sampler.h>
+#include <helper/trace_recorder.h>
+#include <helper/perf_counters.h>
+
 #include "object/string_object.h"
 #include "object/closure_object.h"
 #include "object/instance_object.h"
 
+#include <functional>
 #include <memory>
 #include <map>
+#include <optional>
 #include <ranges>
+#include <type_traits>
+#include <unordered_map>
 
 #include <gsl/gsl>
 #include "object/class_object.h"
@@ -67,11 +80,29 @@ class virtual_machine final
 public:
 	friend class garbage_collector;
 
+	friend class heap_snapshot;
+
+	friend class allocation_profiler;
+
+	friend class baseline_jit;
+
 	static inline constexpr size_t CALL_STACK_RESERVED_SIZE = 64;
 	static inline constexpr size_t STACK_RESERVED_SIZE = 16384;
+	static inline constexpr size_t FUNCTION_COUNTER_ROWS = 20;
 
 	using value_list_type = std::vector<value>;
-	using global_table_type = std::unordered_map<std::string, value>;
+	struct global_name_hash
+	{
+		using is_transparent = void;
+
+		size_t operator()(std::string_view name) const noexcept
+		{
+			return std::hash<std::string_view>{}(name);
+		}
+	};
+
+	// transparent, so that names viewed from the constant pool are looked up without copying them
+	using global_table_type = std::unordered_map<std::string, value, global_name_hash, std::equal_to<>>;
 	using function_table_type = std::unordered_map<full_opcode_type, value>;
 	using ip_type = chunk::iterator_type;
 
@@ -108,10 +139,17 @@ public:
 			return ip_;
 		}
 
+		/// \brief backward jumps not yet reported to the JIT, which is only told every so many of them
+		[[nodiscard]] size_t &backedges()
+		{
+			return backedges_;
+		}
+
 	private:
 		closure_object_raw_pointer closure_{};
 		ip_type ip_{};
 		size_t stack_offset_{};
+		size_t backedges_{};
 	};
 
 	using call_frame_list_type = std::vector<call_frame>;
@@ -121,18 +159,35 @@ public:
 
 	~virtual_machine();
 
+	/// \param load_natives false if the natives come from elsewhere, like a snapshot
 	explicit virtual_machine(helper::console &cons,
-							 std::shared_ptr<object_heap> heap);
+							 std::shared_ptr<object_heap> heap,
+							 bool load_natives = true);
 
 	virtual_machine_status run(clox::interpreting::vm::closure_object *closure);
 
+	/// \return the virtual machine running code on this thread, for natives that inspect it
+	[[nodiscard]] static virtual_machine *running()
+	{
+		return running_;
+	}
+
+	[[nodiscard]] object_heap &heap()
+	{
+		return *heap_;
+	}
+
+	/// \brief call the compiled code instead of the function whenever the arguments are what it was compiled for
+	void attach_native_code(function_object_raw_pointer func, native_code code);
+
 private:
+	/// \brief define natives missing in globals
 	void load_native_functions();
 
 	virtual_machine_status run();
 
 	// {return status, exit}
-	std::tuple<std::optional<virtual_machine_status>, bool> run_code(chunk::code_type instruction, call_frame &frame);
+	std::tuple<std::optional<virtual_machine_status>, bool> run_code(full_opcode_type instruction, call_frame &frame);
 
 	template<class ...TArgs>
 	void runtime_error(std::string_view fmt, TArgs &&...args)
@@ -192,6 +247,86 @@ private:
 		reset_stack();
 	}
 
+	/// \brief exact arithmetic and comparison of two integers, which every path agrees on
+	/// \return nullopt if the result overflows
+	template<typename TOp>
+	static inline std::optional<value> integer_op(TOp op, integer_value_type l, integer_value_type r) noexcept
+	{
+		integer_value_type ret{ 0 };
+		if constexpr (std::is_same_v<TOp, std::plus<>>)
+		{
+			if (__builtin_add_overflow(l, r, &ret))return std::nullopt;
+			return ret;
+		}
+		else if constexpr (std::is_same_v<TOp, std::minus<>>)
+		{
+			if (__builtin_sub_overflow(l, r, &ret))return std::nullopt;
+			return ret;
+		}
+		else if constexpr (std::is_same_v<TOp, std::multiplies<>>)
+		{
+			if (__builtin_mul_overflow(l, r, &ret))return std::nullopt;
+			return ret;
+		}
+		else
+		{
+			return op(l, r);
+		}
+	}
+
+	/// \brief the fast path of arithmetic and comparison specialized by the compiler for the operand types,
+	/// which skips promoting as long as the operands turn out to be what was expected
+	/// \return false if the instruction is not specialized, the operands are not as expected or integers overflow
+	template<typename TOp>
+	inline bool specialized_binary_op(secondary_opcode_base_type secondary, TOp op)
+	{
+		auto r = peek(0), l = peek(1);
+
+		if ((secondary & SEC_OP_INTEGER) &&
+			std::holds_alternative<integer_value_type>(l) && std::holds_alternative<integer_value_type>(r))
+		{
+			auto ret = integer_op(op, std::get<integer_value_type>(l), std::get<integer_value_type>(r));
+			if (!ret)
+			{
+				return false;
+			}
+
+			pop_two_and_push(ret.value());
+			return true;
+		}
+		else if ((secondary & SEC_OP_FLOATING) &&
+			std::holds_alternative<floating_value_type>(l) && std::holds_alternative<floating_value_type>(r))
+		{
+			pop_two_and_push(op(std::get<floating_value_type>(l), std::get<floating_value_type>(r)));
+			return true;
+		}
+
+		return false;
+	}
+
+	/// \brief the generic path for two integers, which are never promoted, so that they are exact beyond 2^53
+	/// and the same as the specialized path
+	/// \return false if the operands are not both integers
+	/// \throws integer_overflow
+	template<typename TOp>
+	inline bool integer_binary_op(TOp op)
+	{
+		auto r = peek(0), l = peek(1);
+		if (!std::holds_alternative<integer_value_type>(l) || !std::holds_alternative<integer_value_type>(r))
+		{
+			return false;
+		}
+
+		auto ret = integer_op(op, std::get<integer_value_type>(l), std::get<integer_value_type>(r));
+		if (!ret)
+		{
+			throw integer_overflow{ std::get<integer_value_type>(l), std::get<integer_value_type>(r) };
+		}
+
+		pop_two_and_push(ret.value());
+		return true;
+	}
+
 	template<typename TOp>
 	requires BinaryOperator<TOp, floating_value_type, floating_value_type, floating_value_type>
 	inline void binary_op(TOp op)
@@ -245,6 +380,10 @@ private:
 
 			pop_two_and_push(op(left, right));
 		}
+		catch (const heap_memory_limit_exceeded &)
+		{
+			throw; // reported by the interpreter loop, not as invalid operands
+		}
 		catch (const std::exception &e)
 		{
 			this->runtime_error(std::format("Invalid operands for binary operator: {}", e.what()));
@@ -295,6 +434,9 @@ private:
 
 	void call(const std::shared_ptr<native::native_function> &, size_t arg_count);
 
+	/// \return false if the arguments are not exactly of the types the code was compiled for, leaving the stack as is
+	bool call_native_code(const native_code &code, size_t arg_count);
+
 	bool is_false(const value &val);
 
 	[[maybe_unused]] bool is_true(const value &val)
@@ -335,15 +477,18 @@ private:
 
 	void push(const value &val);
 
-	inline void pop_two_and_push(const value &val);
+	void pop_two_and_push(const value &val);
 	//
 
 	// instruction reading
 	value next_constant();
 
-	std::string next_variable_name();
+	variable_name_type next_variable_name();
+
+	/// \throws std::out_of_range if the global is undefined
+	value &global_at(variable_name_type name);
 
-	chunk::code_type next_code();
+	chunk::operand_type next_code();
 
 	value &slot_at(const call_frame &frame, size_t slot);
 
@@ -360,14 +505,114 @@ private:
 
 	void push_call_frame(closure_object_raw_pointer closure, chunk::iterator_type ip, size_t stack_offset)
 	{
+		if (sampling_)
+		{
+			auto& sampler = helper::stack_sampler::instance();
+			if (sampler.needs_drain())
+			{
+				sampler.drain();
+			}
+
+			sampler.enter_critical();
+		}
+
+		if constexpr (base::runtime_predefined_configuration::ENABLE_PROFILER)
+		{
+			if (profiler_)
+			{
+				if (call_frames_.empty())
+				{
+					profiler_->enter(closure->function(), nullptr, std::nullopt);
+				}
+				else
+				{
+					profiler_->enter(closure->function(), top_call_frame().function(), top_call_frame().ip());
+				}
+			}
+		}
+
 		call_frames_.emplace_back(closure, ip, stack_offset);
+
+		if (tracing_)
+		{
+			trace_starts_.push_back(helper::trace_recorder::clock_type::now());
+		}
+
+		if (counting_functions_)
+		{
+			function_counter_starts_.push_back(helper::perf_counters::instance().read());
+			function_counter_depths_[closure->function()->name()]++;
+		}
+
+		if (sampling_)
+		{
+			helper::stack_sampler::instance().leave_critical();
+		}
 	}
 
 	void pop_call_frame()
 	{
+		if (counting_functions_ && !function_counter_starts_.empty())
+		{
+			auto delta = helper::perf_counters::instance().read() - function_counter_starts_.back();
+			function_counter_starts_.pop_back();
+
+			// frames of a recursive function are inside its outermost one, which counts them already
+			auto name = top_call_frame().function()->name();
+			if (auto depth = function_counter_depths_.find(name);
+				depth != function_counter_depths_.end() && --depth->second == 0)
+			{
+				function_counter_depths_.erase(depth);
+				function_counters_[name.empty() ? "<script>" : std::move(name)] += delta;
+			}
+		}
+
+		if (tracing_ && !trace_starts_.empty())
+		{
+			auto& tracer = helper::trace_recorder::instance();
+
+			auto start = trace_starts_.back();
+			trace_starts_.pop_back();
+
+			if (auto end = helper::trace_recorder::clock_type::now();end - start >= tracer.threshold())
+			{
+				auto name = top_call_frame().function()->name();
+				tracer.complete(name.empty() ? "<script>" : std::move(name), "lox", start, end);
+			}
+		}
+
+		if constexpr (base::runtime_predefined_configuration::ENABLE_PROFILER)
+		{
+			if (profiler_)
+			{
+				profiler_->leave();
+			}
+		}
+
+		if (sampling_)
+		{
+			helper::stack_sampler::instance().enter_critical();
+			call_frames_.pop_back();
+			helper::stack_sampler::instance().leave_critical();
+			return;
+		}
+
 		call_frames_.pop_back();
 	}
 
+	/// \brief resolve the call stacks sampled so far, while the functions in them are alive
+	void drain_samples()
+	{
+		if (sampling_)
+		{
+			helper::stack_sampler::instance().drain();
+		}
+	}
+
+	static size_t capture_frames(void* source, helper::stack_sampler::raw_frame* frames, size_t capacity) noexcept;
+
+	static std::string resolve_frame(void* source, const helper::stack_sampler::raw_frame& frame);
+
 	//
 
 	// method
@@ -387,6 +632,41 @@ private:
 
 	std::map<index_type, upvalue_object_raw_pointer> open_upvalues_{}; // it should be ordered
 
+	std::unique_ptr<baseline_jit> jit_{};
+
+	static inline thread_local virtual_machine *running_{ nullptr };
+
+	/// \brief whether the stack sampler takes call stacks of this
+	bool sampling_{ false };
+
+	/// \brief whether calls are traced, and when each frame on the stack was pushed if so
+	bool tracing_{ false };
+	std::vector<helper::trace_recorder::clock_type::time_point> trace_starts_{};
+
+	/// \brief whether hardware counters are counted by function, including callees, and their values when each frame
+	/// on the stack was pushed if so, with frames of each function on the stack
+	bool counting_functions_{ false };
+	std::vector<helper::perf_sample> function_counter_starts_{};
+	std::unordered_map<std::string, size_t> function_counter_depths_{};
+	std::unordered_map<std::string, helper::perf_sample> function_counters_{};
+
+	/// \brief whether instructions run by the interpreter loop are counted for the time statistic, and how many,
+	/// if instruction counting is built in
+	bool counting_instructions_{ false };
+	size_t instructions_{ 0 };
+
+	/// \brief only created if the profiler is built in and asked for
+	std::unique_ptr<execution_profiler> profiler_{};
+
+	/// \brief only created if asked for, and the profiler of the heap before it is restored on destruction
+	std::unique_ptr<allocation_profiler> allocation_profiler_{};
+	allocation_profiler *previous_allocation_profiler_{ nullptr };
+
+	/// \brief a hot loop jumped back in the interpreter while its function has machine code
+	bool on_stack_replacement_{ false };
+
+	std::unordered_map<function_object_raw_pointer, native_code> native_code_{};
+
 	mutable helper::console *cons_{nullptr};
 };
 
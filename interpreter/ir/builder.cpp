@@ -0,0 +1,644 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#include <interpreter/ir/builder.h>
+#include <interpreter/ir/exceptions.h>
+
+#include <algorithm>
+#include <ranges>
+
+using namespace std;
+
+using namespace clox;
+using namespace clox::scanning;
+using namespace clox::parsing;
+using namespace clox::resolving;
+using namespace clox::interpreting::ir;
+
+std::optional<function> builder::build(const shared_ptr<parsing::function_statement>& fs,
+	const vector<std::shared_ptr<resolving::named_symbol>>& params)
+{
+	builder b{ params.size() };
+
+	try
+	{
+		for (size_t i = 0; i < params.size(); i++)
+		{
+			if (!params[i] || params[i]->is_captured())
+			{
+				throw unsupported_construct{ "captured parameter" };
+			}
+
+			instruction param{ .op = ir_op::PARAMETER, .index = i, .location = fs->get_name() };
+			b.write_variable(params[i].get(), b.current_, b.func_.append(b.current_, std::move(param)));
+		}
+
+		b.build(fs->get_body());
+
+		if (b.func_.terminator(b.current_) == INVALID_VALUE)
+		{
+			b.emit(ir_op::RETURN, { b.emit_constant(nil_value_tag, fs->get_name()) }, fs->get_name());
+		}
+	}
+	catch (const unsupported_construct&)
+	{
+		return nullopt;
+	}
+
+	return std::move(b.func_);
+}
+
+builder::builder(size_t param_count)
+	: func_(param_count)
+{
+	current_ = func_.new_block();
+	seal_block(current_);
+}
+
+void builder::build(const shared_ptr<parsing::statement>& stmt)
+{
+	accept(*stmt, *static_cast<statement_visitor<void>*>(this));
+}
+
+void builder::build(const vector<std::shared_ptr<parsing::statement>>& stmts)
+{
+	for (const auto& stmt: stmts)
+	{
+		build(stmt);
+	}
+}
+
+value_id builder::build(const shared_ptr<parsing::expression>& expr)
+{
+	return accept(*expr, *static_cast<expression_visitor<value_id>*>(this));
+}
+
+value_id builder::emit(ir_op op, std::vector<value_id> operands, const scanning::token& location)
+{
+	return func_.append(current_, instruction{ .op = op, .operands = std::move(operands), .location = location });
+}
+
+value_id builder::emit_constant(const scanning::literal_value_type& val, const scanning::token& location)
+{
+	return func_.append(current_, instruction{ .op = ir_op::CONSTANT, .constant = val, .location = location });
+}
+
+builder::variable_type builder::local_variable(const shared_ptr<parsing::expression>& expr)
+{
+	auto annotation = expr->get_annotation<variable_annotation>();
+	if (!annotation || !annotation->symbol() || annotation->upvalue())
+	{
+		throw unsupported_construct{ "variable of enclosing functions" };
+	}
+
+	if (annotation->symbol()->is_global() || annotation->symbol()->is_captured())
+	{
+		throw unsupported_construct{ "writing globals or captured locals" };
+	}
+
+	return annotation->symbol().get();
+}
+
+std::pair<value_id, value_id> builder::step_variable(const shared_ptr<parsing::expression>& target,
+	const token& op)
+{
+	if (!dynamic_pointer_cast<var_expression>(target))
+	{
+		throw unsupported_construct{ "increasing or decreasing non-variables" };
+	}
+
+	auto var = local_variable(target);
+
+	// the same as INC and DEC, which keep the type of the operand
+	auto old = read_variable(var, current_);
+	auto updated = emit(op.type() == token_type::PLUS_PLUS ? ir_op::ADD : ir_op::SUBTRACT,
+		{ old, emit_constant(integer_literal_type{ 1 }, op) }, op);
+
+	write_variable(var, current_, updated);
+
+	return { old, updated };
+}
+
+void builder::jump(block_id to)
+{
+	func_.append(current_, instruction{ .op = ir_op::JUMP, .targets = { to }});
+	func_.block(to).predecessors.push_back(current_);
+}
+
+void builder::branch(value_id cond, block_id if_true, block_id if_false, const token& location)
+{
+	func_.append(current_, instruction{
+		.op = ir_op::BRANCH,
+		.operands = { cond },
+		.targets = { if_true, if_false },
+		.location = location });
+
+	func_.block(if_true).predecessors.push_back(current_);
+	func_.block(if_false).predecessors.push_back(current_);
+}
+
+void builder::start_unreachable()
+{
+	current_ = func_.new_block();
+	seal_block(current_);
+}
+
+value_id builder::phi(block_id b, std::vector<value_id> operands, const token& location)
+{
+	return func_.prepend(b, instruction{ .op = ir_op::PHI, .operands = std::move(operands), .location = location });
+}
+
+void builder::write_variable(variable_type var, block_id b, value_id val)
+{
+	current_def_[var][b] = val;
+}
+
+value_id builder::read_variable(variable_type var, block_id b)
+{
+	if (auto& defs = current_def_[var];defs.contains(b))
+	{
+		return defs.at(b);
+	}
+
+	return read_variable_recursive(var, b);
+}
+
+value_id builder::read_variable_recursive(variable_type var, block_id b)
+{
+	value_id val{ INVALID_VALUE };
+
+	if (!sealed_.contains(b))
+	{
+		// not all predecessors are known, which will be filled in when the block is sealed
+		val = phi(b, {}, token{ virtual_token });
+		incomplete_phis_[b].emplace_back(var, val);
+	}
+	else if (const auto& preds = func_.block(b).predecessors;preds.empty())
+	{
+		val = undefined();
+	}
+	else if (preds.size() == 1)
+	{
+		val = read_variable(var, preds.front());
+	}
+	else
+	{
+		// break potential cycles with an operandless phi
+		val = phi(b, {}, token{ virtual_token });
+		write_variable(var, b, val);
+		val = add_phi_operands(var, val);
+	}
+
+	write_variable(var, b, val);
+	return val;
+}
+
+value_id builder::add_phi_operands(variable_type var, value_id phi)
+{
+	// copy, for reading variables may append predecessors' blocks
+	auto preds = func_.block(func_.at(phi).block).predecessors;
+	for (auto pred: preds)
+	{
+		auto operand = read_variable(var, pred);
+		func_.at(phi).operands.push_back(operand);
+	}
+
+	return try_remove_trivial_phi(phi);
+}
+
+value_id builder::try_remove_trivial_phi(value_id phi)
+{
+	value_id same{ INVALID_VALUE };
+	for (auto op: func_.at(phi).operands)
+	{
+		if (op == same || op == phi)
+		{
+			continue;
+		}
+
+		if (same != INVALID_VALUE)
+		{
+			return phi; // it merges at least two values
+		}
+
+		same = op;
+	}
+
+	if (same == INVALID_VALUE)
+	{
+		same = undefined(); // it is unreachable or in the entry
+	}
+
+	vector<value_id> phi_users{};
+	for (const auto& bb: func_.blocks())
+	{
+		for (auto user: bb.instructions)
+		{
+			if (user != phi && func_.at(user).op == ir_op::PHI && ranges::find(func_.at(user).operands, phi) !=
+																   func_.at(user).operands.end())
+			{
+				phi_users.push_back(user);
+			}
+		}
+	}
+
+	func_.replace_all_uses(phi, same);
+	func_.remove(phi);
+
+	for (auto& [var, defs]: current_def_)
+	{
+		for (auto& [b, val]: defs)
+		{
+			if (val == phi)
+			{
+				val = same;
+			}
+		}
+	}
+
+	for (auto& [b, phis]: incomplete_phis_)
+	{
+		for (auto& [var, val]: phis)
+		{
+			if (val == phi)
+			{
+				val = same;
+			}
+		}
+	}
+
+	// users might have become trivial as well
+	for (auto user: phi_users)
+	{
+		if (!func_.at(user).removed)
+		{
+			try_remove_trivial_phi(user);
+		}
+	}
+
+	return same;
+}
+
+void builder::seal_block(block_id b)
+{
+	if (auto iter = incomplete_phis_.find(b);iter != incomplete_phis_.end())
+	{
+		auto phis = std::move(iter->second);
+		incomplete_phis_.erase(iter);
+
+		for (auto [var, phi]: phis)
+		{
+			if (!func_.at(phi).removed && func_.at(phi).op == ir_op::PHI)
+			{
+				add_phi_operands(var, phi);
+			}
+		}
+	}
+
+	sealed_.insert(b);
+}
+
+value_id builder::undefined()
+{
+	if (undefined_ == INVALID_VALUE)
+	{
+		undefined_ = func_.prepend(func_.entry(), instruction{ .op = ir_op::CONSTANT, .constant = nil_value_tag });
+	}
+
+	return undefined_;
+}
+
+value_id builder::visit_assignment_expression(const std::shared_ptr<parsing::assignment_expression>& ae)
+{
+	auto val = build(ae->get_value());
+	write_variable(local_variable(ae), current_, val);
+	return val;
+}
+
+value_id builder::visit_binary_expression(const std::shared_ptr<parsing::binary_expression>& be)
+{
+	if (be->get_annotation<operator_annotation>())
+	{
+		throw unsupported_construct{ "overloaded operator" };
+	}
+
+	ir_op op{};
+	switch (be->get_op().type())
+	{
+	case token_type::PLUS:
+		op = ir_op::ADD;
+		break;
+	case token_type::MINUS:
+		op = ir_op::SUBTRACT;
+		break;
+	case token_type::STAR:
+		op = ir_op::MULTIPLY;
+		break;
+	case token_type::SLASH:
+		op = ir_op::DIVIDE;
+		break;
+	case token_type::STAR_STAR:
+		op = ir_op::POW;
+		break;
+	case token_type::EQUAL_EQUAL:
+		op = ir_op::EQUAL;
+		break;
+	case token_type::BANG_EQUAL:
+		op = ir_op::NOT_EQUAL;
+		break;
+	case token_type::LESS:
+		op = ir_op::LESS;
+		break;
+	case token_type::LESS_EQUAL:
+		op = ir_op::LESS_EQUAL;
+		break;
+	case token_type::GREATER:
+		op = ir_op::GREATER;
+		break;
+	case token_type::GREATER_EQUAL:
+		op = ir_op::GREATER_EQUAL;
+		break;
+	default:
+		throw unsupported_construct{ be->get_op().lexeme() };
+	}
+
+	auto l = build(be->get_left());
+	auto r = build(be->get_right());
+
+	return emit(op, { l, r }, be->get_op());
+}
+
+value_id builder::visit_unary_expression(const std::shared_ptr<parsing::unary_expression>& ue)
+{
+	switch (ue->get_op().type())
+	{
+	case token_type::MINUS:
+		return emit(ir_op::NEGATE, { build(ue->get_right()) }, ue->get_op());
+	case token_type::BANG:
+		return emit(ir_op::NOT, { build(ue->get_right()) }, ue->get_op());
+	case token_type::PLUS_PLUS:
+	case token_type::MINUS_MINUS:
+		return step_variable(ue->get_right(), ue->get_op()).second;
+	default:
+		throw unsupported_construct{ ue->get_op().lexeme() };
+	}
+}
+
+value_id builder::visit_this_expression(const std::shared_ptr<parsing::this_expression>& ptr)
+{
+	throw unsupported_construct{ "this" };
+}
+
+value_id builder::visit_base_expression(const std::shared_ptr<parsing::base_expression>& ptr)
+{
+	throw unsupported_construct{ "base" };
+}
+
+value_id builder::visit_postfix_expression(const std::shared_ptr<parsing::postfix_expression>& pe)
+{
+	if (pe->get_optional_right())
+	{
+		throw unsupported_construct{ "indexing" };
+	}
+
+	return step_variable(pe->get_left(), pe->get_op()).first;
+}
+
+value_id builder::visit_literal_expression(const std::shared_ptr<parsing::literal_expression>& le)
+{
+	if (holds_alternative<empty_literal_tag>(le->get_value()))
+	{
+		throw unsupported_construct{ "empty literal" };
+	}
+
+	return emit_constant(le->get_value(), le->get_token());
+}
+
+value_id builder::visit_grouping_expression(const std::shared_ptr<parsing::grouping_expression>& ge)
+{
+	return build(ge->get_expr());
+}
+
+value_id builder::visit_lambda_expression(const std::shared_ptr<parsing::lambda_expression>& ptr)
+{
+	throw unsupported_construct{ "lambda" };
+}
+
+value_id builder::visit_var_expression(const std::shared_ptr<parsing::var_expression>& ve)
+{
+	if (auto annotation = ve->get_annotation<variable_annotation>();
+		annotation && annotation->symbol() && !annotation->upvalue() && annotation->symbol()->is_global())
+	{
+		instruction load{ .op = ir_op::LOAD_GLOBAL, .name = ve->get_name().lexeme(), .location = ve->get_name() };
+		return func_.append(current_, std::move(load));
+	}
+
+	return read_variable(local_variable(ve), current_);
+}
+
+value_id builder::visit_ternary_expression(const std::shared_ptr<parsing::ternary_expression>& te)
+{
+	auto cond = build(te->get_cond());
+
+	auto true_block = func_.new_block(), false_block = func_.new_block(), join = func_.new_block();
+
+	branch(cond, true_block, false_block, te->get_colon());
+	seal_block(true_block);
+	seal_block(false_block);
+
+	current_ = true_block;
+	auto true_val = build(te->get_true_expr());
+	jump(join);
+
+	current_ = false_block;
+	auto false_val = build(te->get_false_expr());
+	jump(join);
+
+	seal_block(join);
+	current_ = join;
+
+	return phi(join, { true_val, false_val }, te->get_qmark());
+}
+
+value_id builder::visit_logical_expression(const std::shared_ptr<parsing::logical_expression>& le)
+{
+	auto left = build(le->get_left());
+	auto left_block = current_;
+
+	auto right_block = func_.new_block(), join = func_.new_block();
+
+	// like codegen, the value of lhs is the result if it decides
+	switch (le->get_op().type())
+	{
+	case token_type::AND:
+		branch(left, right_block, join, le->get_op());
+		break;
+	case token_type::OR:
+		branch(left, join, right_block, le->get_op());
+		break;
+	default:
+		throw unsupported_construct{ le->get_op().lexeme() };
+	}
+
+	seal_block(right_block);
+
+	current_ = right_block;
+	auto right = build(le->get_right());
+	jump(join);
+
+	seal_block(join);
+	current_ = join;
+
+	// predecessors of join are in order of left_block and the end of rhs
+	auto& preds = func_.block(join).predecessors;
+	return phi(join, preds.front() == left_block ? vector<value_id>{ left, right } : vector<value_id>{ right, left },
+		le->get_op());
+}
+
+value_id builder::visit_call_expression(const std::shared_ptr<parsing::call_expression>& ptr)
+{
+	throw unsupported_construct{ "call" };
+}
+
+value_id builder::visit_list_initializer_expression(const std::shared_ptr<parsing::list_initializer_expression>& ptr)
+{
+	throw unsupported_construct{ "list" };
+}
+
+value_id builder::visit_map_initializer_expression(const std::shared_ptr<parsing::map_initializer_expression>& ptr)
+{
+	throw unsupported_construct{ "map" };
+}
+
+value_id builder::visit_get_expression(const std::shared_ptr<parsing::get_expression>& ptr)
+{
+	throw unsupported_construct{ "property" };
+}
+
+value_id builder::visit_set_expression(const std::shared_ptr<parsing::set_expression>& ptr)
+{
+	throw unsupported_construct{ "property" };
+}
+
+void builder::visit_expression_statement(const std::shared_ptr<parsing::expression_statement>& es)
+{
+	build(es->get_expr());
+}
+
+void builder::visit_print_statement(const std::shared_ptr<parsing::print_statement>& ps)
+{
+	emit(ir_op::PRINT, { build(ps->get_expr()) }, ps->get_keyword());
+}
+
+void builder::visit_variable_statement(const std::shared_ptr<parsing::variable_statement>& vs)
+{
+	auto annotation = vs->get_annotation<variable_annotation>();
+	if (!annotation || !annotation->symbol() || !annotation->symbol()->is_local() ||
+		annotation->symbol()->is_captured())
+	{
+		throw unsupported_construct{ "variable declaration" };
+	}
+
+	auto val = vs->get_initializer() ? build(vs->get_initializer()) : emit_constant(nil_value_tag, vs->get_name());
+	write_variable(annotation->symbol().get(), current_, val);
+}
+
+void builder::visit_block_statement(const std::shared_ptr<parsing::block_statement>& bs)
+{
+	build(bs->get_stmts());
+}
+
+void builder::visit_while_statement(const std::shared_ptr<parsing::while_statement>& ws)
+{
+	auto header = func_.new_block();
+	jump(header);
+
+	current_ = header;
+	auto cond = build(ws->get_cond());
+
+	auto body = func_.new_block(), exit = func_.new_block();
+	branch(cond, body, exit, ws->get_cond_l_paren());
+
+	seal_block(body);
+	seal_block(exit);
+
+	current_ = body;
+	build(ws->get_body());
+	jump(header);
+
+	// every back edge is known now
+	seal_block(header);
+
+	current_ = exit;
+}
+
+void builder::visit_foreach_statement(const std::shared_ptr<parsing::foreach_statement>& ptr)
+{
+	throw unsupported_construct{ "foreach" };
+}
+
+void builder::visit_if_statement(const std::shared_ptr<parsing::if_statement>& ifs)
+{
+	auto cond = build(ifs->get_cond());
+
+	auto true_block = func_.new_block(), false_block = func_.new_block(), join = func_.new_block();
+
+	branch(cond, true_block, false_block, ifs->get_cond_l_paren());
+	seal_block(true_block);
+	seal_block(false_block);
+
+	current_ = true_block;
+	build(ifs->get_true_stmt());
+	jump(join);
+
+	current_ = false_block;
+	if (ifs->get_false_stmt())
+	{
+		build(ifs->get_false_stmt());
+	}
+	jump(join);
+
+	seal_block(join);
+	current_ = join;
+}
+
+void builder::visit_function_statement(const std::shared_ptr<parsing::function_statement>& ptr)
+{
+	throw unsupported_construct{ "nested function" };
+}
+
+void builder::visit_return_statement(const std::shared_ptr<parsing::return_statement>& rs)
+{
+	auto val = rs->get_val() ? build(rs->get_val()) : emit_constant(nil_value_tag, rs->get_return_keyword());
+	emit(ir_op::RETURN, { val }, rs->get_return_keyword());
+
+	start_unreachable();
+}
+
+void builder::visit_class_statement(const std::shared_ptr<parsing::class_statement>& ptr)
+{
+	throw unsupported_construct{ "class" };
+}
@@ -0,0 +1,495 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/16/2022.
+//
+
+#include <interpreter/ir/c_backend.h>
+
+#include <interpreter/vm/native_module.h>
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <ranges>
+#include <variant>
+
+using namespace std;
+
+using namespace clox;
+using namespace clox::scanning;
+using namespace clox::interpreting::ir;
+
+namespace
+{
+
+enum class c_type
+{
+	INTEGER,
+	FLOATING,
+	BOOLEAN,
+};
+
+/// \brief thrown when the function uses what has no unboxed representation
+struct untranslatable
+{
+};
+
+const char* name_of(c_type type)
+{
+	switch (type)
+	{
+	case c_type::INTEGER:
+		return "long long";
+	case c_type::FLOATING:
+		return "long double";
+	default:
+		return "int";
+	}
+}
+
+string integer_constant(integer_literal_type i)
+{
+	if (i == numeric_limits<integer_literal_type>::min())
+	{
+		return "LLONG_MIN";
+	}
+
+	return std::format("{}LL", i);
+}
+
+/// \brief hexadecimal floating constants, which are exact
+string floating_constant(floating_literal_type f)
+{
+	if (!isfinite(f))
+	{
+		throw untranslatable{};
+	}
+
+	return std::format("{}0x{:a}L", signbit(f) ? "-" : "", fabs(f));
+}
+
+class translator final
+{
+public:
+	translator(const function& func, const vector<value_kind>& params)
+		: func_(func), params_(params), order_(func.reverse_post_order()),
+		  kinds_(value_kinds(func, order_, params)), types_(func.value_count())
+	{
+	}
+
+	string translate(const string& name)
+	{
+		for (auto kind: params_)
+		{
+			if (kind == value_kind::UNKNOWN)
+			{
+				throw untranslatable{};
+			}
+		}
+
+		infer_types();
+
+		string ret{ std::format("static clox_value {}(", name) };
+		for (size_t i = 0; i < params_.size(); i++)
+		{
+			ret += std::format("{}{} p{}", i ? ", " : "", name_of(type_of_param(i)), i);
+		}
+		ret += params_.empty() ? "void)\n{\n" : ")\n{\n";
+
+		for (auto b: order_)
+		{
+			for (auto v: func_.block(b).instructions)
+			{
+				if (types_[v])
+				{
+					ret += std::format("\t{} v{};\n", name_of(types_[v].value()), v);
+				}
+			}
+		}
+
+		ret += std::format("\tgoto b{};\n", func_.entry());
+
+		for (auto b: order_)
+		{
+			ret += std::format("b{}:;\n", b);
+			for (auto v: func_.block(b).instructions)
+			{
+				ret += statement(b, v);
+			}
+		}
+
+		ret += "}\n";
+		return ret;
+	}
+
+private:
+	c_type type_of_param(size_t i) const
+	{
+		return params_[i] == value_kind::INTEGER ? c_type::INTEGER : c_type::FLOATING;
+	}
+
+	c_type type_of(value_id v) const
+	{
+		if (!types_[v])
+		{
+			throw untranslatable{};
+		}
+
+		return types_[v].value();
+	}
+
+	bool is_number(value_id v) const
+	{
+		return type_of(v) != c_type::BOOLEAN;
+	}
+
+	void infer_types()
+	{
+		for (bool changed = true; changed;)
+		{
+			changed = false;
+			for (auto b: order_)
+			{
+				for (auto v: func_.block(b).instructions)
+				{
+					if (auto type = infer(v);type != types_[v])
+					{
+						types_[v] = type;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+
+	optional<c_type> infer(value_id v) const
+	{
+		const auto& inst = func_.at(v);
+		switch (inst.op)
+		{
+		case ir_op::CONSTANT:
+			if (holds_alternative<integer_literal_type>(inst.constant))return c_type::INTEGER;
+			if (holds_alternative<floating_literal_type>(inst.constant))return c_type::FLOATING;
+			if (holds_alternative<boolean_literal_type>(inst.constant))return c_type::BOOLEAN;
+			throw untranslatable{};
+
+		case ir_op::PARAMETER:
+			return type_of_param(inst.index);
+
+		case ir_op::ADD:
+		case ir_op::SUBTRACT:
+		case ir_op::MULTIPLY:
+		case ir_op::DIVIDE:
+		case ir_op::POW:
+		case ir_op::NEGATE:
+			if (kinds_[v] == value_kind::UNKNOWN)
+			{
+				throw untranslatable{}; // booleans or values of unknown representation take part
+			}
+			return kinds_[v] == value_kind::INTEGER ? c_type::INTEGER : c_type::FLOATING;
+
+		case ir_op::EQUAL:
+		case ir_op::NOT_EQUAL:
+		case ir_op::LESS:
+		case ir_op::LESS_EQUAL:
+		case ir_op::GREATER:
+		case ir_op::GREATER_EQUAL:
+		case ir_op::NOT:
+			return c_type::BOOLEAN;
+
+		case ir_op::PHI:
+		{
+			optional<c_type> same{};
+			for (auto op: inst.operands)
+			{
+				if (!types_[op])continue;
+				if (same && same != types_[op])
+				{
+					throw untranslatable{}; // the representation changes along paths
+				}
+				same = types_[op];
+			}
+			return same;
+		}
+
+		case ir_op::JUMP:
+		case ir_op::BRANCH:
+		case ir_op::RETURN:
+			return nullopt;
+
+		default:
+			throw untranslatable{}; // globals and printing need the virtual machine
+		}
+	}
+
+	/// \return the operand converted to the representation
+	string operand(value_id v, c_type as) const
+	{
+		if (as == c_type::FLOATING && type_of(v) == c_type::INTEGER)
+		{
+			return std::format("(long double)v{}", v);
+		}
+
+		return std::format("v{}", v);
+	}
+
+	string arithmetic(value_id v, const instruction& inst) const
+	{
+		auto l = inst.operands[0], r = inst.operands[1];
+
+		// promoted like binary_op of the virtual machine, and cast back if both are integers
+		string ret{};
+		switch (inst.op)
+		{
+		case ir_op::ADD:
+			ret = std::format("{} + {}", operand(l, c_type::FLOATING), operand(r, c_type::FLOATING));
+			break;
+		case ir_op::SUBTRACT:
+			ret = std::format("{} - {}", operand(l, c_type::FLOATING), operand(r, c_type::FLOATING));
+			break;
+		case ir_op::MULTIPLY:
+			ret = std::format("{} * {}", operand(l, c_type::FLOATING), operand(r, c_type::FLOATING));
+			break;
+		case ir_op::DIVIDE:
+			ret = std::format("{} / {}", operand(l, c_type::FLOATING), operand(r, c_type::FLOATING));
+			break;
+		default:
+			ret = std::format("powl({}, {})", operand(l, c_type::FLOATING), operand(r, c_type::FLOATING));
+			break;
+		}
+
+		return type_of(v) == c_type::INTEGER ? std::format("(long long)({})", ret) : ret;
+	}
+
+	string comparison(const instruction& inst) const
+	{
+		auto l = inst.operands[0], r = inst.operands[1];
+		if (!is_number(l) || !is_number(r))
+		{
+			throw untranslatable{};
+		}
+
+		const char* op{};
+		switch (inst.op)
+		{
+		case ir_op::EQUAL:
+			op = "==";
+			break;
+		case ir_op::NOT_EQUAL:
+			op = "!=";
+			break;
+		case ir_op::LESS:
+			op = "<";
+			break;
+		case ir_op::LESS_EQUAL:
+			op = "<=";
+			break;
+		case ir_op::GREATER:
+			op = ">";
+			break;
+		default:
+			op = ">=";
+			break;
+		}
+
+		auto as = type_of(l) == c_type::INTEGER && type_of(r) == c_type::INTEGER ? c_type::INTEGER : c_type::FLOATING;
+		return std::format("{} {} {}", operand(l, as), op, operand(r, as));
+	}
+
+	/// \brief assign phis of the target from the block, through temporaries, for they may read each other
+	string phi_copies(block_id from, block_id to) const
+	{
+		const auto& target = func_.block(to);
+		auto pred = ranges::find(target.predecessors, from);
+		if (pred == target.predecessors.end())
+		{
+			throw untranslatable{};
+		}
+
+		auto index = static_cast<size_t>(pred - target.predecessors.begin());
+
+		string temps{}, assigns{};
+		for (auto v: target.instructions)
+		{
+			const auto& inst = func_.at(v);
+			if (inst.op != ir_op::PHI)continue;
+
+			temps += std::format("{} t{} = {}; ", name_of(type_of(v)), v, operand(inst.operands.at(index), type_of(v)));
+			assigns += std::format("v{} = t{}; ", v, v);
+		}
+
+		return std::format("{{ {}{}goto b{}; }}", temps, assigns, to);
+	}
+
+	string statement(block_id b, value_id v) const
+	{
+		const auto& inst = func_.at(v);
+		switch (inst.op)
+		{
+		case ir_op::CONSTANT:
+			if (auto i = get_if<integer_literal_type>(&inst.constant);i)
+			{
+				return std::format("\tv{} = {};\n", v, integer_constant(*i));
+			}
+			else if (auto f = get_if<floating_literal_type>(&inst.constant);f)
+			{
+				return std::format("\tv{} = {};\n", v, floating_constant(*f));
+			}
+			return std::format("\tv{} = {};\n", v, get<boolean_literal_type>(inst.constant) ? 1 : 0);
+
+		case ir_op::PARAMETER:
+			return std::format("\tv{} = p{};\n", v, inst.index);
+
+		case ir_op::ADD:
+		case ir_op::SUBTRACT:
+		case ir_op::MULTIPLY:
+			// exact like the virtual machine, which raises the overflow error when the caller interprets the call again
+			if (type_of(v) == c_type::INTEGER)
+			{
+				const char* builtin = inst.op == ir_op::ADD ? "add" : (inst.op == ir_op::SUBTRACT ? "sub" : "mul");
+				return std::format("\tif (__builtin_{}_overflow(v{}, v{}, &v{})) return (clox_value){{ .kind = CLOX_OVERFLOW }};\n",
+					builtin, inst.operands[0], inst.operands[1], v);
+			}
+			return std::format("\tv{} = {};\n", v, arithmetic(v, inst));
+
+		case ir_op::DIVIDE:
+		case ir_op::POW:
+			return std::format("\tv{} = {};\n", v, arithmetic(v, inst));
+
+		case ir_op::NEGATE:
+			if (type_of(v) == c_type::INTEGER)
+			{
+				return std::format("\tif (__builtin_sub_overflow(0LL, v{}, &v{})) return (clox_value){{ .kind = CLOX_OVERFLOW }};\n",
+					inst.operands[0], v);
+			}
+			return std::format("\tv{} = -v{};\n", v, inst.operands[0]);
+
+		case ir_op::EQUAL:
+		case ir_op::NOT_EQUAL:
+		case ir_op::LESS:
+		case ir_op::LESS_EQUAL:
+		case ir_op::GREATER:
+		case ir_op::GREATER_EQUAL:
+			return std::format("\tv{} = {};\n", v, comparison(inst));
+
+		case ir_op::NOT:
+			// numbers are always true
+			return is_number(inst.operands[0]) ? std::format("\tv{} = 0;\n", v)
+											   : std::format("\tv{} = !v{};\n", v, inst.operands[0]);
+
+		case ir_op::PHI:
+			return "";
+
+		case ir_op::JUMP:
+			return std::format("\t{}\n", phi_copies(b, inst.targets[0]));
+
+		case ir_op::BRANCH:
+			if (is_number(inst.operands[0]) || inst.targets[0] == inst.targets[1])
+			{
+				return std::format("\t{}\n", phi_copies(b, inst.targets[0]));
+			}
+			return std::format("\tif (v{}) {}\n\telse {}\n", inst.operands[0],
+				phi_copies(b, inst.targets[0]), phi_copies(b, inst.targets[1]));
+
+		case ir_op::RETURN:
+		{
+			auto ret = inst.operands[0];
+			switch (type_of(ret))
+			{
+			case c_type::INTEGER:
+				return std::format("\treturn (clox_value){{ .kind = CLOX_INTEGER, .integer = v{} }};\n", ret);
+			case c_type::FLOATING:
+				return std::format("\treturn (clox_value){{ .kind = CLOX_FLOATING, .floating = v{} }};\n", ret);
+			default:
+				return std::format("\treturn (clox_value){{ .kind = CLOX_BOOLEAN, .integer = v{} }};\n", ret);
+			}
+		}
+
+		default:
+			throw untranslatable{};
+		}
+	}
+
+	const function& func_;
+	const vector<value_kind>& params_;
+
+	vector<block_id> order_{};
+	vector<value_kind> kinds_{};
+	vector<optional<c_type>> types_{};
+};
+
+}
+
+std::optional<std::string> c_module::add(const function& func, const vector<value_kind>& params, const string& name)
+{
+	auto index = functions_.size();
+	auto inner = std::format("lox_{}_{}", name, index);
+	auto symbol = std::format("clox_{}_{}", name, index);
+
+	try
+	{
+		auto code = translator{ func, params }.translate(inner);
+
+		// the entry unboxes arguments, whose types the caller has checked
+		code += std::format("clox_value {}(const clox_value* args)\n{{\n\treturn {}(", symbol, inner);
+		for (size_t i = 0; i < params.size(); i++)
+		{
+			code += std::format("{}args[{}].{}", i ? ", " : "", i,
+				params[i] == value_kind::INTEGER ? "integer" : "floating");
+		}
+		code += ");\n}\n";
+
+		functions_.push_back(std::move(code));
+		return symbol;
+	}
+	catch (const untranslatable&)
+	{
+		return nullopt;
+	}
+}
+
+std::string c_module::source() const
+{
+	using namespace clox::interpreting::vm;
+
+	string ret{ "/* generated by clox, do not edit */\n"
+				"#include <stdint.h>\n"
+				"#include <limits.h>\n"
+				"#include <math.h>\n\n" };
+
+	ret += std::format("enum {{ CLOX_INTEGER = {}, CLOX_FLOATING = {}, CLOX_BOOLEAN = {}, CLOX_OVERFLOW = {} }};\n\n",
+		static_cast<int32_t>(NATIVE_INTEGER), static_cast<int32_t>(NATIVE_FLOATING),
+		static_cast<int32_t>(NATIVE_BOOLEAN), static_cast<int32_t>(NATIVE_OVERFLOW));
+
+	ret += "typedef struct\n{\n\tint32_t kind;\n\tlong long integer;\n\tlong double floating;\n} clox_value;\n\n";
+
+	for (const auto& func: functions_)
+	{
+		ret += func;
+		ret += "\n";
+	}
+
+	return ret;
+}
@@ -0,0 +1,156 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#include <interpreter/ir/ir.h>
+
+#include <algorithm>
+#include <ranges>
+
+using namespace std;
+
+using namespace clox::interpreting::ir;
+
+std::vector<block_id> basic_block::successors(const function& func) const
+{
+	if (auto term = func.terminator(id);term != INVALID_VALUE)
+	{
+		return func.at(term).targets;
+	}
+
+	return {};
+}
+
+block_id function::new_block()
+{
+	auto id = static_cast<block_id>(blocks_.size());
+	blocks_.push_back(basic_block{ .id = id });
+	return id;
+}
+
+value_id function::append(block_id b, instruction inst)
+{
+	auto id = static_cast<value_id>(instructions_.size());
+
+	inst.block = b;
+	instructions_.push_back(std::move(inst));
+	blocks_.at(b).instructions.push_back(id);
+
+	return id;
+}
+
+value_id function::prepend(block_id b, instruction inst)
+{
+	auto id = static_cast<value_id>(instructions_.size());
+
+	inst.block = b;
+	instructions_.push_back(std::move(inst));
+
+	auto& insts = blocks_.at(b).instructions;
+	insts.insert(insts.begin(), id);
+
+	return id;
+}
+
+void function::move_before_terminator(value_id v, block_id to)
+{
+	auto& from_insts = blocks_.at(at(v).block).instructions;
+	from_insts.erase(ranges::find(from_insts, v));
+
+	auto& to_insts = blocks_.at(to).instructions;
+	auto pos = to_insts.end();
+	if (!to_insts.empty() && is_terminator(at(to_insts.back()).op))
+	{
+		pos = to_insts.end() - 1;
+	}
+	to_insts.insert(pos, v);
+
+	at(v).block = to;
+}
+
+void function::remove(value_id v)
+{
+	auto& inst = at(v);
+	if (inst.removed)return;
+
+	auto& insts = blocks_.at(inst.block).instructions;
+	insts.erase(ranges::find(insts, v));
+
+	inst.removed = true;
+}
+
+void function::replace_all_uses(value_id from, value_id to)
+{
+	for (auto& inst: instructions_)
+	{
+		if (inst.removed)continue;
+		ranges::replace(inst.operands, from, to);
+	}
+}
+
+value_id function::terminator(block_id b) const
+{
+	const auto& insts = blocks_.at(b).instructions;
+	if (!insts.empty() && is_terminator(at(insts.back()).op))
+	{
+		return insts.back();
+	}
+
+	return INVALID_VALUE;
+}
+
+std::vector<block_id> function::reverse_post_order() const
+{
+	vector<block_id> post_order{};
+	vector<bool> visited(blocks_.size(), false);
+
+	// iterative depth-first search, so that deep nesting never overflows the stack
+	vector<pair<block_id, size_t>> stack{ { entry(), 0 } };
+	visited[entry()] = true;
+
+	while (!stack.empty())
+	{
+		auto& [b, next] = stack.back();
+		auto succs = blocks_[b].successors(*this);
+
+		if (next < succs.size())
+		{
+			auto s = succs[next++];
+			if (!visited[s])
+			{
+				visited[s] = true;
+				stack.emplace_back(s, 0);
+			}
+		}
+		else
+		{
+			post_order.push_back(b);
+			stack.pop_back();
+		}
+	}
+
+	ranges::reverse(post_order);
+	return post_order;
+}
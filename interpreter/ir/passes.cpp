@@ -0,0 +1,611 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#include <interpreter/ir/passes.h>
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <ranges>
+
+using namespace std;
+
+using namespace clox;
+using namespace clox::interpreting::ir;
+
+namespace
+{
+
+bool is_arithmetic_op(ir_op op)
+{
+	return (op >= ir_op::ADD && op <= ir_op::POW) || op == ir_op::NEGATE;
+}
+
+bool is_comparison_op(ir_op op)
+{
+	return op >= ir_op::EQUAL && op <= ir_op::GREATER_EQUAL;
+}
+
+vector<bool> reachable_blocks(const function& func)
+{
+	vector<bool> reachable(func.blocks().size(), false);
+	for (auto b: func.reverse_post_order())
+	{
+		reachable[b] = true;
+	}
+	return reachable;
+}
+
+bool simplify_trivial_phis(function& func)
+{
+	bool changed = false;
+	for (auto& bb: func.blocks())
+	{
+		auto insts = bb.instructions;
+		for (auto v: insts)
+		{
+			if (func.at(v).op != ir_op::PHI || func.at(v).removed)
+			{
+				continue;
+			}
+
+			value_id same{ INVALID_VALUE };
+			bool trivial = true;
+			for (auto op: func.at(v).operands)
+			{
+				if (op == v || op == same)continue;
+				if (same != INVALID_VALUE)
+				{
+					trivial = false;
+					break;
+				}
+				same = op;
+			}
+
+			if (trivial && same != INVALID_VALUE)
+			{
+				func.replace_all_uses(v, same);
+				func.remove(v);
+				changed = true;
+			}
+		}
+	}
+
+	return changed;
+}
+
+using expression_key = pair<ir_op, vector<value_id>>;
+
+void eliminate_in_dominator_subtree(function& func, const vector<vector<block_id>>& children, block_id b,
+	map<expression_key, value_id>& available)
+{
+	vector<expression_key> introduced{};
+
+	auto insts = func.block(b).instructions;
+	for (auto v: insts)
+	{
+		const auto& inst = func.at(v);
+		if (!is_pure(inst.op) || inst.op == ir_op::CONSTANT)
+		{
+			continue;
+		}
+
+		expression_key key{ inst.op, inst.operands };
+		if (auto iter = available.find(key);iter != available.end())
+		{
+			func.replace_all_uses(v, iter->second);
+			func.remove(v);
+		}
+		else
+		{
+			available.emplace(key, v);
+			introduced.push_back(std::move(key));
+		}
+	}
+
+	for (auto child: children[b])
+	{
+		eliminate_in_dominator_subtree(func, children, child, available);
+	}
+
+	// what is computed here is not available to blocks it does not dominate
+	for (const auto& key: introduced)
+	{
+		available.erase(key);
+	}
+}
+
+}
+
+std::vector<bool> clox::interpreting::ir::numeric_values(const function& func, const vector<block_id>& rpo)
+{
+	vector<bool> numeric(func.value_count(), false);
+
+	auto compute = [&func, &numeric](value_id v) -> bool
+	{
+		const auto& inst = func.at(v);
+		if (inst.op == ir_op::CONSTANT)
+		{
+			return holds_alternative<scanning::integer_literal_type>(inst.constant) ||
+				   holds_alternative<scanning::floating_literal_type>(inst.constant) ||
+				   holds_alternative<scanning::boolean_literal_type>(inst.constant);
+		}
+		else if (is_comparison_op(inst.op) || inst.op == ir_op::NOT)
+		{
+			return true;
+		}
+		else if (is_arithmetic_op(inst.op) || inst.op == ir_op::PHI)
+		{
+			return ranges::all_of(inst.operands, [&numeric](value_id op)
+			{
+				return numeric[op];
+			});
+		}
+
+		return false;
+	};
+
+	// optimistic for phis in loops, and then drop the guesses which turn out wrong
+	for (auto b: rpo)
+	{
+		for (auto v: func.block(b).instructions)
+		{
+			numeric[v] = func.at(v).op == ir_op::PHI || is_arithmetic_op(func.at(v).op) || compute(v);
+		}
+	}
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+		for (auto b: rpo)
+		{
+			for (auto v: func.block(b).instructions)
+			{
+				if (numeric[v] && !compute(v))
+				{
+					numeric[v] = false;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	return numeric;
+}
+
+std::vector<value_kind> clox::interpreting::ir::value_kinds(const function& func, const vector<block_id>& rpo,
+	const vector<value_kind>& params)
+{
+	// nullopt for values not computed yet, which is optimistic for phis in loops
+	vector<optional<value_kind>> kinds(func.value_count(), nullopt);
+
+	auto compute = [&func, &kinds, &params](value_id v) -> optional<value_kind>
+	{
+		const auto& inst = func.at(v);
+		if (inst.op == ir_op::CONSTANT)
+		{
+			if (holds_alternative<scanning::integer_literal_type>(inst.constant))return value_kind::INTEGER;
+			if (holds_alternative<scanning::floating_literal_type>(inst.constant))return value_kind::FLOATING;
+			return value_kind::UNKNOWN;
+		}
+		else if (inst.op == ir_op::PARAMETER)
+		{
+			return inst.index < params.size() ? params[inst.index] : value_kind::UNKNOWN;
+		}
+		else if (inst.op == ir_op::PHI)
+		{
+			optional<value_kind> same{ nullopt };
+			for (auto op: inst.operands)
+			{
+				if (!kinds[op])continue;
+				if (same && same != kinds[op])return value_kind::UNKNOWN;
+				same = kinds[op];
+			}
+			return same;
+		}
+		else if (is_arithmetic_op(inst.op))
+		{
+			if (ranges::any_of(inst.operands, [&kinds](value_id op)
+			{
+				return kinds[op] == value_kind::UNKNOWN;
+			}))
+			{
+				return value_kind::UNKNOWN;
+			}
+
+			optional<value_kind> ret{ value_kind::INTEGER };
+			for (auto op: inst.operands)
+			{
+				if (!kinds[op])ret = nullopt;
+				else if (ret && kinds[op] == value_kind::FLOATING)ret = value_kind::FLOATING;
+			}
+			return ret;
+		}
+
+		return value_kind::UNKNOWN;
+	};
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+		for (auto b: rpo)
+		{
+			for (auto v: func.block(b).instructions)
+			{
+				if (auto kind = compute(v);kind != kinds[v])
+				{
+					kinds[v] = kind;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	vector<value_kind> ret(func.value_count(), value_kind::UNKNOWN);
+	for (value_id v = 0; v < func.value_count(); v++)
+	{
+		ret[v] = kinds[v].value_or(value_kind::UNKNOWN);
+	}
+
+	return ret;
+}
+
+bool clox::interpreting::ir::may_trap(const function& func, const vector<bool>& numeric, value_id v)
+{
+	const auto& inst = func.at(v);
+	if (inst.op == ir_op::LOAD_GLOBAL)
+	{
+		return true;
+	}
+	else if (is_arithmetic_op(inst.op) || is_comparison_op(inst.op))
+	{
+		return !ranges::all_of(inst.operands, [&numeric](value_id op)
+		{
+			return numeric[op];
+		});
+	}
+
+	return false;
+}
+
+void clox::interpreting::ir::remove_unreachable_blocks(function& func)
+{
+	auto reachable = reachable_blocks(func);
+
+	for (auto& bb: func.blocks())
+	{
+		if (!reachable[bb.id])
+		{
+			auto insts = bb.instructions;
+			for (auto v: insts)
+			{
+				func.remove(v);
+			}
+			bb.predecessors.clear();
+			continue;
+		}
+
+		vector<bool> keep{};
+		for (auto pred: bb.predecessors)
+		{
+			keep.push_back(reachable[pred]);
+		}
+
+		if (ranges::all_of(keep, [](bool k)
+		{ return k; }))
+		{
+			continue;
+		}
+
+		// phi operands are in the order of predecessors, so they are filtered in lockstep
+		for (auto v: bb.instructions)
+		{
+			if (auto& inst = func.at(v);inst.op == ir_op::PHI)
+			{
+				vector<value_id> operands{};
+				for (size_t i = 0; i < inst.operands.size(); i++)
+				{
+					if (keep[i])operands.push_back(inst.operands[i]);
+				}
+				inst.operands = std::move(operands);
+			}
+		}
+
+		vector<block_id> preds{};
+		for (size_t i = 0; i < bb.predecessors.size(); i++)
+		{
+			if (keep[i])preds.push_back(bb.predecessors[i]);
+		}
+		bb.predecessors = std::move(preds);
+	}
+
+	while (simplify_trivial_phis(func));
+}
+
+std::vector<block_id> clox::interpreting::ir::immediate_dominators(const function& func)
+{
+	// Cooper, Harvey and Kennedy, A Simple, Fast Dominance Algorithm
+	auto rpo = func.reverse_post_order();
+
+	constexpr auto UNVISITED = numeric_limits<size_t>::max();
+	vector<size_t> order(func.blocks().size(), UNVISITED);
+	for (size_t i = 0; i < rpo.size(); i++)
+	{
+		order[rpo[i]] = i;
+	}
+
+	vector<block_id> idom(func.blocks().size(), INVALID_BLOCK);
+	idom[func.entry()] = func.entry();
+
+	auto intersect = [&idom, &order](block_id a, block_id b)
+	{
+		while (a != b)
+		{
+			while (order[a] > order[b])a = idom[a];
+			while (order[b] > order[a])b = idom[b];
+		}
+		return a;
+	};
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+		for (auto b: rpo | views::drop(1))
+		{
+			block_id new_idom{ INVALID_BLOCK };
+			for (auto pred: func.block(b).predecessors)
+			{
+				if (order[pred] == UNVISITED || idom[pred] == INVALID_BLOCK)
+				{
+					continue;
+				}
+
+				new_idom = new_idom == INVALID_BLOCK ? pred : intersect(pred, new_idom);
+			}
+
+			if (idom[b] != new_idom)
+			{
+				idom[b] = new_idom;
+				changed = true;
+			}
+		}
+	}
+
+	return idom;
+}
+
+bool clox::interpreting::ir::dominates(const vector<block_id>& idom, block_id a, block_id b)
+{
+	if (idom[b] == INVALID_BLOCK)
+	{
+		return false;
+	}
+
+	while (b != a)
+	{
+		if (idom[b] == b)
+		{
+			return false; // reached the entry
+		}
+		b = idom[b];
+	}
+
+	return true;
+}
+
+void clox::interpreting::ir::eliminate_common_subexpressions(function& func)
+{
+	auto idom = immediate_dominators(func);
+
+	vector<vector<block_id>> children(func.blocks().size());
+	for (auto b: func.reverse_post_order())
+	{
+		if (b != func.entry())
+		{
+			children[idom[b]].push_back(b);
+		}
+	}
+
+	map<expression_key, value_id> available{};
+	eliminate_in_dominator_subtree(func, children, func.entry(), available);
+}
+
+void clox::interpreting::ir::eliminate_dead_code(function& func)
+{
+	auto numeric = numeric_values(func, func.reverse_post_order());
+
+	vector<bool> live(func.value_count(), false);
+	vector<value_id> worklist{};
+
+	for (const auto& bb: func.blocks())
+	{
+		for (auto v: bb.instructions)
+		{
+			switch (func.at(v).op)
+			{
+			case ir_op::PRINT:
+			case ir_op::JUMP:
+			case ir_op::BRANCH:
+			case ir_op::RETURN:
+			case ir_op::PARAMETER:
+				break;
+			default:
+				// runtime errors, like undefined globals or adding a string to a number, are kept
+				if (!may_trap(func, numeric, v))continue;
+				break;
+			}
+
+			live[v] = true;
+			worklist.push_back(v);
+		}
+	}
+
+	while (!worklist.empty())
+	{
+		auto v = worklist.back();
+		worklist.pop_back();
+
+		for (auto op: func.at(v).operands)
+		{
+			if (!live[op])
+			{
+				live[op] = true;
+				worklist.push_back(op);
+			}
+		}
+	}
+
+	for (auto& bb: func.blocks())
+	{
+		auto insts = bb.instructions;
+		for (auto v: insts)
+		{
+			if (!live[v])
+			{
+				func.remove(v);
+			}
+		}
+	}
+}
+
+void clox::interpreting::ir::hoist_loop_invariants(function& func)
+{
+	struct loop
+	{
+		block_id header{ INVALID_BLOCK };
+		vector<bool> body{};
+		size_t size{ 0 };
+	};
+
+	auto rpo = func.reverse_post_order();
+	auto idom = immediate_dominators(func);
+	auto numeric = numeric_values(func, rpo);
+
+	map<block_id, vector<block_id>> latches{};
+	for (auto b: rpo)
+	{
+		for (auto succ: func.block(b).successors(func))
+		{
+			if (dominates(idom, succ, b))
+			{
+				latches[succ].push_back(b);
+			}
+		}
+	}
+
+	vector<loop> loops{};
+	for (const auto& [header, ls]: latches)
+	{
+		loop l{ .header = header, .body = vector<bool>(func.blocks().size(), false) };
+		l.body[header] = true;
+
+		auto worklist = ls;
+		while (!worklist.empty())
+		{
+			auto b = worklist.back();
+			worklist.pop_back();
+
+			if (l.body[b])continue;
+			l.body[b] = true;
+
+			for (auto pred: func.block(b).predecessors)
+			{
+				worklist.push_back(pred);
+			}
+		}
+
+		l.size = ranges::count(l.body, true);
+		loops.push_back(std::move(l));
+	}
+
+	// inner loops first, so what they hoist can be hoisted further by the outer ones
+	ranges::sort(loops, [](const loop& a, const loop& b)
+	{
+		return a.size < b.size;
+	});
+
+	for (const auto& l: loops)
+	{
+		block_id preheader{ INVALID_BLOCK };
+		for (auto pred: func.block(l.header).predecessors)
+		{
+			if (l.body[pred])continue;
+
+			if (preheader != INVALID_BLOCK)
+			{
+				preheader = INVALID_BLOCK;
+				break;
+			}
+			preheader = pred;
+		}
+
+		if (preheader == INVALID_BLOCK || func.block(preheader).successors(func).size() != 1)
+		{
+			continue;
+		}
+
+		for (auto b: rpo)
+		{
+			if (!l.body[b])continue;
+
+			// the header runs whenever the preheader does, so what might fail can be hoisted from it,
+			// as long as nothing which might fail earlier stays behind
+			bool trapped = b != l.header;
+
+			auto insts = func.block(b).instructions;
+			for (auto v: insts)
+			{
+				const auto& inst = func.at(v);
+
+				bool invariant = is_pure(inst.op) && inst.op != ir_op::CONSTANT &&
+								 ranges::none_of(inst.operands, [&func, &l](value_id op)
+								 {
+									 // constants are emitted where they are used anyway
+									 return func.at(op).op != ir_op::CONSTANT && l.body[func.at(op).block];
+								 });
+
+				bool trap = may_trap(func, numeric, v);
+
+				if (invariant && (!trap || !trapped))
+				{
+					func.move_before_terminator(v, preheader);
+				}
+				else if (trap || inst.op == ir_op::PRINT)
+				{
+					trapped = true;
+				}
+			}
+		}
+	}
+}
+
+void clox::interpreting::ir::run_passes(function& func)
+{
+	remove_unreachable_blocks(func);
+	eliminate_common_subexpressions(func);
+	hoist_loop_invariants(func);
+	eliminate_dead_code(func);
+}
@@ -0,0 +1,316 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/10/2022.
+//
+
+#include <interpreter/ir/slot_allocator.h>
+#include <interpreter/ir/passes.h>
+
+#include <algorithm>
+#include <ranges>
+#include <set>
+
+using namespace std;
+
+using namespace clox;
+using namespace clox::interpreting::ir;
+
+namespace
+{
+
+bool has_effect(const function& func, const vector<bool>& numeric, value_id v)
+{
+	return func.at(v).op == ir_op::PRINT || may_trap(func, numeric, v);
+}
+
+}
+
+slot_assignment clox::interpreting::ir::allocate_slots(const function& func)
+{
+	auto rpo = func.reverse_post_order();
+	auto numeric = numeric_values(func, rpo);
+
+	slot_assignment ret{
+		.inlined = vector<bool>(func.value_count(), false),
+		.slots = vector<size_t>(func.value_count(), slot_assignment::NO_SLOT)
+	};
+
+	vector<vector<value_id>> users(func.value_count());
+	for (auto b: rpo)
+	{
+		for (auto v: func.block(b).instructions)
+		{
+			for (auto op: func.at(v).operands)
+			{
+				users[op].push_back(v);
+			}
+		}
+	}
+
+	// the instruction which a value is eventually emitted with
+	vector<value_id> root(func.value_count(), INVALID_VALUE);
+
+	for (auto b: rpo)
+	{
+		const auto& insts = func.block(b).instructions;
+
+		// backwards, so users are decided before what they use
+		for (auto i = insts.size(); i-- > 0;)
+		{
+			auto v = insts[i];
+			const auto& inst = func.at(v);
+
+			root[v] = v;
+
+			if (inst.op == ir_op::CONSTANT)
+			{
+				ret.inlined[v] = true;
+				continue;
+			}
+
+			if (!is_pure(inst.op) || users[v].size() != 1)
+			{
+				continue;
+			}
+
+			auto user = users[v].front();
+			if (func.at(user).block != b || func.at(user).op == ir_op::PHI)
+			{
+				continue;
+			}
+
+			auto user_pos = static_cast<size_t>(ranges::find(insts, user) - insts.begin());
+
+			// moving it to its user must not reorder it with other effects
+			bool reordered = false;
+			if (may_trap(func, numeric, v))
+			{
+				for (auto j = i + 1; j < user_pos; j++)
+				{
+					auto w = insts[j];
+					if (has_effect(func, numeric, w) && (!ret.inlined[w] || root[w] != root[user]))
+					{
+						reordered = true;
+						break;
+					}
+				}
+			}
+
+			if (!reordered)
+			{
+				ret.inlined[v] = true;
+				root[v] = root[user];
+			}
+		}
+	}
+
+	// number positions in the order blocks are emitted
+	vector<size_t> position(func.value_count(), 0), block_start(func.blocks().size(), 0), block_end(
+		func.blocks().size(), 0);
+
+	size_t counter = 0;
+	for (auto b: rpo)
+	{
+		block_start[b] = counter++;
+		for (auto v: func.block(b).instructions)
+		{
+			position[v] = counter++;
+		}
+		block_end[b] = counter++;
+	}
+
+	auto stored = [&func, &ret, &users](value_id v)
+	{
+		return !ret.inlined[v] && func.at(v).op != ir_op::PARAMETER &&
+			   (func.at(v).op == ir_op::PHI || !users[v].empty());
+	};
+
+	// values read by an instruction once inlined operands are expanded, with where they are read
+	vector<vector<pair<value_id, size_t>>> uses_in_block(func.blocks().size());
+	vector<vector<value_id>> defs_in_block(func.blocks().size());
+
+	// for phis, the operand is read at the end of the predecessor where the phi is written
+	vector<vector<value_id>> phi_writes(func.blocks().size());
+
+	for (auto b: rpo)
+	{
+		for (auto v: func.block(b).instructions)
+		{
+			const auto& inst = func.at(v);
+			if (inst.op == ir_op::PHI)
+			{
+				const auto& preds = func.block(b).predecessors;
+				for (size_t i = 0; i < preds.size(); i++)
+				{
+					uses_in_block[preds[i]].emplace_back(inst.operands[i], block_end[preds[i]]);
+					phi_writes[preds[i]].push_back(v);
+				}
+				defs_in_block[b].push_back(v);
+				continue;
+			}
+
+			for (auto op: inst.operands)
+			{
+				uses_in_block[b].emplace_back(op, position[root[v]]);
+			}
+			defs_in_block[b].push_back(v);
+		}
+	}
+
+	// block-level liveness, with values of phis live out of the predecessors which write them
+	vector<vector<bool>> live_in(func.blocks().size(), vector<bool>(func.value_count(), false));
+	vector<vector<bool>> live_out = live_in;
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+		for (auto b: rpo | views::reverse)
+		{
+			vector<bool> out(func.value_count(), false);
+			for (auto succ: func.block(b).successors(func))
+			{
+				for (value_id v = 0; v < func.value_count(); v++)
+				{
+					if (live_in[succ][v])out[v] = true;
+				}
+			}
+
+			for (auto v: phi_writes[b])
+			{
+				out[v] = true;
+			}
+
+			auto in = out;
+			for (auto v: defs_in_block[b])
+			{
+				in[v] = false;
+			}
+
+			// in SSA form, only values from other blocks are used before they are defined here
+			for (auto [v, pos]: uses_in_block[b])
+			{
+				if (stored(v) && func.at(v).block != b)in[v] = true;
+			}
+
+			if (in != live_in[b] || out != live_out[b])
+			{
+				live_in[b] = std::move(in);
+				live_out[b] = std::move(out);
+				changed = true;
+			}
+		}
+	}
+
+	// the hull of every position where a value is live
+	constexpr auto NOWHERE = numeric_limits<size_t>::max();
+	vector<pair<size_t, size_t>> intervals(func.value_count(), { NOWHERE, 0 });
+
+	auto extend = [&intervals](value_id v, size_t pos)
+	{
+		intervals[v].first = min(intervals[v].first, pos);
+		intervals[v].second = max(intervals[v].second, pos);
+	};
+
+	for (auto b: rpo)
+	{
+		for (value_id v = 0; v < func.value_count(); v++)
+		{
+			if (live_in[b][v])extend(v, block_start[b]);
+			if (live_out[b][v])extend(v, block_end[b]);
+		}
+
+		for (auto v: defs_in_block[b])
+		{
+			extend(v, func.at(v).op == ir_op::PHI ? block_start[b] : position[v]);
+		}
+
+		for (auto [v, pos]: uses_in_block[b])
+		{
+			extend(v, pos);
+		}
+	}
+
+	vector<value_id> candidates{};
+	for (auto b: rpo)
+	{
+		for (auto v: func.block(b).instructions)
+		{
+			if (stored(v))candidates.push_back(v);
+		}
+	}
+
+	ranges::sort(candidates, [&intervals](value_id a, value_id b)
+	{
+		return intervals[a].first < intervals[b].first;
+	});
+
+	// parameters are right above the callee
+	for (auto b: rpo)
+	{
+		for (auto v: func.block(b).instructions)
+		{
+			if (func.at(v).op == ir_op::PARAMETER)
+			{
+				ret.slots[v] = func.at(v).index + 1;
+			}
+		}
+	}
+
+	auto first_temporary = func.param_count() + 1;
+
+	set<size_t> free{};
+	size_t next_slot = first_temporary;
+
+	// (end, slot) of the values currently holding a slot
+	multiset<pair<size_t, size_t>> active{};
+
+	for (auto v: candidates)
+	{
+		auto [start, end] = intervals[v];
+
+		while (!active.empty() && active.begin()->first < start)
+		{
+			free.insert(active.begin()->second);
+			active.erase(active.begin());
+		}
+
+		size_t slot{};
+		if (!free.empty())
+		{
+			slot = *free.begin();
+			free.erase(free.begin());
+		}
+		else
+		{
+			slot = next_slot++;
+		}
+
+		ret.slots[v] = slot;
+		active.emplace(end, slot);
+	}
+
+	ret.temporaries = next_slot - first_temporary;
+
+	return ret;
+}
@@ -0,0 +1,411 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/14/2022.
+//
+
+#include <interpreter/optimizer/evaluator.h>
+#include <interpreter/optimizer/optimizer.h>
+
+#include <parser/statement.h>
+
+#include <limits>
+#include <variant>
+
+using namespace std;
+
+using namespace clox;
+
+using namespace clox::scanning;
+using namespace clox::parsing;
+using namespace clox::resolving;
+using namespace clox::interpreting::optimizing;
+
+std::optional<scanning::literal_value_type>
+evaluator::evaluate(const shared_ptr<parsing::function_statement>& fs, const vector<scanning::literal_value_type>& args)
+{
+	evaluator eval{};
+	try
+	{
+		auto val = eval.call(fs, args);
+
+		// a nil literal generates nothing, so leave such calls as they are
+		if (holds_alternative<nil_value_tag_type>(val))
+		{
+			return nullopt;
+		}
+
+		return val;
+	}
+	catch (const not_evaluable&)
+	{
+		return nullopt;
+	}
+}
+
+scanning::literal_value_type evaluator::call(const shared_ptr<parsing::function_statement>& fs,
+	vector<scanning::literal_value_type> args)
+{
+	if (fs->get_func_type() != function_statement_type::FST_FUNCTION ||
+		fs->get_params().size() != args.size() ||
+		frames_.size() >= DEPTH_LIMIT)
+	{
+		throw not_evaluable{};
+	}
+
+	frames_.push_back(frame{ .callee = fs, .args = std::move(args) });
+
+	for (const auto& stmt: fs->get_body())
+	{
+		execute(stmt);
+		if (frames_.back().returned)break;
+	}
+
+	// falling off the end returns nil, the same as the virtual machine
+	auto ret = frames_.back().returned.value_or(nil_value_tag);
+	frames_.pop_back();
+
+	return ret;
+}
+
+scanning::literal_value_type evaluator::evaluate(const shared_ptr<parsing::expression>& expr)
+{
+	step();
+	return accept(*expr, *static_cast<expression_visitor<literal_value_type>*>(this));
+}
+
+void evaluator::execute(const shared_ptr<parsing::statement>& stmt)
+{
+	if (!stmt)return;
+
+	step();
+	accept(*stmt, *static_cast<statement_visitor<void>*>(this));
+}
+
+void evaluator::step()
+{
+	if (++steps_ > STEP_LIMIT)
+	{
+		throw not_evaluable{};
+	}
+}
+
+const resolving::named_symbol* evaluator::local_of(const shared_ptr<parsing::expression>& expr) const
+{
+	auto annotation = expr->get_annotation<variable_annotation>();
+	if (!annotation || !annotation->symbol() || annotation->upvalue() || !annotation->symbol()->is_local())
+	{
+		throw not_evaluable{}; // globals may change at run time, and upvalues belong to other functions
+	}
+
+	return annotation->symbol().get();
+}
+
+scanning::literal_value_type& evaluator::variable(const shared_ptr<parsing::expression>& expr, const token& name)
+{
+	auto symbol = local_of(expr);
+
+	auto& current = frames_.back();
+	if (auto iter = current.locals.find(symbol);iter != current.locals.end())
+	{
+		return iter->second;
+	}
+
+	const auto& params = current.callee->get_params();
+	for (size_t i = 0; i < params.size(); i++)
+	{
+		if (params[i].first.lexeme() == name.lexeme())
+		{
+			return current.locals[symbol] = current.args[i];
+		}
+	}
+
+	throw not_evaluable{};
+}
+
+std::pair<scanning::literal_value_type, scanning::literal_value_type>
+evaluator::step_variable(const shared_ptr<parsing::expression>& target, const token& op)
+{
+	auto ve = dynamic_pointer_cast<var_expression>(target);
+	if (!ve)
+	{
+		throw not_evaluable{};
+	}
+
+	auto& val = variable(ve, ve->get_name());
+	auto old = val;
+
+	auto delta = op.type() == token_type::PLUS_PLUS ? 1 : -1;
+	if (auto i = get_if<integer_literal_type>(&val);i)
+	{
+		if ((delta > 0 && *i == numeric_limits<integer_literal_type>::max()) ||
+			(delta < 0 && *i == numeric_limits<integer_literal_type>::min()))
+		{
+			throw not_evaluable{};
+		}
+
+		*i += delta;
+	}
+	else if (auto f = get_if<floating_literal_type>(&val);f)
+	{
+		*f += delta;
+	}
+	else
+	{
+		throw not_evaluable{}; // a runtime error, which should be reported when it runs
+	}
+
+	return { old, val };
+}
+
+scanning::literal_value_type
+evaluator::visit_assignment_expression(const std::shared_ptr<parsing::assignment_expression>& ae)
+{
+	auto val = evaluate(ae->get_value());
+	variable(ae, ae->get_name()) = val;
+	return val;
+}
+
+scanning::literal_value_type
+evaluator::visit_binary_expression(const std::shared_ptr<parsing::binary_expression>& be)
+{
+	if (be->get_annotation<operator_annotation>())
+	{
+		throw not_evaluable{};
+	}
+
+	auto l = evaluate(be->get_left());
+	auto r = evaluate(be->get_right());
+
+	if (auto val = optimizer::fold_binary(be->get_op().type(), l, r);val)
+	{
+		return val.value();
+	}
+
+	throw not_evaluable{};
+}
+
+scanning::literal_value_type
+evaluator::visit_unary_expression(const std::shared_ptr<parsing::unary_expression>& ue)
+{
+	if (auto op = ue->get_op().type();op == token_type::PLUS_PLUS || op == token_type::MINUS_MINUS)
+	{
+		return step_variable(ue->get_right(), ue->get_op()).second;
+	}
+
+	if (auto val = optimizer::fold_unary(ue->get_op().type(), evaluate(ue->get_right()));val)
+	{
+		return val.value();
+	}
+
+	throw not_evaluable{};
+}
+
+scanning::literal_value_type evaluator::visit_this_expression(const std::shared_ptr<parsing::this_expression>& ptr)
+{
+	throw not_evaluable{};
+}
+
+scanning::literal_value_type evaluator::visit_base_expression(const std::shared_ptr<parsing::base_expression>& ptr)
+{
+	throw not_evaluable{};
+}
+
+scanning::literal_value_type
+evaluator::visit_postfix_expression(const std::shared_ptr<parsing::postfix_expression>& pe)
+{
+	if (pe->get_optional_right())
+	{
+		throw not_evaluable{}; // indexing
+	}
+
+	return step_variable(pe->get_left(), pe->get_op()).first;
+}
+
+scanning::literal_value_type
+evaluator::visit_literal_expression(const std::shared_ptr<parsing::literal_expression>& le)
+{
+	if (holds_alternative<empty_literal_tag>(le->get_value()))
+	{
+		throw not_evaluable{};
+	}
+
+	return le->get_value();
+}
+
+scanning::literal_value_type
+evaluator::visit_grouping_expression(const std::shared_ptr<parsing::grouping_expression>& ge)
+{
+	return evaluate(ge->get_expr());
+}
+
+scanning::literal_value_type
+evaluator::visit_lambda_expression(const std::shared_ptr<parsing::lambda_expression>& ptr)
+{
+	throw not_evaluable{};
+}
+
+scanning::literal_value_type evaluator::visit_var_expression(const std::shared_ptr<parsing::var_expression>& ve)
+{
+	return variable(ve, ve->get_name());
+}
+
+scanning::literal_value_type
+evaluator::visit_ternary_expression(const std::shared_ptr<parsing::ternary_expression>& te)
+{
+	return optimizer::is_truthy(evaluate(te->get_cond())) ? evaluate(te->get_true_expr()) : evaluate(
+		te->get_false_expr());
+}
+
+scanning::literal_value_type
+evaluator::visit_logical_expression(const std::shared_ptr<parsing::logical_expression>& le)
+{
+	auto l = evaluate(le->get_left());
+
+	switch (le->get_op().type())
+	{
+	case token_type::AND:
+		return optimizer::is_truthy(l) ? evaluate(le->get_right()) : l;
+	case token_type::OR:
+		return optimizer::is_truthy(l) ? l : evaluate(le->get_right());
+	default:
+		throw not_evaluable{};
+	}
+}
+
+scanning::literal_value_type evaluator::visit_call_expression(const std::shared_ptr<parsing::call_expression>& ce)
+{
+	auto annotation = ce->get_annotation<call_annotation>();
+	if (!annotation || annotation->is_method() || annotation->is_ctor())
+	{
+		throw not_evaluable{};
+	}
+
+	auto fs = dynamic_pointer_cast<function_statement>(annotation->statement());
+	if (!fs)
+	{
+		throw not_evaluable{}; // native functions
+	}
+
+	vector<literal_value_type> args{};
+	for (const auto& arg: ce->get_args())
+	{
+		args.push_back(evaluate(arg));
+	}
+
+	return call(fs, std::move(args));
+}
+
+scanning::literal_value_type
+evaluator::visit_list_initializer_expression(const std::shared_ptr<parsing::list_initializer_expression>& ptr)
+{
+	throw not_evaluable{};
+}
+
+scanning::literal_value_type
+evaluator::visit_map_initializer_expression(const std::shared_ptr<parsing::map_initializer_expression>& ptr)
+{
+	throw not_evaluable{};
+}
+
+scanning::literal_value_type evaluator::visit_get_expression(const std::shared_ptr<parsing::get_expression>& ptr)
+{
+	throw not_evaluable{};
+}
+
+scanning::literal_value_type evaluator::visit_set_expression(const std::shared_ptr<parsing::set_expression>& ptr)
+{
+	throw not_evaluable{};
+}
+
+void evaluator::visit_expression_statement(const std::shared_ptr<parsing::expression_statement>& es)
+{
+	evaluate(es->get_expr());
+}
+
+void evaluator::visit_print_statement(const std::shared_ptr<parsing::print_statement>& ptr)
+{
+	throw not_evaluable{};
+}
+
+void evaluator::visit_variable_statement(const std::shared_ptr<parsing::variable_statement>& vs)
+{
+	auto annotation = vs->get_annotation<variable_annotation>();
+	if (!annotation || !annotation->symbol() || !annotation->symbol()->is_local())
+	{
+		throw not_evaluable{};
+	}
+
+	auto val = vs->get_initializer() ? evaluate(vs->get_initializer()) : literal_value_type{ nil_value_tag };
+	frames_.back().locals.insert_or_assign(annotation->symbol().get(), val);
+}
+
+void evaluator::visit_block_statement(const std::shared_ptr<parsing::block_statement>& bs)
+{
+	for (const auto& stmt: bs->get_stmts())
+	{
+		execute(stmt);
+		if (frames_.back().returned)return;
+	}
+}
+
+void evaluator::visit_while_statement(const std::shared_ptr<parsing::while_statement>& ws)
+{
+	while (optimizer::is_truthy(evaluate(ws->get_cond())))
+	{
+		execute(ws->get_body());
+		if (frames_.back().returned)return;
+	}
+}
+
+void evaluator::visit_foreach_statement(const std::shared_ptr<parsing::foreach_statement>& ptr)
+{
+	throw not_evaluable{};
+}
+
+void evaluator::visit_if_statement(const std::shared_ptr<parsing::if_statement>& ifs)
+{
+	if (optimizer::is_truthy(evaluate(ifs->get_cond())))
+	{
+		execute(ifs->get_true_stmt());
+	}
+	else
+	{
+		execute(ifs->get_false_stmt());
+	}
+}
+
+void evaluator::visit_function_statement(const std::shared_ptr<parsing::function_statement>& ptr)
+{
+	throw not_evaluable{};
+}
+
+void evaluator::visit_return_statement(const std::shared_ptr<parsing::return_statement>& rs)
+{
+	frames_.back().returned = rs->get_val() ? evaluate(rs->get_val()) : literal_value_type{ nil_value_tag };
+}
+
+void evaluator::visit_class_statement(const std::shared_ptr<parsing::class_statement>& ptr)
+{
+	throw not_evaluable{};
+}
@@ -0,0 +1,729 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/8/2022.
+//
+
+#include <interpreter/optimizer/optimizer.h>
+#include <interpreter/optimizer/evaluator.h>
+
+#include <parser/statement.h>
+
+#include <cmath>
+#include <limits>
+#include <variant>
+
+using namespace std;
+
+using namespace clox;
+
+using namespace clox::scanning;
+using namespace clox::parsing;
+using namespace clox::resolving;
+using namespace clox::interpreting::optimizing;
+
+namespace
+{
+
+bool is_number(const literal_value_type& val)
+{
+	return holds_alternative<integer_literal_type>(val) ||
+		   holds_alternative<floating_literal_type>(val) ||
+		   holds_alternative<boolean_literal_type>(val);
+}
+
+/// \brief promote the operand the same as get_number_promoted of the virtual machine
+floating_literal_type promoted(const literal_value_type& val)
+{
+	if (auto i = get_if<integer_literal_type>(&val);i)
+	{
+		return static_cast<floating_literal_type>(*i);
+	}
+	else if (auto f = get_if<floating_literal_type>(&val);f)
+	{
+		return *f;
+	}
+
+	return get<boolean_literal_type>(val) ? 1 : 0;
+}
+
+}
+
+optimizer::optimizer(const resolving::resolver& resolver)
+	: resolver_(&resolver)
+{
+}
+
+void optimizer::optimize(const std::vector<std::shared_ptr<parsing::statement>>& stmts)
+{
+	for (const auto& stmt: stmts)
+	{
+		optimize(stmt);
+	}
+}
+
+void optimizer::optimize(const shared_ptr<parsing::statement>& stmt)
+{
+	if (!stmt)return;
+	accept(*stmt, *static_cast<statement_visitor<void>*>(this));
+}
+
+std::shared_ptr<parsing::expression> optimizer::optimize(const shared_ptr<parsing::expression>& expr)
+{
+	if (!expr)return expr;
+	return accept(*expr, *static_cast<expression_visitor<shared_ptr<expression>>*>(this));
+}
+
+std::optional<scanning::literal_value_type> optimizer::literal_of(const shared_ptr<parsing::expression>& expr)
+{
+	auto le = dynamic_pointer_cast<literal_expression>(expr);
+	if (!le || holds_alternative<empty_literal_tag>(le->get_value()))
+	{
+		return nullopt;
+	}
+
+	return le->get_value();
+}
+
+bool optimizer::is_truthy(const scanning::literal_value_type& val)
+{
+	if (auto b = get_if<boolean_literal_type>(&val);b)
+	{
+		return *b;
+	}
+
+	return !holds_alternative<nil_value_tag_type>(val);
+}
+
+std::optional<scanning::literal_value_type>
+optimizer::fold_binary(scanning::token_type op, const scanning::literal_value_type& l,
+	const scanning::literal_value_type& r)
+{
+	if (holds_alternative<string_literal_type>(l) && holds_alternative<string_literal_type>(r))
+	{
+		const auto& ls = get<string_literal_type>(l), & rs = get<string_literal_type>(r);
+		switch (op)
+		{
+		case token_type::PLUS:
+			return ls + rs;
+		case token_type::EQUAL_EQUAL:
+			return ls == rs;
+		case token_type::BANG_EQUAL:
+			return ls != rs;
+		default:
+			return nullopt;
+		}
+	}
+
+	// anything else, like nil or mixing strings and numbers, is left to fail at runtime
+	if (!is_number(l) || !is_number(r))
+	{
+		return nullopt;
+	}
+
+	// the same exact arithmetic as the virtual machine, which raises on overflow at runtime
+	if (holds_alternative<integer_literal_type>(l) && holds_alternative<integer_literal_type>(r))
+	{
+		const auto li = get<integer_literal_type>(l), ri = get<integer_literal_type>(r);
+
+		integer_literal_type ret{ 0 };
+		switch (op)
+		{
+		case token_type::LESS:
+			return li < ri;
+		case token_type::LESS_EQUAL:
+			return li <= ri;
+		case token_type::GREATER:
+			return li > ri;
+		case token_type::GREATER_EQUAL:
+			return li >= ri;
+		case token_type::EQUAL_EQUAL:
+			return li == ri;
+		case token_type::BANG_EQUAL:
+			return li != ri;
+		case token_type::PLUS:
+			if (__builtin_add_overflow(li, ri, &ret))return nullopt;
+			return ret;
+		case token_type::MINUS:
+			if (__builtin_sub_overflow(li, ri, &ret))return nullopt;
+			return ret;
+		case token_type::STAR:
+			if (__builtin_mul_overflow(li, ri, &ret))return nullopt;
+			return ret;
+		default:
+			break; // division and power promote
+		}
+	}
+
+	auto left = promoted(l), right = promoted(r);
+
+	floating_literal_type ret{ 0 };
+	switch (op)
+	{
+	case token_type::LESS:
+		return left < right;
+	case token_type::LESS_EQUAL:
+		return left <= right;
+	case token_type::GREATER:
+		return left > right;
+	case token_type::GREATER_EQUAL:
+		return left >= right;
+	case token_type::EQUAL_EQUAL:
+		return left == right;
+	case token_type::BANG_EQUAL:
+		return left != right;
+
+	case token_type::PLUS:
+		ret = left + right;
+		break;
+	case token_type::MINUS:
+		ret = left - right;
+		break;
+	case token_type::STAR:
+		ret = left * right;
+		break;
+	case token_type::SLASH:
+		ret = left / right;
+		break;
+	case token_type::STAR_STAR:
+		ret = std::pow(left, right);
+		break;
+	default:
+		return nullopt;
+	}
+
+	// like dividing by zero, whose result is left to the runtime
+	if (!std::isfinite(ret))
+	{
+		return nullopt;
+	}
+
+	// the type of the result follows the promoting rules of the virtual machine
+	if (holds_alternative<floating_literal_type>(l) || holds_alternative<floating_literal_type>(r))
+	{
+		return ret;
+	}
+	else if (holds_alternative<integer_literal_type>(l) || holds_alternative<integer_literal_type>(r))
+	{
+		constexpr auto min = static_cast<floating_literal_type>(numeric_limits<integer_literal_type>::min());
+		if (ret < min || ret >= -min)
+		{
+			return nullopt;
+		}
+
+		return static_cast<integer_literal_type>(ret);
+	}
+
+	return static_cast<boolean_literal_type>(ret);
+}
+
+std::optional<scanning::literal_value_type>
+optimizer::fold_unary(scanning::token_type op, const scanning::literal_value_type& r)
+{
+	switch (op)
+	{
+	case token_type::MINUS:
+		if (auto i = get_if<integer_literal_type>(&r);i && *i != numeric_limits<integer_literal_type>::min())
+		{
+			return -*i;
+		}
+		else if (auto f = get_if<floating_literal_type>(&r);f)
+		{
+			return -*f;
+		}
+		return nullopt;
+
+	case token_type::BANG:
+		return !is_truthy(r);
+
+	default:
+		return nullopt;
+	}
+}
+
+size_t optimizer::scope_count(const shared_ptr<parsing::statement>& stmt)
+{
+	if (!stmt)return 0;
+
+	if (dynamic_pointer_cast<block_statement>(stmt) ||
+		dynamic_pointer_cast<function_statement>(stmt) ||
+		dynamic_pointer_cast<class_statement>(stmt) ||
+		dynamic_pointer_cast<foreach_statement>(stmt))
+	{
+		return 1;
+	}
+	else if (auto ifs = dynamic_pointer_cast<if_statement>(stmt);ifs)
+	{
+		return lambda_count(ifs->get_cond()) + scope_count(ifs->get_true_stmt()) + scope_count(ifs->get_false_stmt());
+	}
+	else if (auto ws = dynamic_pointer_cast<while_statement>(stmt);ws)
+	{
+		return lambda_count(ws->get_cond()) + scope_count(ws->get_body());
+	}
+	else if (auto es = dynamic_pointer_cast<expression_statement>(stmt);es)
+	{
+		return lambda_count(es->get_expr());
+	}
+	else if (auto ps = dynamic_pointer_cast<print_statement>(stmt);ps)
+	{
+		return lambda_count(ps->get_expr());
+	}
+	else if (auto rs = dynamic_pointer_cast<return_statement>(stmt);rs)
+	{
+		return lambda_count(rs->get_val());
+	}
+	else if (auto vs = dynamic_pointer_cast<variable_statement>(stmt);vs)
+	{
+		return lambda_count(vs->get_initializer());
+	}
+
+	return 0;
+}
+
+size_t optimizer::lambda_count(const shared_ptr<parsing::expression>& expr)
+{
+	if (!expr)return 0;
+
+	if (dynamic_pointer_cast<lambda_expression>(expr))
+	{
+		return 1; // lambdas inside it are in its own scope
+	}
+	else if (auto ae = dynamic_pointer_cast<assignment_expression>(expr);ae)
+	{
+		return lambda_count(ae->get_value());
+	}
+	else if (auto be = dynamic_pointer_cast<binary_expression>(expr);be)
+	{
+		return lambda_count(be->get_left()) + lambda_count(be->get_right());
+	}
+	else if (auto ue = dynamic_pointer_cast<unary_expression>(expr);ue)
+	{
+		return lambda_count(ue->get_right());
+	}
+	else if (auto pe = dynamic_pointer_cast<postfix_expression>(expr);pe)
+	{
+		return lambda_count(pe->get_left()) + lambda_count(pe->get_optional_right());
+	}
+	else if (auto ge = dynamic_pointer_cast<grouping_expression>(expr);ge)
+	{
+		return lambda_count(ge->get_expr());
+	}
+	else if (auto te = dynamic_pointer_cast<ternary_expression>(expr);te)
+	{
+		return lambda_count(te->get_cond()) + lambda_count(te->get_true_expr()) + lambda_count(te->get_false_expr());
+	}
+	else if (auto le = dynamic_pointer_cast<logical_expression>(expr);le)
+	{
+		return lambda_count(le->get_left()) + lambda_count(le->get_right());
+	}
+	else if (auto ce = dynamic_pointer_cast<call_expression>(expr);ce)
+	{
+		auto ret = lambda_count(ce->get_callee());
+		for (const auto& arg: ce->get_args())
+		{
+			ret += lambda_count(arg);
+		}
+		return ret;
+	}
+	else if (auto lie = dynamic_pointer_cast<list_initializer_expression>(expr);lie)
+	{
+		size_t ret = 0;
+		for (const auto& val: lie->get_values())
+		{
+			ret += lambda_count(val);
+		}
+		return ret;
+	}
+	else if (auto mie = dynamic_pointer_cast<map_initializer_expression>(expr);mie)
+	{
+		size_t ret = 0;
+		for (const auto& [key, val]: mie->get_pairs())
+		{
+			ret += lambda_count(key) + lambda_count(val);
+		}
+		return ret;
+	}
+	else if (auto get = dynamic_pointer_cast<get_expression>(expr);get)
+	{
+		return lambda_count(get->get_object());
+	}
+	else if (auto se = dynamic_pointer_cast<set_expression>(expr);se)
+	{
+		return lambda_count(se->get_object()) + lambda_count(se->get_val());
+	}
+
+	return 0;
+}
+
+bool optimizer::declares_names(const shared_ptr<parsing::statement>& stmt)
+{
+	if (!stmt)return false;
+
+	if (dynamic_pointer_cast<variable_statement>(stmt) ||
+		dynamic_pointer_cast<function_statement>(stmt) ||
+		dynamic_pointer_cast<class_statement>(stmt))
+	{
+		return true;
+	}
+	else if (auto ifs = dynamic_pointer_cast<if_statement>(stmt);ifs)
+	{
+		return declares_names(ifs->get_true_stmt()) || declares_names(ifs->get_false_stmt());
+	}
+	else if (auto ws = dynamic_pointer_cast<while_statement>(stmt);ws)
+	{
+		return declares_names(ws->get_body());
+	}
+
+	return false;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_assignment_expression(const std::shared_ptr<parsing::assignment_expression>& ae)
+{
+	ae->set_value(optimize(ae->get_value()));
+	return ae;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_binary_expression(const std::shared_ptr<parsing::binary_expression>& be)
+{
+	if (auto annotation = be->get_annotation<operator_annotation>();annotation)
+	{
+		// an overloaded operator, whose call is generated instead
+		visit_call_expression(annotation->operator_implementation_call());
+		return be;
+	}
+
+	be->set_left(optimize(be->get_left()));
+	be->set_right(optimize(be->get_right()));
+
+	auto l = literal_of(be->get_left()), r = literal_of(be->get_right());
+	if (!l || !r)
+	{
+		return be;
+	}
+
+	if (auto val = fold_binary(be->get_op().type(), l.value(), r.value());val)
+	{
+		return make_shared<literal_expression>(be->get_op(), val.value());
+	}
+
+	return be;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_unary_expression(const std::shared_ptr<parsing::unary_expression>& ue)
+{
+	if (auto op = ue->get_op().type();op == token_type::PLUS_PLUS || op == token_type::MINUS_MINUS)
+	{
+		return ue; // the operand is written, which must stay as it is
+	}
+
+	ue->set_right(optimize(ue->get_right()));
+
+	if (auto r = literal_of(ue->get_right());r)
+	{
+		if (auto val = fold_unary(ue->get_op().type(), r.value());val)
+		{
+			return make_shared<literal_expression>(ue->get_op(), val.value());
+		}
+	}
+
+	return ue;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_this_expression(const std::shared_ptr<parsing::this_expression>& te)
+{
+	return te;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_base_expression(const std::shared_ptr<parsing::base_expression>& be)
+{
+	return be;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_postfix_expression(const std::shared_ptr<parsing::postfix_expression>& pe)
+{
+	// the left side is either written or indexed, so only the index is folded
+	if (pe->get_optional_right())
+	{
+		pe->set_optional_right(optimize(pe->get_optional_right()));
+	}
+
+	return pe;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_literal_expression(const std::shared_ptr<parsing::literal_expression>& le)
+{
+	return le;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_grouping_expression(const std::shared_ptr<parsing::grouping_expression>& ge)
+{
+	ge->set_expr(optimize(ge->get_expr()));
+
+	if (literal_of(ge->get_expr()))
+	{
+		return ge->get_expr();
+	}
+
+	return ge;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_lambda_expression(const std::shared_ptr<parsing::lambda_expression>& le)
+{
+	return le;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_var_expression(const std::shared_ptr<parsing::var_expression>& ve)
+{
+	if (auto annotation = ve->get_annotation<variable_annotation>();annotation && annotation->symbol())
+	{
+		if (auto iter = constants_.find(annotation->symbol());iter != constants_.end())
+		{
+			return make_shared<literal_expression>(ve->get_name(), iter->second);
+		}
+	}
+
+	return ve;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_ternary_expression(const std::shared_ptr<parsing::ternary_expression>& te)
+{
+	te->set_cond(optimize(te->get_cond()));
+	te->set_true_expr(optimize(te->get_true_expr()));
+	te->set_false_expr(optimize(te->get_false_expr()));
+
+	if (auto cond = literal_of(te->get_cond());cond)
+	{
+		auto taken = is_truthy(cond.value());
+		if (!lambda_count(taken ? te->get_false_expr() : te->get_true_expr()))
+		{
+			return taken ? te->get_true_expr() : te->get_false_expr();
+		}
+	}
+
+	return te;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_logical_expression(const std::shared_ptr<parsing::logical_expression>& le)
+{
+	le->set_left(optimize(le->get_left()));
+	le->set_right(optimize(le->get_right()));
+
+	auto l = literal_of(le->get_left());
+	if (!l || lambda_count(le->get_right()))
+	{
+		return le; // the right side may be dropped, which must not take the scopes of its lambdas away
+	}
+
+	// the same short circuit as code generation, where the value of lhs is left when it decides
+	switch (le->get_op().type())
+	{
+	case token_type::AND:
+		return is_truthy(l.value()) ? le->get_right() : le->get_left();
+	case token_type::OR:
+		return is_truthy(l.value()) ? le->get_left() : le->get_right();
+	default:
+		return le;
+	}
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_call_expression(const std::shared_ptr<parsing::call_expression>& ce)
+{
+	vector<literal_value_type> args{};
+	for (auto& arg: ce->get_args())
+	{
+		arg = optimize(arg);
+
+		if (auto val = literal_of(arg);val)
+		{
+			args.push_back(val.value());
+		}
+	}
+
+	if (!resolver_ || args.size() != ce->get_args().size())
+	{
+		return ce;
+	}
+
+	auto annotation = ce->get_annotation<call_annotation>();
+	if (!annotation || annotation->is_method() || annotation->is_ctor())
+	{
+		return ce;
+	}
+
+	auto fs = dynamic_pointer_cast<function_statement>(annotation->statement());
+	if (!fs || fs->get_func_type() != function_statement_type::FST_FUNCTION || !resolver_->is_pure(fs))
+	{
+		return ce;
+	}
+
+	if (auto val = evaluator::evaluate(fs, args);val)
+	{
+		return make_shared<literal_expression>(ce->get_paren(), val.value());
+	}
+
+	return ce;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_list_initializer_expression(const std::shared_ptr<parsing::list_initializer_expression>& lie)
+{
+	for (auto& val: lie->get_values())
+	{
+		val = optimize(val);
+	}
+
+	return lie;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_map_initializer_expression(const std::shared_ptr<parsing::map_initializer_expression>& mie)
+{
+	for (auto& [key, val]: mie->get_pairs())
+	{
+		key = optimize(key);
+		val = optimize(val);
+	}
+
+	return mie;
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_get_expression(const std::shared_ptr<parsing::get_expression>& ge)
+{
+	return ge; // the object may be a class, whose annotations code generation relies on
+}
+
+std::shared_ptr<parsing::expression>
+optimizer::visit_set_expression(const std::shared_ptr<parsing::set_expression>& se)
+{
+	se->set_val(optimize(se->get_val()));
+	return se;
+}
+
+void optimizer::visit_expression_statement(const std::shared_ptr<parsing::expression_statement>& es)
+{
+	es->set_expr(optimize(es->get_expr()));
+}
+
+void optimizer::visit_print_statement(const std::shared_ptr<parsing::print_statement>& ps)
+{
+	ps->set_expr(optimize(ps->get_expr()));
+}
+
+void optimizer::visit_variable_statement(const std::shared_ptr<parsing::variable_statement>& vs)
+{
+	if (!vs->get_initializer())return;
+
+	vs->set_initializer(optimize(vs->get_initializer()));
+
+	if (auto annotation = vs->get_annotation<variable_annotation>();
+		annotation && annotation->symbol() && annotation->symbol()->is_const())
+	{
+		if (auto val = literal_of(vs->get_initializer());val)
+		{
+			constants_.insert_or_assign(annotation->symbol(), val.value());
+		}
+	}
+}
+
+void optimizer::visit_block_statement(const std::shared_ptr<parsing::block_statement>& bs)
+{
+	optimize(bs->get_stmts());
+}
+
+void optimizer::visit_while_statement(const std::shared_ptr<parsing::while_statement>& ws)
+{
+	ws->set_cond(optimize(ws->get_cond()));
+	optimize(ws->get_body());
+
+	auto cond = literal_of(ws->get_cond());
+	if (!cond)return;
+
+	if (is_truthy(cond.value()))
+	{
+		ws->annotate<branch_annotation>(true, 0);
+	}
+	else if (!declares_names(ws->get_body()))
+	{
+		ws->annotate<branch_annotation>(false, scope_count(ws->get_body()));
+	}
+}
+
+void optimizer::visit_foreach_statement(const std::shared_ptr<parsing::foreach_statement>& fs)
+{
+	optimize(fs->get_var_decl());
+	fs->set_iterable(optimize(fs->get_iterable()));
+	optimize(fs->get_body());
+}
+
+void optimizer::visit_if_statement(const std::shared_ptr<parsing::if_statement>& ifs)
+{
+	ifs->set_cond(optimize(ifs->get_cond()));
+	optimize(ifs->get_true_stmt());
+	optimize(ifs->get_false_stmt());
+
+	auto cond = literal_of(ifs->get_cond());
+	if (!cond)return;
+
+	auto taken = is_truthy(cond.value());
+	if (auto dead = taken ? ifs->get_false_stmt() : ifs->get_true_stmt();!declares_names(dead))
+	{
+		ifs->annotate<branch_annotation>(taken, scope_count(dead));
+	}
+}
+
+void optimizer::visit_function_statement(const std::shared_ptr<parsing::function_statement>& fs)
+{
+	optimize(fs->get_body());
+}
+
+void optimizer::visit_return_statement(const std::shared_ptr<parsing::return_statement>& rs)
+{
+	rs->set_val(optimize(rs->get_val()));
+}
+
+void optimizer::visit_class_statement(const std::shared_ptr<parsing::class_statement>& cs)
+{
+	for (const auto& field: cs->get_fields())
+	{
+		optimize(field);
+	}
+
+	for (const auto& method: cs->get_methods())
+	{
+		optimize(method);
+	}
+}
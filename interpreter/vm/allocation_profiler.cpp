@@ -0,0 +1,121 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/20/2022.
+//
+
+#include <interpreter/vm/allocation_profiler.h>
+#include <interpreter/vm/vm.h>
+
+#include "object/function_object.h"
+
+#include <algorithm>
+#include <format>
+#include <vector>
+
+using namespace std;
+
+using namespace clox::interpreting;
+using namespace clox::interpreting::vm;
+
+allocation_profiler::allocation_profiler(virtual_machine& vm, size_t interval)
+		: vm_(&vm), interval_(interval)
+{
+}
+
+void allocation_profiler::sampled(object_raw_pointer obj, size_t size)
+{
+	auto& site = sites_[current_site()];
+
+	site.samples++;
+	site.count += size < interval_ ? static_cast<double>(interval_) / static_cast<double>(size) : 1.0;
+	site.bytes += std::max(size, interval_);
+
+	live_[obj] = sample_record{ .site=&site };
+}
+
+void allocation_profiler::freed(object_raw_pointer obj)
+{
+	live_.erase(obj);
+}
+
+void allocation_profiler::collected()
+{
+	collections_++;
+
+	for (auto& [obj, sample]: live_)
+	{
+		if (!sample.survived)
+		{
+			sample.survived = true;
+			sample.site->survivors++;
+		}
+	}
+}
+
+void allocation_profiler::report(std::ostream& os) const
+{
+	vector<pair<const site_key_type*, const site_record*>> sorted{};
+	for (const auto& [key, site]: sites_)
+	{
+		sorted.emplace_back(&key, &site);
+	}
+
+	ranges::sort(sorted, [](const auto& lhs, const auto& rhs)
+	{
+		return lhs.second->bytes > rhs.second->bytes;
+	});
+
+	os << std::format("Allocation sites, sampled every {} bytes, {} collections", interval_, collections_) << endl;
+	os << std::format("{:<32}{:>14}{:>14}{:>10}{:>12}", "Site", "Bytes", "Objects", "Samples", "Survived") << endl;
+
+	for (const auto& [key, site]: sorted | views::take(REPORT_SITES))
+	{
+		const auto& [function, line] = *key;
+
+		auto name = line == chunk::INVALID_LINE ? function : std::format("{}:{}", function, line);
+		os << std::format("{:<32}{:>14}{:>14.0f}{:>10}{:>11.1f}%", name, site->bytes, site->count, site->samples,
+				100.0 * static_cast<double>(site->survivors) / static_cast<double>(site->samples)) << endl;
+	}
+}
+
+allocation_profiler::site_key_type allocation_profiler::current_site() const
+{
+	// objects allocated without a frame are made by the compiler or for natives
+	if (vm_->call_frames_.empty())
+	{
+		return { "<compiler>", chunk::INVALID_LINE };
+	}
+
+	auto& frame = vm_->call_frames_.back();
+
+	auto func = frame.function();
+	auto name = func->name().empty() ? string{ "<script>" } : func->name();
+
+	if (frame.ip() == func->body()->begin())
+	{
+		return { name, chunk::INVALID_LINE };
+	}
+
+	return { name, func->body()->line_of(frame.ip() - 1) };
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/4/2022.
+//
+
+#include <interpreter/vm/binary_stream.h>
+
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+bool clox::interpreting::vm::binary_writer::save(const std::string& path) const
+{
+	try
+	{
+		auto temp = path + ".tmp";
+		{
+			ofstream out{ temp, ios::binary | ios::trunc };
+			out.write(buf_.data(), static_cast<streamsize>(buf_.size()));
+			if (!out)
+			{
+				return false;
+			}
+		}
+
+		filesystem::rename(temp, path);
+	}
+	catch (const filesystem::filesystem_error&)
+	{
+		return false;
+	}
+
+	return true;
+}
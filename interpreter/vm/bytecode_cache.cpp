@@ -0,0 +1,146 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/2/2022.
+//
+
+#include <interpreter/vm/bytecode_cache.h>
+#include <interpreter/vm/heap_image.h>
+#include <interpreter/vm/binary_stream.h>
+#include <interpreter/vm/exceptions.h>
+
+#include <base/configuration.h>
+
+#include <helper/mapped_file.h>
+
+#include <filesystem>
+
+using namespace std;
+
+using namespace clox::helper;
+using namespace clox::interpreting;
+using namespace clox::interpreting::vm;
+
+std::string clox::interpreting::vm::bytecode_cache::cache_path_of(const string& source_path)
+{
+	return filesystem::path{ source_path }.replace_extension(FILE_EXTENSION).string();
+}
+
+clox::interpreting::vm::bytecode_cache::hash_type
+clox::interpreting::vm::bytecode_cache::hash_of(std::string_view source)
+{
+	// 64-bit FNV-1a
+	hash_type hash = 0xcbf29ce484222325ull;
+	for (const auto c: source)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+uint32_t clox::interpreting::vm::bytecode_cache::codegen_flags()
+{
+	uint32_t flags = 0;
+
+	if (base::configurable_configuration_instance().optimize())
+	{
+		flags |= CODEGEN_OPTIMIZED;
+	}
+
+	if (base::configurable_configuration_instance().aot())
+	{
+		flags |= CODEGEN_AOT;
+	}
+
+	return flags;
+}
+
+bool clox::interpreting::vm::bytecode_cache::save(const string& path, hash_type source_hash,
+		function_object_raw_pointer top_level)
+{
+	binary_writer writer{};
+
+	writer.write(MAGIC);
+	writer.write(VERSION);
+	writer.write<uint32_t>(sizeof(floating_value_type));
+	writer.write(codegen_flags());
+	writer.write(source_hash);
+
+	try
+	{
+		// the function tree only consists of functions and string constants
+		heap_image_writer image{};
+		image.add(top_level);
+		image.write_objects(writer);
+		writer.write(image.index_of(top_level));
+	}
+	catch (const invalid_binary_image&)
+	{
+		return false;
+	}
+
+	return writer.save(path);
+}
+
+clox::interpreting::vm::function_object_raw_pointer
+clox::interpreting::vm::bytecode_cache::load(const shared_ptr<object_heap>& heap, const string& path,
+		hash_type source_hash)
+{
+	mapped_file file{ path };
+	if (!file.valid())
+	{
+		return nullptr;
+	}
+
+	try
+	{
+		binary_reader reader{ file.data() };
+
+		if (reader.read<uint32_t>() != MAGIC ||
+			reader.read<uint32_t>() != VERSION ||
+			reader.read<uint32_t>() != sizeof(floating_value_type) ||
+			reader.read<uint32_t>() != codegen_flags() ||
+			reader.read<hash_type>() != source_hash)
+		{
+			return nullptr;
+		}
+
+		heap_image_reader image{ heap };
+		image.read_objects(reader);
+
+		auto top_level = image.object_at<function_object_raw_pointer>(reader.read<heap_image_reader::index_type>());
+
+		if (!reader.done())
+		{
+			throw invalid_binary_image{ "trailing data" };
+		}
+
+		return top_level;
+	}
+	catch (const invalid_binary_image&)
+	{
+		// the loaded objects are unreachable, and will be reclaimed by the GC
+		return nullptr;
+	}
+}
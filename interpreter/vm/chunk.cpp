@@ -26,23 +26,31 @@
 #include <interpreter/vm/opcode.h>
 #include <interpreter/vm/exceptions.h>
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
 using namespace std;
 
 using namespace clox::interpreting;
 using namespace clox::interpreting::vm;
 
 
-chunk::chunk(std::string name)
-		: name_(std::move(name))
+chunk::chunk(const allocator_type& alloc)
+		: constants_(alloc), constant_index_(alloc), codes_(alloc), line_table_(alloc)
 {
+}
 
+chunk::chunk(std::string name, const allocator_type& alloc)
+		: name_(std::move(name)), constants_(alloc), constant_index_(alloc), codes_(alloc), line_table_(alloc)
+{
 }
 
-void clox::interpreting::vm::chunk::write(code_type op, std::optional<scanning::token> t)
+void clox::interpreting::vm::chunk::write(full_opcode_type op, std::optional<scanning::token> t)
 {
 	if (t.has_value())
 	{
-		write(op, t->line());
+		write(op, t->line(), t->column());
 	}
 	else
 	{
@@ -51,44 +59,216 @@ void clox::interpreting::vm::chunk::write(code_type op, std::optional<scanning::
 }
 
 
-void chunk::write(code_type op, int64_t line)
+void chunk::write(full_opcode_type op, int64_t line, int64_t column)
+{
+	code_type buf[1 + MAX_OPERAND_SIZE]{};
+	auto size = encode_instruction(op, buf);
+
+	mark_location(line, column);
+	last_instruction_ = static_cast<difference_type>(codes_.size());
+
+	for (size_t i = 0; i < size; i++)
+	{
+		write_byte(buf[i]);
+	}
+}
+
+void chunk::write_operand(operand_type operand)
+{
+	code_type buf[MAX_OPERAND_SIZE]{};
+	auto size = encode_operand(operand, buf);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		write_byte(buf[i]);
+	}
+}
+
+chunk::difference_type chunk::write_placeholder()
+{
+	auto offset = static_cast<difference_type>(codes_.size());
+
+	for (size_t i = 0; i < MAX_OPERAND_SIZE; i++)
+	{
+		write_byte(i == MAX_OPERAND_SIZE - 1 ? 0 : LEB128_MORE);
+	}
+
+	return offset;
+}
+
+void chunk::patch_operand(difference_type offset, operand_type operand)
 {
-	codes_.push_back(op);
+	// keep the full width so that nothing after the placeholder moves
+	for (size_t i = 0; i < MAX_OPERAND_SIZE; i++)
+	{
+		code_type byte = operand & LEB128_PAYLOAD;
+		operand >>= 7;
+
+		if (i != MAX_OPERAND_SIZE - 1)
+		{
+			byte |= LEB128_MORE;
+		}
+
+		codes_[offset + i] = byte;
+	}
+}
+
+full_opcode_type chunk::last_instruction()
+{
+	if (last_instruction_ < 0)
+	{
+		return compose_opcode(0, op_code::OPCODE_ENUM_MIN);
+	}
+
+	auto ip = codes_.begin() + last_instruction_;
+	return read_instruction(ip);
+}
+
+void chunk::patch_last_instruction(full_opcode_type new_op)
+{
+	assert(last_instruction_ >= 0);
+
+	auto ip = codes_.begin() + last_instruction_;
+	read_instruction(ip);
+	auto old_size = static_cast<size_t>(ip - (codes_.begin() + last_instruction_));
+
+	code_type buf[1 + MAX_OPERAND_SIZE]{};
+	auto new_size = encode_instruction(new_op, buf);
+
+	// the header may change its size, which is safe because nothing refers to the code after the last instruction
+	if (new_size > old_size)
+	{
+		codes_.insert(codes_.begin() + last_instruction_, new_size - old_size, 0);
+	}
+	else if (new_size < old_size)
+	{
+		codes_.erase(codes_.begin() + last_instruction_, codes_.begin() + last_instruction_ + (old_size - new_size));
+	}
+
+	for (auto& run: line_table_)
+	{
+		if (run.offset > last_instruction_)
+		{
+			run.offset = run.offset + new_size - old_size;
+		}
+	}
+
+	std::copy_n(buf, new_size, codes_.begin() + last_instruction_);
+}
+
+void chunk::write_byte(code_type byte)
+{
+	codes_.push_back(byte);
+}
 
+void chunk::mark_location(int64_t line, int64_t column)
+{
 	if (line == INVALID_LINE)
 	{
-		lines_.push_back(last_line_);
+		return; // continue the current run
+	}
+
+	if (!line_table_.empty() && line_table_.back().line == line && line_table_.back().column == column)
+	{
+		return;
+	}
+
+	line_run run{ static_cast<uint32_t>(codes_.size()), static_cast<int32_t>(line), static_cast<uint32_t>(column) };
+
+	if (!line_table_.empty() && line_table_.back().offset == run.offset)
+	{
+		line_table_.back() = run; // the last run is empty
 	}
 	else
 	{
-		lines_.push_back(line);
-		last_line_ = line;
+		line_table_.push_back(run);
 	}
+}
+
+const chunk::line_run* chunk::run_of(uint64_t offset) const
+{
+	auto next = std::upper_bound(line_table_.begin(), line_table_.end(), offset,
+			[](uint64_t off, const line_run& run)
+			{
+				return off < run.offset;
+			});
+
+	if (next == line_table_.begin())
+	{
+		return nullptr;
+	}
+
+	return &*std::prev(next);
+}
+
+size_t chunk::encode_instruction(full_opcode_type op, code_type* out)
+{
+	auto main = static_cast<code_type>(helper::enum_cast(main_op_code_of(op)));
+	auto secondary = secondary_op_code_of(op);
+
+	if (!secondary)
+	{
+		out[0] = main;
+		return 1;
+	}
+
+	out[0] = main | SECONDARY_FOLLOWS;
+	return 1 + encode_operand(secondary, out + 1);
+}
+
+size_t chunk::encode_operand(operand_type operand, code_type* out)
+{
+	size_t size = 0;
+	do
+	{
+		code_type byte = operand & LEB128_PAYLOAD;
+		operand >>= 7;
+		if (operand)
+		{
+			byte |= LEB128_MORE;
+		}
+		out[size++] = byte;
+	} while (operand);
 
+	return size;
 }
 
 
 uint64_t clox::interpreting::vm::chunk::disassemble_instruction(helper::console& out, uint64_t offset)
 {
-	auto op = main_op_code_of(codes_[offset]);
-	auto secondary = secondary_op_code_of(codes_[offset]);
+	auto ip = codes_.begin() + offset;
+	auto instruction = read_instruction(ip);
+
+	auto op = main_op_code_of(instruction);
+	auto secondary = secondary_op_code_of(instruction);
+
+	auto operand = [&ip]
+	{
+		return read_operand(ip);
+	};
+
+	auto next_offset = [this, &ip]
+	{
+		return static_cast<uint64_t>(ip - codes_.begin());
+	};
 
 	out.log() << std::format("{0:0>8}", offset); // example: 00000001:	CONSTANT
 
 	constexpr size_t LINE_NUMBER_WIDTH = 10;
-	if (offset > 0 && lines_[offset] == lines_[offset - 1])
+	auto run = run_of(offset);
+	if (offset > 0 && run && run->offset != offset)
 	{
 		out.log() << std::format("{0:>{1}}  ", "|", LINE_NUMBER_WIDTH);
 	}
 	else
 	{
-		if (lines_[offset] == INVALID_LINE)
+		if (!run)
 		{
 			out.log() << std::format("{0:>{1}}  ", "<invalid>", LINE_NUMBER_WIDTH);
 		}
 		else
 		{
-			out.log() << std::format("{0:>{1}}  ", lines_[offset], LINE_NUMBER_WIDTH);
+			out.log() << std::format("{0:>{1}}  ", std::format("{}:{}", run->line, run->column), LINE_NUMBER_WIDTH);
 		}
 	}
 
@@ -108,17 +288,23 @@ uint64_t clox::interpreting::vm::chunk::disassemble_instruction(helper::console&
 	switch (op)
 	{
 	case op_code::CONSTANT:
-		out.log() << std::format(" {} '{}'", codes_[offset + 1], constants_[codes_[offset + 1]]) << endl;
-		return offset + 2;
+	{
+		auto index = operand();
+		out.log() << std::format(" {} '{}'", index, constants_[index]) << endl;
+		break;
+	}
 
 	case op_code::POP_N:
-		out.log() << std::format(" N={}", codes_[offset + 1]) << endl;
-		return offset + 2;
+		out.log() << std::format(" N={}", operand()) << endl;
+		break;
 
 	case op_code::JUMP:
 	case op_code::JUMP_IF_FALSE:
-		out.log() << std::format(" {} -> {}", offset, offset + 2 + codes_[offset + 1]) << endl;
-		return offset + 2;
+	{
+		auto distance = operand();
+		out.log() << std::format(" {} -> {}", offset, next_offset() + distance) << endl;
+		break;
+	}
 
 	case op_code::INC:
 	case op_code::DEC:
@@ -127,124 +313,210 @@ uint64_t clox::interpreting::vm::chunk::disassemble_instruction(helper::console&
 	case op_code::DEFINE:
 		if (secondary & SEC_OP_GLOBAL)
 		{
-			out.log() << std::format(" {} '{}'", codes_[offset + 1], constants_[codes_[offset + 1]]) << endl;
+			auto index = operand();
+			out.log() << std::format(" {} '{}'", index, constants_[index]) << endl;
 		}
 		else if (secondary & SEC_OP_LOCAL)
 		{
-			out.log() << std::format(" (stack slot) '{}'", codes_[offset + 1]) << endl;
+			out.log() << std::format(" (stack slot) '{}'", operand()) << endl;
 		}
 		else if (secondary & SEC_OP_UPVALUE)
 		{
-			out.log() << std::format(" Upvalue {}", codes_[offset + 1]) << endl;
+			out.log() << std::format(" Upvalue {}", operand()) << endl;
 		}
 		else if (secondary & SEC_OP_FUNC)
 		{
-			out.log() << std::format(" ID={}, constant {} '{}'", codes_[offset + 1], codes_[offset + 2],
-					constants_[codes_[offset + 2]]) << endl;
-			return offset + 3;
+			auto id = operand();
+			auto index = operand();
+			out.log() << std::format(" ID={}, constant {} '{}'", id, index, constants_[index]) << endl;
 		}
-
-		return offset + 2;
+		else
+		{
+			out.log() << endl;
+		}
+		break;
 
 	case op_code::PUSH:
 		if (secondary & SEC_OP_FUNC)
 		{
-			out.log() << std::format(" ID={}", codes_[offset + 1]) << endl;
-			return offset + 2;
+			out.log() << std::format(" ID={}", operand()) << endl;
 		}
 		else if (secondary & SEC_OP_CLASS)
 		{
-			out.log() << std::format(" Name={}", constants_[codes_[offset + 1]]) << endl;
-			return offset + 2;
+			out.log() << std::format(" Name={}", constants_[operand()]) << endl;
 		}
+		else
+		{
+			out.log() << endl;
+		}
+		break;
 
 	case op_code::LOOP:
-		out.log() << std::format(" (offset) '{}'", codes_[offset + 1]) << endl;
-		return offset + 2;
-
+	{
+		auto distance = operand();
+		out.log() << std::format(" {} -> {}", offset, next_offset() - distance) << endl;
+		break;
+	}
 
 	case op_code::CALL:
-		out.log() << std::format(" {} args",
-				codes_[offset + 1]) << endl;
-		return offset + 2;
+		out.log() << std::format(" {} args", operand()) << endl;
+		break;
 
 	case op_code::CLOSURE:
 	{
 		if (secondary & SEC_OP_CAPTURE)
 		{
-			offset++;
-			auto count = codes_[offset++];
-			for (int i = 0; i < count; i++)
+			auto count = operand();
+			for (operand_type i = 0; i < count; i++)
 			{
-				auto local = codes_[offset++];
-				auto index = codes_[offset++];
+				auto local = operand();
+				auto index = operand();
 				out.log() << std::format(" {} {}{}",
 						local ? "Local" : "Upvalue", index, i == count - 1 ? "" : ",");
 			}
 			out.log() << endl;
-			return offset;
 		}
 		else
 		{
 			out.log() << " (No captures specified)" << endl;
-			return offset + 1;
 		}
+		break;
 	}
 
 	case op_code::CLASS:
-		out.log() << std::format(" {} '{}', {} fields", codes_[offset + 1], constants_[codes_[offset + 1]],
-				codes_[offset + 2]) << endl;
-		return offset + 3;
+	{
+		auto index = operand();
+		auto fields = operand();
+		out.log() << std::format(" {} '{}', {} fields", index, constants_[index], fields) << endl;
+		break;
+	}
 
 	case op_code::GET_PROPERTY:
 		if (secondary & SEC_OP_FUNC)
 		{
-			out.log() << std::format(" Function ID {}", codes_[offset + 1]) << endl;
+			out.log() << std::format(" Function ID {}", operand()) << endl;
 		}
 		else
 		{
-			out.log() << std::format(" Member offset {}", codes_[offset + 1]) << endl;
+			out.log() << std::format(" Member offset {}", operand()) << endl;
 		}
-		return offset + 2;
+		break;
 
 	case op_code::SET_PROPERTY:
-		out.log() << std::format(" Member offset {}", codes_[offset + 1]) << endl;
-		return offset + 2;
+		out.log() << std::format(" Member offset {}", operand()) << endl;
+		break;
 
 	case op_code::METHOD:
-		out.log() << std::format(" ID= {}", codes_[offset + 1]) << endl;
-		return offset + 2;
+		out.log() << std::format(" ID= {}", operand()) << endl;
+		break;
 
 	case op_code::INVOKE:
-		out.log() << std::format(" ID= {}, {} args", codes_[offset + 1], codes_[offset + 2]) << endl;
-		return offset + 3;
+	{
+		auto id = operand();
+		auto args = operand();
+		out.log() << std::format(" ID= {}, {} args{}", id, args, (secondary & SEC_OP_FUNC) ? ", direct" : "") << endl;
+		break;
+	}
 
 	case op_code::GET_SUPER:
+	{
+		auto index = operand();
+		auto field_id = operand();
 		if (secondary & SEC_OP_LOCAL)
 		{
-			out.log() << std::format("{}th base, {}th member", codes_[offset + 1], codes_[offset + 2]) << endl;
+			out.log() << std::format("{}th base, {}th member", index, field_id) << endl;
 		}
 		else if (secondary & SEC_OP_FUNC)
 		{
-			out.log() << std::format("{}th base, method ID: {}", codes_[offset + 1], codes_[offset + 2]) << endl;
+			out.log() << std::format("{}th base, method ID: {}", index, field_id) << endl;
 		}
-		return offset + 3;
+		else
+		{
+			out.log() << endl;
+		}
+		break;
+	}
 
 	case op_code::MAKE_LIST:
-		out.log() << std::format(" Size= {} ", codes_[offset + 1]) << endl;
-		return offset + 2;
+		out.log() << std::format(" Size= {} ", operand()) << endl;
+		break;
 
-	case op_code::INSTANCE:
-		if (secondary & SEC_OP_FUNC)
+	default:
+		out.log() << endl;
+		break;
+	}
+
+	return next_offset();
+}
+
+chunk::decoded_instruction chunk::decode_instruction(uint64_t offset)
+{
+	auto ip = codes_.begin() + static_cast<difference_type>(offset);
+	auto instruction = read_instruction(ip);
+
+	auto secondary = secondary_op_code_of(instruction);
+
+	size_t count = 0;
+	switch (main_op_code_of(instruction))
+	{
+	case op_code::CONSTANT:
+	case op_code::POP_N:
+	case op_code::JUMP:
+	case op_code::JUMP_IF_FALSE:
+	case op_code::LOOP:
+	case op_code::CALL:
+	case op_code::GET_PROPERTY:
+	case op_code::SET_PROPERTY:
+	case op_code::METHOD:
+	case op_code::MAKE_LIST:
+		count = 1;
+		break;
+
+	case op_code::INC:
+	case op_code::DEC:
+	case op_code::SET:
+	case op_code::GET:
+	case op_code::DEFINE:
+		count = (secondary & (SEC_OP_GLOBAL | SEC_OP_LOCAL | SEC_OP_UPVALUE)) ? 1 : ((secondary & SEC_OP_FUNC) ? 2 : 0);
+		break;
+
+	case op_code::PUSH:
+		count = (secondary & (SEC_OP_FUNC | SEC_OP_CLASS)) ? 1 : 0;
+		break;
+
+	case op_code::CLASS:
+	case op_code::INVOKE:
+	case op_code::GET_SUPER:
+		count = 2;
+		break;
+
+	case op_code::CLOSURE:
+		if (secondary & SEC_OP_CAPTURE)
 		{
-			out.log() << std::format(" ID= {}, {} args.", codes_[offset + 1], codes_[offset + 2]) << endl;
-			return offset + 3;
+			auto captures = read_operand(ip);
+			decoded_instruction ret{ .instruction = instruction, .operands = { captures }};
+			for (operand_type i = 0; i < captures * 2; i++)
+			{
+				ret.operands.push_back(read_operand(ip));
+			}
+
+			ret.next_offset = static_cast<uint64_t>(ip - codes_.begin());
+			return ret;
 		}
-		[[fallthrough]];
+		break;
+
 	default:
-		out.log() << endl;
-		return offset + 1;
+		break;
 	}
+
+	decoded_instruction ret{ .instruction = instruction };
+	for (size_t i = 0; i < count; i++)
+	{
+		ret.operands.push_back(read_operand(ip));
+	}
+
+	ret.next_offset = static_cast<uint64_t>(ip - codes_.begin());
+	return ret;
 }
 
 void chunk::disassemble(helper::console& out)
@@ -255,45 +527,143 @@ void chunk::disassemble(helper::console& out)
 	}
 }
 
-chunk::code_type chunk::add_constant(const value& val)
+chunk::operand_type chunk::add_constant(const value& val)
 {
+	// constants added before the index was dropped, or read from an image
+	for (; indexed_constants_ < constants_.size(); indexed_constants_++)
+	{
+		if (mergeable(constants_[indexed_constants_]))
+		{
+			constant_index_.try_emplace(constants_[indexed_constants_], indexed_constants_);
+		}
+	}
+
+	if (mergeable(val))
+	{
+		if (auto iter = constant_index_.find(val);iter != constant_index_.end())
+		{
+			return iter->second;
+		}
+	}
+
 	constants_.push_back(val);
-	if (constants_.size() > numeric_limits<full_opcode_type>::max())
+	if (constants_.size() > numeric_limits<operand_type>::max())
 	{
 		throw too_many_constants{};
 	}
 
-	return constants_.size() - 1;
+	auto index = static_cast<operand_type>(constants_.size() - 1);
+	if (mergeable(val))
+	{
+		constant_index_.try_emplace(val, index);
+	}
+	indexed_constants_ = constants_.size();
+
+	return index;
 }
 
-value& chunk::constant_at(code_type pos)
+chunk::operand_type chunk::add_name(const std::shared_ptr<constant_pool>& pool, std::string_view name)
 {
-	return constants_.at(pos);
+	// a chunk only ever refers to a single pool, which it keeps alive for the views
+	assert(!pool_ || pool_ == pool);
+	pool_ = pool;
+
+	return add_constant(pool_->intern(name));
 }
 
+void chunk::seal()
+{
+	constant_index_.clear();
+	constant_index_.rehash(0);
+	indexed_constants_ = 0;
+}
 
-int64_t chunk::line_of(chunk::code_list_type::iterator ip)
+bool chunk::mergeable(const value& val)
 {
-	return lines_.at(ip - begin() - 1);
+	if (auto obj = get_if<object_value_type>(&val);obj)
+	{
+		return *obj && (*obj)->type() == object_type::STRING;
+	}
+
+	return true;
 }
 
-std::string chunk::filename()
+size_t chunk::constant_hash::operator()(const value& val) const noexcept
 {
-	return "<filename placeholder>";
+	return std::visit([&val](auto&& v) -> size_t
+	{
+		using T = std::decay_t<decltype(v)>;
+
+		size_t hash = 0;
+		if constexpr (std::is_same_v<T, object_value_type>)
+		{
+			hash = std::hash<std::string>{}(dynamic_cast<string_object_raw_pointer>(v)->string());
+		}
+		else if constexpr (std::is_same_v<T, nil_value_type>)
+		{
+			hash = 0;
+		}
+		else
+		{
+			hash = std::hash<T>{}(v);
+		}
+
+		return hash ^ val.index();
+	}, val);
 }
 
-void chunk::patch_begin(chunk::code_type new_op, int64_t offset)
+bool chunk::constant_equal::operator()(const value& lhs, const value& rhs) const noexcept
 {
-	*(codes_.begin() + offset) = new_op;
+	if (lhs.index() != rhs.index())
+	{
+		return false;
+	}
+
+	return std::visit([&rhs](auto&& l) -> bool
+	{
+		using T = std::decay_t<decltype(l)>;
+		const auto& r = std::get<T>(rhs);
+
+		if constexpr (std::is_same_v<T, object_value_type>)
+		{
+			return dynamic_cast<string_object_raw_pointer>(l)->string() ==
+				   dynamic_cast<string_object_raw_pointer>(r)->string();
+		}
+		else if constexpr (std::is_same_v<T, floating_value_type>)
+		{
+			// 0.0 and -0.0 are equal but not interchangeable
+			return l == r && std::signbit(l) == std::signbit(r);
+		}
+		else if constexpr (std::is_same_v<T, nil_value_type>)
+		{
+			return true;
+		}
+		else
+		{
+			return l == r;
+		}
+	}, lhs);
 }
 
-void chunk::patch_end(chunk::code_type new_op, int64_t offset)
+value& chunk::constant_at(operand_type pos)
 {
-	*(codes_.rbegin() + offset) = new_op;
+	return constants_.at(pos);
 }
 
 
-chunk::code_type chunk::peek(int64_t offset)
+int64_t chunk::line_of(chunk::code_list_type::iterator ip)
 {
-	return *(codes_.rbegin() + offset);
+	auto run = run_of(ip - begin() - 1);
+	return run ? run->line : INVALID_LINE;
+}
+
+int64_t chunk::column_of(chunk::code_list_type::iterator ip)
+{
+	auto run = run_of(ip - begin() - 1);
+	return run ? run->column : INVALID_COLUMN;
+}
+
+std::string chunk::filename()
+{
+	return "<filename placeholder>";
 }
@@ -29,6 +29,10 @@
 
 #include <interpreter/vm/garbage_collector.h>
 #include <interpreter/vm/vm.h>
+#include <interpreter/vm/allocation_profiler.h>
+
+#include <helper/time_statistic.h>
+#include <helper/trace_recorder.h>
 
 #include <format>
 #include <gsl/gsl>
@@ -46,19 +50,45 @@ garbage_collector::garbage_collector(helper::console& cons, std::shared_ptr<obje
 {
 }
 
+garbage_collector::garbage_collector(helper::console& cons, std::shared_ptr<object_heap> heap, virtual_machine& vm)
+		: cons_(&cons), heap_(std::move(heap)), vm_(&vm), gen_(nullptr)
+{
+}
+
 void clox::interpreting::vm::garbage_collector::collect()
 {
+	auto _t = helper::time_statistic::instance().measure(helper::statistic_phase::GC);
+
+	// sampled frames point to functions, which may be swept
+	vm_->drain_samples();
+
 	[[maybe_unused]]auto before = heap_->size_;
 	if constexpr(runtime_predefined_configuration::ENABLE_DEBUG_LOGGING_GC)
 	{
 		cons_->log() << "-- begin gc" << endl;
 	}
 
-	mark_roots();
+	auto& tracer = helper::trace_recorder::instance();
 
-	trace_references();
+	{
+		auto _s = tracer.span("mark roots", "gc");
+		mark_roots();
+	}
 
-	sweep();
+	{
+		auto _s = tracer.span("trace", "gc");
+		trace_references();
+	}
+
+	{
+		auto _s = tracer.span("sweep", "gc");
+		sweep();
+	}
+
+	if (auto profiler = heap_->current_allocation_profiler();profiler)
+	{
+		profiler->collected();
+	}
 
 	if constexpr(runtime_predefined_configuration::ENABLE_DEBUG_LOGGING_GC)
 	{
@@ -67,6 +97,28 @@ void clox::interpreting::vm::garbage_collector::collect()
 	}
 }
 
+void garbage_collector::for_each_reference(object_raw_pointer obj, const reference_visitor_type& visit)
+{
+	reference_visitor_ = &visit;
+	auto _ = finally([this]
+	{
+		reference_visitor_ = nullptr;
+	});
+
+	obj->blacken(this);
+}
+
+void garbage_collector::for_each_root(const reference_visitor_type& visit)
+{
+	reference_visitor_ = &visit;
+	auto _ = finally([this]
+	{
+		reference_visitor_ = nullptr;
+	});
+
+	mark_roots();
+}
+
 void garbage_collector::mark_roots()
 {
 	for (auto& val: vm_->stack_)
@@ -104,9 +156,17 @@ void garbage_collector::mark_functions()
 		mark_value(func.second);
 	}
 
-	for (auto& func: gen_->functions_)
+	if (gen_)
 	{
-		mark_object(func);
+		for (auto& func: gen_->functions_)
+		{
+			mark_object(func);
+		}
+
+		for (auto& [id, func]: gen_->pending_specializations_)
+		{
+			mark_object(func);
+		}
 	}
 }
 
@@ -130,6 +190,13 @@ void garbage_collector::mark_value(value& val)
 void garbage_collector::mark_object(object_raw_pointer obj)
 {
 	if (obj == nullptr)return;
+
+	if (reference_visitor_)
+	{
+		(*reference_visitor_)(obj);
+		return;
+	}
+
 	if (obj->marked_)return;
 
 	obj->marked_ = true;
@@ -26,6 +26,14 @@
 #include <interpreter/vm/heap.h>
 #include <interpreter/vm/exceptions.h>
 #include <interpreter/vm/garbage_collector.h>
+#include <interpreter/vm/allocation_profiler.h>
+
+#include <helper/time_statistic.h>
+
+#include <object/string_object.h>
+#include <object/instance_object.h>
+
+#include <algorithm>
 
 using namespace clox;
 using namespace clox::interpreting;
@@ -38,10 +46,19 @@ object_heap::~object_heap()
 		cons_->log() << "--end of life deallocate" << std::endl;
 	}
 
+	helper::time_statistic::instance().count(helper::statistic_counter::OBJECTS, allocated_objects_);
+	helper::time_statistic::instance().count(helper::statistic_counter::OBJECT_BYTES, allocated_object_bytes_);
+
 	while (!objects_.empty())
 	{
 		auto back = objects_.back();
 		objects_.pop_back();
+
+		if (back->type() == object_type::STRING)
+		{
+			string_object::interns_.erase(static_cast<string_object_raw_pointer>(back));
+		}
+
 		deallocate(back);
 	}
 }
@@ -53,10 +70,12 @@ clox::interpreting::vm::object_heap::raw_pointer clox::interpreting::vm::object_
 		if (gc_)
 		{
 			gc_->collect();
-			next_gc_ = size_ * garbage_collector::GC_HEAP_GROW_FACTOR;
+			update_next_gc();
 		}
 	}
 
+	reserve(size, true);
+
 	auto ret = reinterpret_cast<void*>(malloc(size));
 
 	if (!ret)
@@ -66,26 +85,94 @@ clox::interpreting::vm::object_heap::raw_pointer clox::interpreting::vm::object_
 
 	size_ += size;
 
-	if (gc_ && size_ > next_gc_)
-	{
-		gc_->collect();
-	}
-
 	return ret;
 }
 
 void clox::interpreting::vm::object_heap::deallocate_raw(raw_pointer raw, size_t size)
 {
+	// Never collect here: deallocation happens during sweeping, and a nested collection will corrupt it.
 	free(raw);
 	size_ -= size;
+}
 
-	if (gc_ && size_ > next_gc_)
+void clox::interpreting::vm::object_heap::reserve(size_type size, bool can_collect)
+{
+	if (can_collect && gc_ && size_ + size > next_gc_)
 	{
 		gc_->collect();
-		next_gc_ = size_ * garbage_collector::GC_HEAP_GROW_FACTOR;
+		update_next_gc();
+	}
+
+	if (memory_limit_ != UNLIMITED && size_ + size > memory_limit_)
+	{
+		if (can_collect && gc_)
+		{
+			// the last chance: collect regardless of next_gc_
+			gc_->collect();
+			update_next_gc();
+		}
+
+		if (size_ + size > memory_limit_)
+		{
+			throw heap_memory_limit_exceeded{ size, size_, memory_limit_ };
+		}
+	}
+
+	if (can_collect)
+	{
+		limit_check_pending_ = false;
 	}
 }
 
+void clox::interpreting::vm::object_heap::update_next_gc()
+{
+	next_gc_ = std::max(size_ * garbage_collector::GC_HEAP_GROW_FACTOR, NEXT_GC_INITIAL);
+
+	if (memory_limit_ != UNLIMITED)
+	{
+		next_gc_ = std::min(next_gc_, memory_limit_);
+	}
+}
+
+void* clox::interpreting::vm::object_heap::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	// Internal buffers may be allocated in the middle of constructing or mutating an object that isn't reachable yet,
+	// so they never trigger a collection themselves. A buffer may go over the limit once, and the next object
+	// allocation collects before checking it again. If another buffer goes over before that, nothing could be freed.
+	if (memory_limit_ != UNLIMITED && size_ + bytes > memory_limit_)
+	{
+		if (!gc_ || limit_check_pending_)
+		{
+			throw heap_memory_limit_exceeded{ bytes, size_, memory_limit_ };
+		}
+
+		limit_check_pending_ = true;
+	}
+
+	auto ret = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	size_ += bytes;
+
+	return ret;
+}
+
+void clox::interpreting::vm::object_heap::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+	std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	size_ -= bytes;
+}
+
+bool clox::interpreting::vm::object_heap::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+object_heap& object_heap::set_memory_limit(size_type limit)
+{
+	memory_limit_ = limit;
+	update_next_gc();
+	return *this;
+}
+
 object_heap& object_heap::enable_gc(clox::interpreting::vm::garbage_collector& gc)
 {
 	gc_ = &gc;
@@ -98,4 +185,48 @@ object_heap& object_heap::remove_gc()
 	return *this;
 }
 
+heap_census object_heap::census() const
+{
+	heap_census ret{};
+	ret.total_bytes = size_;
+
+	for (const auto& obj: objects_)
+	{
+		auto& entry = ret.types[obj->type()];
+		entry.count++;
+		entry.bytes += obj->allocated_size_;
 
+		if (obj->type() == object_type::INSTANCE)
+		{
+			auto& cls = ret.classes[static_cast<instance_object*>(obj)->class_object()->printable_string()];
+			cls.count++;
+			cls.bytes += obj->allocated_size_;
+		}
+
+		ret.object_bytes += obj->allocated_size_;
+	}
+
+	return ret;
+}
+
+object_heap& object_heap::set_allocation_profiler(class allocation_profiler* profiler)
+{
+	allocation_profiler_ = profiler;
+	bytes_until_sample_ = profiler ? static_cast<std::ptrdiff_t>(profiler->interval()) : 0;
+	return *this;
+}
+
+void object_heap::sample_allocation(object_raw_pointer obj)
+{
+	// a large object may span several intervals, but is sampled once
+	auto interval = static_cast<std::ptrdiff_t>(allocation_profiler_->interval());
+	bytes_until_sample_ = interval - (-bytes_until_sample_ % interval);
+
+	obj->allocation_sampled_ = true;
+	allocation_profiler_->sampled(obj, obj->allocated_size_);
+}
+
+void object_heap::forget_allocation(object_raw_pointer obj)
+{
+	allocation_profiler_->freed(obj);
+}
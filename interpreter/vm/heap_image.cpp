@@ -0,0 +1,691 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/4/2022.
+//
+
+#include <interpreter/vm/heap_image.h>
+#include <interpreter/vm/exceptions.h>
+
+#include "object/string_object.h"
+#include "object/function_object.h"
+#include "object/closure_object.h"
+#include "object/upvalue_object.h"
+#include "object/native_function_object.h"
+#include "object/list_object.h"
+#include "object/map_object.h"
+#include "object/class_object.h"
+#include "object/instance_object.h"
+#include "object/bounded_method_object.h"
+
+#include "../../native/include/native/native_manager.h"
+
+#include <algorithm>
+
+using namespace std;
+
+using namespace clox::interpreting;
+using namespace clox::interpreting::vm;
+
+namespace
+{
+
+enum class value_tag : uint8_t
+{
+	INTEGER,
+	FLOATING,
+	BOOLEAN,
+	NIL,
+	VARIABLE_NAME,
+	OBJECT,
+};
+
+/// objects of higher rank are allocated later, because their constructors need objects of lower rank
+int allocation_rank_of(object_raw_pointer obj)
+{
+	switch (obj->type())
+	{
+	case object_type::CLOSURE: // needs its function
+	case object_type::INSTANCE: // needs its class
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+}
+
+void clox::interpreting::vm::heap_image_writer::add(object_raw_pointer obj)
+{
+	if (sealed_)
+	{
+		throw std::logic_error{ "Cannot add objects after they are written." };
+	}
+
+	vector<object_raw_pointer> work{ obj };
+
+	const auto add_value = [&work](const value& val)
+	{
+		if (holds_alternative<object_value_type>(val))
+		{
+			work.push_back(get<object_value_type>(val));
+		}
+	};
+
+	while (!work.empty())
+	{
+		auto cur = work.back();
+		work.pop_back();
+
+		if (!cur || indexes_.contains(cur))continue;
+
+		indexes_[cur] = NULL_INDEX; // the real index is assigned on writing
+		objects_.push_back(cur);
+
+		switch (cur->type())
+		{
+		case object_type::FUNCTION:
+		{
+			auto func = static_cast<function_object_raw_pointer>(cur);
+			for (const auto& constant: func->body_->constants_)
+			{
+				add_value(constant);
+			}
+			work.push_back(func->wrapper_closure_);
+			break;
+		}
+		case object_type::CLOSURE:
+		{
+			auto closure = static_cast<closure_object_raw_pointer>(cur);
+			work.push_back(closure->function());
+			work.insert(work.end(), closure->upvalues().begin(), closure->upvalues().end());
+			break;
+		}
+		case object_type::UPVALUE:
+			add_value(*static_cast<upvalue_object_raw_pointer>(cur)->get_value());
+			break;
+		case object_type::LIST:
+			for (const auto& val: static_cast<list_object_raw_pointer>(cur)->values_)
+			{
+				add_value(val);
+			}
+			break;
+		case object_type::MAP:
+			for (const auto& [key, val]: static_cast<map_object_raw_pointer>(cur)->values_)
+			{
+				add_value(key);
+				add_value(val);
+			}
+			break;
+		case object_type::OBJECT:
+		{
+			auto cls = static_cast<class_object_raw_pointer>(cur);
+			work.insert(work.end(), cls->supers_.begin(), cls->supers_.end());
+			for (const auto& method: cls->methods_)
+			{
+				work.push_back(method.second);
+			}
+			break;
+		}
+		case object_type::INSTANCE:
+		{
+			auto inst = static_cast<instance_object_raw_pointer>(cur);
+			work.push_back(inst->class_object());
+			for (const auto& field: inst->fields_)
+			{
+				add_value(field);
+			}
+			break;
+		}
+		case object_type::BOUNDED_METHOD:
+		{
+			auto bound = static_cast<bounded_method_object_raw_pointer>(cur);
+			add_value(bound->receiver());
+			work.push_back(bound->method());
+			break;
+		}
+		default:
+			break; // strings and native functions refer to nothing
+		}
+	}
+}
+
+void clox::interpreting::vm::heap_image_writer::add(const value& val)
+{
+	if (holds_alternative<object_value_type>(val))
+	{
+		add(get<object_value_type>(val));
+	}
+}
+
+void clox::interpreting::vm::heap_image_writer::write_objects(binary_writer& out)
+{
+	sealed_ = true;
+
+	stable_sort(objects_.begin(), objects_.end(), [](object_raw_pointer lhs, object_raw_pointer rhs)
+	{
+		return allocation_rank_of(lhs) < allocation_rank_of(rhs);
+	});
+
+	for (index_type i = 0; i < objects_.size(); i++)
+	{
+		indexes_[objects_[i]] = i;
+	}
+
+	out.write<index_type>(objects_.size());
+	for (const auto& obj: objects_)
+	{
+		write_object(out, obj);
+	}
+}
+
+clox::interpreting::vm::heap_image_writer::index_type
+clox::interpreting::vm::heap_image_writer::index_of(object_raw_pointer obj) const
+{
+	if (!obj)
+	{
+		return NULL_INDEX;
+	}
+
+	return indexes_.at(obj);
+}
+
+void clox::interpreting::vm::heap_image_writer::write_value(binary_writer& out, const value& val) const
+{
+	std::visit([this, &out](auto&& v)
+	{
+		using T = std::decay_t<decltype(v)>;
+		if constexpr (std::is_same_v<T, integer_value_type>)
+		{
+			out.write(value_tag::INTEGER);
+			out.write(v);
+		}
+		else if constexpr (std::is_same_v<T, floating_value_type>)
+		{
+			out.write(value_tag::FLOATING);
+			out.write(v);
+		}
+		else if constexpr (std::is_same_v<T, boolean_value_type>)
+		{
+			out.write(value_tag::BOOLEAN);
+			out.write<uint8_t>(v);
+		}
+		else if constexpr (std::is_same_v<T, nil_value_type>)
+		{
+			out.write(value_tag::NIL);
+		}
+		else if constexpr (std::is_same_v<T, variable_name_type>)
+		{
+			out.write(value_tag::VARIABLE_NAME);
+			out.write(std::string_view{ v });
+		}
+		else if constexpr (std::is_same_v<T, object_value_type>)
+		{
+			out.write(value_tag::OBJECT);
+			out.write(index_of(v));
+		}
+	}, val);
+}
+
+void clox::interpreting::vm::heap_image_writer::write_chunk(binary_writer& out, chunk& body) const
+{
+	out.write(std::string_view{ body.name_ });
+	out.write_array(body.codes_);
+	out.write_array(body.line_table_);
+
+	out.write<uint64_t>(body.constants_.size());
+	for (const auto& constant: body.constants_)
+	{
+		write_value(out, constant);
+	}
+}
+
+void clox::interpreting::vm::heap_image_writer::write_object(binary_writer& out, object_raw_pointer obj) const
+{
+	out.write(obj->type());
+
+	switch (obj->type())
+	{
+	case object_type::STRING:
+		out.write(std::string_view{ static_cast<string_object_raw_pointer>(obj)->data_ });
+		break;
+
+	case object_type::FUNCTION:
+	{
+		auto func = static_cast<function_object_raw_pointer>(obj);
+		out.write(std::string_view{ func->name_ });
+		out.write<uint64_t>(func->arity_);
+		out.write<uint64_t>(func->upvalue_count_);
+		write_chunk(out, *func->body_);
+		out.write(index_of(func->wrapper_closure_));
+		break;
+	}
+
+	case object_type::CLOSURE:
+	{
+		auto closure = static_cast<closure_object_raw_pointer>(obj);
+		out.write(index_of(closure->function()));
+		out.write<uint64_t>(closure->upvalues().size());
+		for (const auto& upvalue: closure->upvalues())
+		{
+			out.write(index_of(upvalue));
+		}
+		break;
+	}
+
+	case object_type::UPVALUE:
+		// open upvalues are saved as closed ones, for the stack they point to isn't part of the image
+		write_value(out, *static_cast<upvalue_object_raw_pointer>(obj)->get_value());
+		break;
+
+	case object_type::NATIVE_FUNC:
+		out.write(std::string_view{ static_cast<native_function_object_raw_pointer>(obj)->function()->name() });
+		break;
+
+	case object_type::LIST:
+	{
+		auto list = static_cast<list_object_raw_pointer>(obj);
+		out.write<uint64_t>(list->values_.size());
+		for (const auto& val: list->values_)
+		{
+			write_value(out, val);
+		}
+		break;
+	}
+
+	case object_type::MAP:
+	{
+		auto map = static_cast<map_object_raw_pointer>(obj);
+		out.write<uint64_t>(map->values_.size());
+		for (const auto& [key, val]: map->values_)
+		{
+			write_value(out, key);
+			write_value(out, val);
+		}
+		break;
+	}
+
+	case object_type::OBJECT:
+	{
+		auto cls = static_cast<class_object_raw_pointer>(obj);
+		out.write(std::string_view{ cls->name_ });
+		out.write<uint64_t>(cls->field_size_);
+
+		out.write<uint64_t>(cls->supers_.size());
+		for (const auto& super: cls->supers_)
+		{
+			out.write(index_of(super));
+		}
+
+		out.write<uint64_t>(cls->methods_.size());
+		for (const auto& [id, method]: cls->methods_)
+		{
+			out.write(id);
+			out.write(index_of(method));
+		}
+		break;
+	}
+
+	case object_type::INSTANCE:
+	{
+		auto inst = static_cast<instance_object_raw_pointer>(obj);
+		out.write(index_of(inst->class_object()));
+		out.write<uint64_t>(inst->fields_.size());
+		for (const auto& field: inst->fields_)
+		{
+			write_value(out, field);
+		}
+		break;
+	}
+
+	case object_type::BOUNDED_METHOD:
+	{
+		auto bound = static_cast<bounded_method_object_raw_pointer>(obj);
+		write_value(out, bound->receiver());
+		out.write(index_of(bound->method()));
+		break;
+	}
+
+	default:
+		throw invalid_binary_image{ std::format("cannot save object of type {}", obj->type()) };
+	}
+}
+
+clox::interpreting::vm::heap_image_reader::heap_image_reader(std::shared_ptr<object_heap> heap)
+		: heap_(std::move(heap))
+{
+}
+
+void clox::interpreting::vm::heap_image_reader::read_objects(binary_reader& in)
+{
+	auto count = in.read<index_type>();
+	if (count > in.remaining())
+	{
+		throw invalid_binary_image{ "object count is larger than the image" };
+	}
+
+	objects_.reserve(count);
+	for (index_type i = 0; i < count; i++)
+	{
+		read_object(in);
+	}
+
+	for (const auto& fixup: fixups_)
+	{
+		fixup();
+	}
+
+	fixups_.clear();
+}
+
+clox::interpreting::vm::object_raw_pointer
+clox::interpreting::vm::heap_image_reader::object_at(index_type idx) const
+{
+	if (idx == heap_image_writer::NULL_INDEX)
+	{
+		return nullptr;
+	}
+
+	if (idx >= objects_.size())
+	{
+		throw invalid_binary_image{ "object index out of range" };
+	}
+
+	return objects_[idx];
+}
+
+clox::interpreting::vm::heap_image_reader::value_ref
+clox::interpreting::vm::heap_image_reader::read_value_ref(binary_reader& in) const
+{
+	switch (in.read<value_tag>())
+	{
+	case value_tag::INTEGER:
+		return { in.read<integer_value_type>() };
+	case value_tag::FLOATING:
+		return { in.read<floating_value_type>() };
+	case value_tag::BOOLEAN:
+		return { static_cast<boolean_value_type>(in.read<uint8_t>()) };
+	case value_tag::NIL:
+		return { nil_value_type{}};
+	case value_tag::VARIABLE_NAME:
+		return { constant_pool_->intern(in.read_string()) };
+	case value_tag::OBJECT:
+	{
+		auto idx = in.read<index_type>();
+		if (idx == heap_image_writer::NULL_INDEX)
+		{
+			return { static_cast<object_raw_pointer>(nullptr) };
+		}
+		return { nil_value_type{}, idx };
+	}
+	default:
+		throw invalid_binary_image{ "unknown value" };
+	}
+}
+
+clox::interpreting::vm::value clox::interpreting::vm::heap_image_reader::resolve(const value_ref& ref) const
+{
+	if (ref.object.has_value())
+	{
+		return object_at(ref.object.value());
+	}
+
+	return ref.val;
+}
+
+clox::interpreting::vm::value clox::interpreting::vm::heap_image_reader::read_value(binary_reader& in) const
+{
+	return resolve(read_value_ref(in));
+}
+
+void clox::interpreting::vm::heap_image_reader::read_chunk(binary_reader& in, chunk& body)
+{
+	body.name_ = in.read_string();
+	body.pool_ = constant_pool_;
+	in.read_array(body.codes_);
+	in.read_array(body.line_table_);
+
+	for (size_t i = 0; i < body.line_table_.size(); i++)
+	{
+		if (body.line_table_[i].offset >= body.codes_.size() ||
+			(i > 0 && body.line_table_[i].offset <= body.line_table_[i - 1].offset))
+		{
+			throw invalid_binary_image{ "line table mismatches the code" };
+		}
+	}
+
+	auto count = in.read<uint64_t>();
+	vector<value_ref> constants{};
+	for (uint64_t i = 0; i < count; i++)
+	{
+		constants.push_back(read_value_ref(in));
+	}
+
+	fixups_.emplace_back([this, &body, constants = std::move(constants)]
+	{
+		for (const auto& constant: constants)
+		{
+			body.constants_.push_back(resolve(constant));
+		}
+	});
+}
+
+void clox::interpreting::vm::heap_image_reader::read_object(binary_reader& in)
+{
+	const auto read_value_refs = [this, &in](uint64_t count)
+	{
+		vector<value_ref> ret{};
+		for (uint64_t i = 0; i < count; i++)
+		{
+			ret.push_back(read_value_ref(in));
+		}
+		return ret;
+	};
+
+	const auto read_indexes = [&in](uint64_t count)
+	{
+		vector<index_type> ret{};
+		for (uint64_t i = 0; i < count; i++)
+		{
+			ret.push_back(in.read<index_type>());
+		}
+		return ret;
+	};
+
+	switch (in.read<object_type>())
+	{
+	case object_type::STRING:
+		objects_.push_back(string_object::create_on_heap(heap_, in.read_string()));
+		break;
+
+	case object_type::FUNCTION:
+	{
+		auto name = in.read_string();
+		auto arity = in.read<uint64_t>();
+
+		auto func = heap_->allocate<function_object>(name, arity);
+		objects_.push_back(func);
+
+		func->upvalue_count_ = in.read<uint64_t>();
+		read_chunk(in, *func->body_);
+
+		auto wrapper = in.read<index_type>();
+		fixups_.emplace_back([this, func, wrapper]
+		{
+			// closures overwrite it on construction, so set it after all of them are allocated
+			func->wrapper_closure_ = object_at<closure_object_raw_pointer>(wrapper);
+		});
+		break;
+	}
+
+	case object_type::CLOSURE:
+	{
+		auto func = object_at<function_object_raw_pointer>(in.read<index_type>());
+		if (!func)
+		{
+			throw invalid_binary_image{ "closure without function" };
+		}
+
+		auto closure = heap_->allocate<closure_object>(func);
+		objects_.push_back(closure);
+
+		fixups_.emplace_back([this, closure, upvalues = read_indexes(in.read<uint64_t>())]
+		{
+			for (const auto& upvalue: upvalues)
+			{
+				closure->upvalues().push_back(object_at<upvalue_object_raw_pointer>(upvalue));
+			}
+		});
+		break;
+	}
+
+	case object_type::UPVALUE:
+	{
+		auto upvalue = heap_->allocate<upvalue_object>(nullptr);
+		objects_.push_back(upvalue);
+
+		fixups_.emplace_back([this, upvalue, ref = read_value_ref(in)]
+		{
+			upvalue->closed_ = resolve(ref);
+			upvalue->value_ = &upvalue->closed_.value();
+		});
+		break;
+	}
+
+	case object_type::NATIVE_FUNC:
+	{
+		auto name = in.read_string();
+
+		auto& natives = native::native_manager::instance().functions();
+		if (!natives.contains(name))
+		{
+			throw invalid_binary_image{ std::format("no native function named {}", name) };
+		}
+
+		objects_.push_back(heap_->allocate<native_function_object>(natives.at(name)));
+		break;
+	}
+
+	case object_type::LIST:
+	{
+		auto list = heap_->allocate<list_object>(vector<value>{});
+		objects_.push_back(list);
+
+		fixups_.emplace_back([this, list, refs = read_value_refs(in.read<uint64_t>())]
+		{
+			for (const auto& ref: refs)
+			{
+				list->values_.push_back(resolve(ref));
+			}
+		});
+		break;
+	}
+
+	case object_type::MAP:
+	{
+		auto map = heap_->allocate<map_object>(vector<pair<value, value>>{});
+		objects_.push_back(map);
+
+		fixups_.emplace_back([this, map, refs = read_value_refs(in.read<uint64_t>() * 2)]
+		{
+			for (size_t i = 0; i + 1 < refs.size(); i += 2)
+			{
+				map->values_.emplace_back(resolve(refs[i]), resolve(refs[i + 1]));
+			}
+		});
+		break;
+	}
+
+	case object_type::OBJECT:
+	{
+		auto name = in.read_string();
+		auto field_size = in.read<uint64_t>();
+
+		auto cls = heap_->allocate<class_object>(name, field_size);
+		objects_.push_back(cls);
+
+		auto supers = read_indexes(in.read<uint64_t>());
+
+		vector<pair<resolving::function_id_type, index_type>> methods{};
+		for (auto count = in.read<uint64_t>(); count > 0; count--)
+		{
+			auto id = in.read<resolving::function_id_type>();
+			methods.emplace_back(id, in.read<index_type>());
+		}
+
+		fixups_.emplace_back([this, cls, supers = std::move(supers), methods = std::move(methods)]
+		{
+			for (const auto& super: supers)
+			{
+				cls->supers_.push_back(object_at<class_object_raw_pointer>(super));
+			}
+
+			for (const auto& [id, method]: methods)
+			{
+				cls->methods_.insert_or_assign(id, object_at<closure_object_raw_pointer>(method));
+			}
+		});
+		break;
+	}
+
+	case object_type::INSTANCE:
+	{
+		auto cls = object_at<class_object_raw_pointer>(in.read<index_type>());
+		if (!cls)
+		{
+			throw invalid_binary_image{ "instance without class" };
+		}
+
+		auto inst = heap_->allocate<instance_object>(cls);
+		objects_.push_back(inst);
+
+		fixups_.emplace_back([this, inst, refs = read_value_refs(in.read<uint64_t>())]
+		{
+			inst->fields_.clear();
+			for (const auto& ref: refs)
+			{
+				inst->fields_.push_back(resolve(ref));
+			}
+		});
+		break;
+	}
+
+	case object_type::BOUNDED_METHOD:
+	{
+		auto bound = heap_->allocate<bounded_method_object>(value{ nil_value_type{}}, nullptr);
+		objects_.push_back(bound);
+
+		auto receiver = read_value_ref(in);
+		auto method = in.read<index_type>();
+		fixups_.emplace_back([this, bound, receiver, method]
+		{
+			bound->receiver_ = resolve(receiver);
+			bound->method_ = object_at<closure_object_raw_pointer>(method);
+		});
+		break;
+	}
+
+	default:
+		throw invalid_binary_image{ "unknown object" };
+	}
+}
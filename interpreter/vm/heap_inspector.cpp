@@ -0,0 +1,311 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/19/2022.
+//
+
+#include <interpreter/vm/heap_inspector.h>
+#include <interpreter/vm/garbage_collector.h>
+
+#include "object/string_object.h"
+#include "object/function_object.h"
+#include "object/closure_object.h"
+#include "object/class_object.h"
+#include "object/instance_object.h"
+
+#include <helper/json.h>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <ranges>
+#include <unordered_map>
+
+using namespace std;
+
+using namespace clox::interpreting;
+using namespace clox::interpreting::vm;
+
+using clox::helper::escape_json;
+
+namespace
+{
+
+constexpr size_t NAME_LENGTH_LIMIT = 64;
+
+}
+
+heap_inspector::heap_inspector(object_heap& heap)
+		: heap_(&heap)
+{
+	if (!heap.gc_)
+	{
+		throw std::logic_error{ "Cannot inspect a heap without GC." };
+	}
+}
+
+void heap_inspector::print_census(const heap_census& census, std::ostream& os)
+{
+	os << std::format("{:<24}{:>12}{:>16}", "Type", "Count", "Bytes") << endl;
+	for (const auto& [type, entry]: census.types)
+	{
+		os << std::format("{:<24}{:>12}{:>16}", std::format("{}", type), entry.count, entry.bytes) << endl;
+	}
+
+	if (!census.classes.empty())
+	{
+		os << endl << std::format("{:<24}{:>12}{:>16}", "Class", "Instances", "Bytes") << endl;
+		for (const auto& [name, entry]: census.classes)
+		{
+			os << std::format("{:<24}{:>12}{:>16}", name, entry.count, entry.bytes) << endl;
+		}
+	}
+
+	os << endl << std::format("{} bytes in objects, {} bytes in their buffers, {} bytes in total",
+			census.object_bytes, census.total_bytes - census.object_bytes, census.total_bytes) << endl;
+}
+
+bool heap_inspector::write_snapshot(const std::string& path)
+{
+	ofstream file{ path };
+	if (!file)
+	{
+		return false;
+	}
+
+	write_snapshot(file);
+	return static_cast<bool>(file);
+}
+
+void heap_inspector::write_snapshot(std::ostream& os)
+{
+	build_graph();
+	compute_dominators();
+
+	// children before their dominators, so that retained sizes add up towards the root
+	for (auto id: reverse_postorder_ | views::reverse)
+	{
+		auto& n = nodes_[id];
+		n.retained += n.size;
+
+		if (id != ROOT)
+		{
+			nodes_[n.dominator].retained += n.retained;
+		}
+	}
+
+	// garbage not swept yet retains only itself
+	for (auto& n: nodes_)
+	{
+		if (!n.reachable)
+		{
+			n.retained = n.size;
+		}
+	}
+
+	auto census = heap_->census();
+
+	os << "{\"census\":{\"types\":{";
+	for (bool first = true; const auto& [type, entry]: census.types)
+	{
+		os << std::format("{}\"{}\":{{\"count\":{},\"bytes\":{}}}", first ? "" : ",", type, entry.count, entry.bytes);
+		first = false;
+	}
+
+	os << "},\"classes\":{";
+	for (bool first = true; const auto& [name, entry]: census.classes)
+	{
+		os << std::format("{}\"{}\":{{\"count\":{},\"bytes\":{}}}", first ? "" : ",", escape_json(name), entry.count,
+				entry.bytes);
+		first = false;
+	}
+
+	os << std::format("}},\"object_bytes\":{},\"total_bytes\":{}}},", census.object_bytes, census.total_bytes);
+
+	os << "\n\"nodes\":[";
+	for (size_t id = 1; id < nodes_.size(); id++)
+	{
+		const auto& n = nodes_[id];
+		os << std::format("{}\n{{\"id\":{},\"type\":\"{}\",\"name\":\"{}\",\"size\":{},\"retained\":{},"
+						  "\"dominator\":{},\"reachable\":{}}}",
+				id == 1 ? "" : ",", id, n.obj->type(), escape_json(name_of(n.obj)), n.size, n.retained,
+				n.reachable ? n.dominator : 0, n.reachable);
+	}
+
+	os << "],\n\"edges\":[";
+	bool first_edge = true;
+	for (size_t id = 1; id < nodes_.size(); id++)
+	{
+		for (auto ref: nodes_[id].references)
+		{
+			os << std::format("{}[{},{}]", first_edge ? "" : ",", id, ref);
+			first_edge = false;
+		}
+	}
+
+	os << "],\n\"roots\":[";
+	for (bool first = true; auto ref: nodes_[ROOT].references)
+	{
+		os << std::format("{}{}", first ? "" : ",", ref);
+		first = false;
+	}
+
+	os << "]}" << endl;
+}
+
+void heap_inspector::build_graph()
+{
+	nodes_.clear();
+	nodes_.resize(1); // the root
+
+	unordered_map<object_raw_pointer, size_t> ids{};
+	for (auto obj: heap_->objects_)
+	{
+		ids[obj] = nodes_.size();
+		nodes_.push_back(node{ .obj=obj, .size=obj->allocated_size_ });
+	}
+
+	auto gc = heap_->gc_;
+
+	const auto add_edge = [this, &ids](size_t from)
+	{
+		return [this, &ids, from](object_raw_pointer obj)
+		{
+			auto iter = ids.find(obj);
+			if (iter == ids.end())return; // not of this heap
+
+			nodes_[from].references.push_back(iter->second);
+			nodes_[iter->second].referrers.push_back(from);
+		};
+	};
+
+	gc->for_each_root(add_edge(ROOT));
+
+	for (size_t id = 1; id < nodes_.size(); id++)
+	{
+		gc->for_each_reference(nodes_[id].obj, add_edge(id));
+	}
+}
+
+void heap_inspector::compute_dominators()
+{
+	reverse_postorder_.clear();
+
+	// iterative depth-first search, numbering nodes in postorder
+	vector<pair<size_t, size_t>> stack{ { ROOT, 0 }};
+	nodes_[ROOT].reachable = true;
+
+	while (!stack.empty())
+	{
+		auto& [id, next] = stack.back();
+		if (next < nodes_[id].references.size())
+		{
+			auto ref = nodes_[id].references[next++];
+			if (!nodes_[ref].reachable)
+			{
+				nodes_[ref].reachable = true;
+				stack.emplace_back(ref, 0);
+			}
+		}
+		else
+		{
+			nodes_[id].postorder = reverse_postorder_.size();
+			reverse_postorder_.push_back(id);
+			stack.pop_back();
+		}
+	}
+
+	ranges::reverse(reverse_postorder_);
+
+	constexpr size_t UNDEFINED = numeric_limits<size_t>::max();
+	for (auto& n: nodes_)
+	{
+		n.dominator = UNDEFINED;
+	}
+	nodes_[ROOT].dominator = ROOT;
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+
+		for (auto id: reverse_postorder_)
+		{
+			if (id == ROOT)continue;
+
+			auto new_dominator = UNDEFINED;
+			for (auto pred: nodes_[id].referrers)
+			{
+				if (!nodes_[pred].reachable || nodes_[pred].dominator == UNDEFINED)continue;
+
+				new_dominator = new_dominator == UNDEFINED ? pred : intersect(pred, new_dominator);
+			}
+
+			if (nodes_[id].dominator != new_dominator)
+			{
+				nodes_[id].dominator = new_dominator;
+				changed = true;
+			}
+		}
+	}
+}
+
+size_t heap_inspector::intersect(size_t a, size_t b) const
+{
+	while (a != b)
+	{
+		while (nodes_[a].postorder < nodes_[b].postorder)
+		{
+			a = nodes_[a].dominator;
+		}
+
+		while (nodes_[b].postorder < nodes_[a].postorder)
+		{
+			b = nodes_[b].dominator;
+		}
+	}
+
+	return a;
+}
+
+std::string heap_inspector::name_of(object_raw_pointer obj)
+{
+	switch (obj->type())
+	{
+	case object_type::STRING:
+	{
+		auto str = static_cast<string_object_raw_pointer>(obj)->string();
+		return str.size() > NAME_LENGTH_LIMIT ? str.substr(0, NAME_LENGTH_LIMIT) + "..." : str;
+	}
+	case object_type::FUNCTION:
+		return static_cast<function_object_raw_pointer>(obj)->name();
+	case object_type::CLOSURE:
+		return static_cast<closure_object_raw_pointer>(obj)->function()->name();
+	case object_type::OBJECT:
+		return static_cast<class_object_raw_pointer>(obj)->printable_string();
+	case object_type::INSTANCE:
+		return static_cast<instance_object_raw_pointer>(obj)->class_object()->printable_string();
+	default:
+		return "";
+	}
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/4/2022.
+//
+
+#include <interpreter/vm/heap_snapshot.h>
+#include <interpreter/vm/heap_image.h>
+#include <interpreter/vm/binary_stream.h>
+#include <interpreter/vm/exceptions.h>
+
+#include <helper/mapped_file.h>
+
+using namespace std;
+
+using namespace clox::helper;
+using namespace clox::interpreting;
+using namespace clox::interpreting::vm;
+
+bool clox::interpreting::vm::heap_snapshot::save(const string& path, virtual_machine& vm,
+		const vector<std::string>& prelude_sources)
+{
+	binary_writer writer{};
+
+	writer.write(MAGIC);
+	writer.write(VERSION);
+	writer.write<uint32_t>(sizeof(floating_value_type));
+
+	writer.write<uint64_t>(prelude_sources.size());
+	for (const auto& src: prelude_sources)
+	{
+		writer.write(std::string_view{ src });
+	}
+
+	try
+	{
+		heap_image_writer image{};
+
+		for (const auto& global: vm.globals_)
+		{
+			image.add(global.second);
+		}
+
+		for (const auto& func: vm.functions_)
+		{
+			image.add(func.second);
+		}
+
+		image.write_objects(writer);
+
+		writer.write<uint64_t>(vm.globals_.size());
+		for (const auto& [name, val]: vm.globals_)
+		{
+			writer.write(std::string_view{ name });
+			image.write_value(writer, val);
+		}
+
+		writer.write<uint64_t>(vm.functions_.size());
+		for (const auto& [id, val]: vm.functions_)
+		{
+			writer.write(id);
+			image.write_value(writer, val);
+		}
+	}
+	catch (const invalid_binary_image&)
+	{
+		return false;
+	}
+
+	return writer.save(path);
+}
+
+std::optional<std::vector<std::string>> clox::interpreting::vm::heap_snapshot::load(const string& path,
+		virtual_machine& vm)
+{
+	mapped_file file{ path };
+	if (!file.valid())
+	{
+		return nullopt;
+	}
+
+	try
+	{
+		binary_reader reader{ file.data() };
+
+		if (reader.read<uint32_t>() != MAGIC ||
+			reader.read<uint32_t>() != VERSION ||
+			reader.read<uint32_t>() != sizeof(floating_value_type))
+		{
+			return nullopt;
+		}
+
+		vector<string> prelude_sources{};
+		for (auto count = reader.read<uint64_t>(); count > 0; count--)
+		{
+			prelude_sources.push_back(reader.read_string());
+		}
+
+		heap_image_reader image{ vm.heap_ };
+		image.read_objects(reader);
+
+		virtual_machine::global_table_type globals{};
+		for (auto count = reader.read<uint64_t>(); count > 0; count--)
+		{
+			auto name = reader.read_string();
+			globals.insert_or_assign(name, image.read_value(reader));
+		}
+
+		virtual_machine::function_table_type functions{};
+		for (auto count = reader.read<uint64_t>(); count > 0; count--)
+		{
+			auto id = reader.read<full_opcode_type>();
+			functions.insert_or_assign(id, image.read_value(reader));
+		}
+
+		if (!reader.done())
+		{
+			throw invalid_binary_image{ "trailing data" };
+		}
+
+		vm.globals_ = std::move(globals);
+		vm.functions_ = std::move(functions);
+
+		// natives added after the snapshot was taken
+		vm.load_native_functions();
+
+		return prelude_sources;
+	}
+	catch (const invalid_binary_image&)
+	{
+		// the loaded objects are unreachable, and will be reclaimed by the GC
+		return nullopt;
+	}
+}
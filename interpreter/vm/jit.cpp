@@ -0,0 +1,723 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/15/2022.
+//
+
+#include <interpreter/vm/jit.h>
+#include <interpreter/vm/vm.h>
+
+#include <cstring>
+#include <format>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#define CLOX_JIT_X86_64
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#endif
+
+using namespace std;
+
+using namespace clox::interpreting;
+using namespace clox::interpreting::vm;
+
+namespace
+{
+
+/// \brief the few x86-64 instructions the baseline JIT is made of.
+/// rbx holds the context through the code, for it is preserved across the calls to stubs.
+class x86_64_emitter final
+{
+public:
+	[[nodiscard]] size_t size() const
+	{
+		return code_.size();
+	}
+
+	[[nodiscard]] const vector<uint8_t>& code() const
+	{
+		return code_;
+	}
+
+	/// \brief push rbx; mov rbx, rdi; jmp rsi
+	void prologue()
+	{
+		bytes({ 0x53, 0x48, 0x89, 0xFB, 0xFF, 0xE6 });
+	}
+
+	/// \brief pop rbx; ret
+	void epilogue()
+	{
+		bytes({ 0x5B, 0xC3 });
+	}
+
+	/// \brief mov rdi, rbx; mov rsi, operand; mov edx, offset; mov rax, stub; call rax
+	void call_stub(baseline_jit::stub_type stub, uint64_t operand, uint32_t offset)
+	{
+		bytes({ 0x48, 0x89, 0xDF });
+
+		bytes({ 0x48, 0xBE });
+		imm64(operand);
+
+		bytes({ 0xBA });
+		imm32(offset);
+
+		bytes({ 0x48, 0xB8 });
+		imm64(reinterpret_cast<uint64_t>(stub));
+
+		bytes({ 0xFF, 0xD0 });
+	}
+
+	/// \brief test eax, eax; jnz rel32
+	/// \return position of the displacement to patch
+	size_t jump_if_nonzero()
+	{
+		bytes({ 0x85, 0xC0, 0x0F, 0x85 });
+		imm32(0);
+		return size() - sizeof(uint32_t);
+	}
+
+	/// \brief jmp rel32
+	/// \return position of the displacement to patch
+	size_t jump()
+	{
+		bytes({ 0xE9 });
+		imm32(0);
+		return size() - sizeof(uint32_t);
+	}
+
+	void patch(size_t displacement, size_t target)
+	{
+		auto rel = static_cast<int32_t>(static_cast<int64_t>(target) -
+										static_cast<int64_t>(displacement + sizeof(uint32_t)));
+		memcpy(code_.data() + displacement, &rel, sizeof(rel));
+	}
+
+private:
+	void bytes(initializer_list<uint8_t> bs)
+	{
+		code_.insert(code_.end(), bs);
+	}
+
+	void imm32(uint32_t imm)
+	{
+		auto begin = reinterpret_cast<const uint8_t*>(&imm);
+		code_.insert(code_.end(), begin, begin + sizeof(imm));
+	}
+
+	void imm64(uint64_t imm)
+	{
+		auto begin = reinterpret_cast<const uint8_t*>(&imm);
+		code_.insert(code_.end(), begin, begin + sizeof(imm));
+	}
+
+	vector<uint8_t> code_{};
+};
+
+}
+
+executable_memory::executable_memory(const vector<uint8_t>& code)
+{
+#ifdef CLOX_JIT_X86_64
+	auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	auto size = (code.size() + page - 1) / page * page;
+
+	auto mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED)
+	{
+		return;
+	}
+
+	memcpy(mem, code.data(), code.size());
+
+	// never writable and executable at the same time
+	if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(mem, size);
+		return;
+	}
+
+	data_ = static_cast<uint8_t*>(mem);
+	size_ = size;
+#endif
+}
+
+executable_memory::~executable_memory()
+{
+#ifdef CLOX_JIT_X86_64
+	if (data_)
+	{
+		munmap(data_, size_);
+	}
+#endif
+}
+
+executable_memory::executable_memory(executable_memory&& other) noexcept
+	: data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+{
+}
+
+executable_memory& executable_memory::operator=(executable_memory&& other) noexcept
+{
+	swap(data_, other.data_);
+	swap(size_, other.size_);
+	return *this;
+}
+
+bool baseline_jit::available()
+{
+#ifdef CLOX_JIT_X86_64
+	return true;
+#else
+	return false;
+#endif
+}
+
+baseline_jit::baseline_jit(virtual_machine& vm, tiering_policy policy, helper::console& cons)
+	: vm_(&vm), policy_(policy), cons_(&cons)
+{
+}
+
+baseline_jit::~baseline_jit()
+{
+	if (policy_.observe)
+	{
+		report();
+	}
+}
+
+baseline_jit::profile& baseline_jit::profile_of(const function_object* func)
+{
+	auto body = func->body();
+
+	auto& prof = profiles_[body.get()];
+	if (!prof.body)
+	{
+		prof.body = body;
+		prof.name = func->name().empty() ? "<script>" : func->name();
+	}
+
+	return prof;
+}
+
+void baseline_jit::count_call(const function_object* func)
+{
+	auto& prof = profile_of(func);
+	if (++prof.calls >= policy_.call_threshold)
+	{
+		tier_up(prof, "calls");
+	}
+}
+
+bool baseline_jit::count_backedges(const function_object* func, size_t count)
+{
+	auto& prof = profile_of(func);
+	if ((prof.backedges += count) >= policy_.backedge_threshold)
+	{
+		tier_up(prof, "loop iterations");
+	}
+
+	// nothing to wait for before the function is hot
+	if (prof.pending.valid())
+	{
+		poll(prof);
+	}
+
+	if (!is_runnable(prof))
+	{
+		return false;
+	}
+
+	prof.replacements++;
+	return true;
+}
+
+void baseline_jit::tier_up(profile& prof, const char* reason)
+{
+	if (prof.compiled || prof.pending.valid())
+	{
+		return; // hot for the other reason already
+	}
+
+	if (policy_.observe)
+	{
+		cons_->log() << std::format("[tiering] {} is hot after {} {}\n", prof.name,
+			reason == string_view{ "calls" } ? prof.calls : prof.backedges, reason);
+	}
+
+	if (policy_.background)
+	{
+		// chunks of running code are never changed, so the compiler may read them on any thread
+		prof.pending = std::async(launch::async, timed_compile, std::ref(*prof.body));
+	}
+	else
+	{
+		auto [compiled, time] = timed_compile(*prof.body);
+		install(prof, std::move(compiled), time);
+	}
+}
+
+void baseline_jit::poll(profile& prof)
+{
+	if (prof.pending.valid() && prof.pending.wait_for(chrono::seconds{ 0 }) == future_status::ready)
+	{
+		auto [compiled, time] = prof.pending.get();
+		install(prof, std::move(compiled), time);
+	}
+}
+
+bool baseline_jit::is_runnable(const profile& prof)
+{
+	return prof.compiled && !prof.compiled->code.empty();
+}
+
+void baseline_jit::install(profile& prof, optional<compiled_function> compiled, chrono::microseconds time)
+{
+	prof.compile_time = time;
+
+	// a function failing to compile keeps an empty one, so it is never tried again
+	prof.compiled = std::move(compiled).value_or(compiled_function{});
+
+	if (policy_.observe)
+	{
+		cons_->log() << std::format("[tiering] {} {} in {}us\n", prof.name,
+			is_runnable(prof) ? "compiled to machine code" : "can not be compiled", time.count());
+	}
+}
+
+void baseline_jit::report()
+{
+	cons_->log() << std::format("[tiering] {:<24} {:>10} {:>12} {:>8} {:>12}  {}\n",
+		"function", "calls", "backedges", "osr", "compile(us)", "tier");
+
+	for (auto& [_, prof]: profiles_)
+	{
+		const char* tier = "interpreter";
+		if (prof.pending.valid())
+		{
+			tier = "compiling";
+		}
+		else if (prof.compiled)
+		{
+			tier = is_runnable(prof) ? "machine code" : "interpreter (failed)";
+		}
+
+		cons_->log() << std::format("[tiering] {:<24} {:>10} {:>12} {:>8} {:>12}  {}\n",
+			prof.name, prof.calls, prof.backedges, prof.replacements, prof.compile_time.count(), tier);
+	}
+}
+
+optional<tuple<optional<virtual_machine_status>, bool>> baseline_jit::run()
+{
+	auto& frame = vm_->top_call_frame();
+	auto body = frame.function()->body();
+
+	auto iter = profiles_.find(body.get());
+	if (iter == profiles_.end())
+	{
+		return nullopt;
+	}
+
+	if (iter->second.pending.valid())
+	{
+		poll(iter->second);
+	}
+
+	if (!is_runnable(iter->second))
+	{
+		return nullopt;
+	}
+
+	// nodes of the map stay where they are even if other functions are compiled while this runs
+	const auto& compiled = iter->second.compiled.value();
+
+	auto offset = frame.ip() - body->begin();
+	if (offset < 0 || static_cast<size_t>(offset) >= compiled.entries.size() || compiled.entries[offset] < 0)
+	{
+		return nullopt;
+	}
+
+	context ctx{ .vm = vm_, .depth = vm_->call_frames_.size(), .body = body.get() };
+
+	auto entry = reinterpret_cast<entry_type>(compiled.code.data());
+	entry(&ctx, compiled.code.data() + compiled.entries[offset]);
+
+	if (ctx.error)
+	{
+		rethrow_exception(ctx.error);
+	}
+
+	return tuple{ ctx.status, ctx.exit };
+}
+
+tuple<optional<baseline_jit::compiled_function>, chrono::microseconds> baseline_jit::timed_compile(chunk& body)
+{
+	auto start = chrono::steady_clock::now();
+	auto compiled = compile(body);
+	return { std::move(compiled), chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start) };
+}
+
+optional<baseline_jit::compiled_function> baseline_jit::compile(chunk& body)
+{
+#ifdef CLOX_JIT_X86_64
+	x86_64_emitter emitter{};
+
+	emitter.prologue();
+
+	auto exit = emitter.size();
+	emitter.epilogue();
+
+	compiled_function ret{ .entries = vector<int64_t>(body.count() + 1, -1) };
+
+	vector<size_t> leaves{};
+	vector<pair<size_t, uint64_t>> branches{}; // displacements and the bytecode offsets they go to
+
+	auto body_operand = reinterpret_cast<uint64_t>(&body);
+
+	auto emit = [&](stub_type stub, uint64_t operand, uint64_t offset)
+	{
+		emitter.call_stub(stub, operand, static_cast<uint32_t>(offset));
+		leaves.push_back(emitter.jump_if_nonzero());
+	};
+
+	for (uint64_t offset = 0; offset < body.count();)
+	{
+		ret.entries[offset] = static_cast<int64_t>(emitter.size());
+
+		auto decoded = body.decode_instruction(offset);
+		auto secondary = secondary_op_code_of(decoded.instruction);
+
+		switch (main_op_code_of(decoded.instruction))
+		{
+		case op_code::JUMP:
+			branches.emplace_back(emitter.jump(), decoded.next_offset + decoded.operands[0]);
+			break;
+
+		case op_code::LOOP:
+			branches.emplace_back(emitter.jump(), decoded.next_offset - decoded.operands[0]);
+			break;
+
+		case op_code::JUMP_IF_FALSE:
+			emitter.call_stub(is_false, 0, static_cast<uint32_t>(offset));
+			branches.emplace_back(emitter.jump_if_nonzero(), decoded.next_offset + decoded.operands[0]);
+			break;
+
+		case op_code::CONSTANT:
+			// constants are never added to a chunk which already runs, so they stay where they are
+			emit(push_constant, reinterpret_cast<uint64_t>(&body.constant_at(decoded.operands[0])), offset);
+			break;
+
+		case op_code::CONSTANT_NIL:
+			emit(push_nil, 0, offset);
+			break;
+
+		case op_code::CONSTANT_TRUE:
+			emit(push_true, 0, offset);
+			break;
+
+		case op_code::CONSTANT_FALSE:
+			emit(push_false, 0, offset);
+			break;
+
+		case op_code::POP:
+			emit(pop, 0, offset);
+			break;
+
+		case op_code::GET:
+			if (!(secondary & SEC_OP_GLOBAL) && (secondary & SEC_OP_LOCAL))
+			{
+				emit(get_local, decoded.operands[0], offset);
+			}
+			else
+			{
+				emit(run_instruction, body_operand, offset);
+			}
+			break;
+
+		case op_code::SET:
+			if (!(secondary & SEC_OP_GLOBAL) && (secondary & SEC_OP_LOCAL))
+			{
+				emit(set_local, decoded.operands[0], offset);
+			}
+			else
+			{
+				emit(run_instruction, body_operand, offset);
+			}
+			break;
+
+#define SPECIALIZED_BINARY(op) \
+        case op_code::op: \
+            if (secondary & (SEC_OP_INTEGER | SEC_OP_FLOATING)) \
+            { \
+                emit(specialized_binary<op_code::op>, secondary, offset); \
+            } \
+            else \
+            { \
+                emit(run_instruction, body_operand, offset); \
+            } \
+            break;
+
+		SPECIALIZED_BINARY(ADD)
+		SPECIALIZED_BINARY(SUBTRACT)
+		SPECIALIZED_BINARY(MULTIPLY)
+		SPECIALIZED_BINARY(LESS)
+		SPECIALIZED_BINARY(LESS_EQUAL)
+		SPECIALIZED_BINARY(GREATER)
+		SPECIALIZED_BINARY(GREATER_EQUAL)
+		SPECIALIZED_BINARY(EQUAL)
+
+#undef SPECIALIZED_BINARY
+
+		default:
+			emit(run_instruction, body_operand, offset);
+			break;
+		}
+
+		offset = decoded.next_offset;
+	}
+
+	// falling off the end of the bytecode
+	ret.entries[body.count()] = static_cast<int64_t>(emitter.size());
+	emit(leave_at, body_operand, body.count());
+
+	for (auto leave: leaves)
+	{
+		emitter.patch(leave, exit);
+	}
+
+	for (const auto& [displacement, target]: branches)
+	{
+		if (target >= ret.entries.size() || ret.entries[target] < 0)
+		{
+			return nullopt; // not the start of an instruction
+		}
+
+		emitter.patch(displacement, static_cast<size_t>(ret.entries[target]));
+	}
+
+	ret.code = executable_memory{ emitter.code() };
+	if (ret.code.empty())
+	{
+		return nullopt;
+	}
+
+	return ret;
+#else
+	return nullopt;
+#endif
+}
+
+uint32_t baseline_jit::run_instruction(context* ctx, uint64_t body, uint32_t offset) noexcept
+{
+	try
+	{
+		auto& vm = *ctx->vm;
+		auto& frame = vm.top_call_frame();
+
+		frame.ip() = reinterpret_cast<chunk*>(body)->begin() + offset;
+
+		auto instruction = chunk::read_instruction(frame.ip());
+		auto [status, exit] = vm.run_code(instruction, frame);
+		if (exit)
+		{
+			ctx->status = status;
+			ctx->exit = true;
+			return STUB_LEAVE;
+		}
+
+		// calls and returns are dispatched by the interpreter, which enters the code of the new frame if there is
+		return vm.call_frames_.size() == ctx->depth ? STUB_CONTINUE : STUB_LEAVE;
+	}
+	catch (...)
+	{
+		ctx->error = current_exception();
+		return STUB_LEAVE;
+	}
+}
+
+uint32_t baseline_jit::leave_at(context* ctx, uint64_t body, uint32_t offset) noexcept
+{
+	ctx->vm->top_call_frame().ip() = reinterpret_cast<chunk*>(body)->begin() + offset;
+	return STUB_LEAVE;
+}
+
+void baseline_jit::sync_ip(context* ctx, uint32_t offset) noexcept
+{
+	ctx->vm->top_call_frame().ip() = ctx->body->begin() + offset;
+}
+
+uint32_t baseline_jit::push_constant(context* ctx, uint64_t constant, uint32_t offset) noexcept
+{
+	try
+	{
+		sync_ip(ctx, offset);
+		ctx->vm->push(*reinterpret_cast<const value*>(constant));
+		return STUB_CONTINUE;
+	}
+	catch (...)
+	{
+		ctx->error = current_exception();
+		return STUB_LEAVE;
+	}
+}
+
+uint32_t baseline_jit::push_nil(context* ctx, uint64_t operand, uint32_t offset) noexcept
+{
+	try
+	{
+		sync_ip(ctx, offset);
+		ctx->vm->push(scanning::nil_value_tag);
+		return STUB_CONTINUE;
+	}
+	catch (...)
+	{
+		ctx->error = current_exception();
+		return STUB_LEAVE;
+	}
+}
+
+uint32_t baseline_jit::push_true(context* ctx, uint64_t operand, uint32_t offset) noexcept
+{
+	try
+	{
+		sync_ip(ctx, offset);
+		ctx->vm->push(true);
+		return STUB_CONTINUE;
+	}
+	catch (...)
+	{
+		ctx->error = current_exception();
+		return STUB_LEAVE;
+	}
+}
+
+uint32_t baseline_jit::push_false(context* ctx, uint64_t operand, uint32_t offset) noexcept
+{
+	try
+	{
+		sync_ip(ctx, offset);
+		ctx->vm->push(false);
+		return STUB_CONTINUE;
+	}
+	catch (...)
+	{
+		ctx->error = current_exception();
+		return STUB_LEAVE;
+	}
+}
+
+uint32_t baseline_jit::pop(context* ctx, uint64_t operand, uint32_t offset) noexcept
+{
+	sync_ip(ctx, offset);
+	ctx->vm->pop();
+	return STUB_CONTINUE;
+}
+
+uint32_t baseline_jit::get_local(context* ctx, uint64_t slot, uint32_t offset) noexcept
+{
+	try
+	{
+		sync_ip(ctx, offset);
+
+		auto& vm = *ctx->vm;
+		vm.push(vm.slot_at(vm.top_call_frame(), slot));
+		return STUB_CONTINUE;
+	}
+	catch (...)
+	{
+		ctx->error = current_exception();
+		return STUB_LEAVE;
+	}
+}
+
+uint32_t baseline_jit::set_local(context* ctx, uint64_t slot, uint32_t offset) noexcept
+{
+	sync_ip(ctx, offset);
+
+	auto& vm = *ctx->vm;
+	vm.slot_at(vm.top_call_frame(), slot) = vm.peek(0);
+	return STUB_CONTINUE;
+}
+
+uint32_t baseline_jit::is_false(context* ctx, uint64_t operand, uint32_t offset) noexcept
+{
+	sync_ip(ctx, offset);
+	return ctx->vm->is_false(ctx->vm->peek(0)) ? 1 : 0;
+}
+
+template<op_code Op>
+uint32_t baseline_jit::specialized_binary(context* ctx, uint64_t secondary, uint32_t offset) noexcept
+{
+	sync_ip(ctx, offset);
+
+	auto& vm = *ctx->vm;
+	auto sec = static_cast<secondary_opcode_base_type>(secondary);
+
+	bool done{ false };
+	if constexpr (Op == op_code::ADD)
+	{
+		done = vm.specialized_binary_op(sec, std::plus<>{});
+	}
+	else if constexpr (Op == op_code::SUBTRACT)
+	{
+		done = vm.specialized_binary_op(sec, std::minus<>{});
+	}
+	else if constexpr (Op == op_code::MULTIPLY)
+	{
+		done = vm.specialized_binary_op(sec, std::multiplies<>{});
+	}
+	else if constexpr (Op == op_code::LESS)
+	{
+		done = vm.specialized_binary_op(sec, std::less<>{});
+	}
+	else if constexpr (Op == op_code::LESS_EQUAL)
+	{
+		done = vm.specialized_binary_op(sec, std::less_equal<>{});
+	}
+	else if constexpr (Op == op_code::GREATER)
+	{
+		done = vm.specialized_binary_op(sec, std::greater<>{});
+	}
+	else if constexpr (Op == op_code::GREATER_EQUAL)
+	{
+		done = vm.specialized_binary_op(sec, std::greater_equal<>{});
+	}
+	else if constexpr (Op == op_code::EQUAL)
+	{
+		done = vm.specialized_binary_op(sec, std::equal_to<>{});
+	}
+
+	if (done)
+	{
+		return STUB_CONTINUE;
+	}
+
+	// operands other than expected, which promote or raise the same as the interpreter
+	return run_instruction(ctx, reinterpret_cast<uint64_t>(ctx->body), offset);
+}
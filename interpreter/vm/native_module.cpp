@@ -0,0 +1,212 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/16/2022.
+//
+
+#include <interpreter/vm/native_module.h>
+
+#include <gsl/gsl>
+
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <utility>
+
+#if defined(__linux__)
+
+#define CLOX_NATIVE_MODULE
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#endif
+
+using namespace std;
+
+using namespace clox::interpreting::vm;
+
+native_module::~native_module()
+{
+#ifdef CLOX_NATIVE_MODULE
+	if (handle_)
+	{
+		dlclose(handle_);
+	}
+#endif
+}
+
+native_module::native_module(native_module&& other) noexcept
+	: handle_(std::exchange(other.handle_, nullptr))
+{
+}
+
+native_module& native_module::operator=(native_module&& other) noexcept
+{
+	swap(handle_, other.handle_);
+	return *this;
+}
+
+bool native_module::available()
+{
+#ifdef CLOX_NATIVE_MODULE
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::optional<native_module> native_module::build(const string& source)
+{
+#ifdef CLOX_NATIVE_MODULE
+	// a directory only we can write to, so neither file can be replaced or linked elsewhere before it is loaded
+	auto dir_template = (filesystem::temp_directory_path() / "clox_aot_XXXXXX").string();
+	if (!mkdtemp(dir_template.data()))
+	{
+		return nullopt;
+	}
+
+	const filesystem::path dir{ dir_template };
+	auto _ = gsl::finally([&dir]
+	{
+		// the loaded object stays mapped after its file is gone
+		error_code ec{};
+		filesystem::remove_all(dir, ec);
+	});
+
+	auto c_path = (dir / "module.c").string(), so_path = (dir / "module.so").string();
+	if (!write_source(c_path, source))
+	{
+		return nullopt;
+	}
+
+	vector<string> args{ compiler() };
+	if (args.empty())
+	{
+		return nullopt;
+	}
+
+	args.insert(args.end(), { "-O2", "-shared", "-fPIC", "-o", so_path, c_path, "-lm" });
+	if (!run_compiler(args))
+	{
+		return nullopt;
+	}
+
+	native_module ret{};
+	ret.handle_ = dlopen(so_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (!ret.handle_)
+	{
+		return nullopt;
+	}
+
+	return ret;
+#else
+	return nullopt;
+#endif
+}
+
+#ifdef CLOX_NATIVE_MODULE
+
+vector<string> native_module::compiler()
+{
+	// CC may carry a launcher or flags, like "ccache gcc", but is never run by a shell
+	auto cc = getenv("CC");
+
+	vector<string> ret{};
+	istringstream ss{ cc && *cc ? cc : "cc" };
+	for (string word{}; ss >> word;)
+	{
+		ret.push_back(std::move(word));
+	}
+
+	return ret;
+}
+
+bool native_module::write_source(const string& path, const string& source)
+{
+	auto fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	auto _ = gsl::finally([fd]
+	{
+		close(fd);
+	});
+
+	for (size_t written = 0; written < source.size();)
+	{
+		auto n = write(fd, source.data() + written, source.size() - written);
+		if (n < 0)
+		{
+			if (errno == EINTR)continue;
+			return false;
+		}
+		written += static_cast<size_t>(n);
+	}
+
+	return true;
+}
+
+bool native_module::run_compiler(const vector<string>& args)
+{
+	vector<char*> argv{};
+	for (const auto& arg: args)
+	{
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	argv.push_back(nullptr);
+
+	pid_t pid{};
+	if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0)
+	{
+		return false;
+	}
+
+	int status{ 0 };
+	while (waitpid(pid, &status, 0) < 0)
+	{
+		if (errno != EINTR)
+		{
+			return false;
+		}
+	}
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+#endif
+
+native_entry_type native_module::entry(const string& symbol) const
+{
+#ifdef CLOX_NATIVE_MODULE
+	return handle_ ? reinterpret_cast<native_entry_type>(dlsym(handle_, symbol.c_str())) : nullptr;
+#else
+	return nullptr;
+#endif
+}
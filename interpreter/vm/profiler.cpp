@@ -0,0 +1,235 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/17/2022.
+//
+
+#include <interpreter/vm/profiler.h>
+
+#include "object/function_object.h"
+
+#include <algorithm>
+#include <format>
+#include <ranges>
+
+using namespace std;
+
+using namespace clox::interpreting::vm;
+
+namespace
+{
+
+double milliseconds_of(execution_profiler::clock_type::duration time)
+{
+	return chrono::duration<double, milli>{ time }.count();
+}
+
+double percent_of(uint64_t part, uint64_t whole)
+{
+	return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+}
+
+execution_profiler::function_profile& execution_profiler::profile_of(const function_object* func)
+{
+	auto body = func->body();
+
+	auto& prof = functions_[body.get()];
+	if (!prof.body)
+	{
+		prof.body = body;
+		prof.name = func->name().empty() ? "<script>" : func->name();
+	}
+
+	return prof;
+}
+
+void execution_profiler::enter(const function_object* func, const function_object* caller,
+		optional<chunk::iterator_type> caller_ip)
+{
+	auto& prof = profile_of(func);
+	prof.calls++;
+	prof.active++;
+
+	if (caller && caller_ip)
+	{
+		auto& caller_prof = profile_of(caller);
+		call_sites_[{ &caller_prof, caller_ip.value() - caller_prof.body->begin(), &prof }]++;
+	}
+
+	auto parent = frames_.empty() ? 0 : frames_.back().node;
+
+	size_t node{};
+	if (auto iter = stack_nodes_[parent].children.find(&prof);iter != stack_nodes_[parent].children.end())
+	{
+		node = iter->second;
+	}
+	else
+	{
+		node = stack_nodes_.size();
+		stack_nodes_.push_back(stack_node{ .parent = parent, .func = &prof });
+		stack_nodes_[parent].children.insert_or_assign(&prof, node);
+	}
+
+	frames_.push_back(active_frame{
+			.func = &prof,
+			.node = node,
+			.start = clock_type::now(),
+			.start_instructions = instructions_ });
+}
+
+void execution_profiler::leave()
+{
+	if (frames_.empty())
+	{
+		return;
+	}
+
+	auto frame = frames_.back();
+	frames_.pop_back();
+
+	auto time = clock_type::now() - frame.start;
+
+	frame.func->self_time += time - frame.callee_time;
+
+	// the outermost frame of a recursion covers all the inner ones
+	if (--frame.func->active == 0)
+	{
+		frame.func->total_time += time;
+		frame.func->total_instructions += instructions_ - frame.start_instructions;
+	}
+
+	if (!frames_.empty())
+	{
+		frames_.back().callee_time += time;
+	}
+}
+
+void execution_profiler::finish()
+{
+	while (!frames_.empty())
+	{
+		leave();
+	}
+}
+
+void execution_profiler::report(std::ostream& os)
+{
+	finish();
+
+	os << std::format("[profile] {} instructions\n", instructions_);
+
+	// opcodes, each one with its secondary opcode, and in total
+	unordered_map<op_code, uint64_t> main_opcodes{};
+	for (const auto& [code, count]: opcodes_)
+	{
+		main_opcodes[main_op_code_of(code)] += count;
+	}
+
+	vector<pair<op_code, uint64_t>> mains{ main_opcodes.begin(), main_opcodes.end() };
+	ranges::sort(mains, greater{}, &pair<op_code, uint64_t>::second);
+
+	os << std::format("[profile] {:<24} {:>14} {:>8}\n", "opcode", "count", "%");
+	for (const auto& [op, count]: mains)
+	{
+		os << std::format("[profile] {:<24} {:>14} {:>8.2f}\n", op, count, percent_of(count, instructions_));
+	}
+
+	vector<pair<full_opcode_type, uint64_t>> fulls{ opcodes_.begin(), opcodes_.end() };
+	ranges::sort(fulls, greater{}, &pair<full_opcode_type, uint64_t>::second);
+
+	os << std::format("[profile] {:<24} {:>10} {:>14} {:>8}\n", "opcode", "secondary", "count", "%");
+	for (const auto& [code, count]: fulls)
+	{
+		os << std::format("[profile] {:<24} {:>#10x} {:>14} {:>8.2f}\n", main_op_code_of(code),
+				secondary_op_code_of(code), count, percent_of(count, instructions_));
+	}
+
+	// functions by the instructions run in them
+	vector<const function_profile*> funcs{};
+	for (const auto& [_, prof]: functions_)
+	{
+		funcs.push_back(&prof);
+	}
+
+	ranges::sort(funcs, greater{}, &function_profile::self_instructions);
+
+	os << std::format("[profile] {:<24} {:>10} {:>14} {:>14} {:>12} {:>12}\n", "function", "calls",
+			"self instr", "total instr", "self ms", "total ms");
+	for (auto prof: funcs)
+	{
+		os << std::format("[profile] {:<24} {:>10} {:>14} {:>14} {:>12.3f} {:>12.3f}\n", prof->name, prof->calls,
+				prof->self_instructions, prof->total_instructions, milliseconds_of(prof->self_time),
+				milliseconds_of(prof->total_time));
+	}
+
+	// call sites by calls
+	vector<pair<tuple<function_profile*, int64_t, function_profile*>, uint64_t>> sites{ call_sites_.begin(),
+			call_sites_.end() };
+	ranges::stable_sort(sites, greater{}, [](const auto& site)
+	{
+		return site.second;
+	});
+
+	os << std::format("[profile] {:<40} {:<24} {:>10}\n", "call site", "callee", "calls");
+	for (const auto& [site, count]: sites)
+	{
+		auto [caller, offset, callee] = site;
+		auto line = caller->body->line_of(caller->body->begin() + offset);
+
+		os << std::format("[profile] {:<40} {:<24} {:>10}\n", std::format("{} (line {})", caller->name, line),
+				callee->name, count);
+	}
+}
+
+void execution_profiler::write_collapsed_stacks(std::ostream& os)
+{
+	finish();
+
+	for (size_t i = 1; i < stack_nodes_.size(); i++)
+	{
+		if (!stack_nodes_[i].self_instructions)
+		{
+			continue;
+		}
+
+		vector<const string*> names{};
+		for (auto node = i; node != 0; node = stack_nodes_[node].parent)
+		{
+			names.push_back(&stack_nodes_[node].func->name);
+		}
+
+		string line{};
+		for (const auto& name: names | views::reverse)
+		{
+			if (!line.empty())
+			{
+				line += ';';
+			}
+			line += *name;
+		}
+
+		os << std::format("{} {}\n", line, stack_nodes_[i].self_instructions);
+	}
+}
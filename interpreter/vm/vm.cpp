@@ -24,9 +24,11 @@
 
 #include <base/configuration.h>
 #include <helper/exceptions.h>
+#include <helper/time_statistic.h>
 
 #include <interpreter/vm/vm.h>
 #include <interpreter/vm/exceptions.h>
+#include <interpreter/vm/jit.h>
 #include <interpreter/vm/opcode.h>
 
 #include "object/string_object.h"
@@ -41,6 +43,11 @@
 
 #include "../../native/include/native/native_manager.h"
 
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <utility>
+
 #include <gsl/gsl>
 
 #define DEBUG_NO_CATCH
@@ -54,26 +61,157 @@ using namespace clox::interpreting;
 using namespace clox::interpreting::vm;
 
 virtual_machine::virtual_machine(clox::helper::console &cons,
-								 std::shared_ptr<object_heap> heap)
+								 std::shared_ptr<object_heap> heap,
+								 bool load_natives)
 	: heap_(std::move(heap)), cons_(&cons)
 {
 	stack_.reserve(STACK_RESERVED_SIZE);
 	call_frames_.reserve(CALL_STACK_RESERVED_SIZE);
 
-	load_native_functions();
+	if (load_natives)
+	{
+		load_native_functions();
+	}
+
+	if constexpr (runtime_predefined_configuration::ENABLE_PROFILER)
+	{
+		if (configurable_configuration_instance().profile())
+		{
+			profiler_ = make_unique<execution_profiler>();
+		}
+	}
+
+	if (configurable_configuration_instance().allocation_profile())
+	{
+		allocation_profiler_ = make_unique<allocation_profiler>(*this,
+				configurable_configuration_instance().allocation_sample_interval());
+
+		previous_allocation_profiler_ = heap_->current_allocation_profiler();
+		heap_->set_allocation_profiler(allocation_profiler_.get());
+	}
+
+	tracing_ = helper::trace_recorder::instance().enabled();
+
+	if constexpr (runtime_predefined_configuration::ENABLE_INSTRUCTION_COUNTING)
+	{
+		counting_instructions_ = configurable_configuration_instance().count_instructions();
+	}
+
+	counting_functions_ = configurable_configuration_instance().perf_counters_by_function() &&
+						  helper::perf_counters::instance().enabled();
+
+	if (helper::stack_sampler::instance().running())
+	{
+		helper::stack_sampler::instance().attach(this, capture_frames, resolve_frame);
+		sampling_ = true;
+	}
+
+	// machine code runs instructions the profiler and the instruction counter never see
+	if (configurable_configuration_instance().jit() && baseline_jit::available() && !profiler_ && !counting_instructions_)
+	{
+		jit_ = make_unique<baseline_jit>(*this, tiering_policy{
+				.call_threshold = configurable_configuration_instance().jit_threshold(),
+				.backedge_threshold = configurable_configuration_instance().osr_threshold(),
+				.background = configurable_configuration_instance().jit_background(),
+				.observe = configurable_configuration_instance().show_tiering() }, cons);
+	}
 }
 
 void virtual_machine::load_native_functions()
 {
 	for (const auto &f: interpreting::native::native_manager::instance().functions())
 	{
-		globals_.insert_or_assign(f.first,
-								  heap_->allocate<native_function_object>(f.second));
+		if (!globals_.contains(f.first))
+		{
+			globals_.insert_or_assign(f.first,
+									  heap_->allocate<native_function_object>(f.second));
+		}
 	}
 }
 
 virtual_machine::~virtual_machine()
 {
+	if (sampling_)
+	{
+		helper::stack_sampler::instance().detach(this);
+	}
+
+	if (counting_instructions_)
+	{
+		helper::time_statistic::instance().count(helper::statistic_counter::INSTRUCTIONS, instructions_);
+	}
+
+	if (!function_counters_.empty())
+	{
+		vector<pair<string, helper::perf_sample>> rows{ function_counters_.begin(), function_counters_.end() };
+		ranges::sort(rows, [](const auto& lhs, const auto& rhs)
+		{
+			return lhs.second[helper::perf_event::CYCLES] > rhs.second[helper::perf_event::CYCLES];
+		});
+
+		rows.resize(std::min(rows.size(), FUNCTION_COUNTER_ROWS));
+		helper::perf_counters::instance().print_rows(cons_->log(), "Function", rows);
+	}
+
+	if (allocation_profiler_)
+	{
+		heap_->set_allocation_profiler(previous_allocation_profiler_);
+		allocation_profiler_->report(cons_->log());
+	}
+
+	if constexpr (runtime_predefined_configuration::ENABLE_PROFILER)
+	{
+		if (profiler_)
+		{
+			profiler_->report(cons_->log());
+
+			if (auto path = configurable_configuration_instance().profile_output();!path.empty())
+			{
+				ofstream file{ path };
+				profiler_->write_collapsed_stacks(file);
+			}
+		}
+	}
+}
+
+size_t virtual_machine::capture_frames(void* source, helper::stack_sampler::raw_frame* frames,
+		size_t capacity) noexcept
+{
+	auto vm = static_cast<virtual_machine*>(source);
+
+	auto count = std::min(vm->call_frames_.size(), capacity);
+	auto first = vm->call_frames_.size() - count;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		auto& frame = vm->call_frames_[first + i];
+		frames[i] = {
+				reinterpret_cast<uint64_t>(frame.function()),
+				reinterpret_cast<uint64_t>(std::to_address(frame.ip())) };
+	}
+
+	return count;
+}
+
+std::string virtual_machine::resolve_frame([[maybe_unused]] void* source, const helper::stack_sampler::raw_frame& frame)
+{
+	auto func = reinterpret_cast<function_object_raw_pointer>(frame.function);
+	auto body = func->body();
+
+	auto name = func->name().empty() ? std::string{ "<script>" } : func->name();
+
+	auto offset = reinterpret_cast<const chunk::code_type*>(frame.location) - std::to_address(body->begin());
+	if (offset <= 0 || static_cast<size_t>(offset) > body->count())
+	{
+		return name;
+	}
+
+	if (auto line = body->line_of(body->begin() + offset - 1);line != chunk::INVALID_LINE)
+	{
+		return std::format("{}:{}", name, line);
+	}
+
+	return name;
 }
 
 void virtual_machine::reset_stack()
@@ -86,22 +224,67 @@ void virtual_machine::reset_stack()
 
 clox::interpreting::vm::virtual_machine_status clox::interpreting::vm::virtual_machine::run()
 {
+	size_t jit_depth{ 0 }; // the depth of call frames where machine code was last looked for
+
 	for (; top_call_frame().ip() != top_call_frame().function()->body()->end();)
 	{
-#ifndef DEBUG_NO_CATCH
 		try
 		{
-#endif
+			// only calls and returns can make a compiled function the top one, or a hot loop its frame
+			if (jit_ && (jit_depth != call_frames_.size() || on_stack_replacement_))
+			{
+				jit_depth = call_frames_.size();
+				on_stack_replacement_ = false;
+
+				if (auto ret = jit_->run();ret)
+				{
+					auto [status, exit] = ret.value();
+					if (exit)
+					{
+						return status.value_or(virtual_machine_status::OK);
+					}
 
-		chunk::code_type instruction = *top_call_frame().ip()++;
-		auto [status, exit] = run_code(instruction, top_call_frame());
-		if (exit)
+					jit_depth = 0; // left for a call or return, whose frame may be compiled as well
+					continue;
+				}
+			}
+
+			auto instruction = chunk::read_instruction(top_call_frame().ip());
+
+			if constexpr (runtime_predefined_configuration::ENABLE_INSTRUCTION_COUNTING)
+			{
+				if (counting_instructions_)
+				{
+					instructions_++;
+				}
+			}
+
+			if constexpr (runtime_predefined_configuration::ENABLE_PROFILER)
+			{
+				if (profiler_)
+				{
+					profiler_->instruction(instruction);
+				}
+			}
+
+			auto [status, exit] = run_code(instruction, top_call_frame());
+			if (exit)
+			{
+				return status.value_or(virtual_machine_status::OK);
+			}
+		}
+		catch (const heap_memory_limit_exceeded& e)
+		{
+			// there is no way for lox code to recover from it, so always report it as a runtime error.
+			runtime_error("{}", e.what());
+			return virtual_machine_status::RUNTIME_ERROR;
+		}
+		catch (const integer_overflow& e)
 		{
-			return status.value_or(virtual_machine_status::OK);
+			runtime_error("{}", e.what());
+			return virtual_machine_status::RUNTIME_ERROR;
 		}
-
 #ifndef DEBUG_NO_CATCH
-		}
 		catch (const exception& e)
 		{
 			runtime_error("{}", e.what());
@@ -115,7 +298,7 @@ clox::interpreting::vm::virtual_machine_status clox::interpreting::vm::virtual_m
 }
 
 std::tuple<std::optional<virtual_machine_status>, bool>
-virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
+virtual_machine::run_code(full_opcode_type instruction, call_frame &frame)
 {
 	switch (main_op_code_of(instruction))
 	{
@@ -156,7 +339,7 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 		else if (secondary & SEC_OP_CLASS)
 		{
 			auto name = next_variable_name();
-			push(globals_.at(name));
+			push(global_at(name));
 		}
 		else
 		{
@@ -209,8 +392,16 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 		push(std::visit([](auto &&val) -> value
 						{
 							using T = std::decay_t<decltype(val)>;
-							if constexpr (std::is_same_v<T, scanning::floating_literal_type> ||
-								std::is_same_v<T, scanning::integer_literal_type>)
+							if constexpr (std::is_same_v<T, scanning::integer_literal_type>)
+							{
+								auto ret = integer_op(std::minus<>{}, 0, val);
+								if (!ret)
+								{
+									throw integer_overflow{ 0, val };
+								}
+								return *ret;
+							}
+							else if constexpr (std::is_same_v<T, scanning::floating_literal_type>)
 							{
 								return -val;
 							}
@@ -228,6 +419,11 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 
 	case ADD:
 	{
+		if (specialized_binary_op(secondary_op_code_of(instruction), std::plus<>{}) ||
+			integer_binary_op(std::plus<>{}))
+		{
+			break;
+		}
 
 		if (is_string_value(peek(1)) || is_string_value(peek(1)))
 		{
@@ -248,6 +444,12 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 	}
 	case SUBTRACT:
 	{
+		if (specialized_binary_op(secondary_op_code_of(instruction), std::minus<>{}) ||
+			integer_binary_op(std::minus<>{}))
+		{
+			break;
+		}
+
 		binary_op([](floating_value_type l, floating_value_type r) -> floating_value_type
 				  {
 					  return l - r;
@@ -256,6 +458,12 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 	}
 	case MULTIPLY:
 	{
+		if (specialized_binary_op(secondary_op_code_of(instruction), std::multiplies<>{}) ||
+			integer_binary_op(std::multiplies<>{}))
+		{
+			break;
+		}
+
 		binary_op([](floating_value_type l, floating_value_type r) -> floating_value_type
 				  {
 					  return l * r;
@@ -281,6 +489,12 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 
 	case LESS:
 	{
+		if (specialized_binary_op(secondary_op_code_of(instruction), std::less<>{}) ||
+			integer_binary_op(std::less<>{}))
+		{
+			break;
+		}
+
 		binary_op([](scanning::floating_literal_type l, scanning::floating_literal_type r) -> bool
 				  {
 					  return l < r;
@@ -289,6 +503,12 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 	}
 	case LESS_EQUAL:
 	{
+		if (specialized_binary_op(secondary_op_code_of(instruction), std::less_equal<>{}) ||
+			integer_binary_op(std::less_equal<>{}))
+		{
+			break;
+		}
+
 		binary_op([](scanning::floating_literal_type l, scanning::floating_literal_type r) -> bool
 				  {
 					  return l <= r;
@@ -297,6 +517,12 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 	}
 	case GREATER:
 	{
+		if (specialized_binary_op(secondary_op_code_of(instruction), std::greater<>{}) ||
+			integer_binary_op(std::greater<>{}))
+		{
+			break;
+		}
+
 		binary_op([](scanning::floating_literal_type l, scanning::floating_literal_type r) -> bool
 				  {
 					  return l > r;
@@ -305,6 +531,12 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 	}
 	case GREATER_EQUAL:
 	{
+		if (specialized_binary_op(secondary_op_code_of(instruction), std::greater_equal<>{}) ||
+			integer_binary_op(std::greater_equal<>{}))
+		{
+			break;
+		}
+
 		binary_op([](scanning::floating_literal_type l, scanning::floating_literal_type r) -> bool
 				  {
 					  return l >= r;
@@ -313,6 +545,12 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 	}
 	case EQUAL:
 	{
+		if (specialized_binary_op(secondary_op_code_of(instruction), std::equal_to<>{}) ||
+			integer_binary_op(std::equal_to<>{}))
+		{
+			break;
+		}
+
 		if (is_string_value(peek(1)) || is_string_value(peek(1)))
 		{
 			binary_op([](string_object_raw_pointer lp, string_object_raw_pointer rp) -> bool
@@ -343,7 +581,7 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 		if (secondary & SEC_OP_GLOBAL)
 		{
 			auto name = next_variable_name();
-			push(globals_.at(name));
+			push(global_at(name));
 		}
 		else if (secondary & SEC_OP_LOCAL)
 		{
@@ -371,7 +609,7 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 		if (secondary & SEC_OP_GLOBAL)
 		{
 			auto name = next_variable_name();
-			globals_.at(name) = peek(0);
+			global_at(name) = peek(0);
 		}
 		else if (secondary & SEC_OP_LOCAL)
 		{
@@ -399,7 +637,14 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 		if (secondary & SEC_OP_GLOBAL)
 		{
 			auto name = next_variable_name();
-			globals_.insert_or_assign(name, peek(0));
+			if (auto iter = globals_.find(name);iter != globals_.end())
+			{
+				iter->second = peek(0);
+			}
+			else
+			{
+				globals_.emplace(name, peek(0));
+			}
 			pop();
 		}
 		else if (secondary & SEC_OP_FUNC)
@@ -472,8 +717,8 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 		if (secondary & SEC_OP_GLOBAL)
 		{
 			auto name = next_variable_name();
-			auto prev_val = globals_.at(name);
-			globals_.at(name) = std::visit(inc_dec_visitor, prev_val);
+			auto prev_val = global_at(name);
+			global_at(name) = std::visit(inc_dec_visitor, prev_val);
 
 			if (secondary & SEC_OP_POSTFIX)
 			{
@@ -481,7 +726,7 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 			}
 			else
 			{
-				push(globals_.at(name));
+				push(global_at(name));
 			}
 		}
 		else if (secondary & SEC_OP_LOCAL)
@@ -531,6 +776,13 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 	{
 		auto offset = next_code();
 		frame.ip() -= offset;
+
+		// counted in the frame, so a running loop looks its function up only once the threshold is reached
+		if (jit_ && ++frame.backedges() >= jit_->backedge_threshold() &&
+			jit_->count_backedges(frame.function(), std::exchange(frame.backedges(), 0)))
+		{
+			on_stack_replacement_ = true; // go on from the head of the loop in machine code
+		}
 		break;
 	}
 
@@ -554,7 +806,7 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 			if (secondary & SEC_OP_CAPTURE)
 			{
 				auto count = next_code();
-				for (int i = 0; i < count; i++)
+				for (chunk::operand_type i = 0; i < count; i++)
 				{
 					auto local = next_code();
 					auto index = next_code();
@@ -599,7 +851,7 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 		auto name = next_variable_name();
 		auto fields_size = next_code();
 
-		push(heap_->allocate<class_object>(name, fields_size));
+		push(heap_->allocate<class_object>(std::string{ name }, fields_size));
 		break;
 	}
 
@@ -668,11 +920,20 @@ virtual_machine::run_code(chunk::code_type instruction, call_frame &frame)
 
 		auto inst = peek_object<instance_object_raw_pointer>(args);
 
-		auto func = inst->class_object()->method_at(id);
+		auto secondary = secondary_op_code_of(instruction);
+
+		closure_object_raw_pointer func{ nullptr };
+		if (secondary & SEC_OP_FUNC) // devirtualized, the method is known without its class
+		{
+			func = dynamic_cast<function_object_raw_pointer>(get<object_raw_pointer>(functions_.at(id)))->wrapper_closure();
+		}
+		else
+		{
+			func = inst->class_object()->method_at(id);
+		}
 
 		call(func, args);
 
-		auto secondary = secondary_op_code_of(instruction);
 		if (secondary == SEC_OP_CTOR) // workaround the first POP instruction for any function
 		{
 			push(inst);
@@ -767,9 +1028,9 @@ value virtual_machine::next_constant()
 	return top_call_frame().function()->body()->constant_at(next_code());
 }
 
-chunk::code_type virtual_machine::next_code()
+chunk::operand_type virtual_machine::next_code()
 {
-	return *top_call_frame().ip()++;
+	return chunk::read_operand(top_call_frame().ip());
 }
 
 value virtual_machine::pop()
@@ -790,7 +1051,7 @@ value virtual_machine::peek(size_t offset)
 	return *(stack_.rbegin() + offset);
 }
 
-inline void virtual_machine::pop_two_and_push(const value &val)
+void virtual_machine::pop_two_and_push(const value &val)
 {
 	auto left = pop();
 	auto right = pop();
@@ -819,13 +1080,29 @@ bool virtual_machine::is_false(const value &val)
 					  }, val);
 }
 
-std::string virtual_machine::next_variable_name()
+variable_name_type virtual_machine::next_variable_name()
+{
+	return get<variable_name_type>(top_call_frame().function()->body()->constant_at(next_code()));
+}
+
+value &virtual_machine::global_at(variable_name_type name)
 {
-	return get<std::string>(next_constant());
+	if (auto iter = globals_.find(name);iter != globals_.end())
+	{
+		return iter->second;
+	}
+
+	throw std::out_of_range{ std::format("Undefined variable '{}'.", name) };
 }
 
 virtual_machine_status virtual_machine::run(closure_object_raw_pointer closure)
 {
+	auto previous = std::exchange(running_, this);
+	auto _ = finally([previous]
+	{
+		running_ = previous;
+	});
+
 	push(closure);
 
 	push_call_frame(closure, closure->function()->body()->begin(), 0);
@@ -871,6 +1148,17 @@ void virtual_machine::call(closure_object_raw_pointer closure, size_t arg_count)
 		closure->function()->body()->disassemble(*cons_);
 	}
 
+	if (auto iter = native_code_.find(closure->function());
+		iter != native_code_.end() && call_native_code(iter->second, arg_count))
+	{
+		return;
+	}
+
+	if (jit_)
+	{
+		jit_->count_call(closure->function());
+	}
+
 	int64_t stack_offset = static_cast<int64_t>(stack_.size()) - arg_count - 1;
 	assert(stack_offset >= 0);
 
@@ -887,7 +1175,18 @@ void virtual_machine::call(const shared_ptr<native_function> &func, size_t arg_c
 		args.push_back(peek(i));
 	}
 
-	auto ret = func->call(args);
+	value ret{};
+	if (tracing_)
+	{
+		auto start = helper::trace_recorder::clock_type::now();
+		ret = func->call(args);
+		helper::trace_recorder::instance().complete_call(func->name(), "native", start,
+				helper::trace_recorder::clock_type::now());
+	}
+	else
+	{
+		ret = func->call(args);
+	}
 
 	pop();
 	for (size_t i = 0; i < arg_count; ++i)
@@ -898,6 +1197,73 @@ void virtual_machine::call(const shared_ptr<native_function> &func, size_t arg_c
 	push(ret);
 }
 
+bool virtual_machine::call_native_code(const native_code &code, size_t arg_count)
+{
+	if (code.params.size() != arg_count)
+	{
+		return false;
+	}
+
+	std::vector<native_value> args(arg_count);
+	for (size_t i = 0; i < arg_count; ++i)
+	{
+		const auto &arg = peek(arg_count - i - 1);
+		switch (code.params[i])
+		{
+		case NATIVE_INTEGER:
+			if (!holds_alternative<integer_value_type>(arg))
+			{
+				return false;
+			}
+			args[i].integer = get<integer_value_type>(arg);
+			break;
+		case NATIVE_FLOATING:
+			if (!holds_alternative<floating_value_type>(arg))
+			{
+				return false;
+			}
+			args[i].floating = get<floating_value_type>(arg);
+			break;
+		default:
+			return false;
+		}
+		args[i].kind = code.params[i];
+	}
+
+	auto ret = code.entry(args.data());
+	if (ret.kind == NATIVE_OVERFLOW)
+	{
+		// compiled functions have no side effects, so interpreting the call again raises the error where it happens
+		return false;
+	}
+
+	pop();
+	for (size_t i = 0; i < arg_count; ++i)
+	{
+		pop();
+	}
+
+	switch (ret.kind)
+	{
+	case NATIVE_INTEGER:
+		push(ret.integer);
+		break;
+	case NATIVE_FLOATING:
+		push(ret.floating);
+		break;
+	default:
+		push(ret.integer != 0);
+		break;
+	}
+
+	return true;
+}
+
+void virtual_machine::attach_native_code(function_object_raw_pointer func, native_code code)
+{
+	native_code_.insert_or_assign(func, std::move(code));
+}
+
 upvalue_object_raw_pointer virtual_machine::capture_upvalue(value *val, index_type stack_index)
 {
 	if (open_upvalues_.contains(stack_index))
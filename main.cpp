@@ -39,8 +39,125 @@ int main(int argc, char *argv[])
 		.default_value(false)
 		.implicit_value(true);
 
-	arg_parser.add_argument("-t", "--time-statistic")
-		.help("Show time statistic like the runtime, compile time, etc.")
+	arg_parser.add_argument("-c", "--bytecode-cache")
+		.help("Load the script from, or save it to the precompiled bytecode (.loxc) next to it.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--no-optimize")
+		.help("Generate code from the AST as it is, without folding constants, evaluating pure calls, devirtualizing, inlining or optimizing in SSA form.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--jit")
+		.help("Compile hot functions to x86-64 machine code, instead of interpreting every function.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--jit-threshold")
+		.help("Calls after which a function is compiled to machine code.")
+		.default_value(std::string{ "100" });
+
+	arg_parser.add_argument("--osr-threshold")
+		.help("Backward jumps after which a running loop switches to machine code, replacing its frame on the stack.")
+		.default_value(std::string{ "1000" });
+
+	arg_parser.add_argument("--jit-background")
+		.help("Compile hot functions on a background thread while they are interpreted, instead of stopping to compile them.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--show-tiering")
+		.help("Report functions moving between the interpreter and machine code, and their counters at exit.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--aot")
+		.help("Compile numeric functions ahead of time to C with the system C compiler, and call them when the arguments are numbers of the types expected.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("-p", "--prelude")
+		.help("Run the script before the main script or REPL, whose definitions are visible to them.")
+		.default_value(std::string{ "" });
+
+	arg_parser.add_argument("--save-snapshot")
+		.help("Save the heap after running the prelude to the snapshot file.")
+		.default_value(std::string{ "" });
+
+	arg_parser.add_argument("-s", "--snapshot")
+		.help("Restore the heap from the snapshot file instead of running the prelude again.")
+		.default_value(std::string{ "" });
+
+	arg_parser.add_argument("-m", "--memory-limit")
+		.help("Limit heap memory of the virtual machine, in bytes or with K, M, G suffix. 0 for unlimited.")
+		.default_value(std::string{ "0" });
+
+	arg_parser.add_argument("-T", "--time-statistic")
+		.help("Show the time of scanning, parsing, resolving, optimizing, code generation, execution and GC, with token, AST node and bytecode counts.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--profile")
+		.help("Count executed instructions by opcode, and instructions, time and calls by function and call site, reported at exit. Needs a build with ENABLE_PROFILER.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--profile-output")
+		.help("Write the profile as collapsed stacks to the file, for flame graphs. Implies --profile.")
+		.default_value(std::string{ "" });
+
+	arg_parser.add_argument("--sample")
+		.help("Sample call stacks by SIGPROF while running, and write them to the file as folded stacks for flame graphs.")
+		.default_value(std::string{ "" });
+
+	arg_parser.add_argument("--sample-frequency")
+		.help("Samples taken every second of CPU time.")
+		.default_value(std::string{ "997" });
+
+	arg_parser.add_argument("--trace")
+		.help("Write compiler phases, GC phases and function calls to the file as Chrome trace events.")
+		.default_value(std::string{ "" });
+
+	arg_parser.add_argument("--trace-threshold")
+		.help("Microseconds a function call takes at least to be traced.")
+		.default_value(std::string{ "100" });
+
+	arg_parser.add_argument("--heap-census")
+		.help("Count objects left in the heap by type, and instances by class, after running.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--alloc-profile")
+		.help("Sample allocations by the Lox function and line making them, and report sites allocating most and how much of it survives GC at exit.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--alloc-sample-interval")
+		.help("Bytes allocated between two samples of --alloc-profile, with K, M, G suffix.")
+		.default_value(std::string{ "4K" });
+
+	arg_parser.add_argument("--perf-counters")
+		.help("Count cycles, instructions, branch misses and cache misses of each phase by hardware performance counters, and report IPC and miss rates.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--perf-counters-by-function")
+		.help("Report hardware performance counters of each Lox function as well, including its callees. Implies --perf-counters.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--count-instructions")
+		.help("Count instructions the virtual machine runs and objects it allocates into the time statistic, with JIT and AOT off so that counts are the same in every run. Implies --time-statistic. Needs a build with ENABLE_INSTRUCTION_COUNTING.")
+		.default_value(false)
+		.implicit_value(true);
+
+	arg_parser.add_argument("--heap-dump")
+		.help("Write objects left in the heap with their references and retained sizes to the file as JSON after running.")
+		.default_value(std::string{ "" });
+
+	arg_parser.add_argument("--time-statistic-json")
+		.help("Show the time statistic as JSON instead of a table.")
 		.default_value(false)
 		.implicit_value(true);
 
@@ -36,6 +36,7 @@ namespace clox::interpreting::native
 {
 DEF_NATIVE_FUNC(clock)
 DEF_NATIVE_FUNC(len)
+DEF_NATIVE_FUNC(heap_dump)
 
 
 }
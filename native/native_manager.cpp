@@ -94,4 +94,8 @@ void native_manager::register_global_functions()
 		nf_len,
 		make_shared<lox_integer_type>(),
 		lox_callable_type::parameter_list_of(make_shared<lox_any_type>()));
+	register_function("heap_dump",
+		nf_heap_dump,
+		make_shared<lox_boolean_type>(),
+		lox_callable_type::parameter_list_of(make_shared<lox_string_type>()));
 }
@@ -31,8 +31,9 @@ using namespace std;
 using namespace gsl;
 
 
-clox::interpreting::vm::class_object::class_object(std::string name, size_t fields_size)
-		: name_(std::move(name)), field_size_(fields_size)
+clox::interpreting::vm::class_object::class_object(std::string name, size_t fields_size,
+		const allocator_type& alloc)
+		: name_(std::move(name)), field_size_(fields_size), supers_(alloc), methods_(alloc)
 {
 }
 
@@ -25,8 +25,8 @@
 #include "object/closure_object.h"
 #include "interpreter/vm/garbage_collector.h"
 
-clox::interpreting::vm::closure_object::closure_object(function_object_raw_pointer func)
-		: function_{ func }
+clox::interpreting::vm::closure_object::closure_object(function_object_raw_pointer func, const allocator_type& alloc)
+		: function_{ func }, upvalues_(alloc)
 {
 	func->wrapper_closure_ = this;
 }
@@ -36,8 +36,9 @@ clox::interpreting::vm::object_type clox::interpreting::vm::function_object::typ
 	return object_type::FUNCTION;
 }
 
-clox::interpreting::vm::function_object::function_object(std::string name, size_t arity)
-		: name_(std::move(name)), arity_(arity), body_(make_shared<chunk>())
+clox::interpreting::vm::function_object::function_object(std::string name, size_t arity,
+		const allocator_type& alloc)
+		: name_(std::move(name)), arity_(arity), body_(allocate_shared<chunk>(alloc)) // the chunk is constructed with alloc as well
 {
 }
 
@@ -45,6 +45,9 @@ class bounded_method_object
 		: public object
 {
 public:
+	friend class heap_image_reader;
+
+	friend class heap_image_writer;
 
 	explicit bounded_method_object(value receiver, closure_object_raw_pointer method);
 
@@ -37,6 +37,8 @@
 #include <string>
 
 #include <memory>
+#include <memory_resource>
+#include <unordered_map>
 #include <map>
 
 namespace clox::interpreting::vm
@@ -47,8 +49,14 @@ class class_object
 public:
 	friend class instance_object;
 
+	friend class heap_image_reader;
+
+	friend class heap_image_writer;
+
 public:
-	explicit class_object(std::string name, size_t field_size);
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	explicit class_object(std::string name, size_t field_size, const allocator_type& alloc = {});
 
 	std::string printable_string() override;
 
@@ -73,9 +81,9 @@ private:
 
 	size_t field_size_{};
 
-	std::vector<class_object*> supers_{};
+	std::pmr::vector<class_object*> supers_{};
 
-	std::unordered_map<resolving::function_id_type, closure_object_raw_pointer> methods_{};
+	std::pmr::unordered_map<resolving::function_id_type, closure_object_raw_pointer> methods_{};
 };
 
 using class_object_raw_pointer = class_object*;
@@ -34,6 +34,7 @@
 #include <string>
 
 #include <memory>
+#include <memory_resource>
 #include <map>
 
 namespace clox::interpreting::vm
@@ -45,7 +46,9 @@ protected:
 	void blacken(struct garbage_collector* gc_inst) override;
 
 public:
-	[[nodiscard]] explicit closure_object(function_object_raw_pointer func);
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	[[nodiscard]] explicit closure_object(function_object_raw_pointer func, const allocator_type& alloc = {});
 
 	std::string printable_string() override;
 
@@ -56,7 +59,7 @@ public:
 		return function_;
 	}
 
-	[[nodiscard]] std::vector<upvalue_object_raw_pointer>& upvalues() const
+	[[nodiscard]] std::pmr::vector<upvalue_object_raw_pointer>& upvalues() const
 	{
 		return upvalues_;
 	}
@@ -64,7 +67,7 @@ public:
 private:
 	function_object_raw_pointer function_{};
 
-	mutable std::vector<upvalue_object_raw_pointer> upvalues_{};
+	mutable std::pmr::vector<upvalue_object_raw_pointer> upvalues_{};
 };
 
 using closure_object_raw_pointer = closure_object*;
@@ -33,6 +33,7 @@
 #include <string>
 
 #include <memory>
+#include <memory_resource>
 #include <map>
 
 namespace clox::interpreting::compiling // to avoid header circular dependency
@@ -50,7 +51,13 @@ public:
 
 	friend class compiling::codegen;
 
-	explicit function_object(std::string name, size_t arity);
+	friend class heap_image_reader;
+
+	friend class heap_image_writer;
+
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	explicit function_object(std::string name, size_t arity, const allocator_type& alloc = {});
 
 	[[nodiscard]] object_type type() const noexcept override;
 
@@ -35,6 +35,7 @@
 #include <string>
 
 #include <memory>
+#include <memory_resource>
 #include <map>
 
 #include "gsl/gsl"
@@ -45,9 +46,15 @@ class instance_object
 		: public object
 {
 public:
+	friend class heap_image_reader;
+
+	friend class heap_image_writer;
+
 	using index_type = gsl::index;
 
-	explicit instance_object(class_object_raw_pointer class_obj);
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	explicit instance_object(class_object_raw_pointer class_obj, const allocator_type& alloc = {});
 
 	std::string printable_string() override;
 
@@ -68,7 +75,7 @@ protected:
 
 private:
 	class_object_raw_pointer class_{};
-	std::vector<value> fields_{};
+	std::pmr::vector<value> fields_{};
 };
 
 using instance_object_raw_pointer = instance_object*;
@@ -33,6 +33,7 @@
 #include <string>
 
 #include <memory>
+#include <memory_resource>
 #include <map>
 #include "gsl/gsl"
 
@@ -42,10 +43,16 @@ class list_object
 		: public  object
 {
 public:
-	explicit list_object(std::vector<value> values);
+	friend class heap_image_reader;
+
+	friend class heap_image_writer;
 
 	using index_type = gsl::index;
 
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	explicit list_object(const std::vector<value>& values, const allocator_type& alloc = {});
+
 	std::string printable_string() override;
 
 	[[nodiscard]] object_type type() const noexcept override;
@@ -60,7 +67,7 @@ protected:
 	void blacken(struct garbage_collector* gc_inst) override;
 
 private:
-	std::vector<value> values_{};
+	std::pmr::vector<value> values_{};
 };
 
 using list_object_raw_pointer = class list_object*;
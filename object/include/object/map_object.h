@@ -31,6 +31,7 @@
 #include <string>
 
 #include <memory>
+#include <memory_resource>
 #include <map>
 
 #include "gsl/gsl"
@@ -44,9 +45,15 @@ class map_object
 		: public object
 {
 public:
+	friend class heap_image_reader;
+
+	friend class heap_image_writer;
+
 	using index_type = gsl::index;
 
-	explicit map_object(std::vector<std::pair<value,value>> vals);
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
+	explicit map_object(const std::vector<std::pair<value, value>>& vals, const allocator_type& alloc = {});
 
 	std::string printable_string() override;
 
@@ -59,7 +66,7 @@ protected:
 
 
 private:
-	std::vector<std::pair<value,value>> values_{};
+	std::pmr::vector<std::pair<value, value>> values_{};
 };
 
 }
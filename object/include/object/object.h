@@ -79,7 +79,20 @@ public:
 
 
 public:
+	friend class object_heap;
+
+	friend class heap_inspector;
+
+	/// \brief internal buffers of objects are allocated from the heap, so they must be released on deallocation
+	virtual ~object() = default;
+
 	[[nodiscard]]virtual object_type type() const noexcept = 0;
+
+private:
+	size_t allocated_size_{};
+
+	/// \brief whether the allocation profiler keeps track of it
+	bool allocation_sampled_{ false };
 };
 
 /// \brief object raw pointer will be used frequently because memory reclaim will be done by GC
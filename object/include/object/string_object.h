@@ -33,6 +33,7 @@
 #include <string>
 
 #include <memory>
+#include <memory_resource>
 #include <unordered_set>
 
 
@@ -47,6 +48,8 @@ class string_object :
 public:
 	friend class garbage_collector;
 	friend class object_heap;
+	friend class heap_image_reader;
+	friend class heap_image_writer;
 
 	struct string_object_intern_hash
 	{
@@ -63,6 +66,8 @@ public:
 
 	using string_interns_table_type = std::unordered_set<string_object_raw_pointer, string_object_intern_hash>;
 
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+
 
 	string_object() = delete;
 
@@ -82,9 +87,9 @@ public:
 	std::string printable_string() override;
 
 private:
-	explicit string_object(std::string value);
+	explicit string_object(std::string_view value, const allocator_type& alloc = {});
 
-	std::string data_{};
+	std::pmr::string data_{};
 
 	static string_interns_table_type interns_;
 };
@@ -35,6 +35,10 @@ class upvalue_object final
 		: public object
 {
 public:
+	friend class heap_image_reader;
+
+	friend class heap_image_writer;
+
 	explicit upvalue_object(value* val)
 			: value_(val)
 	{
@@ -25,10 +25,10 @@
 #include "object/instance_object.h"
 #include "interpreter/vm/garbage_collector.h"
 
-clox::interpreting::vm::instance_object::instance_object(clox::interpreting::vm::class_object_raw_pointer class_obj)
-		: class_(class_obj), fields_(class_obj->field_size_)
+clox::interpreting::vm::instance_object::instance_object(clox::interpreting::vm::class_object_raw_pointer class_obj,
+		const allocator_type& alloc)
+		: class_(class_obj), fields_(class_obj->field_size_, alloc)
 {
-
 }
 
 std::string clox::interpreting::vm::instance_object::printable_string()
@@ -28,10 +28,9 @@
 
 #include <utility>
 
-clox::interpreting::vm::list_object::list_object(std::vector<value> values)
-		: values_(std::move(values))
+clox::interpreting::vm::list_object::list_object(const std::vector<value>& values, const allocator_type& alloc)
+		: values_(values.begin(), values.end(), alloc)
 {
-
 }
 
 std::string clox::interpreting::vm::list_object::printable_string()
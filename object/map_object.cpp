@@ -28,8 +28,9 @@
 
 #include <utility>
 
-clox::interpreting::vm::map_object::map_object(std::vector<std::pair<value, value>> vals)
-	: values_(std::move(vals))
+clox::interpreting::vm::map_object::map_object(const std::vector<std::pair<value, value>>& vals,
+		const allocator_type& alloc)
+		: values_(vals.begin(), vals.end(), alloc)
 {
 }
 
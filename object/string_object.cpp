@@ -39,17 +39,17 @@ clox::interpreting::vm::object_type clox::interpreting::vm::string_object::type(
 
 std::string clox::interpreting::vm::string_object::string() const
 {
-	return data_;
+	return std::string{ data_ };
 }
 
-clox::interpreting::vm::string_object::string_object(std::string value)
-		: data_(std::move(value))
+clox::interpreting::vm::string_object::string_object(std::string_view value, const allocator_type& alloc)
+		: data_(value, alloc)
 {
 }
 
 std::string clox::interpreting::vm::string_object::printable_string()
 {
-	return data_;
+	return std::string{ data_ };
 }
 
 void string_object::blacken(clox::interpreting::vm::garbage_collector* gc_inst)
@@ -46,7 +46,8 @@ enum ast_annotation_type
 	AST_ANNOTATION_OPERATOR,
 	AST_ANNOTATION_CLASS,
 	AST_ANNOTATION_BASE,
-	AST_ANNOTATION_CONTAINER
+	AST_ANNOTATION_CONTAINER,
+	AST_ANNOTATION_BRANCH
 };
 
 class ast_annotation
@@ -99,6 +100,17 @@ protected:
 class parser_class_base
 {
 public:
+	parser_class_base()
+	{
+		created_count_++;
+	}
+
+	/// \return how many nodes have ever been created, for statistics
+	[[nodiscard]] static size_t created_count()
+	{
+		return created_count_;
+	}
+
 	bool has_parent_node() const
 	{
 		return !parent_node_.expired();
@@ -121,6 +133,9 @@ public:
 
 protected:
 	std::weak_ptr<parser_class_base> parent_node_{};
+
+private:
+	static inline size_t created_count_{ 0 };
 };
 
 template<typename T, typename TChild>
@@ -409,6 +409,7 @@ void parser::synchronize()
 		case token_type::CLASS:
 		case token_type::FUN:
 		case token_type::VAR:
+		case token_type::CONST:
 		case token_type::FOR:
 		case token_type::IF:
 		case token_type::WHILE:
@@ -495,7 +496,7 @@ std::shared_ptr<statement> parser::declaration()
 		{
 			return func_declaration(function_statement_type::FST_FUNCTION);
 		}
-		else if (match({ token_type::VAR }))
+		else if (match({ token_type::VAR, token_type::CONST }))
 		{
 			return var_declaration();
 		}
@@ -572,6 +573,7 @@ std::shared_ptr<statement> parser::func_declaration(function_statement_type type
 
 std::shared_ptr<statement> parser::var_statement()
 {
+	auto keyword = previous();
 	auto name = consume(token_type::IDENTIFIER, "Variable name is expected.");
 
 	decltype(type_expr()) type = nullptr;
@@ -586,7 +588,7 @@ std::shared_ptr<statement> parser::var_statement()
 		initializer = initializer_expr();
 	}
 
-	return set_parent(make_shared<variable_statement>(name, type, initializer), type, initializer);
+	return set_parent(make_shared<variable_statement>(name, type, initializer, keyword), type, initializer);
 }
 
 
@@ -378,6 +378,47 @@ struct annotation_tag<container_annotation>
 	static constexpr parsing::ast_annotation_type type = parsing::ast_annotation_type::AST_ANNOTATION_CONTAINER;
 };
 
+/// \brief the condition of an if or a while statement is known before running,
+/// so that only one branch is ever taken
+class branch_annotation final
+		: public parsing::ast_annotation
+{
+public:
+	[[nodiscard]] parsing::ast_annotation_type type() const override
+	{
+		return parsing::ast_annotation_type::AST_ANNOTATION_BRANCH;
+	}
+
+	branch_annotation() = default;
+
+	explicit branch_annotation(bool taken, size_t dead_scopes)
+			: taken_(taken), dead_scopes_(dead_scopes)
+	{
+	}
+
+	/// \brief the value of the condition
+	[[nodiscard]] bool taken() const
+	{
+		return taken_;
+	}
+
+	/// \brief count of scopes the eliminated branch owns, which code generation must skip
+	[[nodiscard]] size_t dead_scopes() const
+	{
+		return dead_scopes_;
+	}
+
+private:
+	bool taken_{ false };
+	size_t dead_scopes_{ 0 };
+};
+
+template<>
+struct annotation_tag<branch_annotation>
+{
+	static constexpr parsing::ast_annotation_type type = parsing::ast_annotation_type::AST_ANNOTATION_BRANCH;
+};
+
 template<typename T>
 [[maybe_unused, nodiscard]] static inline std::shared_ptr<T>
 downcast_annotation(const std::shared_ptr<parsing::ast_annotation>& anno)
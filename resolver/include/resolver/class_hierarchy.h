@@ -0,0 +1,67 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/13/2022.
+//
+
+#pragma once
+
+#include <parser/gen/parser_classes.inc>
+
+#include "type/class_type.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace clox::resolving
+{
+
+/// \brief whole-program class hierarchy analysis.
+/// Records every class declaration with its base and the methods it declares,
+/// so that methods never overridden in any subclass can be called directly.
+class class_hierarchy final
+{
+public:
+	void add_class(const std::shared_ptr<parsing::class_statement>& cls,
+			const std::shared_ptr<lox_class_type>& class_type,
+			const std::shared_ptr<lox_class_type>& base_type);
+
+	/// \brief whether a subclass (transitively) of the declaring class declares a method of the same name.
+	/// unknown statements are conservatively treated as overridden
+	[[nodiscard]] bool is_overridden(const std::shared_ptr<parsing::statement>& method) const;
+
+private:
+	struct class_node
+	{
+		std::vector<const lox_class_type*> subclasses{};
+		std::unordered_set<std::string> methods{};
+	};
+
+	std::unordered_map<const lox_class_type*, class_node> classes_{};
+	std::unordered_map<const parsing::statement*, const lox_class_type*> declaring_classes_{};
+};
+
+}
@@ -38,6 +38,7 @@
 #include "type/instance_type.h"
 #include <resolver/binding.h>
 #include <resolver/function.h>
+#include <resolver/class_hierarchy.h>
 
 #include "symbol/scope.h"
 #include "symbol/scope_collection.h"
@@ -57,6 +58,15 @@ namespace clox::resolving
 // tuple{result type for assignment,compatible,narrowing}
 using type_compatibility = std::tuple<std::shared_ptr<lox_type>, bool, bool>;
 
+/// \brief a clone of a function whose union typed parameters are known to be certain primitive types
+struct function_specialization
+{
+	function_id_type id{ FUNCTION_ID_INVALID };
+
+	/// \brief the primitive type each parameter is specialized for, PRIMITIVE_TYPE_ID_ANY if it is not
+	std::vector<type_id> param_types{};
+};
+
 
 class resolver final
 		: public parsing::expression_visitor<std::shared_ptr<lox_type>>,
@@ -189,6 +199,28 @@ public:
 
 	[[nodiscard]] std::optional<function_id_type> function_id(const std::shared_ptr<parsing::statement>& stmt) const;
 
+	/// \brief whether calling the function has no effect other than computing its result:
+	/// it never prints, writes globals, captured variables or properties, or calls natives, methods and closures,
+	/// and neither do the functions it calls
+	[[nodiscard]] bool is_pure(const std::shared_ptr<parsing::statement>& stmt) const;
+
+	/// \return the clones of the function requested by calls resolved so far
+	[[nodiscard]] std::vector<function_specialization>
+	specializations(const std::shared_ptr<parsing::statement>& stmt) const;
+
+	/// \return the id of the clone the call should be dispatched to, if any
+	[[nodiscard]] std::optional<function_id_type>
+	specialization_of(const std::shared_ptr<parsing::call_expression>& ce) const;
+
+	[[nodiscard]] const class_hierarchy& hierarchy() const
+	{
+		return hierarchy_;
+	}
+
+	/// \brief let following code generation skip the code resolved so far,
+	/// whose code comes from elsewhere, like a heap snapshot
+	void skip_code_generation();
+
 private:
 
 	std::shared_ptr<lox_type> type_error(const clox::scanning::token& tk, const std::string& msg);
@@ -228,6 +260,9 @@ private:
 
 	std::shared_ptr<lox_type> type_lookup(const scanning::token& tk);
 
+	/// \brief report an error if the expression, which is going to be written, refers to a constant
+	void check_constant_write(const std::shared_ptr<parsing::expression>& target, const scanning::token& tk);
+
 	type_compatibility check_type_assignment(const scanning::token& tk, const std::shared_ptr<lox_type>& left,
 			const std::shared_ptr<lox_type>& right);
 
@@ -239,6 +274,11 @@ private:
 	check_type_binary_expression(const scanning::token& tk, const std::shared_ptr<lox_type>& left,
 			const std::shared_ptr<lox_type>& right);
 
+	/// \brief check an operator on a union by every type it may hold
+	overloadable_operator_type_check_result
+	check_type_binary_expression_union(const scanning::token& tk, const std::shared_ptr<lox_type>& left,
+			const std::shared_ptr<lox_type>& right);
+
 	overloadable_operator_type_check_result
 	check_type_binary_expression_primitive(const scanning::token& tk, const std::shared_ptr<lox_type>& left,
 			const std::shared_ptr<lox_type>& right);
@@ -339,6 +379,17 @@ private:
 
 	void define_global_functions();
 
+	/// \brief record that the function being resolved has an effect
+	void mark_impure();
+
+	/// \brief record an effect if the target written is not a local of the function being resolved
+	void note_write(const std::shared_ptr<parsing::expression>& target);
+
+	/// \brief request a clone of the called function for the primitive types of arguments of union typed parameters
+	void specialize_call(const std::shared_ptr<parsing::call_expression>& ce,
+			const std::shared_ptr<lox_callable_type>& callable,
+			const std::vector<std::shared_ptr<lox_type>>& args);
+
 	std::shared_ptr<function_scope> global_scope_{ nullptr };
 
 	base::iterable_stack<std::shared_ptr<scope>> scopes_{};
@@ -358,6 +409,21 @@ private:
 
 	std::unordered_map<std::shared_ptr<parsing::statement>, function_id_type> function_ids_;
 
+	class_hierarchy hierarchy_{};
+
+	struct function_effects
+	{
+		bool impure{ false };
+		std::vector<function_id_type> callees{};
+	};
+
+	std::unordered_map<function_id_type, function_effects> function_effects_{};
+
+	static inline constexpr size_t SPECIALIZATION_LIMIT = 4;
+
+	std::unordered_map<std::shared_ptr<parsing::statement>, std::vector<function_specialization>> specializations_{};
+	std::unordered_map<std::shared_ptr<parsing::call_expression>, function_id_type> call_specializations_{};
+
 	function_id_type function_id_counter_{ FUNCTION_ID_BEGIN };
 };
 }
\ No newline at end of file
@@ -36,6 +36,7 @@
 #include "resolver/function.h"
 #include "resolver/upvalue.h"
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 #include <stack>
@@ -178,23 +179,25 @@ public:
 		return container_func_;
 	}
 
-	[[nodiscard]] bool is_global() const
+	/// \brief make iterators skip children created so far, as if they have been visited
+	void skip_children()
 	{
-		return is_global_;
+		next_child_ = children_.size();
 	}
 
-
-private:
-	[[nodiscard]] scope_list_type::iterator& last() const
+	/// \brief make iterators skip the next count children, whose code is never generated
+	void skip_children(size_t count)
 	{
-		if (!last_.has_value())
-		{
-			last_ = children_.begin();
-		}
+		next_child_ = std::min(next_child_ + count, children_.size());
+	}
 
-		return last_.value();
+	[[nodiscard]] bool is_global() const
+	{
+		return is_global_;
 	}
 
+
+private:
 	mutable function_id_type container_func_{};
 
 	mutable type_table_type types_{};
@@ -205,7 +208,8 @@ private:
 
 	mutable scope_list_type children_{};
 
-	mutable std::optional<scope_list_type::iterator> last_{};
+	/// \brief index rather than iterator, for children can be added after iterating, like in the REPL
+	mutable size_t next_child_{ 0 };
 
 	mutable std::weak_ptr<scope> parent_{};
 
@@ -119,6 +119,17 @@ public:
 
 	std::shared_ptr<class upvalue> capture();
 
+	/// \brief whether it is declared by const, which can never be assigned after its initialization
+	[[nodiscard]] bool is_const() const
+	{
+		return is_const_;
+	}
+
+	void set_const(bool c)
+	{
+		is_const_ = c;
+	}
+
 	[[nodiscard]] std::shared_ptr<class upvalue> get_upvalue() const
 	{
 		return upvalue_;
@@ -137,6 +148,8 @@ private:
 
 	bool is_captured_{ false };
 
+	bool is_const_{ false };
+
 	std::shared_ptr<class upvalue> upvalue_{};
 
 	int64_t slot_index_{ -1 };
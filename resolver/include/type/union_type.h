@@ -58,6 +58,16 @@ public:
 		return children_.end();
 	}
 
+	[[nodiscard]] auto begin() const
+	{
+		return children_.begin();
+	}
+
+	[[nodiscard]] auto end() const
+	{
+		return children_.end();
+	}
+
 
 	std::string printable_string() override;
 
@@ -28,6 +28,7 @@
 #include "type/object_type.h"
 #include "type/callable_type.h"
 #include "type/instance_type.h"
+#include "type/union_type.h"
 #include <resolver/operators.h>
 #include "type/list_type.h"
 #include "type/map_type.h"
@@ -87,7 +88,11 @@ resolver::check_type_binary_expression(const clox::scanning::token& tk, const sh
 	if (lox_type::is_instance(*left))left = static_pointer_cast<lox_instance_type>(left)->underlying_type();
 	if (lox_type::is_instance(*right))right = static_pointer_cast<lox_instance_type>(right)->underlying_type();
 
-	if (lox_type::is_primitive(*left) || left->id() == TYPE_ID_STRING_CLASS /*FIXME*/)
+	if (lox_type::is_union(*left) || lox_type::is_union(*right))
+	{
+		return check_type_binary_expression_union(tk, left, right);
+	}
+	else if (lox_type::is_primitive(*left) || left->id() == TYPE_ID_STRING_CLASS /*FIXME*/)
 	{
 		return check_type_binary_expression_primitive(tk, left, right);
 	}
@@ -106,6 +111,70 @@ resolver::check_type_binary_expression(const clox::scanning::token& tk, const sh
 }
 
 
+resolver::overloadable_operator_type_check_result
+resolver::check_type_binary_expression_union(const clox::scanning::token& tk, const shared_ptr<lox_type>& left,
+		const shared_ptr<lox_type>& right)
+{
+	auto members = [](const shared_ptr<lox_type>& type)
+	{
+		if (lox_type::is_union(*type))
+		{
+			auto type_union = static_pointer_cast<lox_union_type>(type);
+			return vector<shared_ptr<lox_type>>{ type_union->begin(), type_union->end() };
+		}
+		return vector<shared_ptr<lox_type>>{ type };
+	};
+
+	auto left_members = members(left), right_members = members(right);
+
+	// only unions of primitives, whose operators are not overloaded, are checked by their members
+	auto is_primitive = [](const shared_ptr<lox_type>& t)
+	{
+		return lox_type::is_primitive(*t) || t->id() == TYPE_ID_STRING_CLASS;
+	};
+
+	if (ranges::all_of(left_members, is_primitive) && ranges::all_of(right_members, is_primitive))
+	{
+		// the operator must be valid for every pair the operands may hold, giving any of their results
+		shared_ptr<lox_type> result{ nullptr };
+		bool compatible = true;
+
+		for (const auto& l: left_members)
+		{
+			for (const auto& r: right_members)
+			{
+				auto [type, ok, _] = check_type_binary_expression_primitive(tk, l, r);
+				if (!ok)
+				{
+					compatible = false;
+				}
+				else if (!result)
+				{
+					result = type;
+				}
+				else if (!lox_type::unify(*result, *type))
+				{
+					result = lox_union_type::unite(result, type);
+				}
+			}
+		}
+
+		if (compatible)
+		{
+			return make_tuple(result, true, nullopt);
+		}
+
+		return make_tuple(make_shared<lox_any_type>(), false, nullopt);
+	}
+
+	return make_tuple(type_error(tk, std::format(R"( cannot do operator {} for type {} and {} )",
+					tk.lexeme(),
+					left->printable_string(),
+					right->printable_string())),
+			false,
+			nullopt);
+}
+
 resolver::overloadable_operator_type_check_result
 resolver::check_type_binary_expression_primitive(const clox::scanning::token& tk, const shared_ptr<lox_type>& left,
 		const shared_ptr<lox_type>& right)
@@ -0,0 +1,87 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/13/2022.
+//
+
+#include <resolver/class_hierarchy.h>
+
+#include <ranges>
+
+using namespace clox::parsing;
+using namespace clox::resolving;
+
+using namespace std;
+
+void class_hierarchy::add_class(const shared_ptr<class_statement>& cls,
+		const shared_ptr<lox_class_type>& class_type,
+		const shared_ptr<lox_class_type>& base_type)
+{
+	auto& node = classes_[class_type.get()];
+
+	for (const auto& method: cls->get_methods())
+	{
+		node.methods.insert(method->get_name().lexeme());
+		declaring_classes_.insert_or_assign(method.get(), class_type.get());
+	}
+
+	if (base_type && cls->get_base_class())
+	{
+		classes_[base_type.get()].subclasses.push_back(class_type.get());
+	}
+}
+
+bool class_hierarchy::is_overridden(const shared_ptr<statement>& method) const
+{
+	auto fs = dynamic_pointer_cast<function_statement>(method);
+	if (!fs || !declaring_classes_.contains(fs.get()))
+	{
+		return true;
+	}
+
+	const auto& name = fs->get_name().lexeme();
+
+	vector<const lox_class_type*> work{ declaring_classes_.at(fs.get()) };
+	while (!work.empty())
+	{
+		auto cls = work.back();
+		work.pop_back();
+
+		if (!classes_.contains(cls))
+		{
+			continue;
+		}
+
+		for (auto sub: classes_.at(cls).subclasses)
+		{
+			if (classes_.contains(sub) && classes_.at(sub).methods.contains(name))
+			{
+				return true;
+			}
+
+			work.push_back(sub);
+		}
+	}
+
+	return false;
+}
@@ -63,6 +63,13 @@ resolver::visit_assignment_expression(const std::shared_ptr<parsing::assignment_
 		return type_error(e->get_name(), std::format("{} is not a variable", e->get_name().lexeme()));
 	}
 
+	if (static_pointer_cast<named_symbol>(symbol)->is_const())
+	{
+		return type_error(e->get_name(), std::format("Cannot assign to constant {}.", e->get_name().lexeme()));
+	}
+
+	note_write(e);
+
 	auto compa = check_type_assignment(e->get_name(), static_pointer_cast<named_symbol>(symbol)->type(), value_type);
 
 	return get<0>(compa);
@@ -92,6 +99,8 @@ std::shared_ptr<lox_type> resolver::visit_binary_expression(const std::shared_pt
 
 		call_expr->annotate<call_annotation>(stmt, function_ids_.at(stmt), call_annotation::FB_METHOD);
 
+		mark_impure(); // overloaded operators call methods
+
 	}
 
 	return get<0>(ret);
@@ -101,6 +110,12 @@ std::shared_ptr<lox_type> resolver::visit_unary_expression(const std::shared_ptr
 {
 	auto type = resolve(ue->get_right());
 
+	if (auto op = ue->get_op().type();op == scanning::token_type::PLUS_PLUS || op == scanning::token_type::MINUS_MINUS)
+	{
+		check_constant_write(ue->get_right(), ue->get_op());
+		note_write(ue->get_right());
+	}
+
 	auto ret = check_type_unary_expression(ue->get_op(), type);
 	return get<0>(ret);
 }
@@ -126,6 +141,9 @@ std::shared_ptr<lox_type> resolver::visit_postfix_expression(const std::shared_p
 	}
 	else
 	{
+		check_constant_write(pe->get_left(), pe->get_op());
+		note_write(pe->get_left());
+
 		auto ret = check_type_postfix_expression(pe->get_op(), type, nullptr);
 		return get<0>(ret);
 	}
@@ -280,6 +298,8 @@ std::shared_ptr<lox_type> resolver::visit_set_expression(const std::shared_ptr<s
 
 	se->annotate<class_annotation>(class_type);
 
+	mark_impure();
+
 	auto property_type = class_type->fields()[se->get_name().lexeme()];
 
 	auto ret = check_type_assignment(se->get_name(), property_type, value_type);
@@ -379,6 +399,19 @@ std::shared_ptr<lox_type> resolver::visit_call_expression(const std::shared_ptr<
 
 	auto return_type = callable->return_type();
 
+	specialize_call(ce, callable, args);
+
+	// only calls to plain functions may keep the caller pure
+	if (auto annotation = ce->get_annotation<call_annotation>();
+		annotation && !annotation->is_method() && !annotation->is_ctor() && annotation->statement())
+	{
+		function_effects_[cur_func_id_.top()].callees.push_back(annotation->id());
+	}
+	else
+	{
+		mark_impure();
+	}
+
 	if (ce->get_callee()->get_type() == parsing::PC_TYPE_base_expression)
 	{
 		auto annotation = ce->get_callee()->get_annotation<base_annotation>();
@@ -39,6 +39,7 @@
 #include <format>
 #include <ranges>
 #include <tuple>
+#include <unordered_set>
 
 #include <cassert>
 
@@ -316,6 +317,18 @@ std::shared_ptr<symbol> resolver::resolve_local(const shared_ptr<expression>& ex
 	return nullptr;
 }
 
+void resolver::check_constant_write(const shared_ptr<parsing::expression>& target, const scanning::token& tk)
+{
+	auto var = dynamic_pointer_cast<var_expression>(target);
+	if (!var)return;
+
+	if (auto annotation = var->get_annotation<variable_annotation>();
+		annotation && annotation->symbol() && annotation->symbol()->is_const())
+	{
+		type_error(tk, std::format("Cannot modify constant {}.", var->get_name().lexeme()));
+	}
+}
+
 std::shared_ptr<lox_type> resolver::type_lookup(const scanning::token& tk)
 {
 	for (auto& scoop : scopes_)
@@ -470,3 +483,134 @@ optional<function_id_type> resolver::function_id(const shared_ptr<parsing::state
 }
 
 
+bool resolver::is_pure(const shared_ptr<parsing::statement>& stmt) const
+{
+	auto id = function_id(stmt);
+	if (!id)
+	{
+		return false;
+	}
+
+	// recursion alone never makes a function impure
+	unordered_set<function_id_type> visited{};
+	vector<function_id_type> work{ id.value() };
+	while (!work.empty())
+	{
+		auto func = work.back();
+		work.pop_back();
+
+		if (!visited.insert(func).second || !function_effects_.contains(func))
+		{
+			continue;
+		}
+
+		const auto& effects = function_effects_.at(func);
+		if (effects.impure)
+		{
+			return false;
+		}
+
+		work.insert(work.end(), effects.callees.begin(), effects.callees.end());
+	}
+
+	return true;
+}
+
+void resolver::mark_impure()
+{
+	function_effects_[cur_func_id_.top()].impure = true;
+}
+
+void resolver::note_write(const shared_ptr<parsing::expression>& target)
+{
+	auto annotation = target->get_annotation<variable_annotation>();
+	if (!annotation || !annotation->symbol() || annotation->upvalue() || annotation->symbol()->is_global())
+	{
+		mark_impure();
+	}
+}
+
+vector<function_specialization> resolver::specializations(const shared_ptr<parsing::statement>& stmt) const
+{
+	if (specializations_.contains(stmt))
+	{
+		return specializations_.at(stmt);
+	}
+
+	return {};
+}
+
+optional<function_id_type> resolver::specialization_of(const shared_ptr<parsing::call_expression>& ce) const
+{
+	if (call_specializations_.contains(ce))
+	{
+		return call_specializations_.at(ce);
+	}
+
+	return std::nullopt;
+}
+
+void resolver::specialize_call(const shared_ptr<parsing::call_expression>& ce,
+		const shared_ptr<lox_callable_type>& callable,
+		const vector<shared_ptr<lox_type>>& args)
+{
+	auto annotation = ce->get_annotation<call_annotation>();
+	if (!annotation || annotation->is_method() || annotation->is_ctor() || !annotation->statement() ||
+		callable->param_size() != args.size())
+	{
+		return;
+	}
+
+	vector<type_id> param_types(args.size(), PRIMITIVE_TYPE_ID_ANY);
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		// parameters taking more than one type, which unions, object and any do
+		if (auto param = callable->param_type(i);!lox_type::is_union(*param) &&
+			param->id() != PRIMITIVE_TYPE_ID_OBJECT && param->id() != PRIMITIVE_TYPE_ID_ANY)
+		{
+			continue;
+		}
+
+		// only numbers have specialized operations
+		if (auto id = args[i]->id();id == PRIMITIVE_TYPE_ID_INTEGER || id == PRIMITIVE_TYPE_ID_FLOATING)
+		{
+			param_types[i] = id;
+		}
+	}
+
+	if (ranges::all_of(param_types, [](type_id id)
+	{
+		return id == PRIMITIVE_TYPE_ID_ANY;
+	}))
+	{
+		return;
+	}
+
+	auto& clones = specializations_[annotation->statement()];
+	if (auto iter = ranges::find(clones, param_types, &function_specialization::param_types);iter != clones.end())
+	{
+		call_specializations_.insert_or_assign(ce, iter->id);
+		return;
+	}
+
+	if (clones.size() >= SPECIALIZATION_LIMIT)
+	{
+		return; // the generic one serves the others
+	}
+
+	auto id = next_function_id(ce->get_paren());
+	if (id == FUNCTION_ID_INVALID)
+	{
+		return;
+	}
+
+	clones.push_back(function_specialization{ .id = id, .param_types = std::move(param_types) });
+	call_specializations_.insert_or_assign(ce, id);
+}
+
+
+void resolver::skip_code_generation()
+{
+	global_scope_->skip_children();
+}
+
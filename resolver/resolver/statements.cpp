@@ -133,8 +133,12 @@ void resolver::visit_class_statement(const std::shared_ptr<class_statement>& cls
 {
 	cur_class_.push(env_class_type::CT_CLASS);
 
+	mark_impure(); // the class object is created at runtime, and its methods are resolved as part of this function
+
 	auto[class_type, base_class_type, this_type] = resolve_class_type_decl(cls);
 
+	hierarchy_.add_class(cls, class_type, base_class_type);
+
 	/* The scope structure for class:
 	 * scope {
 	 * 	base:base_type
@@ -308,12 +312,21 @@ void resolver::visit_expression_statement(const std::shared_ptr<parsing::express
 void resolver::visit_print_statement(const std::shared_ptr<parsing::print_statement>& pe)
 {
 	resolve(pe->get_expr());
+
+	mark_impure();
 }
 
 void resolver::visit_variable_statement(const std::shared_ptr<parsing::variable_statement>& stmt)
 {
 	declare_name(stmt->get_name());
 
+	bool is_const = stmt->get_keyword().type() == scanning::token_type::CONST;
+	if (is_const && !stmt->get_initializer())
+	{
+		logger::instance().error(stmt->get_name(),
+				std::format("Constant {} should be initialized when it is declared.", stmt->get_name().lexeme()));
+	}
+
 	shared_ptr<lox_type> initializer_type{ nullptr };
 
 
@@ -363,6 +376,15 @@ void resolver::visit_variable_statement(const std::shared_ptr<parsing::variable_
 	}
 
 	this->define_name(stmt->get_name(), var_type, 0, cur_class_.top() == env_class_type::CT_NONE);
+
+	if (!scopes_.empty())
+	{
+		auto symbol = scopes_.top()->name_typed<named_symbol>(stmt->get_name().lexeme());
+		symbol->set_const(is_const);
+
+		// so that later passes can find the variable, and the value of a constant, from its declaration
+		stmt->annotate<variable_annotation>(0, symbol);
+	}
 }
 
 void resolver::visit_block_statement(const std::shared_ptr<parsing::block_statement>& blk)
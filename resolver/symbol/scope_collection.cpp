@@ -33,13 +33,13 @@ std::shared_ptr<scope> clox::resolving::scope_iterator::operator*()
 
 scope_iterator& scope_iterator::operator++()
 {
-	if (data_->last() == data_->children_.end())
+	if (data_->next_child_ == data_->children_.size())
 	{
 		data_ = nullptr;
 	}
 	else
 	{
-		data_ = *(data_->last()++);
+		data_ = data_->children_[data_->next_child_++];
 		data_->visit_count_++;
 	}
 
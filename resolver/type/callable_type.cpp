@@ -24,8 +24,10 @@
 #include <helper/enum.h>
 
 #include "type/callable_type.h"
+#include "type/union_type.h"
 
 #include <cassert>
+#include <algorithm>
 #include <tuple>
 #include <utility>
 #include <format>
@@ -228,6 +230,25 @@ lox_overloaded_metatype::get(const std::vector<std::shared_ptr<lox_type>>& param
 	return std::make_tuple(node->stmt_, node->callable_);
 }
 
+/// how far the argument type derives from the parameter type; a union parameter is as far as the nearest type in it
+static type_id_diff distance(const lox_type& param, const lox_type& arg)
+{
+	if (lox_type::is_union(param))
+	{
+		type_id_diff ret = INT64_MAX;
+		for (const auto& child: dynamic_cast<const lox_union_type&>(param))
+		{
+			if (lox_type::unify(*child, arg))
+			{
+				ret = std::min(ret, distance(*child, arg));
+			}
+		}
+		return ret;
+	}
+
+	return arg.id() - param.id();
+}
+
 std::shared_ptr<lox_overloaded_metatype::lox_overloaded_node>
 lox_overloaded_metatype::overloading_resolve(std::vector<std::shared_ptr<lox_type>>::iterator param_iter,
 		const std::vector<std::shared_ptr<lox_type>>::iterator end,
@@ -252,9 +273,7 @@ lox_overloaded_metatype::overloading_resolve(std::vector<std::shared_ptr<lox_typ
 	{
 		if (lox_type::unify(*iter.first, **param_iter))
 		{
-			auto base_object = std::static_pointer_cast<lox_object_type>(iter.first);
-			auto derive_object = std::static_pointer_cast<lox_object_type>(*param_iter);
-			if (auto d = derive_object->id() - base_object->id();d <= diff)
+			if (auto d = distance(*iter.first, **param_iter);d <= diff)
 			{
 				auto next_node = overloading_resolve(param_iter + 1, end, iter.second);
 				if (next_node)
@@ -3,8 +3,10 @@
 
 #include "type/lox_type.h"
 #include "type/instance_type.h"
+#include "type/union_type.h"
 
 #include <tuple>
+#include <algorithm>
 #include <utility>
 #include <format>
 
@@ -36,6 +38,26 @@ bool lox_type::unify(const lox_type& base, const lox_type& derived)
 		return false;
 	}
 
+	// a union is assignable if every type it may hold is
+	if (lox_type::is_union(derived))
+	{
+		const auto& derived_union = dynamic_cast<const lox_union_type&>(derived);
+		return std::ranges::all_of(derived_union, [&base](const auto& child)
+		{
+			return unify(base, *child);
+		});
+	}
+
+	// and one may be assigned to a union if any of its types accepts it
+	if (lox_type::is_union(base))
+	{
+		const auto& base_union = dynamic_cast<const lox_union_type&>(base);
+		return std::ranges::any_of(base_union, [&derived](const auto& child)
+		{
+			return unify(*child, derived);
+		});
+	}
+
 	return derived < base;
 
 }
@@ -112,8 +112,9 @@ class token final
 public:
 	static inline constexpr empty_literal_tag empty_literal;
 
-	[[nodiscard]] explicit token(token_type t, std::string lexeme, literal_value_type lit, size_t line)
-			: type_(t), lexeme_(std::move(lexeme)), literal_(std::move(lit)), line_(line)
+	[[nodiscard]] explicit token(token_type t, std::string lexeme, literal_value_type lit, size_t line,
+			size_t column = 0)
+			: type_(t), lexeme_(std::move(lexeme)), literal_(std::move(lit)), line_(line), column_(column)
 	{
 	}
 
@@ -150,11 +151,18 @@ public:
 		return line_;
 	}
 
+	/// \return 1-based column of the first character, or 0 if unknown
+	[[nodiscard]] size_t column() const
+	{
+		return column_;
+	}
+
 private:
 	token_type type_;
 	std::string lexeme_;
 	literal_value_type literal_;
 	size_t line_;
+	size_t column_;
 };
 
 class scanner final
@@ -208,6 +216,8 @@ private:
 
 	void scan_next_token();
 
+	void new_line();
+
 	void add_token(token_type t);
 
 	void add_token(token_type t, const literal_value_type& literal);
@@ -240,6 +250,7 @@ private:
 	std::string src_;
 	std::vector<token> tokens_{};
 	size_t start_{ 0 }, cur_{ 0 }, line_{ 1 };
+	size_t line_start_{ 0 }, start_column_{ 1 };
 };
 }
 
@@ -37,10 +37,11 @@ std::vector<token> clox::scanning::scanner::scan()
 	while (!is_end())
 	{
 		start_ = cur_;
+		start_column_ = start_ - line_start_ + 1;
 		scan_next_token();
 	}
 
-	tokens_.emplace_back(token_type::FEND, "", token::empty_literal, line_);
+	tokens_.emplace_back(token_type::FEND, "", token::empty_literal, line_, cur_ - line_start_ + 1);
 	return tokens_;
 }
 
@@ -52,7 +53,13 @@ void scanner::add_token(token_type t)
 
 void scanner::add_token(token_type t, const literal_value_type& literal)
 {
-	tokens_.emplace_back(t, whole_lexeme(), literal, line_);
+	tokens_.emplace_back(t, whole_lexeme(), literal, line_, start_column_);
+}
+
+void scanner::new_line()
+{
+	line_++;
+	line_start_ = cur_;
 }
 
 char scanner::advance()
@@ -89,8 +96,8 @@ void scanner::scan_string()
 {
 	while (peek() != '"' && !is_end())
 	{
-		if (peek() == '\n')line_++;
 		advance();
+		if (src_.at(cur_ - 1) == '\n')new_line();
 	}
 
 	if (is_end())
@@ -256,7 +263,7 @@ void scanner::scan_next_token()
 		break;
 
 	case '\n':
-		line_++;
+		new_line();
 		break;
 
 	case '"':
@@ -286,7 +293,7 @@ void scanner::consume_block_comment()
 	while (!is_end())
 	{
 		auto c = advance();
-		if (c == '\n')line_++;
+		if (c == '\n')new_line();
 		else if (c == '*' && peek() == '/')
 		{
 			[[maybe_unused]]auto _ = advance(); // eat "/"
@@ -0,0 +1,86 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <base/configuration.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+using namespace std;
+
+class AllocationProfilerTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+	}
+
+	virtual void TearDown()
+	{
+		clox::base::configurable_configuration_instance().set_allocation_profile(false, 4096);
+
+		clox::logging::logger::instance().clear_error();
+	}
+};
+
+TEST_F(AllocationProfilerTest, SiteLineTest)
+{
+	// sample every allocation
+	clox::base::configurable_configuration_instance().set_allocation_profile(true, 1);
+
+	test_scaffold_console cons{};
+	auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+	ASSERT_EQ(clox::driver::run_code(cons, adapter, R"(
+fun build(n:integer):string {
+    var s="";
+    for (var i=0; i < n; i=i + 1) {
+        s=s + "x";
+    }
+    return s;
+}
+
+print build(100);
+)"), 0);
+
+	auto report = cons.get_log_text();
+	ASSERT_NE(report.find("Allocation sites"), string::npos) << report;
+
+	// the concatenation on line 5 allocates a string every iteration
+	ASSERT_NE(report.find("build:5 "), string::npos) << report;
+}
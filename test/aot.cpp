@@ -0,0 +1,74 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/16/2022.
+//
+
+#include <test_program_comparison.h>
+
+#include <base/configuration.h>
+
+#include <interpreter/vm/native_module.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace std;
+
+class AotTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+	}
+
+	virtual void TearDown()
+	{
+		clox::base::configurable_configuration_instance().set_aot(false);
+		clox::base::configurable_configuration_instance().set_show_tiering(false);
+
+		clox::logging::logger::instance().clear_error();
+	}
+};
+
+TEST_F(AotTest, SameOutputAsInterpreterTest)
+{
+	if (!clox::interpreting::vm::native_module::available())
+	{
+		GTEST_SKIP();
+	}
+
+	auto compiled = test_program_comparison::compare([]
+	{
+		clox::base::configurable_configuration_instance().set_aot(true);
+	});
+
+	// functions stay interpreted without a C compiler, where comparing only the output would pass as well
+	ASSERT_GT(compiled, 0);
+}
@@ -0,0 +1,206 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <base/configuration.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <interpreter/vm/bytecode_cache.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+using clox::interpreting::vm::bytecode_cache;
+
+class BytecodeCacheTest : public ::testing::Test
+{
+
+protected:
+
+	static inline const string CODE = R"(
+fun fib(n:integer):integer {
+  if (n < 2) return n;
+  return fib(n - 1) + fib(n - 2);
+}
+
+var greeting="hello";
+print greeting + " " + "cache";
+print fib(15);
+)";
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+		path_ = (filesystem::temp_directory_path() / std::format("clox_cache_{}.loxc", random_device{}())).string();
+	}
+
+	virtual void TearDown()
+	{
+		filesystem::remove(path_);
+
+		clox::base::configurable_configuration_instance().set_optimize(true);
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	[[nodiscard]] clox::driver::bytecode_cache_target target() const
+	{
+		return { path_, bytecode_cache::hash_of(CODE) };
+	}
+
+	/// \brief compile and run CODE, saving the cache
+	string save()
+	{
+		test_scaffold_console cons{};
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+		EXPECT_EQ(clox::driver::run_code(cons, adapter, CODE, target()), 0);
+		EXPECT_TRUE(filesystem::exists(path_));
+
+		return cons.get_written_text();
+	}
+
+	/// \return the output of running the cache, or nullopt if it is rejected
+	optional<string> load(const clox::driver::bytecode_cache_target& cache)
+	{
+		clox::logging::logger::instance().clear_error();
+
+		test_scaffold_console cons{};
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+		auto ret = adapter->cached_code(cache);
+		if (!ret)
+		{
+			return nullopt;
+		}
+
+		EXPECT_EQ(ret.value(), 0);
+		return cons.get_written_text();
+	}
+
+	[[nodiscard]] string read_file() const
+	{
+		ifstream file{ path_, ios::binary };
+		stringstream ss{};
+		ss << file.rdbuf();
+		return ss.str();
+	}
+
+	void write_file(const string& content) const
+	{
+		ofstream file{ path_, ios::binary | ios::trunc };
+		file << content;
+	}
+
+	string path_{};
+};
+
+TEST_F(BytecodeCacheTest, SaveAndLoadTest)
+{
+	auto compiled = save();
+
+	auto cached = load(target());
+	ASSERT_TRUE(cached.has_value());
+	ASSERT_EQ(cached.value(), compiled);
+}
+
+TEST_F(BytecodeCacheTest, StaleSourceHashTest)
+{
+	save();
+
+	auto cache = target();
+	cache.source_hash = bytecode_cache::hash_of(CODE + "print 1;");
+
+	ASSERT_FALSE(load(cache).has_value());
+}
+
+TEST_F(BytecodeCacheTest, CodegenOptionsTest)
+{
+	save();
+
+	// optimized bytecode is never run by --no-optimize, and the other way round
+	clox::base::configurable_configuration_instance().set_optimize(false);
+	ASSERT_FALSE(load(target()).has_value());
+
+	save();
+	ASSERT_TRUE(load(target()).has_value());
+
+	clox::base::configurable_configuration_instance().set_optimize(true);
+	ASSERT_FALSE(load(target()).has_value());
+}
+
+TEST_F(BytecodeCacheTest, MissingFileTest)
+{
+	ASSERT_FALSE(load(target()).has_value());
+}
+
+TEST_F(BytecodeCacheTest, TruncatedTest)
+{
+	save();
+	const auto image = read_file();
+
+	// every prefix misses at least the index of the top level function
+	for (size_t size = 0; size < image.size(); size += std::max<size_t>(image.size() / 64, 1))
+	{
+		SCOPED_TRACE(size);
+
+		write_file(image.substr(0, size));
+		ASSERT_FALSE(load(target()).has_value());
+	}
+}
+
+TEST_F(BytecodeCacheTest, CorruptedTest)
+{
+	save();
+	const auto image = read_file();
+
+	auto bad_magic = image;
+	bad_magic[0] = static_cast<char>(~bad_magic[0]);
+	write_file(bad_magic);
+	ASSERT_FALSE(load(target()).has_value());
+
+	auto bad_version = image;
+	bad_version[sizeof(uint32_t)] = static_cast<char>(~bad_version[sizeof(uint32_t)]);
+	write_file(bad_version);
+	ASSERT_FALSE(load(target()).has_value());
+
+	write_file(image + "trailing");
+	ASSERT_FALSE(load(target()).has_value());
+}
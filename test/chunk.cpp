@@ -0,0 +1,237 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <interpreter/vm/chunk.h>
+#include <interpreter/vm/opcode.h>
+#include <interpreter/vm/heap.h>
+#include <interpreter/vm/constant_pool.h>
+
+#include <object/list_object.h>
+#include <object/string_object.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+using namespace clox::interpreting::vm;
+
+class ChunkTest : public ::testing::Test
+{
+
+protected:
+
+	/// \brief operands at both sides of each LEB128 width, with their encoded sizes
+	static inline const vector<pair<chunk::operand_type, size_t>> WIDTH_BOUNDARIES{
+			{ 0, 1 },
+			{ 127, 1 },
+			{ 128, 2 },
+			{ (1u << 14) - 1, 2 },
+			{ 1u << 14, 3 },
+			{ (1u << 21) - 1, 3 },
+			{ 1u << 21, 4 },
+			{ (1u << 28) - 1, 4 },
+			{ 1u << 28, 5 },
+			{ numeric_limits<chunk::operand_type>::max(), 5 },
+	};
+};
+
+TEST_F(ChunkTest, OperandWidthTest)
+{
+	for (const auto& [operand, size]: WIDTH_BOUNDARIES)
+	{
+		SCOPED_TRACE(operand);
+
+		chunk ck{ "leb128" };
+		ck.write(compose_opcode(0, op_code::CONSTANT));
+		ck.write_operand(operand);
+
+		ASSERT_EQ(chunk::operand_size(operand), size);
+		ASSERT_EQ(ck.count(), 1 + size);
+
+		auto decoded = ck.decode_instruction(0);
+		ASSERT_EQ(decoded.instruction, compose_opcode(0, op_code::CONSTANT));
+		ASSERT_EQ(decoded.operands, vector<chunk::operand_type>{ operand });
+		ASSERT_EQ(decoded.next_offset, 1 + size);
+	}
+}
+
+TEST_F(ChunkTest, SecondaryOpcodeTest)
+{
+	// SEC_OP_CTOR is beyond 7 bits, so the secondary opcode takes two bytes after the header
+	const auto op = compose_opcode(SEC_OP_GLOBAL | SEC_OP_CTOR, op_code::GET);
+
+	chunk ck{ "secondary" };
+	ck.write(op);
+	ck.write_operand(300);
+	ck.write(compose_opcode(0, op_code::RETURN));
+
+	auto decoded = ck.decode_instruction(0);
+	ASSERT_EQ(decoded.instruction, op);
+	ASSERT_EQ(decoded.operands, vector<chunk::operand_type>{ 300 });
+	ASSERT_EQ(decoded.next_offset, 1 + 2 + 2);
+
+	ASSERT_EQ(ck.decode_instruction(decoded.next_offset).instruction, compose_opcode(0, op_code::RETURN));
+}
+
+TEST_F(ChunkTest, PlaceholderTest)
+{
+	for (const auto& [operand, size]: WIDTH_BOUNDARIES)
+	{
+		SCOPED_TRACE(operand);
+
+		chunk ck{ "placeholder" };
+		ck.write(compose_opcode(0, op_code::JUMP));
+		auto offset = ck.write_placeholder();
+		ck.write(compose_opcode(0, op_code::RETURN));
+
+		// patching never moves the code after the placeholder, whatever the width of the operand
+		ck.patch_operand(offset, operand);
+		ASSERT_EQ(ck.count(), 1 + chunk::MAX_OPERAND_SIZE + 1);
+
+		auto decoded = ck.decode_instruction(0);
+		ASSERT_EQ(decoded.operands, vector<chunk::operand_type>{ operand });
+		ASSERT_EQ(decoded.next_offset, 1 + chunk::MAX_OPERAND_SIZE);
+		ASSERT_EQ(ck.decode_instruction(decoded.next_offset).instruction, compose_opcode(0, op_code::RETURN));
+	}
+}
+
+TEST_F(ChunkTest, LineTableTest)
+{
+	chunk ck{ "lines" };
+
+	// the operand, and instructions without a location, belong to the run before them
+	ck.write(compose_opcode(0, op_code::CONSTANT), 1, 5);
+	ck.write_operand(1000);
+	ck.write(compose_opcode(0, op_code::NEGATE), 1, 5);
+	ck.write(compose_opcode(0, op_code::PRINT), 2, 1);
+	ck.write(compose_opcode(0, op_code::CONSTANT_NIL));
+	ck.write(compose_opcode(0, op_code::POP), 7, 3);
+	ck.write(compose_opcode(0, op_code::RETURN), 7, 9);
+
+	const vector<tuple<int64_t, int64_t>> expected{
+			{ 1, 5 }, // CONSTANT
+			{ 1, 5 }, // NEGATE
+			{ 2, 1 }, // PRINT
+			{ 2, 1 }, // CONSTANT_NIL
+			{ 7, 3 }, // POP
+			{ 7, 9 }, // RETURN
+	};
+
+	// the virtual machine asks for the location once it has read the instruction header
+	uint64_t offset = 0;
+	for (const auto& [line, column]: expected)
+	{
+		SCOPED_TRACE(offset);
+
+		auto ip = ck.begin() + static_cast<chunk::difference_type>(offset) + 1;
+		ASSERT_EQ(ck.line_of(ip), line);
+		ASSERT_EQ(ck.column_of(ip), column);
+
+		offset = ck.decode_instruction(offset).next_offset;
+	}
+
+	ASSERT_EQ(offset, ck.count());
+
+	// ip after the operand is still covered by the run of its instruction
+	ASSERT_EQ(ck.line_of(ck.begin() + 1 + chunk::operand_size(1000)), 1);
+}
+
+TEST_F(ChunkTest, NoLineTest)
+{
+	chunk ck{ "no lines" };
+	ck.write(compose_opcode(0, op_code::RETURN));
+
+	ASSERT_EQ(ck.line_of(ck.begin() + 1), chunk::INVALID_LINE);
+	ASSERT_EQ(ck.column_of(ck.begin() + 1), chunk::INVALID_COLUMN);
+}
+
+TEST_F(ChunkTest, ConstantDeduplicationTest)
+{
+	chunk ck{ "constants" };
+
+	auto one_and_half = ck.add_constant(floating_value_type{ 1.5 });
+	ASSERT_EQ(ck.add_constant(floating_value_type{ 1.5 }), one_and_half);
+
+	// equal, but not interchangeable
+	auto zero = ck.add_constant(floating_value_type{ 0.0 });
+	auto negative_zero = ck.add_constant(floating_value_type{ -0.0 });
+	ASSERT_NE(zero, negative_zero);
+	ASSERT_EQ(ck.add_constant(floating_value_type{ -0.0 }), negative_zero);
+
+	// NaN never equals itself, so it is never merged
+	ASSERT_NE(ck.add_constant(numeric_limits<floating_value_type>::quiet_NaN()),
+			ck.add_constant(numeric_limits<floating_value_type>::quiet_NaN()));
+
+	ASSERT_NE(ck.add_constant(integer_value_type{ 1 }), ck.add_constant(floating_value_type{ 1.0 }));
+	ASSERT_EQ(ck.add_constant(true), ck.add_constant(true));
+
+	// the index is rebuilt from the constants after it is dropped
+	ck.seal();
+	ASSERT_EQ(ck.add_constant(floating_value_type{ 1.5 }), one_and_half);
+}
+
+TEST_F(ChunkTest, ObjectConstantTest)
+{
+	test_scaffold_console cons{};
+	auto heap = make_shared<object_heap>(cons);
+
+	chunk ck{ "objects" };
+
+	auto str = ck.add_constant(string_object::create_on_heap(heap, "lox"));
+	ASSERT_EQ(ck.add_constant(string_object::create_on_heap(heap, "lox")), str);
+	ASSERT_NE(ck.add_constant(string_object::create_on_heap(heap, "clox")), str);
+
+	// other objects may be placeholders patched later
+	object_value_type list = heap->allocate<list_object>(vector<value>{});
+	ASSERT_NE(ck.add_constant(list), ck.add_constant(list));
+}
+
+TEST_F(ChunkTest, NamePoolTest)
+{
+	auto pool = make_shared<constant_pool>();
+
+	chunk first{ "first" }, second{ "second" };
+
+	auto name = first.add_name(pool, "counter");
+	ASSERT_EQ(first.add_name(pool, "counter"), name);
+
+	second.add_name(pool, "counter");
+	second.add_name(pool, "total");
+
+	// both chunks view the same pooled name
+	ASSERT_EQ(pool->size(), 2);
+	ASSERT_EQ(get<variable_name_type>(first.constant_at(name)).data(),
+			get<variable_name_type>(second.constant_at(0)).data());
+}
@@ -65,6 +65,22 @@ protected:
 	const char* inheritance_out_{
 #include "class/inheritance.out"
 	};
+
+	const char* accessor_{
+#include "class/accessor.txt"
+	};
+
+	const char* accessor_out_{
+#include "class/accessor.out"
+	};
+
+	const char* devirtualization_{
+#include "class/devirtualization.txt"
+	};
+
+	const char* devirtualization_out_{
+#include "class/devirtualization.out"
+	};
 };
 
 #include <driver/run.h>
@@ -94,4 +110,26 @@ TEST_F(ClassTest, InheritanceTest)
 
 	auto output = cons.get_written_text();
 	ASSERT_NE(output.find(inheritance_out_), string::npos);
-}
\ No newline at end of file
+}
+
+TEST_F(ClassTest, AccessorTest)
+{
+	test_scaffold_console cons{};
+
+	int ret = run_code(cons,test_interpreter_adapater::get(cons), accessor_);
+	ASSERT_EQ(ret, 0);
+
+	auto output = cons.get_written_text();
+	ASSERT_NE(output.find(accessor_out_), string::npos);
+}
+
+TEST_F(ClassTest, DevirtualizationTest)
+{
+	test_scaffold_console cons{};
+
+	int ret = run_code(cons,test_interpreter_adapater::get(cons), devirtualization_);
+	ASSERT_EQ(ret, 0);
+
+	auto output = cons.get_written_text();
+	ASSERT_NE(output.find(devirtualization_out_), string::npos);
+}
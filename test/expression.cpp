@@ -82,6 +82,18 @@ protected:
 #include <expression/ternary.out>
 	};
 
+	const char* constant_{
+#include <expression/constant.txt>
+	};
+
+	const char* constant_out_{
+#include <expression/constant.out>
+	};
+
+	const char* bad_constant_{
+#include <expression/bad_constant.txt>
+	};
+
 
 };
 
@@ -138,4 +150,24 @@ TEST_F(ExpressionTest, TernaryTest)
 	ASSERT_NE(output.find(ternary_out_), string::npos);
 }
 
+TEST_F(ExpressionTest, ConstantTest)
+{
+	test_scaffold_console cons{};
+
+	int ret = run_code(cons,test_interpreter_adapater::get(cons), constant_);
+	ASSERT_EQ(ret, 0);
+
+	auto output = cons.get_written_text();
+	ASSERT_NE(output.find(constant_out_), string::npos);
+}
+
+TEST_F(ExpressionTest, BadConstantTest)
+{
+	test_scaffold_console cons{};
 
+	int ret = run_code(cons,test_interpreter_adapater::get(cons), bad_constant_);
+	ASSERT_NE(ret, 0);
+
+	auto output = cons.get_error_text();
+	ASSERT_NE(output.find("Cannot assign to constant limit."), string::npos);
+}
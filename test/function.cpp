@@ -63,6 +63,42 @@ protected:
 	};
 
 
+	const char* arithmetic_{
+#include <function/arithmetic.txt>
+	};
+
+	const char* arithmetic_out_{
+#include <function/arithmetic.out>
+	};
+
+	const char* specialization_{
+#include <function/specialization.txt>
+	};
+
+	const char* specialization_out_{
+#include <function/specialization.out>
+	};
+
+	const char* pure_{
+#include <function/pure.txt>
+	};
+
+	const char* pure_out_{
+#include <function/pure.out>
+	};
+
+	const char* integer_limits_{
+#include <function/integer_limits.txt>
+	};
+
+	const char* integer_limits_out_{
+#include <function/integer_limits.out>
+	};
+
+	const char* integer_overflow_{
+#include <function/integer_overflow.txt>
+	};
+
 	const char* simple_recursive_{
 #include <function/simple_recursive.txt>
 	};
@@ -87,6 +123,7 @@ protected:
 };
 
 #include <driver/run.h>
+#include <driver/adapter/vm.h>
 
 
 using namespace std;
@@ -136,4 +173,60 @@ TEST_F(FunctionTest, RecursiveTest)
 
 	auto output = cons.get_written_text();
 	ASSERT_NE(output.find(complex_out_), string::npos);
-}
\ No newline at end of file
+}
+
+TEST_F(FunctionTest, ArithmeticTest)
+{
+	test_scaffold_console cons{};
+
+	int ret = run_code(cons, make_shared<vm_interpreter_adapter>(cons), arithmetic_);
+	ASSERT_EQ(ret, 0);
+
+	auto output = cons.get_written_text();
+	ASSERT_NE(output.find(arithmetic_out_), string::npos);
+}
+
+TEST_F(FunctionTest, SpecializationTest)
+{
+	test_scaffold_console cons{};
+
+	int ret = run_code(cons, make_shared<vm_interpreter_adapter>(cons), specialization_);
+	ASSERT_EQ(ret, 0);
+
+	auto output = cons.get_written_text();
+	ASSERT_NE(output.find(specialization_out_), string::npos);
+}
+
+TEST_F(FunctionTest, PureEvaluationTest)
+{
+	test_scaffold_console cons{};
+
+	int ret = run_code(cons, make_shared<vm_interpreter_adapter>(cons), pure_);
+	ASSERT_EQ(ret, 0);
+
+	auto output = cons.get_written_text();
+	ASSERT_NE(output.find(pure_out_), string::npos);
+}
+
+TEST_F(FunctionTest, IntegerLimitsTest)
+{
+	// the virtual machine specializes integer arithmetic, which must stay exact near the limits
+	test_scaffold_console cons{};
+
+	int ret = run_code(cons, make_shared<vm_interpreter_adapter>(cons), integer_limits_);
+	ASSERT_EQ(ret, 0);
+
+	auto output = cons.get_written_text();
+	ASSERT_NE(output.find(integer_limits_out_), string::npos);
+}
+
+TEST_F(FunctionTest, IntegerOverflowTest)
+{
+	test_scaffold_console cons{};
+
+	int ret = run_code(cons, make_shared<vm_interpreter_adapter>(cons), integer_overflow_);
+	ASSERT_EQ(ret, 67);
+
+	auto error = cons.get_error_text();
+	ASSERT_NE(error.find("Integer overflow"), string::npos);
+}
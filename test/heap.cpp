@@ -0,0 +1,146 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <base/configuration.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <interpreter/vm/heap.h>
+#include <interpreter/vm/exceptions.h>
+
+#include <object/list_object.h>
+#include <object/string_object.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+using namespace clox::interpreting::vm;
+
+class HeapTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+	}
+
+	virtual void TearDown()
+	{
+		clox::base::configurable_configuration_instance().set_memory_limit(object_heap::UNLIMITED);
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	struct result
+	{
+		int ret;
+		string error;
+	};
+
+	static result run_limited(const string& code, size_t limit)
+	{
+		clox::base::configurable_configuration_instance().set_memory_limit(limit);
+
+		test_scaffold_console cons{};
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+		int ret = clox::driver::run_code(cons, adapter, code);
+		return { ret, cons.get_error_text() };
+	}
+};
+
+TEST_F(HeapTest, BufferAccountingTest)
+{
+	test_scaffold_console cons{};
+	auto heap = make_shared<object_heap>(cons);
+
+	auto before = heap->size();
+	heap->allocate<list_object>(vector<value>(1000));
+	ASSERT_GE(heap->size() - before, sizeof(list_object) + 1000 * sizeof(value));
+
+	before = heap->size();
+	string_object::create_on_heap(heap, string(10000, 'x'));
+	ASSERT_GE(heap->size() - before, 10000);
+}
+
+TEST_F(HeapTest, BufferOverLimitWithoutGCTest)
+{
+	test_scaffold_console cons{};
+	object_heap heap{ cons, 4096 };
+
+	ASSERT_THROW(heap.allocate<list_object>(vector<value>(1000)), heap_memory_limit_exceeded);
+}
+
+TEST_F(HeapTest, GarbageUnderLimitTest)
+{
+	// every string is garbage once the next is built, so collections keep the heap under the limit,
+	// even if a string buffer goes over it before the next collection
+	auto res = run_limited(R"(
+fun repeat(s:string, n:integer):string {
+    var ret="";
+    for (var i=0; i < n; i=i + 1) {
+        ret=ret + s;
+    }
+    return ret;
+}
+
+var built=0;
+for (var i=0; i < 100; i=i + 1) {
+    var text=repeat("abcd", 1000);
+    built=built + 1;
+}
+print built;
+)", 64 * 1024);
+
+	ASSERT_EQ(res.ret, 0);
+	ASSERT_TRUE(res.error.empty());
+}
+
+TEST_F(HeapTest, MemoryLimitExceededTest)
+{
+	auto res = run_limited(R"(
+var text="";
+for (var i=0; i < 100000; i=i + 1) {
+    text=text + "abcd";
+}
+print text == "";
+)", 64 * 1024);
+
+	ASSERT_EQ(res.ret, 67);
+	ASSERT_NE(res.error.find("Heap memory limit exceeded"), string::npos);
+}
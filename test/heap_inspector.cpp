@@ -0,0 +1,131 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/19/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+class HeapInspectorTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+		path_ = (filesystem::temp_directory_path() / std::format("clox_heap_{}.json", random_device{}())).string();
+	}
+
+	virtual void TearDown()
+	{
+		filesystem::remove(path_);
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	string dump(const string& code)
+	{
+		test_scaffold_console cons{};
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+		auto source = code;
+		source.replace(source.find("$PATH"), 5, path_);
+
+		EXPECT_EQ(clox::driver::run_code(cons, adapter, source), 0);
+
+		ifstream file{ path_ };
+		stringstream ss{};
+		ss << file.rdbuf();
+		return ss.str();
+	}
+
+	string path_{};
+};
+
+TEST_F(HeapInspectorTest, DumpFromLoxTest)
+{
+	auto snapshot = dump(R"(
+class Point {
+  var x:integer;
+
+  constructor(x:integer) {
+    this.x=x;
+  }
+}
+
+var points:list[Point]=list{Point(1),Point(2),Point(3)};
+heap_dump("$PATH");
+)");
+
+	ASSERT_NE(snapshot.find(R"("Point":{"count":3,)"), string::npos);
+	ASSERT_NE(snapshot.find(R"("edges":[)"), string::npos);
+	ASSERT_NE(snapshot.find(R"("roots":[)"), string::npos);
+
+	// the list is the only way to the points, so it dominates them and retains their size
+	const regex node{ R"re(\{"id":(\d+),"type":"(\w+)","name":"(\w*)","size":(\d+),"retained":(\d+),"dominator":(\d+),"reachable":(\w+)\})re" };
+
+	string list_id{};
+	size_t list_retained{ 0 }, points_size{ 0 };
+	vector<string> point_dominators{};
+
+	for (sregex_iterator iter{ snapshot.begin(), snapshot.end(), node }; iter != sregex_iterator{}; ++iter)
+	{
+		const auto& m = *iter;
+		if (m[2] == "LIST")
+		{
+			list_id = m[1];
+			list_retained = stoull(m[5]);
+		}
+		else if (m[2] == "INSTANCE" && m[3] == "Point")
+		{
+			point_dominators.push_back(m[6]);
+			points_size += stoull(m[4]);
+		}
+	}
+
+	ASSERT_EQ(point_dominators.size(), 3);
+	for (const auto& dom: point_dominators)
+	{
+		ASSERT_EQ(dom, list_id);
+	}
+
+	ASSERT_GT(list_retained, points_size);
+}
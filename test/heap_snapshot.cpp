@@ -0,0 +1,146 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+class HeapSnapshotTest : public ::testing::Test
+{
+
+protected:
+
+	static inline const string PRELUDE = R"(
+var count=0;
+var greeting="hello";
+
+fun bump():integer {
+  count=count + 1;
+  return count;
+}
+
+fun twice(x:integer):integer {
+  return x * 2;
+}
+
+bump();
+bump();
+)";
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+
+		auto id = random_device{}();
+		prelude_path_ = (filesystem::temp_directory_path() / std::format("clox_prelude_{}.lox", id)).string();
+		snapshot_path_ = (filesystem::temp_directory_path() / std::format("clox_prelude_{}.snapshot", id)).string();
+
+		ofstream file{ prelude_path_ };
+		file << PRELUDE;
+	}
+
+	virtual void TearDown()
+	{
+		filesystem::remove(prelude_path_);
+		filesystem::remove(snapshot_path_);
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	void save()
+	{
+		test_scaffold_console cons{};
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+		ASSERT_EQ(clox::driver::run_prelude(cons, adapter, prelude_path_), 0);
+		ASSERT_TRUE(adapter->save_snapshot(snapshot_path_));
+	}
+
+	string prelude_path_{};
+	string snapshot_path_{};
+};
+
+TEST_F(HeapSnapshotTest, RoundTripTest)
+{
+	save();
+
+	test_scaffold_console cons{};
+	auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+	ASSERT_TRUE(adapter->load_snapshot(snapshot_path_));
+
+	// the state left by the prelude is restored without running it again
+	ASSERT_EQ(clox::driver::run_code(cons, adapter, R"(
+print bump();
+print twice(21);
+print greeting + " snapshot";
+)"), 0);
+
+	auto out = cons.get_written_text();
+	ASSERT_NE(out.find("3"), string::npos);
+	ASSERT_NE(out.find("42"), string::npos);
+	ASSERT_NE(out.find("hello snapshot"), string::npos);
+}
+
+TEST_F(HeapSnapshotTest, CorruptedTest)
+{
+	save();
+
+	string image{};
+	{
+		ifstream file{ snapshot_path_, ios::binary };
+		stringstream ss{};
+		ss << file.rdbuf();
+		image = ss.str();
+	}
+
+	for (auto size: { size_t{ 0 }, image.size() / 2, image.size() - 1 })
+	{
+		SCOPED_TRACE(size);
+
+		{
+			ofstream file{ snapshot_path_, ios::binary | ios::trunc };
+			file << image.substr(0, size);
+		}
+
+		test_scaffold_console cons{};
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+		ASSERT_FALSE(adapter->load_snapshot(snapshot_path_));
+	}
+}
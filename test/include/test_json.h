@@ -0,0 +1,99 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/// \brief a strict reader of JSON, for tests checking what the interpreter writes
+class test_json
+{
+public:
+	struct value;
+
+	using array_type = std::vector<value>;
+
+	using object_type = std::vector<std::pair<std::string, value>>;
+
+	struct value
+	{
+		std::variant<std::nullptr_t, bool, double, std::string, array_type, object_type> data{};
+
+		/// \return nullptr if it is not an object or has no such member
+		[[nodiscard]] const value* find(std::string_view key) const;
+
+		[[nodiscard]] bool contains(std::string_view key) const
+		{
+			return find(key) != nullptr;
+		}
+
+		/// \brief the member, which fails the test with an exception if it is missing
+		[[nodiscard]] const value& operator[](std::string_view key) const;
+
+		[[nodiscard]] const array_type& array() const
+		{
+			return std::get<array_type>(data);
+		}
+
+		[[nodiscard]] double number() const
+		{
+			return std::get<double>(data);
+		}
+
+		[[nodiscard]] const std::string& string() const
+		{
+			return std::get<std::string>(data);
+		}
+	};
+
+	/// \return nullopt unless the text is exactly one JSON value, with whitespace around it
+	static std::optional<value> parse(std::string_view text);
+
+private:
+	explicit test_json(std::string_view text) : text_(text)
+	{
+	}
+
+	std::optional<value> parse_value();
+
+	std::optional<std::string> parse_string();
+
+	std::optional<value> parse_number();
+
+	bool consume(std::string_view word);
+
+	void skip_whitespace();
+
+	std::string_view text_{};
+	size_t pos_{ 0 };
+	size_t depth_{ 0 };
+};
@@ -0,0 +1,56 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/// \brief runs the programs in LOX_SRC_DIR interpreted and compiled to machine code, for the JIT and AOT tests
+class test_program_comparison
+{
+public:
+	struct result
+	{
+		int ret;
+		std::string out;
+		std::string error;
+
+		/// \brief functions compiled to machine code, as --show-tiering logs them
+		size_t compiled;
+	};
+
+	/// \brief run the code in the virtual machine as configured now
+	static result run(const std::string& code);
+
+	/// \brief compare the output of every program interpreted and run after configure_compiled
+	/// \return functions compiled to machine code in all the programs
+	static size_t compare(const std::function<void()>& configure_compiled);
+
+private:
+	static inline constexpr auto COMPILED_LOG = "compiled to machine code";
+};
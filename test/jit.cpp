@@ -0,0 +1,104 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/15/2022.
+//
+
+#include <test_program_comparison.h>
+
+#include <base/configuration.h>
+
+#include <interpreter/vm/jit.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <limits>
+#include <string>
+
+using namespace std;
+
+class JitTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+	}
+
+	virtual void TearDown()
+	{
+		clox::base::configurable_configuration_instance().set_jit(false);
+		clox::base::configurable_configuration_instance().set_jit_threshold(100);
+		clox::base::configurable_configuration_instance().set_osr_threshold(1000);
+		clox::base::configurable_configuration_instance().set_jit_background(false);
+		clox::base::configurable_configuration_instance().set_show_tiering(false);
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	/// \return a configuration of the JIT for test_program_comparison::compare
+	static function<void()> jit(size_t call_threshold, size_t osr_threshold, bool background = false)
+	{
+		return [=]
+		{
+			clox::base::configurable_configuration_instance().set_jit(true);
+			clox::base::configurable_configuration_instance().set_jit_threshold(call_threshold);
+			clox::base::configurable_configuration_instance().set_osr_threshold(osr_threshold);
+			clox::base::configurable_configuration_instance().set_jit_background(background);
+		};
+	}
+};
+
+TEST_F(JitTest, SameOutputAsInterpreterTest)
+{
+	// compile every function called
+	auto compiled = test_program_comparison::compare(jit(1, numeric_limits<size_t>::max()));
+
+	// comparing only the output would pass as well if nothing is compiled
+	if (clox::interpreting::vm::baseline_jit::available())
+	{
+		ASSERT_GT(compiled, 0);
+	}
+}
+
+TEST_F(JitTest, OnStackReplacementTest)
+{
+	// functions are never hot for calls, so only loops switch to machine code, in the middle of running
+	auto compiled = test_program_comparison::compare(jit(numeric_limits<size_t>::max(), 1));
+
+	if (clox::interpreting::vm::baseline_jit::available())
+	{
+		ASSERT_GT(compiled, 0);
+	}
+}
+
+TEST_F(JitTest, BackgroundCompilationTest)
+{
+	// code compiled in the background may never be installed before a short program ends, so only outputs are compared
+	test_program_comparison::compare(jit(1, 1, true));
+}
@@ -0,0 +1,194 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <base/configuration.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <helper/perf_counters.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+
+#include <sys/resource.h>
+
+#endif
+
+using namespace std;
+
+using namespace clox::helper;
+
+class PerfCountersTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+		perf_counters::instance().close();
+	}
+
+	virtual void TearDown()
+	{
+		perf_counters::instance().close();
+		clox::base::configurable_configuration_instance().set_perf_counters(false, false);
+		clox::base::configurable_configuration_instance().set_optimize(true);
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	/// \return instructions counted for each function in the report, or nullopt if the report has none
+	static optional<map<string, uint64_t>> function_instructions(const string& report)
+	{
+		map<string, uint64_t> ret{};
+
+		istringstream ss{ report };
+		bool rows{ false };
+		for (string line{}; getline(ss, line);)
+		{
+			istringstream words{ line };
+
+			string name{}, cycles{}, instructions{};
+			words >> name >> cycles >> instructions;
+
+			if (name == "Function")
+			{
+				rows = true;
+			}
+			else if (rows && !instructions.empty())
+			{
+				if (instructions == "n/a")
+				{
+					return nullopt;
+				}
+				ret[name] = stoull(instructions);
+			}
+		}
+
+		return ret;
+	}
+};
+
+TEST_F(PerfCountersTest, OpenFailureTest)
+{
+	auto& perf = perf_counters::instance();
+
+#if defined(__linux__)
+	// no descriptor can be opened, as if perf_event_open were not permitted
+	rlimit saved{};
+	ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &saved), 0);
+
+	rlimit none{ 0, saved.rlim_max };
+	ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &none), 0);
+
+	auto opened = perf.open();
+
+	ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &saved), 0);
+#else
+	auto opened = perf.open();
+#endif
+
+	ASSERT_FALSE(opened);
+	ASSERT_FALSE(perf.enabled());
+	ASSERT_FALSE(perf.error().empty());
+
+	for (auto value: perf.read().values)
+	{
+		ASSERT_EQ(value, 0);
+	}
+
+	// asked for by function, but nothing is counted, and the script runs as usual
+	clox::base::configurable_configuration_instance().set_perf_counters(true, true);
+
+	test_scaffold_console cons{};
+	auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+	ASSERT_EQ(clox::driver::run_code(cons, adapter, R"(
+fun add(a:integer, b:integer):integer {
+    return a + b;
+}
+
+print add(1, 2);
+)"), 0);
+
+	ASSERT_NE(cons.get_written_text().find("3"), string::npos);
+	ASSERT_EQ(cons.get_log_text().find("Function"), string::npos);
+}
+
+TEST_F(PerfCountersTest, RecursiveFunctionTest)
+{
+	if (!perf_counters::instance().open())
+	{
+		GTEST_SKIP() << perf_counters::instance().error();
+	}
+
+	// not inlined, so main keeps its frame
+	clox::base::configurable_configuration_instance().set_optimize(false);
+	clox::base::configurable_configuration_instance().set_perf_counters(true, true);
+
+	test_scaffold_console cons{};
+	auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+	ASSERT_EQ(clox::driver::run_code(cons, adapter, R"(
+fun fib(n:integer):integer {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+fun main():integer {
+    return fib(20);
+}
+
+print main();
+)"), 0);
+
+	auto rows = function_instructions(cons.get_log_text());
+	if (!rows)
+	{
+		GTEST_SKIP() << "instructions are not counted on this processor";
+	}
+
+	ASSERT_TRUE(rows->contains("fib")) << cons.get_log_text();
+	ASSERT_TRUE(rows->contains("main")) << cons.get_log_text();
+
+	// counted once for the outermost call, which main includes, instead of once for every level of the recursion
+	ASSERT_LE(rows->at("fib"), rows->at("main"));
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <base/configuration.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <string>
+
+using namespace std;
+
+class ProfilerTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		if constexpr (!clox::base::runtime_predefined_configuration::ENABLE_PROFILER)
+		{
+			GTEST_SKIP() << "the profiler is not built in";
+		}
+
+		clox::logging::logger::instance().clear_error();
+		path_ = (filesystem::temp_directory_path() / std::format("clox_profile_{}.txt", random_device{}())).string();
+	}
+
+	virtual void TearDown()
+	{
+		clox::base::configurable_configuration_instance().set_profile_output(false, "");
+		clox::base::configurable_configuration_instance().set_optimize(true);
+
+		error_code ec{};
+		filesystem::remove(path_, ec);
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	string path_{};
+};
+
+TEST_F(ProfilerTest, CollapsedStacksTest)
+{
+	// not inlined, so each function keeps its frame
+	clox::base::configurable_configuration_instance().set_optimize(false);
+	clox::base::configurable_configuration_instance().set_profile_output(true, path_);
+
+	test_scaffold_console cons{};
+	auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+	ASSERT_EQ(clox::driver::run_code(cons, adapter, R"(
+fun inner(n:integer):integer {
+    var sum=0;
+    for (var i=0; i < n; i=i + 1) {
+        sum=sum + i;
+    }
+    return sum;
+}
+
+fun outer():integer {
+    return inner(100);
+}
+
+print outer();
+)"), 0);
+
+	adapter.reset(); // the profile is written when the virtual machine is gone, at the latest
+
+	ifstream file{ path_ };
+	ASSERT_TRUE(file.is_open());
+
+	const regex line_pattern{ R"(^([^ ;]+(;[^ ;]+)*) ([0-9]+)$)" };
+
+	size_t lines{ 0 };
+	uint64_t inner_instructions{ 0 };
+	for (string line{}; getline(file, line); lines++)
+	{
+		smatch m{};
+		ASSERT_TRUE(regex_match(line, m, line_pattern)) << line;
+		ASSERT_GT(stoull(m[3]), 0) << line;
+
+		if (m[1] == "<script>;outer;inner")
+		{
+			inner_instructions = stoull(m[3]);
+		}
+	}
+
+	ASSERT_GE(lines, 3); // the script, outer and inner run instructions of their own
+	ASSERT_GT(inner_instructions, 100); // the loop
+}
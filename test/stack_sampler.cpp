@@ -0,0 +1,113 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <helper/stack_sampler.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+using namespace clox::helper;
+
+class StackSamplerTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		if (!stack_sampler::available())
+		{
+			GTEST_SKIP() << "sampling is not supported on this platform";
+		}
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	virtual void TearDown()
+	{
+		stack_sampler::instance().stop();
+
+		clox::logging::logger::instance().clear_error();
+	}
+};
+
+TEST_F(StackSamplerTest, FoldedStacksTest)
+{
+	ASSERT_TRUE(stack_sampler::instance().start(1000));
+
+	{
+		test_scaffold_console cons{};
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+		// long enough in CPU time for a few samples at 1000Hz
+		ASSERT_EQ(clox::driver::run_code(cons, adapter, R"(
+fun busy(n:integer):integer {
+    var sum=0;
+    var i=0;
+    while (i < n) {
+        sum=sum + i * 3;
+        i=i + 1;
+    }
+    return sum;
+}
+
+print busy(3000000);
+)"), 0);
+	}
+
+	stack_sampler::instance().stop();
+	ASSERT_GT(stack_sampler::instance().samples(), 0);
+
+	stringstream ss{};
+	stack_sampler::instance().write_folded(ss);
+
+	const regex line_pattern{ R"(^(.+) ([0-9]+)$)" };
+
+	bool busy{ false };
+	for (string line{}; getline(ss, line);)
+	{
+		smatch m{};
+		ASSERT_TRUE(regex_match(line, m, line_pattern)) << line;
+		ASSERT_GT(stoull(m[2]), 0) << line;
+
+		busy |= m[1].str().find("busy") != string::npos;
+	}
+
+	ASSERT_TRUE(busy) << ss.str();
+}
@@ -0,0 +1,329 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_json.h>
+
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+using namespace std;
+
+const test_json::value* test_json::value::find(string_view key) const
+{
+	if (!holds_alternative<object_type>(data))
+	{
+		return nullptr;
+	}
+
+	for (const auto& [name, member]: get<object_type>(data))
+	{
+		if (name == key)
+		{
+			return &member;
+		}
+	}
+
+	return nullptr;
+}
+
+const test_json::value& test_json::value::operator[](string_view key) const
+{
+	auto ret = find(key);
+	if (!ret)
+	{
+		throw out_of_range{ std::string{ key } + " is missing" };
+	}
+
+	return *ret;
+}
+
+optional<test_json::value> test_json::parse(string_view text)
+{
+	test_json reader{ text };
+
+	auto ret = reader.parse_value();
+	reader.skip_whitespace();
+
+	if (!ret || reader.pos_ != text.size())
+	{
+		return nullopt;
+	}
+
+	return ret;
+}
+
+optional<test_json::value> test_json::parse_value()
+{
+	static constexpr size_t MAX_DEPTH = 256;
+
+	skip_whitespace();
+	if (pos_ >= text_.size() || depth_ > MAX_DEPTH)
+	{
+		return nullopt;
+	}
+
+	switch (text_[pos_])
+	{
+	case '{':
+	{
+		pos_++;
+		depth_++;
+
+		object_type members{};
+		skip_whitespace();
+		if (consume("}"))
+		{
+			depth_--;
+			return value{ std::move(members) };
+		}
+
+		do
+		{
+			skip_whitespace();
+			auto key = parse_string();
+			skip_whitespace();
+			if (!key || !consume(":"))
+			{
+				return nullopt;
+			}
+
+			auto member = parse_value();
+			if (!member)
+			{
+				return nullopt;
+			}
+
+			members.emplace_back(std::move(*key), std::move(*member));
+			skip_whitespace();
+		} while (consume(","));
+
+		if (!consume("}"))
+		{
+			return nullopt;
+		}
+
+		depth_--;
+		return value{ std::move(members) };
+	}
+	case '[':
+	{
+		pos_++;
+		depth_++;
+
+		array_type elements{};
+		skip_whitespace();
+		if (consume("]"))
+		{
+			depth_--;
+			return value{ std::move(elements) };
+		}
+
+		do
+		{
+			auto element = parse_value();
+			if (!element)
+			{
+				return nullopt;
+			}
+
+			elements.push_back(std::move(*element));
+			skip_whitespace();
+		} while (consume(","));
+
+		if (!consume("]"))
+		{
+			return nullopt;
+		}
+
+		depth_--;
+		return value{ std::move(elements) };
+	}
+	case '"':
+	{
+		auto str = parse_string();
+		if (!str)
+		{
+			return nullopt;
+		}
+		return value{ std::move(*str) };
+	}
+	case 't':
+		return consume("true") ? optional<value>{ value{ true } } : nullopt;
+	case 'f':
+		return consume("false") ? optional<value>{ value{ false } } : nullopt;
+	case 'n':
+		return consume("null") ? optional<value>{ value{ nullptr } } : nullopt;
+	default:
+		return parse_number();
+	}
+}
+
+optional<string> test_json::parse_string()
+{
+	if (!consume("\""))
+	{
+		return nullopt;
+	}
+
+	string ret{};
+	while (pos_ < text_.size())
+	{
+		auto c = text_[pos_++];
+		if (c == '"')
+		{
+			return ret;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			return nullopt; // control characters must be escaped
+		}
+		else if (c != '\\')
+		{
+			ret += c;
+			continue;
+		}
+
+		if (pos_ >= text_.size())
+		{
+			return nullopt;
+		}
+
+		switch (text_[pos_++])
+		{
+		case '"':
+			ret += '"';
+			break;
+		case '\\':
+			ret += '\\';
+			break;
+		case '/':
+			ret += '/';
+			break;
+		case 'b':
+			ret += '\b';
+			break;
+		case 'f':
+			ret += '\f';
+			break;
+		case 'n':
+			ret += '\n';
+			break;
+		case 'r':
+			ret += '\r';
+			break;
+		case 't':
+			ret += '\t';
+			break;
+		case 'u':
+		{
+			// code points are only checked, for no test compares text beyond ASCII
+			unsigned code{ 0 };
+			if (pos_ + 4 > text_.size() ||
+				from_chars(text_.data() + pos_, text_.data() + pos_ + 4, code, 16).ptr != text_.data() + pos_ + 4)
+			{
+				return nullopt;
+			}
+			pos_ += 4;
+			ret += code < 0x80 ? static_cast<char>(code) : '?';
+			break;
+		}
+		default:
+			return nullopt;
+		}
+	}
+
+	return nullopt;
+}
+
+optional<test_json::value> test_json::parse_number()
+{
+	auto start = pos_;
+
+	consume("-");
+	if (pos_ >= text_.size() || !isdigit(static_cast<unsigned char>(text_[pos_])))
+	{
+		return nullopt;
+	}
+
+	// no leading zeros
+	if (text_[pos_] == '0' && pos_ + 1 < text_.size() && isdigit(static_cast<unsigned char>(text_[pos_ + 1])))
+	{
+		return nullopt;
+	}
+
+	auto digits = [this]
+	{
+		auto begin = pos_;
+		while (pos_ < text_.size() && isdigit(static_cast<unsigned char>(text_[pos_])))
+		{
+			pos_++;
+		}
+		return pos_ != begin;
+	};
+
+	digits();
+
+	if (consume(".") && !digits())
+	{
+		return nullopt;
+	}
+
+	if (consume("e") || consume("E"))
+	{
+		if (!consume("+"))
+		{
+			consume("-");
+		}
+
+		if (!digits())
+		{
+			return nullopt;
+		}
+	}
+
+	return value{ stod(string{ text_.substr(start, pos_ - start) }) };
+}
+
+bool test_json::consume(string_view word)
+{
+	if (text_.substr(pos_, word.size()) != word)
+	{
+		return false;
+	}
+
+	pos_ += word.size();
+	return true;
+}
+
+void test_json::skip_whitespace()
+{
+	while (pos_ < text_.size() &&
+		   (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r'))
+	{
+		pos_++;
+	}
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_program_comparison.h>
+#include <test_scaffold_console.h>
+
+#include <base/configuration.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+
+test_program_comparison::result test_program_comparison::run(const string& code)
+{
+	clox::base::configurable_configuration_instance().set_show_tiering(true);
+
+	clox::logging::logger::instance().clear_error();
+
+	test_scaffold_console cons{};
+	auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+	int ret = clox::driver::run_code(cons, adapter, code);
+
+	size_t compiled{ 0 };
+	auto log = cons.get_log_text();
+	for (auto pos = log.find(COMPILED_LOG); pos != string::npos; pos = log.find(COMPILED_LOG, pos + 1))
+	{
+		compiled++;
+	}
+
+	return { ret, cons.get_written_text(), cons.get_error_text(), compiled };
+}
+
+size_t test_program_comparison::compare(const function<void()>& configure_compiled)
+{
+	size_t compiled{ 0 };
+
+	for (const auto& entry: filesystem::directory_iterator{ LOX_SRC_DIR })
+	{
+		if (entry.path().extension() != ".lox")
+		{
+			continue;
+		}
+
+		SCOPED_TRACE(entry.path().string());
+
+		ifstream file{ entry.path() };
+		stringstream ss{};
+		ss << file.rdbuf();
+
+		auto code = ss.str();
+		if (code.find("clock(") != string::npos)
+		{
+			continue; // different every run
+		}
+
+		clox::base::configurable_configuration_instance().set_jit(false);
+		clox::base::configurable_configuration_instance().set_aot(false);
+		auto interpreted = run(code);
+
+		configure_compiled();
+		auto native = run(code);
+
+		EXPECT_EQ(native.ret, interpreted.ret);
+		EXPECT_EQ(native.out, interpreted.out);
+		EXPECT_EQ(native.error, interpreted.error);
+
+		compiled += native.compiled;
+	}
+
+	return compiled;
+}
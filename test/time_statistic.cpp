@@ -0,0 +1,129 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+#include <test_json.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <helper/time_statistic.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+using namespace clox::helper;
+
+class TimeStatisticTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+
+		time_statistic::instance().clear();
+		time_statistic::instance().enable(true);
+	}
+
+	virtual void TearDown()
+	{
+		time_statistic::instance().enable(false);
+		time_statistic::instance().clear();
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	static void run(const string& code)
+	{
+		test_scaffold_console cons{};
+
+		// objects are counted when the heap of the adapter is gone
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+		ASSERT_EQ(clox::driver::run_code(cons, adapter, code), 0);
+	}
+};
+
+TEST_F(TimeStatisticTest, JsonTest)
+{
+	run(R"(
+var greeting="hello";
+for (var i=0; i < 10; i=i + 1) {
+    greeting=greeting + "!";
+}
+print greeting;
+)");
+
+	stringstream ss{};
+	time_statistic::instance().print_json(ss);
+
+	auto json = test_json::parse(ss.str());
+	ASSERT_TRUE(json.has_value()) << ss.str();
+
+	const auto& phases = (*json)["phases"];
+	for (auto phase: { "scanning", "parsing", "resolving", "optimizing", "codegen", "execution", "gc" })
+	{
+		SCOPED_TRACE(phase);
+		ASSERT_TRUE(phases.contains(phase));
+		ASSERT_GE(phases[phase]["milliseconds"].number(), 0);
+	}
+
+	ASSERT_EQ(phases["scanning"]["times"].number(), 1);
+	ASSERT_EQ(phases["execution"]["times"].number(), 1);
+
+	const auto& counters = (*json)["counters"];
+	ASSERT_GT(counters["tokens"].number(), 0);
+	ASSERT_GT(counters["ast_nodes"].number(), 0);
+	ASSERT_GT(counters["bytecode_bytes"].number(), 0);
+	ASSERT_GE(counters["objects"].number(), 10); // a string for every iteration
+	ASSERT_GT(counters["object_bytes"].number(), 0);
+
+	// counted only with --count-instructions
+	ASSERT_EQ(counters["instructions"].number(), 0);
+}
+
+TEST_F(TimeStatisticTest, DisabledTest)
+{
+	time_statistic::instance().enable(false);
+
+	run("print 1+2;");
+
+	stringstream ss{};
+	time_statistic::instance().print_json(ss);
+
+	auto json = test_json::parse(ss.str());
+	ASSERT_TRUE(json.has_value()) << ss.str();
+	ASSERT_EQ((*json)["phases"]["execution"]["times"].number(), 0);
+	ASSERT_EQ((*json)["counters"]["tokens"].number(), 0);
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2022 SmartPolarBear
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+
+//
+// Created by cleve on 5/22/2022.
+//
+
+#include <test_scaffold_console.h>
+#include <test_json.h>
+
+#include <driver/run.h>
+#include <driver/adapter/vm.h>
+
+#include <helper/trace_recorder.h>
+
+#include <logger/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+using namespace clox::helper;
+
+class TraceRecorderTest : public ::testing::Test
+{
+
+protected:
+
+	virtual void SetUp()
+	{
+		clox::logging::logger::instance().clear_error();
+		path_ = (filesystem::temp_directory_path() / std::format("clox_trace_{}.json", random_device{}())).string();
+	}
+
+	virtual void TearDown()
+	{
+		trace_recorder::instance().stop();
+
+		error_code ec{};
+		filesystem::remove(path_, ec);
+
+		clox::logging::logger::instance().clear_error();
+	}
+
+	string path_{};
+};
+
+TEST_F(TraceRecorderTest, PhaseEventsTest)
+{
+	ASSERT_TRUE(trace_recorder::instance().start(path_, chrono::microseconds{ 0 }));
+
+	{
+		test_scaffold_console cons{};
+		auto adapter = make_shared<clox::driver::vm_interpreter_adapter>(cons);
+
+		ASSERT_EQ(clox::driver::run_code(cons, adapter, R"(
+fun twice(s:string):string {
+    return s + s;
+}
+
+print twice("ab");
+print clock() >= 0;
+)"), 0);
+	}
+
+	trace_recorder::instance().stop();
+
+	ifstream file{ path_ };
+	stringstream ss{};
+	ss << file.rdbuf();
+
+	auto json = test_json::parse(ss.str());
+	ASSERT_TRUE(json.has_value()) << ss.str();
+
+	set<string> phases{};
+	for (const auto& event: (*json)["traceEvents"].array())
+	{
+		ASSERT_EQ(event["ph"].string(), "X");
+		ASSERT_GE(event["dur"].number(), 0);
+		ASSERT_GE(event["ts"].number(), 0);
+		ASSERT_TRUE(event.contains("pid"));
+		ASSERT_TRUE(event.contains("tid"));
+
+		if (event["cat"].string() == "phase")
+		{
+			phases.insert(event["name"].string());
+		}
+	}
+
+	for (auto phase: { "scanning", "parsing", "resolving", "codegen", "execution" })
+	{
+		ASSERT_TRUE(phases.contains(phase)) << phase;
+	}
+}